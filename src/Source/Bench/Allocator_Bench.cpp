@@ -0,0 +1,64 @@
+#include "HE_Bench.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "ChunkArena.h"
+#include "HE_Allocator.h"
+
+using namespace HE;
+
+// Allocations in batches, freed in reverse order, as a Model growing then shrinking its chunks would
+// The argument is the size of the allocations, in bytes, for the heap allocators
+
+namespace
+{
+	constexpr size_t BatchSize = 64;
+
+	std::vector<std::int64_t> Sizes()
+	{
+		return{ 64, 1024, 16 * 1024 };
+	}
+
+	template<class Allocate, class Deallocate>
+	void RunBatches(Bench::State& state, Allocate allocate, Deallocate deallocate)
+	{
+		std::vector<Blk> cBlocks;
+		cBlocks.reserve(BatchSize);
+		while (state.KeepRunning())
+		{
+			for (size_t i = 0; i < BatchSize; ++i)
+			{
+				cBlocks.push_back(allocate());
+			}
+			while (!cBlocks.empty())
+			{
+				deallocate(cBlocks.back());
+				cBlocks.pop_back();
+			}
+		}
+		state.SetItemsProcessed(state.GetIterations() * BatchSize);
+	}
+}
+
+HE_BENCHMARK_ARGS(Allocator_Malloc, Sizes())
+{
+	auto const nSize = static_cast<size_t>(state.GetArg());
+	RunBatches(state, [nSize]() { return MallocAllocator::it.allocate(nSize); }, [](Blk b) { MallocAllocator::it.deallocate(b); });
+}
+
+HE_BENCHMARK_ARGS(Allocator_AlignedMalloc, Sizes())
+{
+	auto const nSize = static_cast<size_t>(state.GetArg());
+	RunBatches(state, [nSize]() { return AlignedMallocAllocator::it.allocate(nSize, Chunk::ColumnAlignment); },
+		[](Blk b) { AlignedMallocAllocator::it.deallocate(b); });
+}
+
+// Chunks from the slabs of an arena, against Allocator_AlignedMalloc/16384 for the chunks from the heap
+HE_BENCHMARK(Allocator_ChunkArena)
+{
+	ChunkArena arena;
+	RunBatches(state, [&arena]() { return Blk{ arena.Allocate(), Chunk::Size }; },
+		[&arena](Blk b) { arena.Free(static_cast<unsigned char*>(b.ptr)); });
+	state.SetCounter("reserved_KiB", arena.GetReservedBytes() / 1024.0);
+}
@@ -0,0 +1,258 @@
+#include "HE_Bench.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "HE_ConcurrentQueue.h"
+
+using namespace HE;
+
+// Throughput: the argument is the number of producer threads, and of consumer threads for the MPMC queues
+// Items per second count the items that went through the queue, thread startup included
+// Latency: one item bounces between two threads, and the time is per round trip
+
+namespace
+{
+	constexpr size_t ItemCount = 1 << 18;
+	constexpr size_t Capacity = 1024;
+	constexpr size_t BatchSize = 32;
+
+	struct Item : MpscQueueNode
+	{
+		std::uint64_t nValue;
+	};
+
+	// Baseline: what the queues replace
+	class MutexQueue
+	{
+	public:
+		bool TryPush(std::uint64_t n)
+		{
+			std::lock_guard<std::mutex> lock{ m_mutItems };
+			m_cItems.push_back(n);
+			return true;
+		}
+
+		bool TryPop(std::uint64_t& n)
+		{
+			std::lock_guard<std::mutex> lock{ m_mutItems };
+			if (m_cItems.empty()) return false;
+			n = m_cItems.front();
+			m_cItems.pop_front();
+			return true;
+		}
+
+	private:
+		std::mutex m_mutItems;
+		std::deque<std::uint64_t> m_cItems;
+	};
+
+	// Form: Transfer(nProducers, nConsumers, push(nProducer, nItem) -> bool, pop(sum&) -> count)
+	// Pushes ItemCount items over the producers, and pops them over the consumers
+	template<class Push, class Pop>
+	void Transfer(size_t nProducers, size_t nConsumers, Push push, Pop pop)
+	{
+		std::atomic<size_t> nPopped{ 0 };
+		std::vector<std::thread> cThreads;
+		for (size_t p = 0; p < nProducers; ++p)
+		{
+			cThreads.emplace_back([&push, p, nProducers]() {
+				for (size_t i = p; i < ItemCount; )
+				{
+					if (push(p, i)) i += nProducers;
+					else std::this_thread::yield();
+				}
+			});
+		}
+		for (size_t c = 0; c < nConsumers; ++c)
+		{
+			cThreads.emplace_back([&pop, &nPopped]() {
+				std::uint64_t nSum = 0;
+				while (nPopped.load(std::memory_order_relaxed) < ItemCount)
+				{
+					auto const nCount = pop(nSum);
+					if (nCount == 0) std::this_thread::yield();
+					else nPopped.fetch_add(nCount, std::memory_order_relaxed);
+				}
+				Bench::DoNotOptimize(nSum);
+			});
+		}
+		for (auto& thread : cThreads) thread.join();
+	}
+}
+
+HE_BENCHMARK(ConcurrentQueue_Spsc)
+{
+	SpscQueue<std::uint64_t> queue{ Capacity };
+	while (state.KeepRunning())
+	{
+		Transfer(1, 1,
+			[&queue](size_t, std::uint64_t n) { return queue.TryPush(n); },
+			[&queue](std::uint64_t& nSum) {
+				std::uint64_t n;
+				if (!queue.TryPop(n)) return size_t{ 0 };
+				nSum += n;
+				return size_t{ 1 };
+			});
+	}
+	state.SetItemsProcessed(state.GetIterations() * ItemCount);
+}
+
+HE_BENCHMARK(ConcurrentQueue_SpscBatch)
+{
+	SpscQueue<std::uint64_t> queue{ Capacity };
+	while (state.KeepRunning())
+	{
+		// Both sides go by batches
+		std::thread consumer{ [&queue]() {
+			std::uint64_t aBatch[BatchSize];
+			std::uint64_t nSum = 0;
+			size_t nCount = 0;
+			while (nCount < ItemCount)
+			{
+				auto const nBatch = queue.TryPopBatch(aBatch, BatchSize);
+				for (size_t i = 0; i < nBatch; ++i) nSum += aBatch[i];
+				nCount += nBatch;
+				if (nBatch == 0) std::this_thread::yield();
+			}
+			Bench::DoNotOptimize(nSum);
+		} };
+
+		std::uint64_t aBatch[BatchSize];
+		for (size_t i = 0; i < ItemCount; )
+		{
+			size_t nBatch = 0;
+			while (nBatch < BatchSize && i + nBatch < ItemCount)
+			{
+				aBatch[nBatch] = i + nBatch;
+				++nBatch;
+			}
+			auto const nPushed = queue.TryPushBatch(aBatch, nBatch);
+			if (nPushed == 0) std::this_thread::yield();
+			i += nPushed;
+		}
+		consumer.join();
+	}
+	state.SetItemsProcessed(state.GetIterations() * ItemCount);
+}
+
+HE_BENCHMARK_ARGS(ConcurrentQueue_Mpmc, Bench::ThreadCounts())
+{
+	auto const nThreads = static_cast<size_t>(state.GetArg());
+	MpmcQueue<std::uint64_t> queue{ Capacity };
+	while (state.KeepRunning())
+	{
+		Transfer(nThreads, nThreads,
+			[&queue](size_t, std::uint64_t n) { return queue.TryPush(std::uint64_t{ n }); },
+			[&queue](std::uint64_t& nSum) {
+				std::uint64_t n;
+				if (!queue.TryPop(n)) return size_t{ 0 };
+				nSum += n;
+				return size_t{ 1 };
+			});
+	}
+	state.SetItemsProcessed(state.GetIterations() * ItemCount);
+}
+
+HE_BENCHMARK_ARGS(ConcurrentQueue_MpmcBatch, Bench::ThreadCounts())
+{
+	auto const nThreads = static_cast<size_t>(state.GetArg());
+	MpmcQueue<std::uint64_t> queue{ Capacity };
+	while (state.KeepRunning())
+	{
+		// Producers push one at a time, consumers pop in batches, as workers draining a shared queue would
+		Transfer(nThreads, nThreads,
+			[&queue](size_t, std::uint64_t n) { return queue.TryPush(std::uint64_t{ n }); },
+			[&queue](std::uint64_t& nSum) {
+				std::uint64_t aBatch[BatchSize];
+				auto const nCount = queue.TryPopBatch(aBatch, BatchSize);
+				for (size_t i = 0; i < nCount; ++i) nSum += aBatch[i];
+				return nCount;
+			});
+	}
+	state.SetItemsProcessed(state.GetIterations() * ItemCount);
+}
+
+HE_BENCHMARK_ARGS(ConcurrentQueue_Mpsc, Bench::ThreadCounts())
+{
+	auto const nProducers = static_cast<size_t>(state.GetArg());
+	std::vector<Item> cItems(ItemCount);
+	MpscQueue<Item> queue;
+	while (state.KeepRunning())
+	{
+		Transfer(nProducers, 1,
+			[&queue, &cItems](size_t, std::uint64_t n) {
+				cItems[n].nValue = n;
+				queue.Push(&cItems[n]);
+				return true;
+			},
+			[&queue](std::uint64_t& nSum) {
+				Item* apBatch[BatchSize];
+				auto const nCount = queue.PopBatch(apBatch, BatchSize);
+				for (size_t i = 0; i < nCount; ++i) nSum += apBatch[i]->nValue;
+				return nCount;
+			});
+	}
+	state.SetItemsProcessed(state.GetIterations() * ItemCount);
+}
+
+HE_BENCHMARK_ARGS(ConcurrentQueue_MutexBaseline, Bench::ThreadCounts())
+{
+	auto const nThreads = static_cast<size_t>(state.GetArg());
+	MutexQueue queue;
+	while (state.KeepRunning())
+	{
+		Transfer(nThreads, nThreads,
+			[&queue](size_t, std::uint64_t n) { return queue.TryPush(n); },
+			[&queue](std::uint64_t& nSum) {
+				std::uint64_t n;
+				if (!queue.TryPop(n)) return size_t{ 0 };
+				nSum += n;
+				return size_t{ 1 };
+			});
+	}
+	state.SetItemsProcessed(state.GetIterations() * ItemCount);
+}
+
+namespace
+{
+	// One round trip per iteration, between this thread and an echo thread
+	template<class Queue>
+	void RoundTrip(Bench::State& state)
+	{
+		Queue ping{ Capacity };
+		Queue pong{ Capacity };
+		std::atomic<bool> bDone{ false };
+		std::thread echo{ [&]() {
+			std::uint64_t n;
+			while (!bDone.load(std::memory_order_relaxed))
+			{
+				if (ping.TryPop(n)) pong.TryPush(std::uint64_t{ n });
+				else std::this_thread::yield();
+			}
+		} };
+
+		std::uint64_t n = 0;
+		while (state.KeepRunning())
+		{
+			ping.TryPush(std::uint64_t{ n });
+			while (!pong.TryPop(n)) std::this_thread::yield();
+		}
+		bDone = true;
+		echo.join();
+	}
+}
+
+HE_BENCHMARK(ConcurrentQueue_SpscLatency)
+{
+	RoundTrip<SpscQueue<std::uint64_t>>(state);
+}
+
+HE_BENCHMARK(ConcurrentQueue_MpmcLatency)
+{
+	RoundTrip<MpmcQueue<std::uint64_t>>(state);
+}
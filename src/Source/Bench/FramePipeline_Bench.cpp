@@ -0,0 +1,52 @@
+#include "HE_Bench.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "FramePipeline.h"
+#include "HE_JobSystem.h"
+
+using namespace HE;
+
+// Frames through five stages of uneven cost, as simulate, extract, cull, record and submit would be
+// The argument is the depth of the pipeline: with enough threads, the time per frame goes from the sum
+// of the stages at depth 1 towards the slowest stage
+
+namespace
+{
+	// Relative costs of the stages: the slowest is the simulation
+	constexpr int StageCosts[] = { 4, 1, 2, 3, 1 };
+
+	void Work(int nUnits)
+	{
+		auto f = 1.0f;
+		for (int i = 0; i < nUnits * 20000; ++i)
+		{
+			f = std::sqrt(f * 1.0001f + 0.5f);
+		}
+		Bench::DoNotOptimize(f);
+	}
+
+	std::vector<std::int64_t> Depths()
+	{
+		return{ 1, 2, 3 };
+	}
+}
+
+HE_BENCHMARK_ARGS(FramePipeline_Depth, Depths())
+{
+	JobSystem jobSystem;
+	FramePipeline pipeline{ jobSystem, static_cast<size_t>(state.GetArg()) };
+	for (auto const nCost : StageCosts)
+	{
+		pipeline.AddStage("Stage", [nCost](const PipelineFrame&) { Work(nCost); });
+	}
+
+	while (state.KeepRunning())
+	{
+		pipeline.StartFrame();
+	}
+	pipeline.Flush();
+	state.SetItemsProcessed(state.GetIterations());
+}
@@ -0,0 +1,348 @@
+#include "HE_Bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <thread>
+
+#include "HE_String.h"
+
+namespace HE
+{
+	namespace Bench
+	{
+		namespace
+		{
+			std::vector<Benchmark>& GetRegistry()
+			{
+				// Function-local, since registrars run during static initialization
+				static std::vector<Benchmark> s_cBenchmarks;
+				return s_cBenchmarks;
+			}
+
+			struct Result
+			{
+				std::string sName;
+				std::int64_t nArg;
+				bool bHasArg;
+				std::uint64_t nIterations;
+				double fNsPerIteration;
+				double fItemsPerSecond;
+				std::vector<State::Counter> cCounters;
+				std::string sSkipReason;
+			};
+
+			State RunOnce(const Benchmark& benchmark, std::int64_t nArg, std::uint64_t nIterations)
+			{
+				State state{ nArg, nIterations };
+				benchmark.pFunction(state);
+				return state;
+			}
+
+			Result Measure(const Benchmark& benchmark, std::int64_t nArg, bool bHasArg, const Options& options)
+			{
+				Result result{ benchmark.psName, nArg, bHasArg, 0, 0.0, 0.0, {}, {} };
+
+				// Grows the iteration count until a run lasts at least the minimum time
+				std::uint64_t nIterations = 1;
+				while (true)
+				{
+					auto const state = RunOnce(benchmark, nArg, nIterations);
+					if (!state.GetSkipReason().empty())
+					{
+						result.sSkipReason = state.GetSkipReason();
+						return result;
+					}
+
+					auto const tElapsed = state.GetElapsed();
+					if (tElapsed >= options.tMinTime || nIterations >= (1ull << 40)) break;
+
+					// Aim a bit past the minimum, so that the next run is likely the last
+					auto const fRatio = tElapsed.count() > 0 ? 1.4 * std::chrono::nanoseconds{ options.tMinTime }.count() / tElapsed.count() : 100.0;
+					nIterations = static_cast<std::uint64_t>(nIterations * std::min(std::max(fRatio, 2.0), 100.0));
+				}
+
+				std::vector<State> cRuns;
+				for (unsigned i = 0; i < std::max(options.nRepetitions, 1u); ++i)
+				{
+					cRuns.push_back(RunOnce(benchmark, nArg, nIterations));
+				}
+				std::sort(cRuns.begin(), cRuns.end(), [](const State& a, const State& b) { return a.GetElapsed() < b.GetElapsed(); });
+				auto const& median = cRuns[cRuns.size() / 2];
+
+				auto const fSeconds = std::chrono::duration<double>(median.GetElapsed()).count();
+				result.nIterations = nIterations;
+				result.fNsPerIteration = median.GetElapsed().count() / static_cast<double>(nIterations);
+				result.fItemsPerSecond = fSeconds > 0.0 ? median.GetItemsProcessed() / fSeconds : 0.0;
+				result.cCounters = median.GetCounters();
+				return result;
+			}
+
+			std::string GetDisplayName(const Result& result)
+			{
+				return result.bHasArg ? Format("{_}/{_}", result.sName, result.nArg) : result.sName;
+			}
+
+			// Time per iteration by display name
+			using Baseline = std::map<std::string, double>;
+
+			void Print(const Result& result, const Baseline& baseline)
+			{
+				auto const sName = GetDisplayName(result);
+				if (!result.sSkipReason.empty())
+				{
+					std::printf("%-48s skipped: %s\n", sName.c_str(), result.sSkipReason.c_str());
+					return;
+				}
+
+				std::printf("%-48s %16.1f ns %14llu", sName.c_str(), result.fNsPerIteration, static_cast<unsigned long long>(result.nIterations));
+				auto const it = baseline.find(sName);
+				if (it != baseline.end() && it->second > 0.0)
+				{
+					std::printf(" %+7.1f%%", (result.fNsPerIteration / it->second - 1.0) * 100.0);
+				}
+				if (result.fItemsPerSecond > 0.0)
+				{
+					std::printf(" %14.4g items/s", result.fItemsPerSecond);
+				}
+				for (auto const& counter : result.cCounters)
+				{
+					std::printf(" %s=%g", counter.sName.c_str(), counter.fValue);
+				}
+				std::printf("\n");
+				std::fflush(stdout);
+			}
+
+			std::string EscapeJson(const std::string& s)
+			{
+				std::string sEscaped;
+				for (auto const c : s)
+				{
+					if (c == '"' || c == '\\') sEscaped += '\\';
+					sEscaped += c;
+				}
+				return sEscaped;
+			}
+
+#define HE_BENCH_STRINGIZE_IMPL(x) #x
+#define HE_BENCH_STRINGIZE(x) HE_BENCH_STRINGIZE_IMPL(x)
+
+			const char* GetCompiler() noexcept
+			{
+#if defined(_MSC_FULL_VER)
+				return "MSVC " HE_BENCH_STRINGIZE(_MSC_FULL_VER);
+#elif defined(__clang__)
+				return "Clang " __clang_version__;
+#elif defined(__GNUC__)
+				return "GCC " __VERSION__;
+#else
+				return "Unknown";
+#endif
+			}
+
+			std::string GetDate()
+			{
+				auto const tNow = std::time(nullptr);
+				char aDate[32];
+				std::tm tm;
+#if defined(_MSC_VER)
+				gmtime_s(&tm, &tNow);
+#else
+				gmtime_r(&tNow, &tm);
+#endif
+				return std::strftime(aDate, sizeof(aDate), "%Y-%m-%dT%H:%M:%SZ", &tm) != 0 ? aDate : "";
+			}
+
+			bool WriteJson(const std::string& sPath, const std::vector<Result>& cResults)
+			{
+				std::ofstream file{ sPath };
+				if (!file) return false;
+
+				// Enough to tell apart the runs being compared
+				file << "{\n  \"context\": { \"threads\": " << std::thread::hardware_concurrency()
+#if defined(NDEBUG)
+					<< ", \"build\": \"Release\""
+#else
+					<< ", \"build\": \"Debug\""
+#endif
+					<< ", \"compiler\": \"" << EscapeJson(GetCompiler()) << "\", \"date\": \"" << GetDate() << "\" },\n  \"benchmarks\": [\n";
+				for (size_t i = 0; i < cResults.size(); ++i)
+				{
+					auto const& result = cResults[i];
+					file << "    { \"name\": \"" << EscapeJson(GetDisplayName(result)) << "\"";
+					if (result.bHasArg) file << ", \"arg\": " << result.nArg;
+					if (!result.sSkipReason.empty())
+					{
+						file << ", \"skipped\": \"" << EscapeJson(result.sSkipReason) << "\"";
+					}
+					else
+					{
+						file << ", \"iterations\": " << result.nIterations
+							<< ", \"ns_per_iteration\": " << Format("{_:.3}", result.fNsPerIteration)
+							<< ", \"items_per_second\": " << Format("{_:.3}", result.fItemsPerSecond);
+						for (auto const& counter : result.cCounters)
+						{
+							file << ", \"" << EscapeJson(counter.sName) << "\": " << Format("{_:.6}", counter.fValue);
+						}
+					}
+					file << " }" << (i + 1 < cResults.size() ? "," : "") << "\n";
+				}
+				file << "  ]\n}\n";
+				return static_cast<bool>(file);
+			}
+
+			// Form: ReadJsonString(sLine, sKey, sValue) -> bFound
+			// Only reads what WriteJson writes: one benchmark per line, with escaped quotes and backslashes
+			bool ReadJsonString(const std::string& sLine, const std::string& sKey, std::string& sValue)
+			{
+				auto n = sLine.find("\"" + sKey + "\": \"");
+				if (n == std::string::npos) return false;
+
+				sValue.clear();
+				for (n += sKey.size() + 5; n < sLine.size() && sLine[n] != '"'; ++n)
+				{
+					if (sLine[n] == '\\' && n + 1 < sLine.size()) ++n;
+					sValue += sLine[n];
+				}
+				return true;
+			}
+
+			bool ReadBaseline(const std::string& sPath, Baseline& baseline)
+			{
+				std::ifstream file{ sPath };
+				if (!file) return false;
+
+				std::string sLine;
+				while (std::getline(file, sLine))
+				{
+					std::string sName;
+					auto const n = sLine.find("\"ns_per_iteration\": ");
+					if (!ReadJsonString(sLine, "name", sName) || n == std::string::npos) continue;
+					baseline[sName] = std::strtod(sLine.c_str() + n + 20, nullptr);
+				}
+				return true;
+			}
+
+			bool ParseOption(const char* psArg, const char* psName, std::string& sValue)
+			{
+				auto const nNameSize = std::strlen(psName);
+				if (std::strncmp(psArg, psName, nNameSize) != 0 || psArg[nNameSize] != '=') return false;
+				sValue = psArg + nNameSize + 1;
+				return true;
+			}
+		}
+
+		void Private::UseAddress(const volatile void*) noexcept
+		{
+
+		}
+
+		Registrar::Registrar(const char* psName, BenchmarkFunction pFunction, std::vector<std::int64_t> cArgs)
+		{
+			GetRegistry().push_back({ psName, pFunction, std::move(cArgs) });
+		}
+
+		const std::vector<Benchmark>& GetBenchmarks()
+		{
+			return GetRegistry();
+		}
+
+		std::vector<std::int64_t> ThreadCounts()
+		{
+			auto const nCores = static_cast<std::int64_t>(std::max(1u, std::thread::hardware_concurrency()));
+			std::vector<std::int64_t> cCounts;
+			for (std::int64_t n = 1; n < nCores; n *= 2)
+			{
+				cCounts.push_back(n);
+			}
+			cCounts.push_back(nCores);
+			return cCounts;
+		}
+
+		std::vector<std::int64_t> Range(std::int64_t nBegin, std::int64_t nEnd, std::int64_t nMultiplier)
+		{
+			std::vector<std::int64_t> cValues;
+			for (auto n = nBegin; n <= nEnd; n *= nMultiplier)
+			{
+				cValues.push_back(n);
+			}
+			return cValues;
+		}
+
+		bool ParseOptions(int argc, const char* const argv[], Options& options)
+		{
+			for (int i = 1; i < argc; ++i)
+			{
+				std::string sValue;
+				if (ParseOption(argv[i], "--filter", sValue))
+				{
+					options.sFilter = sValue;
+				}
+				else if (ParseOption(argv[i], "--min-time-ms", sValue))
+				{
+					options.tMinTime = std::chrono::milliseconds{ std::stoll(sValue) };
+				}
+				else if (ParseOption(argv[i], "--repetitions", sValue))
+				{
+					options.nRepetitions = static_cast<unsigned>(std::stoul(sValue));
+				}
+				else if (ParseOption(argv[i], "--json", sValue))
+				{
+					options.sJsonPath = sValue;
+				}
+				else if (ParseOption(argv[i], "--baseline", sValue))
+				{
+					options.sBaselinePath = sValue;
+				}
+				else
+				{
+					std::cerr << "Unknown argument \"" << argv[i] << "\"\n"
+						"Usage: HazelEngine_Bench [--filter=Name] [--min-time-ms=200] [--repetitions=3] [--json=results.json] "
+						"[--baseline=previous.json]" << std::endl;
+					return false;
+				}
+			}
+			return true;
+		}
+
+		int RunBenchmarks(const Options& options)
+		{
+			Baseline baseline;
+			if (!options.sBaselinePath.empty() && !ReadBaseline(options.sBaselinePath, baseline))
+			{
+				std::cerr << "Could not read the baseline \"" << options.sBaselinePath << "\"" << std::endl;
+				return 1;
+			}
+
+			std::vector<Result> cResults;
+			std::printf("%-48s %19s %14s%s\n", "Benchmark", "Time/iteration", "Iterations", baseline.empty() ? "" : "   Change");
+
+			for (auto const& benchmark : GetBenchmarks())
+			{
+				if (!options.sFilter.empty() && std::strstr(benchmark.psName, options.sFilter.c_str()) == nullptr) continue;
+
+				if (benchmark.cArgs.empty())
+				{
+					cResults.push_back(Measure(benchmark, 0, false, options));
+					Print(cResults.back(), baseline);
+				}
+				for (auto const nArg : benchmark.cArgs)
+				{
+					cResults.push_back(Measure(benchmark, nArg, true, options));
+					Print(cResults.back(), baseline);
+				}
+			}
+
+			if (!options.sJsonPath.empty() && !WriteJson(options.sJsonPath, cResults))
+			{
+				std::cerr << "Could not write the results to \"" << options.sJsonPath << "\"" << std::endl;
+				return 1;
+			}
+			return 0;
+		}
+	}
+}
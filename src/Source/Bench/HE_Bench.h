@@ -0,0 +1,177 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "HE_Platform.h"
+
+#if defined(COMPILER_MSVC)
+#include <intrin.h>
+#endif
+
+// In-house micro-benchmark harness of HazelEngine_Bench
+//
+// A benchmark is a function taking a HE::Bench::State, which times the body of its KeepRunning loop:
+//
+//	HE_BENCHMARK(Format_Int)
+//	{
+//		while (state.KeepRunning())
+//		{
+//			HE::Bench::DoNotOptimize(HE::Format("{_}", 42));
+//		}
+//	}
+//
+// HE_BENCHMARK_ARGS registers one run per argument, read with state.GetArg(), ex: a thread count
+// or an entity count. The harness picks the iteration count so that each run lasts long enough
+// to be measured, repeats it, and reports the median
+namespace HE
+{
+	namespace Bench
+	{
+		class State
+		{
+		public:
+			State(std::int64_t nArg, std::uint64_t nIterations) noexcept
+				: m_nArg(nArg),
+				m_nIterations(nIterations)
+			{
+
+			}
+
+			// True while the benchmark should run one more iteration. Times from the first call to the last
+			bool KeepRunning()
+			{
+				if (m_nDone == 0)
+				{
+					m_tStart = Clock::now();
+				}
+				if (m_nDone == m_nIterations)
+				{
+					m_tElapsed += Clock::now() - m_tStart;
+					return false;
+				}
+				++m_nDone;
+				return true;
+			}
+
+			// Excludes setup from the measured time, ex: rebuilding the data an iteration consumed
+			void PauseTiming() { m_tElapsed += Clock::now() - m_tStart; }
+			void ResumeTiming() { m_tStart = Clock::now(); }
+
+			std::int64_t GetArg() const noexcept { return m_nArg; }
+			std::uint64_t GetIterations() const noexcept { return m_nIterations; }
+
+			// Items (ex: entities, jobs, bytes) processed over all the iterations, to report a throughput
+			void SetItemsProcessed(std::uint64_t nItems) noexcept { m_nItems = nItems; }
+			std::uint64_t GetItemsProcessed() const noexcept { return m_nItems; }
+
+			// Skips the run, ex: when the argument does not apply to this machine
+			void Skip(std::string sReason) { m_sSkipReason = std::move(sReason); m_nIterations = 0; }
+			const std::string& GetSkipReason() const noexcept { return m_sSkipReason; }
+
+			// Free-form extra value to report next to the timings, ex: a memory usage
+			void SetCounter(std::string sName, double fValue) { m_cCounters.push_back({ std::move(sName), fValue }); }
+
+			struct Counter
+			{
+				std::string sName;
+				double fValue;
+			};
+			const std::vector<Counter>& GetCounters() const noexcept { return m_cCounters; }
+
+			std::chrono::nanoseconds GetElapsed() const noexcept { return std::chrono::duration_cast<std::chrono::nanoseconds>(m_tElapsed); }
+
+		private:
+			using Clock = std::chrono::steady_clock;
+
+			std::int64_t m_nArg;
+			std::uint64_t m_nIterations;
+			std::uint64_t m_nDone{ 0 };
+			std::uint64_t m_nItems{ 0 };
+			Clock::time_point m_tStart;
+			Clock::duration m_tElapsed{ 0 };
+			std::string m_sSkipReason;
+			std::vector<Counter> m_cCounters;
+		};
+
+		using BenchmarkFunction = void(*)(State&);
+
+		struct Benchmark
+		{
+			const char* psName;
+			BenchmarkFunction pFunction;
+			std::vector<std::int64_t> cArgs;
+		};
+
+		// Called by the registration macros, during static initialization
+		struct Registrar
+		{
+			Registrar(const char* psName, BenchmarkFunction pFunction, std::vector<std::int64_t> cArgs = {});
+		};
+
+		const std::vector<Benchmark>& GetBenchmarks();
+
+		namespace Private
+		{
+			// Out of line, so that the compiler cannot see that the pointer is not read
+			void UseAddress(const volatile void* p) noexcept;
+		}
+
+		// Keeps the compiler from optimizing away the computation of value
+		template<class T>
+		void DoNotOptimize(const T& value)
+		{
+#if defined(COMPILER_MSVC)
+			// No inline assembly on x64: the address escapes to another translation unit, and the barrier keeps the
+			// stores to value before the call
+			Private::UseAddress(&value);
+			_ReadWriteBarrier();
+#else
+			// The value is in memory or a register, read by assembly that may read any memory
+			asm volatile("" : : "g"(&value) : "memory");
+#endif
+		}
+
+		// Thread counts from 1 to the number of cores, doubling, plus the number of cores itself
+		std::vector<std::int64_t> ThreadCounts();
+
+		// Powers of nMultiplier from nBegin to nEnd, inclusive
+		std::vector<std::int64_t> Range(std::int64_t nBegin, std::int64_t nEnd, std::int64_t nMultiplier = 10);
+
+		struct Options
+		{
+			// Only runs the benchmarks with this in their name
+			std::string sFilter;
+			// Minimum duration of a measured run
+			std::chrono::milliseconds tMinTime{ 200 };
+			// Measured runs per benchmark and argument. The median is reported
+			unsigned nRepetitions{ 3 };
+			// Also writes the results as JSON to this file
+			std::string sJsonPath;
+			// Results written by an earlier run with sJsonPath, ex: of another build. Each result is printed with
+			// its change of time per iteration from the baseline
+			std::string sBaselinePath;
+		};
+
+		// Parses "--filter=", "--min-time-ms=", "--repetitions=", "--json=" and "--baseline=". Returns false on an
+		// unknown argument
+		bool ParseOptions(int argc, const char* const argv[], Options& options);
+
+		// Prints a table of the results to stdout. Returns the process exit code
+		int RunBenchmarks(const Options& options);
+	}
+}
+
+#define HE_BENCHMARK_IMPL(Name, ...)														\
+	static void Name(HE::Bench::State& state);											\
+	static HE::Bench::Registrar s_benchmarkRegistrar##Name{ #Name, &Name, __VA_ARGS__ };	\
+	static void Name(HE::Bench::State& state)
+
+// Form: HE_BENCHMARK(Name) { body using state }
+#define HE_BENCHMARK(Name) HE_BENCHMARK_IMPL(Name, {})
+
+// Form: HE_BENCHMARK_ARGS(Name, cArgs) { body using state.GetArg() }
+// cArgs is a braced list or an expression giving a std::vector<std::int64_t>, ex: HE::Bench::ThreadCounts()
+#define HE_BENCHMARK_ARGS(Name, ...) HE_BENCHMARK_IMPL(Name, __VA_ARGS__)
@@ -0,0 +1,93 @@
+#include "HE_Bench.h"
+
+#include <cmath>
+#include <vector>
+
+#include "HE_JobSystem.h"
+
+using namespace HE;
+
+// Scaling benchmarks: the argument is the number of threads running jobs, the waiting thread included
+
+namespace
+{
+	std::uint64_t Fibonacci(JobSystem& jobSystem, unsigned n)
+	{
+		if (n < 16)
+		{
+			return n < 2 ? n : Fibonacci(jobSystem, n - 1) + Fibonacci(jobSystem, n - 2);
+		}
+
+		std::uint64_t a;
+		JobCounter counter;
+		jobSystem.Run(counter, [&jobSystem, &a, n]() { a = Fibonacci(jobSystem, n - 1); });
+		auto const b = Fibonacci(jobSystem, n - 2);
+		jobSystem.Wait(counter);
+		return a + b;
+	}
+}
+
+// Even data-parallel work, ex: updating components
+HE_BENCHMARK_ARGS(JobSystem_ParallelFor, Bench::ThreadCounts())
+{
+	JobSystem jobSystem{ static_cast<size_t>(state.GetArg() - 1) };
+
+	constexpr size_t Count = 1 << 20;
+	std::vector<float> cValues(Count, 1.0f);
+	while (state.KeepRunning())
+	{
+		jobSystem.ParallelFor(0, Count, [&cValues](size_t i) {
+			cValues[i] = std::sqrt(cValues[i] * 1.0001f + 0.5f);
+		});
+	}
+	Bench::DoNotOptimize(cValues.front());
+	state.SetItemsProcessed(state.GetIterations() * Count);
+}
+
+// Uneven work, balanced by stealing: the cost of an element grows with its index
+HE_BENCHMARK_ARGS(JobSystem_ParallelForUneven, Bench::ThreadCounts())
+{
+	JobSystem jobSystem{ static_cast<size_t>(state.GetArg() - 1) };
+
+	constexpr size_t Count = 1 << 12;
+	std::vector<double> cValues(Count, 0.0);
+	while (state.KeepRunning())
+	{
+		jobSystem.ParallelFor(0, Count, [&cValues](size_t i) {
+			auto f = 0.0;
+			for (size_t j = 0; j < i; ++j) f += std::sqrt(static_cast<double>(j));
+			cValues[i] = f;
+		});
+	}
+	Bench::DoNotOptimize(cValues.back());
+	state.SetItemsProcessed(state.GetIterations() * Count);
+}
+
+// Scheduling overhead: many empty jobs from a single thread
+HE_BENCHMARK_ARGS(JobSystem_EmptyJobs, Bench::ThreadCounts())
+{
+	JobSystem jobSystem{ static_cast<size_t>(state.GetArg() - 1) };
+
+	constexpr size_t Count = 10000;
+	while (state.KeepRunning())
+	{
+		JobCounter counter;
+		for (size_t i = 0; i < Count; ++i)
+		{
+			jobSystem.Run(counter, []() {});
+		}
+		jobSystem.Wait(counter);
+	}
+	state.SetItemsProcessed(state.GetIterations() * Count);
+}
+
+// Nested fork-join, where every job spawns and waits on more jobs
+HE_BENCHMARK_ARGS(JobSystem_NestedForkJoin, Bench::ThreadCounts())
+{
+	JobSystem jobSystem{ static_cast<size_t>(state.GetArg() - 1) };
+
+	while (state.KeepRunning())
+	{
+		Bench::DoNotOptimize(Fibonacci(jobSystem, 30));
+	}
+}
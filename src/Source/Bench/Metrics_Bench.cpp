@@ -0,0 +1,75 @@
+#include "HE_Bench.h"
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "HE_Metrics.h"
+
+using namespace HE;
+
+// Cost of an update from each thread: the argument is the number of threads updating the same metric, each on
+// its own shard. Items per second count the updates of all the threads
+
+namespace
+{
+	constexpr std::uint64_t UpdateCount = 1 << 18;
+
+	template<class F>
+	void UpdateFromThreads(size_t nThreads, F f)
+	{
+		std::vector<std::thread> cThreads;
+		for (size_t t = 0; t < nThreads; ++t)
+		{
+			cThreads.emplace_back([&f]() {
+				for (std::uint64_t i = 0; i < UpdateCount; ++i) f(i);
+			});
+		}
+		for (auto& thread : cThreads) thread.join();
+	}
+}
+
+HE_BENCHMARK_ARGS(Metrics_CounterAdd, Bench::ThreadCounts())
+{
+	auto const nThreads = static_cast<size_t>(state.GetArg());
+	MetricsRegistry metrics;
+	auto& counter = metrics.GetCounter("Counter");
+	while (state.KeepRunning())
+	{
+		UpdateFromThreads(nThreads, [&counter](std::uint64_t) { counter.Add(); });
+	}
+	state.SetItemsProcessed(state.GetIterations() * nThreads * UpdateCount);
+}
+
+HE_BENCHMARK_ARGS(Metrics_HistogramRecord, Bench::ThreadCounts())
+{
+	auto const nThreads = static_cast<size_t>(state.GetArg());
+	MetricsRegistry metrics;
+	auto& histogram = metrics.GetHistogram("Histogram");
+	while (state.KeepRunning())
+	{
+		// Spread over a few buckets, as frame times would be
+		UpdateFromThreads(nThreads, [&histogram](std::uint64_t i) { histogram.Record(16000000 + (i & 0xFFFF) * 64); });
+	}
+	state.SetItemsProcessed(state.GetIterations() * nThreads * UpdateCount);
+}
+
+// What the Engine pays at the end of each frame: merging a frame time and 16 system histograms, each updated
+HE_BENCHMARK(Metrics_Merge)
+{
+	MetricsRegistry metrics;
+	std::vector<Histogram*> cHistograms;
+	for (int i = 0; i < 17; ++i)
+	{
+		cHistograms.push_back(&metrics.GetHistogram("Histogram " + std::to_string(i)));
+	}
+	std::uint64_t n = 0;
+	while (state.KeepRunning())
+	{
+		state.PauseTiming();
+		for (auto const pHistogram : cHistograms) pHistogram->Record(++n);
+		state.ResumeTiming();
+		metrics.Merge();
+	}
+}
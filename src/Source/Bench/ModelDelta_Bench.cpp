@@ -0,0 +1,120 @@
+#include "HE_Bench.h"
+
+#include <sstream>
+#include <vector>
+
+#include "Model.h"
+#include "ModelDelta.h"
+
+using namespace HE;
+
+// Deltas of 100k entities against the percentage of them written to between two deltas, given as the argument.
+// The cost of a delta should follow the changes, not the size of the Model
+
+namespace ModelDeltaBench
+{
+	struct Position
+	{
+		float x, y, z;
+	};
+
+	struct Velocity
+	{
+		float x, y, z;
+	};
+
+	struct Cold
+	{
+		float aValues[16];
+	};
+}
+
+using namespace ModelDeltaBench;
+
+namespace
+{
+	size_t const EntityCount = 100000;
+
+	// Spread over the Model, as a system touching a few entities here and there would
+	void Move(Model& model, const std::vector<EntityHandle>& cEntities, std::int64_t nPercent, float fStep)
+	{
+		if (nPercent == 0) return;
+
+		auto const nStride = static_cast<size_t>(100 / nPercent);
+		for (size_t i = 0; i < cEntities.size(); i += nStride)
+		{
+			model.GetComponent<Position>(cEntities[i])->x += fStep;
+		}
+	}
+
+	std::vector<EntityHandle> MakeScene(Model& model)
+	{
+		std::vector<EntityHandle> cEntities;
+		for (size_t i = 0; i < EntityCount; ++i)
+		{
+			cEntities.push_back(model.CreateEntity(Position{ static_cast<float>(i), 0.0f, 0.0f }, Velocity{}, Cold{}));
+		}
+		return cEntities;
+	}
+
+	std::vector<std::int64_t> Percentages()
+	{
+		return{ 0, 1, 10, 100 };
+	}
+}
+
+HE_BENCHMARK_ARGS(ModelDelta_Encode, Percentages())
+{
+	Model model;
+	auto const cEntities = MakeScene(model);
+	DeltaEncoder encoder;
+	std::stringstream stream;
+	encoder.Encode(model, stream);
+
+	size_t nBytes = 0;
+	float fStep = 1.0f;
+	while (state.KeepRunning())
+	{
+		state.PauseTiming();
+		Move(model, cEntities, state.GetArg(), fStep);
+		fStep = -fStep;
+		stream.str({});
+		state.ResumeTiming();
+
+		encoder.Encode(model, stream);
+		nBytes = static_cast<size_t>(stream.tellp());
+	}
+	state.SetItemsProcessed(state.GetIterations() * EntityCount);
+	state.SetCounter("Bytes", static_cast<double>(nBytes));
+}
+
+HE_BENCHMARK_ARGS(ModelDelta_Apply, Percentages())
+{
+	Model model;
+	auto const cEntities = MakeScene(model);
+	DeltaEncoder encoder;
+	DeltaDecoder decoder;
+	Model replica;
+	{
+		std::stringstream stream;
+		encoder.Encode(model, stream);
+		decoder.Apply(stream, replica);
+	}
+
+	float fStep = 1.0f;
+	std::stringstream stream;
+	while (state.KeepRunning())
+	{
+		state.PauseTiming();
+		Move(model, cEntities, state.GetArg(), fStep);
+		fStep = -fStep;
+		stream.str({});
+		stream.clear();
+		encoder.Encode(model, stream);
+		state.ResumeTiming();
+
+		decoder.Apply(stream, replica);
+	}
+	state.SetItemsProcessed(state.GetIterations() * EntityCount);
+	Bench::DoNotOptimize(replica.GetEntityCount());
+}
@@ -0,0 +1,350 @@
+#include "HE_Bench.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "CommandBuffer.h"
+#include "HE_JobSystem.h"
+#include "Model.h"
+#include "ModelSnapshot.h"
+#include "ModelState.h"
+#include "Query.h"
+#include "Scene.h"
+
+using namespace HE;
+
+// Archetype chunks against the layout the Model had before them: a vector of heap-allocated entities
+// The argument is the number of entities
+
+namespace
+{
+	struct Position
+	{
+		float x, y, z;
+	};
+
+	struct Velocity
+	{
+		float x, y, z;
+	};
+
+	// Data a movement system does not touch, ex: rendering or gameplay state
+	struct Cold
+	{
+		float aValues[16];
+	};
+
+	class LegacyEntity
+	{
+	public:
+		virtual ~LegacyEntity() = default;
+
+		std::uint64_t nGlobalUniqueID;
+		Position position;
+		Velocity velocity;
+		Cold cold;
+	};
+
+	constexpr float Dt = 1.0f / 60.0f;
+
+	std::vector<std::unique_ptr<LegacyEntity>> MakeLegacyEntities(size_t nCount)
+	{
+		std::vector<std::unique_ptr<LegacyEntity>> cEntities;
+		cEntities.reserve(nCount);
+		for (size_t i = 0; i < nCount; ++i)
+		{
+			auto pEntity = std::make_unique<LegacyEntity>();
+			pEntity->nGlobalUniqueID = i + 1;
+			pEntity->position = { 0.0f, 0.0f, 0.0f };
+			pEntity->velocity = { 1.0f, 2.0f, 3.0f };
+			cEntities.push_back(std::move(pEntity));
+		}
+		return cEntities;
+	}
+
+	void MakeEntities(Model& model, size_t nCount)
+	{
+		for (size_t i = 0; i < nCount; ++i)
+		{
+			model.CreateEntity(Position{ 0.0f, 0.0f, 0.0f }, Velocity{ 1.0f, 2.0f, 3.0f }, Cold{});
+		}
+	}
+}
+
+HE_BENCHMARK_ARGS(Model_Integrate_Legacy, Bench::Range(10000, 1000000))
+{
+	auto const nCount = static_cast<size_t>(state.GetArg());
+	auto cEntities = MakeLegacyEntities(nCount);
+
+	while (state.KeepRunning())
+	{
+		for (auto& pEntity : cEntities)
+		{
+			pEntity->position.x += pEntity->velocity.x * Dt;
+			pEntity->position.y += pEntity->velocity.y * Dt;
+			pEntity->position.z += pEntity->velocity.z * Dt;
+		}
+	}
+	Bench::DoNotOptimize(cEntities.front()->position);
+	state.SetItemsProcessed(state.GetIterations() * nCount);
+}
+
+HE_BENCHMARK_ARGS(Model_Integrate_Archetype, Bench::Range(10000, 1000000))
+{
+	auto const nCount = static_cast<size_t>(state.GetArg());
+	Model model;
+	MakeEntities(model, nCount);
+
+	Query<Position, const Velocity> query{ model };
+	while (state.KeepRunning())
+	{
+		query.ForEach([](Position& position, const Velocity& velocity) {
+			position.x += velocity.x * Dt;
+			position.y += velocity.y * Dt;
+			position.z += velocity.z * Dt;
+		});
+	}
+	state.SetItemsProcessed(state.GetIterations() * nCount);
+}
+
+// Same, on the columns of each chunk
+HE_BENCHMARK_ARGS(Model_Integrate_ArchetypeChunks, Bench::Range(10000, 1000000))
+{
+	auto const nCount = static_cast<size_t>(state.GetArg());
+	Model model;
+	MakeEntities(model, nCount);
+
+	Query<Position, const Velocity> query{ model };
+	while (state.KeepRunning())
+	{
+		query.ForEachChunk([](const ChunkView<Position, const Velocity>& view) {
+			auto const pPositions = view.Get<Position>();
+			auto const pVelocities = view.Get<const Velocity>();
+			for (std::uint32_t i = 0; i < view.GetCount(); ++i)
+			{
+				pPositions[i].x += pVelocities[i].x * Dt;
+				pPositions[i].y += pVelocities[i].y * Dt;
+				pPositions[i].z += pVelocities[i].z * Dt;
+			}
+		});
+	}
+	state.SetItemsProcessed(state.GetIterations() * nCount);
+}
+
+// Same, as a system of the Model, on 1M entities. The argument is the number of threads
+HE_BENCHMARK_ARGS(Model_UpdateSystems, Bench::ThreadCounts())
+{
+	constexpr size_t Count = 1000000;
+	JobSystem jobSystem{ static_cast<size_t>(state.GetArg() - 1) };
+	Model model;
+	MakeEntities(model, Count);
+
+	model.GetSystems().AddSystem<Position, const Velocity>("Integrate", [](SystemContext&, const ChunkView<Position, const Velocity>& view) {
+		auto const pPositions = view.Get<Position>();
+		auto const pVelocities = view.Get<const Velocity>();
+		for (std::uint32_t i = 0; i < view.GetCount(); ++i)
+		{
+			pPositions[i].x += pVelocities[i].x * Dt;
+			pPositions[i].y += pVelocities[i].y * Dt;
+			pPositions[i].z += pVelocities[i].z * Dt;
+		}
+	});
+	while (state.KeepRunning())
+	{
+		model.Update(Dt, jobSystem);
+	}
+	state.SetItemsProcessed(state.GetIterations() * Count);
+}
+
+// Destroys and recreates 1% of the entities per iteration, then iterates them all
+HE_BENCHMARK_ARGS(Model_Churn_Legacy, Bench::Range(10000, 1000000))
+{
+	auto const nCount = static_cast<size_t>(state.GetArg());
+	auto cEntities = MakeLegacyEntities(nCount);
+	auto const nChurn = std::max<size_t>(1, nCount / 100);
+	size_t nNext = 0;
+
+	while (state.KeepRunning())
+	{
+		for (size_t i = 0; i < nChurn; ++i)
+		{
+			// Swap with the last then pop, as the old Model did not keep an order either
+			auto& pEntity = cEntities[(nNext += 7919) % cEntities.size()];
+			std::swap(pEntity, cEntities.back());
+			cEntities.pop_back();
+		}
+		for (size_t i = 0; i < nChurn; ++i)
+		{
+			auto pEntity = std::make_unique<LegacyEntity>();
+			pEntity->velocity = { 1.0f, 2.0f, 3.0f };
+			cEntities.push_back(std::move(pEntity));
+		}
+		for (auto& pEntity : cEntities)
+		{
+			pEntity->position.x += pEntity->velocity.x * Dt;
+		}
+	}
+	Bench::DoNotOptimize(cEntities.front()->position);
+	state.SetItemsProcessed(state.GetIterations() * nCount);
+}
+
+HE_BENCHMARK_ARGS(Model_Churn_Archetype, Bench::Range(10000, 1000000))
+{
+	auto const nCount = static_cast<size_t>(state.GetArg());
+	Model model;
+	MakeEntities(model, nCount);
+	size_t nNext = 0;
+
+	Query<Position, const Velocity> query{ model };
+	CommandBuffer commands{ model };
+	while (state.KeepRunning())
+	{
+		size_t nIndex = 0;
+		query.ForEachEntity([&](EntityHandle entity, Position& position, const Velocity& velocity) {
+			if ((nIndex++ + nNext) % 100 == 0)
+			{
+				commands.DestroyEntity(entity);
+				commands.CreateEntity(Position{ 0.0f, 0.0f, 0.0f }, Velocity{ 1.0f, 2.0f, 3.0f }, Cold{});
+			}
+			position.x += velocity.x * Dt;
+		});
+		model.Apply(commands);
+		nNext += 37;
+	}
+	state.SetItemsProcessed(state.GetIterations() * nCount);
+}
+
+// Cross-entity references: reads the position of entities in a shuffled order, as a gameplay system following references would
+HE_BENCHMARK_ARGS(Model_ResolveHandle, Bench::Range(10000, 1000000))
+{
+	auto const nCount = static_cast<size_t>(state.GetArg());
+	Model model;
+	std::vector<EntityHandle> cReferences;
+	for (size_t i = 0; i < nCount; ++i)
+	{
+		cReferences.push_back(model.CreateEntity(Position{ 1.0f, 0.0f, 0.0f }, Velocity{}, Cold{}));
+	}
+	for (size_t i = 0; i < nCount; ++i)
+	{
+		std::swap(cReferences[i], cReferences[(i * 7919) % nCount]);
+	}
+
+	// Reads only, so that the entities are not marked as changed
+	auto const& constModel = model;
+	auto fSum = 0.0f;
+	while (state.KeepRunning())
+	{
+		for (auto const entity : cReferences)
+		{
+			fSum += constModel.GetComponent<Position>(entity)->x;
+		}
+	}
+	Bench::DoNotOptimize(fSum);
+	state.SetItemsProcessed(state.GetIterations() * nCount);
+}
+
+// Same, through the persistent IDs
+HE_BENCHMARK_ARGS(Model_ResolveGlobalUniqueID, Bench::Range(10000, 1000000))
+{
+	auto const nCount = static_cast<size_t>(state.GetArg());
+	Model model;
+	std::vector<std::uint64_t> cReferences;
+	for (size_t i = 0; i < nCount; ++i)
+	{
+		cReferences.push_back(model.GetGlobalUniqueID(model.CreateEntity(Position{ 1.0f, 0.0f, 0.0f }, Velocity{}, Cold{})));
+	}
+	for (size_t i = 0; i < nCount; ++i)
+	{
+		std::swap(cReferences[i], cReferences[(i * 7919) % nCount]);
+	}
+
+	auto fSum = 0.0f;
+	while (state.KeepRunning())
+	{
+		for (auto const nGlobalUniqueID : cReferences)
+		{
+			fSum += model.GetComponent<Position>(model.FindEntity(nGlobalUniqueID))->x;
+		}
+	}
+	Bench::DoNotOptimize(fSum);
+	state.SetItemsProcessed(state.GetIterations() * nCount);
+}
+
+// Snapshot of the positions of 1M entities, for a render thread. The argument is the number of entities
+// changed between two captures, spread over the chunks
+HE_BENCHMARK_ARGS(Model_CaptureSnapshot, Bench::Range(100, 1000000))
+{
+	constexpr size_t Count = 1000000;
+	Model model;
+	std::vector<EntityHandle> cEntities;
+	cEntities.reserve(Count);
+	for (size_t i = 0; i < Count; ++i)
+	{
+		cEntities.push_back(model.CreateEntity(Position{ 0.0f, 0.0f, 0.0f }, Velocity{ 1.0f, 2.0f, 3.0f }, Cold{}));
+	}
+
+	auto const nChanged = static_cast<size_t>(state.GetArg());
+	ModelSnapshot snapshot{ MakeComponentMask<Position>() };
+	snapshot.Capture(model);
+	while (state.KeepRunning())
+	{
+		for (size_t i = 0; i < nChanged; ++i)
+		{
+			model.GetComponent<Position>(cEntities[i * (Count / nChanged)])->x += Dt;
+		}
+		snapshot.Capture(model);
+	}
+	Bench::DoNotOptimize(snapshot.GetEntityCount());
+	state.SetItemsProcessed(state.GetIterations() * Count);
+}
+
+// Rollback every frame on a generated scene, where every mover changes each tick: restores the state saved before
+// the tick, as a rollback of one tick would. The argument is the number of entities
+HE_BENCHMARK_ARGS(Model_RestoreState, Bench::SceneSizes())
+{
+	Bench::SceneSettings settings;
+	settings.nEntities = static_cast<size_t>(state.GetArg());
+	Model model;
+	Bench::GenerateScene(model, settings);
+	JobSystem jobSystem;
+
+	ModelState saved;
+	saved.Save(model);
+	while (state.KeepRunning())
+	{
+		state.PauseTiming();
+		model.Update(1.0 / 60.0, jobSystem);
+		state.ResumeTiming();
+
+		saved.Restore(model);
+	}
+	state.SetItemsProcessed(state.GetIterations() * settings.nEntities);
+	state.SetCounter("MiB", saved.GetChunkMemory() / (1024.0 * 1024.0));
+}
+
+// Saving every frame into a ring of states, then restoring the oldest, as rollback netcode does on a late input
+HE_BENCHMARK_ARGS(Model_SaveRestoreState, Bench::SceneSizes())
+{
+	Bench::SceneSettings settings;
+	settings.nEntities = static_cast<size_t>(state.GetArg());
+	Model model;
+	Bench::GenerateScene(model, settings);
+	JobSystem jobSystem;
+
+	constexpr size_t RingSize = 8;
+	ModelState aStates[RingSize];
+	size_t nFrame = 0;
+	while (state.KeepRunning())
+	{
+		aStates[nFrame % RingSize].Save(model);
+
+		state.PauseTiming();
+		model.Update(1.0 / 60.0, jobSystem);
+		state.ResumeTiming();
+
+		++nFrame;
+		if (nFrame >= RingSize) aStates[(nFrame - RingSize + 1) % RingSize].Restore(model);
+	}
+	state.SetItemsProcessed(state.GetIterations() * settings.nEntities);
+}
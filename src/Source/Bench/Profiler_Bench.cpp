@@ -0,0 +1,35 @@
+#include "HE_Bench.h"
+
+#include "HE_Profiler.h"
+
+using namespace HE;
+
+// Cost of a HE_PROFILE_SCOPE around nothing: two time stamp reads and a push into the ring of the thread.
+// The history drains the ring outside of the measured time, so that no event is dropped
+HE_BENCHMARK(Profiler_Scope)
+{
+	ProfileHistory history{ 1 };
+	std::uint64_t nScopes = 0;
+	while (state.KeepRunning())
+	{
+		{
+			HE_PROFILE_SCOPE("Profiler_Scope");
+		}
+		if (++nScopes % 4096 == 0)
+		{
+			state.PauseTiming();
+			history.EndFrame();
+			state.ResumeTiming();
+		}
+	}
+	state.SetItemsProcessed(nScopes);
+}
+
+// Cost of reading the clock of the profiler alone
+HE_BENCHMARK(Profiler_ReadTicks)
+{
+	while (state.KeepRunning())
+	{
+		Bench::DoNotOptimize(ReadProfileTicks());
+	}
+}
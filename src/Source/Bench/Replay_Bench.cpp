@@ -0,0 +1,112 @@
+#include "HE_Bench.h"
+
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "HE_JobSystem.h"
+#include "Model.h"
+#include "Query.h"
+#include "Replay.h"
+
+using namespace HE;
+
+// A recorded match replayed headless, as fast as the simulation goes: 600 ticks of entities steered by the
+// input of each tick. The argument is the number of entities. The items are the ticks, and the counters the
+// percentiles of the time per tick of the last replay
+
+namespace
+{
+	struct Position
+	{
+		float x, y, z;
+	};
+
+	struct Velocity
+	{
+		float x, y, z;
+	};
+
+	constexpr std::uint32_t RecordedTicks = 600;
+
+	void AddMatch(Model& model, size_t nEntities)
+	{
+		for (size_t i = 0; i < nEntities; ++i)
+		{
+			model.CreateEntity(Position{ static_cast<float>(i), 0.0f, 0.0f }, Velocity{ 1.0f, 0.0f, 0.0f });
+		}
+
+		auto& systems = model.GetSystems();
+		// The input of a tick steers every entity: one signed byte per axis
+		systems.AddSystem<Velocity>("Steer", [](SystemContext& context, const ChunkView<Velocity>& view) {
+			auto const& cInput = context.GetModel().GetInput();
+			if (cInput.size() < 3) return;
+			auto const pVelocities = view.Get<Velocity>();
+			for (size_t i = 0; i < view.GetCount(); ++i)
+			{
+				pVelocities[i].x += static_cast<signed char>(cInput[0]) * 0.01f;
+				pVelocities[i].y += static_cast<signed char>(cInput[1]) * 0.01f;
+				pVelocities[i].z += static_cast<signed char>(cInput[2]) * 0.01f;
+			}
+		});
+		systems.AddSystem<Position, const Velocity>("Move", [](SystemContext& context, const ChunkView<Position, const Velocity>& view) {
+			auto const pPositions = view.Get<Position>();
+			auto const pVelocities = view.Get<const Velocity>();
+			auto const fDt = static_cast<float>(context.GetDt());
+			for (size_t i = 0; i < view.GetCount(); ++i)
+			{
+				pPositions[i].x += pVelocities[i].x * fDt;
+				pPositions[i].y += pVelocities[i].y * fDt;
+				pPositions[i].z += pVelocities[i].z * fDt;
+			}
+		});
+	}
+
+	std::string RecordMatch(size_t nEntities, JobSystem& jobSystem)
+	{
+		Model model;
+		AddMatch(model, nEntities);
+
+		std::ostringstream stream;
+		ReplayRecorder recorder{ stream, model };
+		for (std::uint32_t nTick = 0; nTick < RecordedTicks; ++nTick)
+		{
+			auto const n = static_cast<unsigned char>(nTick * 37);
+			unsigned char const aInput[] = { n, static_cast<unsigned char>(n ^ 0x5A), static_cast<unsigned char>(n >> 1) };
+			model.SetInput(aInput, sizeof(aInput));
+			recorder.Update(model, 1.0 / 60.0, jobSystem);
+		}
+		return stream.str();
+	}
+}
+
+HE_BENCHMARK_ARGS(Replay_Match, Bench::Range(1000, 100000))
+{
+	JobSystem jobSystem;
+	auto const nEntities = static_cast<size_t>(state.GetArg());
+	auto const sRecording = RecordMatch(nEntities, jobSystem);
+
+	ReplayResult result;
+	while (state.KeepRunning())
+	{
+		state.PauseTiming();
+		auto pModel = std::make_unique<Model>();
+		AddMatch(*pModel, nEntities);
+		std::istringstream stream{ sRecording };
+		state.ResumeTiming();
+
+		result = RunReplay(stream, *pModel, jobSystem);
+		Bench::DoNotOptimize(result.nDivergentTick);
+
+		state.PauseTiming();
+		pModel.reset();
+		state.ResumeTiming();
+	}
+
+	state.SetItemsProcessed(state.GetIterations() * RecordedTicks);
+	state.SetCounter("p50_us", result.tickTime.GetPercentile(0.5) / 1000.0);
+	state.SetCounter("p99_us", result.tickTime.GetPercentile(0.99) / 1000.0);
+	state.SetCounter("diverged", result.HasDiverged() ? 1.0 : 0.0);
+}
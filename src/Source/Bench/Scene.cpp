@@ -0,0 +1,191 @@
+#include "Scene.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Model.h"
+#include "Query.h"
+
+namespace HE
+{
+	namespace Bench
+	{
+		namespace
+		{
+			struct Position
+			{
+				float x, y, z;
+			};
+
+			struct Velocity
+			{
+				float x, y, z;
+			};
+
+			struct Health
+			{
+				float fValue;
+				float fMax;
+			};
+
+			struct Brain
+			{
+				std::uint32_t nState;
+				float fTimer;
+			};
+
+			struct Lifetime
+			{
+				std::uint32_t nTicksLeft;
+			};
+
+			// Data the simulation does not touch, ex: what the renderer needs
+			struct Render
+			{
+				float aValues[16];
+			};
+
+			template<int N>
+			struct Tag
+			{
+				std::uint8_t nValue;
+			};
+
+			// Form: NextRandom(nState) -> 64 random bits. SplitMix64, the same on every platform
+			std::uint64_t NextRandom(std::uint64_t& nState) noexcept
+			{
+				auto n = (nState += 0x9E3779B97F4A7C15ull);
+				n = (n ^ (n >> 30)) * 0xBF58476D1CE4E5B9ull;
+				n = (n ^ (n >> 27)) * 0x94D049BB133111EBull;
+				return n ^ (n >> 31);
+			}
+
+			float NextFloat(std::uint64_t& nState) noexcept
+			{
+				return static_cast<float>(NextRandom(nState) >> 40) / static_cast<float>(1 << 24);
+			}
+
+			Velocity MakeVelocity(std::uint64_t& nState) noexcept
+			{
+				return{ NextFloat(nState) * 2.0f - 1.0f, NextFloat(nState) * 2.0f - 1.0f, 0.0f };
+			}
+
+			// Form: AddTags(model, entity, nTags) -> entity with Tag<N> for each bit N of nTags
+			template<int N>
+			void AddTags(Model& model, EntityHandle entity, std::uint64_t nTags)
+			{
+				if (nTags & (1 << N)) model.AddComponent(entity, Tag<N>{ static_cast<std::uint8_t>(N) });
+				AddTags<N + 1>(model, entity, nTags);
+			}
+
+			template<>
+			void AddTags<6>(Model&, EntityHandle, std::uint64_t)
+			{
+
+			}
+		}
+
+		void GenerateScene(Model& model, const SceneSettings& settings)
+		{
+			auto nRandom = std::uint64_t{ settings.nSeed };
+			// Churned entities live 1 / fChurn ticks on average
+			auto const nMaxLifetime = settings.fChurn > 0.0 ? static_cast<std::uint32_t>(std::max(2.0, std::round(2.0 / settings.fChurn))) : 0;
+			auto const MakeLifetime = [nMaxLifetime](std::uint64_t& nState) {
+				return Lifetime{ static_cast<std::uint32_t>(1 + NextRandom(nState) % nMaxLifetime) };
+			};
+
+			for (size_t i = 0; i < settings.nEntities; ++i)
+			{
+				auto const position = Position{ NextFloat(nRandom) * 1000.0f, NextFloat(nRandom) * 1000.0f, 0.0f };
+				auto nKind = NextRandom(nRandom) % 10;
+				if (settings.eMix != SceneMix::Mixed) nKind = 3;
+
+				EntityHandle entity;
+				if (nKind < 3)
+				{
+					// Props
+					model.CreateEntity(position, Render{});
+					continue;
+				}
+				else if (nKind < 7)
+				{
+					entity = model.CreateEntity(position, MakeVelocity(nRandom));
+				}
+				else if (nKind < 9)
+				{
+					entity = model.CreateEntity(position, MakeVelocity(nRandom), Health{ 50.0f, 100.0f },
+						Brain{ static_cast<std::uint32_t>(NextRandom(nRandom) % 4), NextFloat(nRandom) }, Render{});
+				}
+				else
+				{
+					// Projectiles
+					entity = model.CreateEntity(position, Velocity{ 50.0f, 0.0f, 0.0f });
+				}
+
+				if (settings.eMix == SceneMix::Fragmented) AddTags<0>(model, entity, NextRandom(nRandom) % 64);
+				if (nMaxLifetime != 0) model.AddComponent(entity, MakeLifetime(nRandom));
+			}
+
+			auto& systems = model.GetSystems();
+			systems.AddSystem<Brain, Velocity>("Steer", [](SystemContext& context, const ChunkView<Brain, Velocity>& view) {
+				auto const pBrains = view.Get<Brain>();
+				auto const pVelocities = view.Get<Velocity>();
+				auto const fDt = static_cast<float>(context.GetDt());
+				for (size_t i = 0; i < view.GetCount(); ++i)
+				{
+					auto& brain = pBrains[i];
+					brain.fTimer -= fDt;
+					if (brain.fTimer > 0.0f) continue;
+
+					// Turns a quarter, and keeps going for a second
+					brain.nState = (brain.nState + 1) % 4;
+					brain.fTimer += 1.0f;
+					auto const fSpeed = std::sqrt(pVelocities[i].x * pVelocities[i].x + pVelocities[i].y * pVelocities[i].y);
+					pVelocities[i].x = brain.nState % 2 == 0 ? (brain.nState == 0 ? fSpeed : -fSpeed) : 0.0f;
+					pVelocities[i].y = brain.nState % 2 == 1 ? (brain.nState == 1 ? fSpeed : -fSpeed) : 0.0f;
+				}
+			});
+			systems.AddSystem<Position, const Velocity>("Move", [](SystemContext& context, const ChunkView<Position, const Velocity>& view) {
+				auto const pPositions = view.Get<Position>();
+				auto const pVelocities = view.Get<const Velocity>();
+				auto const fDt = static_cast<float>(context.GetDt());
+				for (size_t i = 0; i < view.GetCount(); ++i)
+				{
+					pPositions[i].x += pVelocities[i].x * fDt;
+					pPositions[i].y += pVelocities[i].y * fDt;
+					pPositions[i].z += pVelocities[i].z * fDt;
+				}
+			});
+			systems.AddSystem<Health>("Regenerate", [](SystemContext& context, const ChunkView<Health>& view) {
+				auto const pHealths = view.Get<Health>();
+				auto const fDt = static_cast<float>(context.GetDt());
+				for (size_t i = 0; i < view.GetCount(); ++i)
+				{
+					pHealths[i].fValue = std::min(pHealths[i].fMax, pHealths[i].fValue + fDt);
+				}
+			});
+
+			if (nMaxLifetime == 0) return;
+
+			// Each expired entity is replaced by a new mover
+			systems.AddSystem<Lifetime>("Expire", [MakeLifetime](SystemContext& context, const ChunkView<Lifetime>& view) {
+				auto const pLifetimes = view.Get<Lifetime>();
+				auto const pEntities = view.GetEntities();
+				for (size_t i = 0; i < view.GetCount(); ++i)
+				{
+					if (--pLifetimes[i].nTicksLeft != 0) continue;
+
+					auto nState = std::uint64_t{ pEntities[i].GetIndex() } << 32 | pEntities[i].GetGeneration();
+					context.GetCommands().DestroyEntity(pEntities[i]);
+					context.GetCommands().CreateEntity(Position{ NextFloat(nState) * 1000.0f, NextFloat(nState) * 1000.0f, 0.0f },
+						MakeVelocity(nState), MakeLifetime(nState));
+				}
+			});
+		}
+
+		std::vector<std::int64_t> SceneSizes()
+		{
+			return{ 10000, 100000, 1000000 };
+		}
+	}
+}
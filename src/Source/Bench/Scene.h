@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace HE
+{
+	class Model;
+
+	namespace Bench
+	{
+		// Component mixes of the generated scenes
+		enum class SceneMix
+		{
+			// Every entity moves, in a single archetype
+			Uniform,
+			// Spread over a few archetypes as in a game: props that never move, movers, characters with health and
+			// a brain, projectiles
+			Mixed,
+			// The movers also get 6 tags at random, for 64 archetypes with few chunks each: weighs the per-archetype
+			// and per-chunk costs
+			Fragmented,
+		};
+
+		struct SceneSettings
+		{
+			std::size_t nEntities{ 10000 };
+			SceneMix eMix{ SceneMix::Mixed };
+			// Fraction of the movers that despawn each tick, each replaced by a new one, so that the count is stable
+			double fChurn{ 0.0 };
+			std::uint32_t nSeed{ 1 };
+		};
+
+		// Fills an empty Model with the entities of the scene, and adds the systems of a game loop over them:
+		// steering, movement, health regeneration, and the despawn and respawn of the churn
+		// The same settings give the same scene
+		void GenerateScene(Model& model, const SceneSettings& settings);
+
+		// 10k, 100k and 1M entities
+		std::vector<std::int64_t> SceneSizes();
+	}
+}
@@ -0,0 +1,195 @@
+#include "HE_Bench.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#include "Model.h"
+#include "Scene.h"
+#include "SceneFile.h"
+
+using namespace HE;
+
+// Loading scene files, against a stream deserializer creating the entities one at a time. The argument is the
+// number of entities. The file stays in the page cache, so this is the cost of loading, not of the disk
+
+namespace SceneFileBench
+{
+	struct Position
+	{
+		float x, y, z;
+	};
+
+	struct Velocity
+	{
+		float x, y, z;
+	};
+
+	struct Cold
+	{
+		float aValues[16];
+	};
+}
+
+using namespace SceneFileBench;
+
+namespace
+{
+	char const* const ScenePath = "HE_SceneFile_Bench.bin";
+	char const* const StreamPath = "HE_SceneFile_Bench.stream";
+
+	// A third of props, the rest moving
+	void MakeScene(Model& model, size_t nCount)
+	{
+		for (size_t i = 0; i < nCount; ++i)
+		{
+			auto const position = Position{ static_cast<float>(i), 0.0f, 0.0f };
+			if (i % 3 == 0) model.CreateEntity(position, Cold{});
+			else model.CreateEntity(position, Velocity{ 1.0f, 2.0f, 3.0f }, Cold{});
+		}
+	}
+
+	// Per entity: its ID, its number of components, then each component as its type id and its bytes
+	void SaveStream(const Model& model, const char* psPath)
+	{
+		std::ofstream file{ psPath, std::ios::binary | std::ios::trunc };
+		for (auto const pArchetype : model.GetArchetypes())
+		{
+			auto const& cTypes = pArchetype->GetComponentTypes();
+			for (size_t i = 0; i < pArchetype->GetChunkCount(); ++i)
+			{
+				auto const& chunk = pArchetype->GetChunk(i);
+				for (std::uint32_t nRow = 0; nRow < chunk.nCount; ++nRow)
+				{
+					auto const entity = pArchetype->GetEntities(chunk)[nRow];
+					auto const nGlobalUniqueID = model.GetGlobalUniqueID(entity);
+					auto const nTypeCount = static_cast<std::uint8_t>(cTypes.size());
+					file.write(reinterpret_cast<const char*>(&nGlobalUniqueID), sizeof(nGlobalUniqueID));
+					file.write(reinterpret_cast<const char*>(&nTypeCount), sizeof(nTypeCount));
+					for (auto const nId : cTypes)
+					{
+						auto const nType = static_cast<std::uint8_t>(nId);
+						file.write(reinterpret_cast<const char*>(&nType), sizeof(nType));
+						file.write(static_cast<const char*>(model.GetComponent(entity, nId)), GetComponentTypeInfo(nId).nSize);
+					}
+				}
+			}
+		}
+	}
+
+	void LoadStream(Model& model, const char* psPath)
+	{
+		std::ifstream file{ psPath, std::ios::binary };
+		std::uint64_t nGlobalUniqueID;
+		unsigned char aComponents[MaxComponentTypes][256];
+		while (file.read(reinterpret_cast<char*>(&nGlobalUniqueID), sizeof(nGlobalUniqueID)))
+		{
+			std::uint8_t nTypeCount;
+			std::uint8_t aTypes[MaxComponentTypes];
+			file.read(reinterpret_cast<char*>(&nTypeCount), sizeof(nTypeCount));
+
+			ComponentMask nMask = 0;
+			for (std::uint8_t i = 0; i < nTypeCount; ++i)
+			{
+				file.read(reinterpret_cast<char*>(&aTypes[i]), sizeof(aTypes[i]));
+				file.read(reinterpret_cast<char*>(aComponents[i]), GetComponentTypeInfo(aTypes[i]).nSize);
+				nMask |= GetComponentBit(aTypes[i]);
+			}
+
+			auto const entity = model.InsertEntity(nGlobalUniqueID, nMask);
+			for (std::uint8_t i = 0; i < nTypeCount; ++i)
+			{
+				std::memcpy(model.GetComponent(entity, aTypes[i]), aComponents[i], GetComponentTypeInfo(aTypes[i]).nSize);
+			}
+		}
+	}
+
+	template<class F>
+	void RunLoads(Bench::State& state, F load)
+	{
+		auto const nCount = static_cast<size_t>(state.GetArg());
+		while (state.KeepRunning())
+		{
+			auto pModel = std::make_unique<Model>();
+			load(*pModel);
+			Bench::DoNotOptimize(pModel->GetEntityCount());
+
+			state.PauseTiming();
+			pModel.reset();
+			state.ResumeTiming();
+		}
+		state.SetItemsProcessed(state.GetIterations() * nCount);
+	}
+
+	size_t SaveScene(Bench::State& state, bool bChecksums)
+	{
+		Model model;
+		MakeScene(model, static_cast<size_t>(state.GetArg()));
+		SceneFile::Save(model, ScenePath, bChecksums);
+		return model.GetChunkMemory();
+	}
+}
+
+HE_BENCHMARK_ARGS(SceneFile_Save, Bench::SceneSizes())
+{
+	Model model;
+	MakeScene(model, static_cast<size_t>(state.GetArg()));
+	while (state.KeepRunning())
+	{
+		SceneFile::Save(model, ScenePath);
+	}
+	state.SetItemsProcessed(state.GetIterations() * model.GetEntityCount());
+	std::remove(ScenePath);
+}
+
+// Mapping, validating, and copying the chunks
+HE_BENCHMARK_ARGS(SceneFile_Load, Bench::SceneSizes())
+{
+	auto const nBytes = SaveScene(state, false);
+	RunLoads(state, [](Model& model) { SceneFile::Open(ScenePath, false).Load(model); });
+	state.SetCounter("MiB", nBytes / (1024.0 * 1024.0));
+	std::remove(ScenePath);
+}
+
+// Same, reading the whole file once more to verify its checksums
+HE_BENCHMARK_ARGS(SceneFile_LoadVerified, Bench::SceneSizes())
+{
+	SaveScene(state, true);
+	RunLoads(state, [](Model& model) { SceneFile::Open(ScenePath, true).Load(model); });
+	std::remove(ScenePath);
+}
+
+// The baseline: reading the entities one at a time from a stream, and creating them in the Model
+HE_BENCHMARK_ARGS(SceneFile_LoadStream, Bench::SceneSizes())
+{
+	{
+		Model model;
+		MakeScene(model, static_cast<size_t>(state.GetArg()));
+		SaveStream(model, StreamPath);
+	}
+	RunLoads(state, [](Model& model) { LoadStream(model, StreamPath); });
+	std::remove(StreamPath);
+}
+
+// Reading the positions in place, with no load: what a level streamer would do for static data
+HE_BENCHMARK_ARGS(SceneFile_ReadInPlace, Bench::SceneSizes())
+{
+	SaveScene(state, false);
+	while (state.KeepRunning())
+	{
+		auto const scene = SceneFile::Open(ScenePath, false);
+		float fSum = 0.0f;
+		scene.ForEachChunk<Position>([&fSum](const ChunkView<const Position>& view) {
+			auto const pPositions = view.Get<const Position>();
+			for (std::uint32_t i = 0; i < view.GetCount(); ++i)
+			{
+				fSum += pPositions[i].x;
+			}
+		});
+		Bench::DoNotOptimize(fSum);
+	}
+	state.SetItemsProcessed(state.GetIterations() * state.GetArg());
+	std::remove(ScenePath);
+}
@@ -0,0 +1,87 @@
+#include "HE_Bench.h"
+
+#include <cstdint>
+#include <memory>
+
+#include "HE_JobSystem.h"
+#include "Model.h"
+#include "Scene.h"
+
+using namespace HE;
+
+// Model::Update on generated scenes (see Scene.h). The argument is the number of entities, and the items are the
+// entities updated
+
+namespace
+{
+	void RunUpdates(Bench::State& state, const Bench::SceneSettings& settings, JobSystem& jobSystem)
+	{
+		Model model;
+		Bench::GenerateScene(model, settings);
+
+		while (state.KeepRunning())
+		{
+			model.Update(1.0 / 60.0, jobSystem);
+		}
+		state.SetItemsProcessed(state.GetIterations() * settings.nEntities);
+		state.SetCounter("MiB", model.GetChunkMemory() / (1024.0 * 1024.0));
+	}
+
+	Bench::SceneSettings MakeSettings(std::int64_t nEntities, Bench::SceneMix eMix, double fChurn = 0.0)
+	{
+		Bench::SceneSettings settings;
+		settings.nEntities = static_cast<size_t>(nEntities);
+		settings.eMix = eMix;
+		settings.fChurn = fChurn;
+		return settings;
+	}
+}
+
+HE_BENCHMARK_ARGS(Scene_Uniform, Bench::SceneSizes())
+{
+	JobSystem jobSystem;
+	RunUpdates(state, MakeSettings(state.GetArg(), Bench::SceneMix::Uniform), jobSystem);
+}
+
+HE_BENCHMARK_ARGS(Scene_Mixed, Bench::SceneSizes())
+{
+	JobSystem jobSystem;
+	RunUpdates(state, MakeSettings(state.GetArg(), Bench::SceneMix::Mixed), jobSystem);
+}
+
+HE_BENCHMARK_ARGS(Scene_Fragmented, Bench::SceneSizes())
+{
+	JobSystem jobSystem;
+	RunUpdates(state, MakeSettings(state.GetArg(), Bench::SceneMix::Fragmented), jobSystem);
+}
+
+// 1% of the movers despawn and respawn each tick, through the command buffers of the systems
+HE_BENCHMARK_ARGS(Scene_MixedChurn, Bench::SceneSizes())
+{
+	JobSystem jobSystem;
+	RunUpdates(state, MakeSettings(state.GetArg(), Bench::SceneMix::Mixed, 0.01), jobSystem);
+}
+
+// 100k mixed entities. The argument is the number of threads running the systems
+HE_BENCHMARK_ARGS(Scene_MixedThreads, Bench::ThreadCounts())
+{
+	JobSystem jobSystem{ static_cast<size_t>(state.GetArg() - 1) };
+	auto const settings = MakeSettings(100000, Bench::SceneMix::Mixed);
+	RunUpdates(state, settings, jobSystem);
+}
+
+// Creating the entities of a scene, one at a time
+HE_BENCHMARK_ARGS(Scene_Generate, Bench::SceneSizes())
+{
+	auto const settings = MakeSettings(state.GetArg(), Bench::SceneMix::Mixed);
+	while (state.KeepRunning())
+	{
+		auto pModel = std::make_unique<Model>();
+		Bench::GenerateScene(*pModel, settings);
+
+		state.PauseTiming();
+		pModel.reset();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.GetIterations() * settings.nEntities);
+}
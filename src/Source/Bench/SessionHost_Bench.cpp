@@ -0,0 +1,96 @@
+#include "HE_Bench.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Model.h"
+#include "Query.h"
+#include "SessionHost.h"
+
+using namespace HE;
+
+// Sessions of 2000 moving entities each, ticking at 60 Hz on one host. The argument is the number of sessions
+// Each iteration is 100ms of hosting: the items are the ticks run in that time. The counters give the sessions one
+// core could hold at 60 Hz from the mean cost of a tick, and the updates that ended past their deadline
+
+namespace
+{
+	struct Position
+	{
+		float x, y, z;
+	};
+
+	struct Velocity
+	{
+		float x, y, z;
+	};
+
+	void AddMovingSession(Model& model)
+	{
+		for (int i = 0; i < 2000; ++i)
+		{
+			auto const f = static_cast<float>(i);
+			model.CreateEntity(Position{ f, 0.0f, 0.0f }, Velocity{ 1.0f, 0.5f, -0.25f });
+		}
+		model.GetSystems().AddSystem<Position, const Velocity>("Move", [](SystemContext& context, const ChunkView<Position, const Velocity>& view) {
+			auto const pPositions = view.Get<Position>();
+			auto const pVelocities = view.Get<const Velocity>();
+			auto const fDt = static_cast<float>(context.GetDt());
+			for (size_t i = 0; i < view.GetCount(); ++i)
+			{
+				pPositions[i].x += pVelocities[i].x * fDt;
+				pPositions[i].y += pVelocities[i].y * fDt;
+				pPositions[i].z += pVelocities[i].z * fDt;
+			}
+		});
+	}
+
+	std::vector<std::int64_t> SessionCounts()
+	{
+		return{ 1, 16, 64, 256 };
+	}
+}
+
+HE_BENCHMARK_ARGS(SessionHost_Sessions, SessionCounts())
+{
+	SessionHost host;
+	SessionSettings settings;
+	std::vector<Session*> cSessions;
+	for (std::int64_t i = 0; i < state.GetArg(); ++i)
+	{
+		cSessions.push_back(&host.AddSession("Session" + std::to_string(i), settings, AddMovingSession));
+	}
+
+	auto futEnd = host.Run();
+	while (state.KeepRunning())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds{ 100 });
+	}
+	host.Stop();
+	futEnd.get();
+
+	std::uint64_t nTicks = 0;
+	std::uint64_t nTickTime = 0;
+	std::uint64_t nMissedDeadlines = 0;
+	std::uint64_t nDroppedTicks = 0;
+	for (auto const pSession : cSessions)
+	{
+		auto const metrics = pSession->GetMetrics();
+		nTicks += metrics.cCounters.at("Session.Ticks");
+		nTickTime += metrics.cHistograms.at("Session.TickTime").nSum;
+		nMissedDeadlines += metrics.cCounters.at("Session.MissedDeadlines");
+		nDroppedTicks += metrics.cCounters.at("Session.DroppedTicks");
+	}
+
+	state.SetItemsProcessed(static_cast<std::int64_t>(nTicks));
+	if (nTicks > 0 && nTickTime > 0)
+	{
+		auto const fMeanTick = static_cast<double>(nTickTime) / nTicks;
+		state.SetCounter("sessions/core", static_cast<double>(settings.tTickPeriod.count()) / fMeanTick);
+	}
+	state.SetCounter("missed", static_cast<double>(nMissedDeadlines));
+	state.SetCounter("dropped", static_cast<double>(nDroppedTicks));
+}
@@ -0,0 +1,97 @@
+#include "HE_Bench.h"
+
+#include <cstdint>
+#include <string>
+
+#include "HE_Log.h"
+#include "HE_String.h"
+
+using namespace HE;
+
+HE_DEFINE_LOG_CATEGORY(BenchLog, Off);
+
+// Cost of Format, and of HE_LOG when its category filters the message out, and when it goes to a sink
+
+namespace
+{
+	class NullLogSink : public LogSink
+	{
+	public:
+		void Write(LogLevel, const LogCategory&, const char* psMsg) noexcept override
+		{
+			Bench::DoNotOptimize(psMsg);
+		}
+	};
+}
+
+HE_BENCHMARK(Format_Int)
+{
+	int n = 0;
+	while (state.KeepRunning())
+	{
+		Bench::DoNotOptimize(Format("{_}", ++n));
+	}
+}
+
+HE_BENCHMARK(Format_Double)
+{
+	double f = 0.0;
+	while (state.KeepRunning())
+	{
+		Bench::DoNotOptimize(Format("{_:.3}", f += 0.5));
+	}
+}
+
+// A typical log line: a name, a count, a duration
+HE_BENCHMARK(Format_Mixed)
+{
+	std::string const sName = "System.Move";
+	std::uint64_t n = 0;
+	while (state.KeepRunning())
+	{
+		++n;
+		Bench::DoNotOptimize(Format("{_}: {_} entities in {_:.3}ms", sName, n, n * 0.001));
+	}
+}
+
+// Into the inline buffer of a LogString, which does not allocate for short messages
+HE_BENCHMARK(Format_MixedLogString)
+{
+	std::string const sName = "System.Move";
+	std::uint64_t n = 0;
+	while (state.KeepRunning())
+	{
+		++n;
+		Bench::DoNotOptimize(FormatAs<LogString>("{_}: {_} entities in {_:.3}ms", sName, n, n * 0.001));
+	}
+}
+
+HE_BENCHMARK(Log_Filtered)
+{
+	std::uint64_t n = 0;
+	while (state.KeepRunning())
+	{
+		HE_LOG(Debug, BenchLog, "Filtered message {_}", ++n);
+	}
+	Bench::DoNotOptimize(n);
+}
+
+// Formatted and sent to a sink that drops it, instead of the console
+HE_BENCHMARK(Log_ToSink)
+{
+	NullLogSink sink;
+	RemoveLogSink(ConsoleLogSink::it);
+	AddLogSink(sink);
+	g_LogCategoryBenchLog.SetLevel(LogLevel::Verbose);
+
+	std::uint64_t n = 0;
+	while (state.KeepRunning())
+	{
+		++n;
+		HE_LOG(Info, BenchLog, "Entity {_} moved to {_:.2}", n, n * 0.5);
+	}
+
+	g_LogCategoryBenchLog.SetLevel(LogLevel::Off);
+	RemoveLogSink(sink);
+	AddLogSink(ConsoleLogSink::it);
+}
@@ -0,0 +1,147 @@
+#include "HE_Bench.h"
+
+#include <vector>
+
+#include "HE_JobSystem.h"
+#include "TransformHierarchy.h"
+
+using namespace HE;
+
+// 101100 nodes: 100 roots with 10 children, each with 10 children, each with 9 leaves
+// The argument is the thread count
+
+namespace
+{
+	std::vector<EntityHandle> MakeHierarchy(TransformHierarchy& hierarchy)
+	{
+		std::vector<EntityHandle> cEntities;
+		std::vector<EntityHandle> cParents(100);
+		std::vector<EntityHandle> cChildren;
+		std::uint32_t nIndex = 0;
+		auto const add = [&](EntityHandle parent) {
+			EntityHandle const entity{ nIndex, 1 };
+			hierarchy.Add(entity, Math::Mat4::Translation({ 1.0f, static_cast<float>(nIndex % 7), 0.0f }), parent);
+			cEntities.push_back(entity);
+			++nIndex;
+			return entity;
+		};
+
+		for (auto& root : cParents) root = add({});
+		for (size_t nChildren : { 10, 10, 9 })
+		{
+			cChildren.clear();
+			for (auto const parent : cParents)
+			{
+				for (size_t i = 0; i < nChildren; ++i) cChildren.push_back(add(parent));
+			}
+			cParents.swap(cChildren);
+		}
+		return cEntities;
+	}
+}
+
+// Every node moved: the whole hierarchy is recomputed
+HE_BENCHMARK_ARGS(TransformHierarchy_UpdateAll, Bench::ThreadCounts())
+{
+	JobSystem jobSystem{ static_cast<size_t>(state.GetArg() - 1) };
+	TransformHierarchy hierarchy;
+	auto const cEntities = MakeHierarchy(hierarchy);
+	hierarchy.Update(jobSystem);
+
+	float fStep = 1.0f;
+	while (state.KeepRunning())
+	{
+		state.PauseTiming();
+		for (size_t i = 0; i < 100; ++i)
+		{
+			hierarchy.SetLocal(cEntities[i], Math::Mat4::Translation({ fStep, 0.0f, 0.0f }));
+		}
+		fStep = -fStep;
+		state.ResumeTiming();
+
+		hierarchy.Update(jobSystem);
+	}
+	Bench::DoNotOptimize(hierarchy.GetWorld(cEntities.back()));
+	state.SetItemsProcessed(state.GetIterations() * hierarchy.GetNodeCount());
+}
+
+// A few leaves moved: the pass only reads the dirty flags
+HE_BENCHMARK_ARGS(TransformHierarchy_UpdateFew, Bench::ThreadCounts())
+{
+	JobSystem jobSystem{ static_cast<size_t>(state.GetArg() - 1) };
+	TransformHierarchy hierarchy;
+	auto const cEntities = MakeHierarchy(hierarchy);
+	hierarchy.Update(jobSystem);
+
+	float fStep = 1.0f;
+	while (state.KeepRunning())
+	{
+		state.PauseTiming();
+		for (size_t i = cEntities.size() - 100; i < cEntities.size(); ++i)
+		{
+			hierarchy.SetLocal(cEntities[i], Math::Mat4::Translation({ fStep, 0.0f, 0.0f }));
+		}
+		fStep = -fStep;
+		state.ResumeTiming();
+
+		hierarchy.Update(jobSystem);
+	}
+	Bench::DoNotOptimize(hierarchy.GetWorld(cEntities.back()));
+	state.SetItemsProcessed(state.GetIterations() * hierarchy.GetNodeCount());
+}
+
+// Every frame, 10 nodes of the third depth move under a root with their leaves, and back the next frame, and 10 leaves
+// are destroyed and added again: the changes keep the order of the nodes, without rebuilding it
+HE_BENCHMARK_ARGS(TransformHierarchy_Churn, Bench::ThreadCounts())
+{
+	JobSystem jobSystem{ static_cast<size_t>(state.GetArg() - 1) };
+	TransformHierarchy hierarchy;
+	auto cEntities = MakeHierarchy(hierarchy);
+	hierarchy.Update(jobSystem);
+
+	// Indices in cEntities, in the order of MakeHierarchy
+	size_t const nThirdDepth = 100 + 100 * 10;
+	size_t const nLeaves = nThirdDepth + 100 * 10 * 10;
+	std::vector<EntityHandle> cMoved;
+	std::vector<EntityHandle> cMovedParents;
+	cMoved.reserve(10);
+	cMovedParents.reserve(10);
+
+	size_t nFrame = 0;
+	while (state.KeepRunning())
+	{
+		if (cMoved.empty())
+		{
+			for (size_t i = 0; i < 10; ++i)
+			{
+				auto const entity = cEntities[nThirdDepth + (nFrame * 10 + i) * 7919 % (nLeaves - nThirdDepth)];
+				cMoved.push_back(entity);
+				cMovedParents.push_back(hierarchy.GetParent(entity));
+				hierarchy.SetParent(entity, cEntities[i]);
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < cMoved.size(); ++i)
+			{
+				hierarchy.SetParent(cMoved[i], cMovedParents[i]);
+			}
+			cMoved.clear();
+			cMovedParents.clear();
+		}
+
+		for (size_t i = 0; i < 10; ++i)
+		{
+			auto& leaf = cEntities[nLeaves + (nFrame * 10 + i) * 7919 % (cEntities.size() - nLeaves)];
+			auto const parent = hierarchy.GetParent(leaf);
+			hierarchy.Remove(leaf);
+			leaf = EntityHandle{ leaf.GetIndex(), leaf.GetGeneration() + 1 };
+			hierarchy.Add(leaf, Math::Mat4::Translation({ 1.0f, 0.0f, 0.0f }), parent);
+		}
+		++nFrame;
+
+		hierarchy.Update(jobSystem);
+	}
+	Bench::DoNotOptimize(hierarchy.GetWorld(cEntities.back()));
+	state.SetItemsProcessed(state.GetIterations() * hierarchy.GetNodeCount());
+}
@@ -0,0 +1,9 @@
+#include "HE_Bench.h"
+
+int main(int const argc, char const* const argv[])
+{
+	HE::Bench::Options options;
+	if (!HE::Bench::ParseOptions(argc, argv, options)) return 2;
+
+	return HE::Bench::RunBenchmarks(options);
+}
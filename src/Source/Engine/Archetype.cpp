@@ -0,0 +1,235 @@
+#include "Archetype.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include "ChunkArena.h"
+#include "HE_Allocator.h"
+#include "HE_Assert.h"
+
+namespace HE
+{
+	namespace
+	{
+		size_t AlignUp(size_t n, size_t nAlignment) noexcept
+		{
+			return (n + nAlignment - 1) / nAlignment * nAlignment;
+		}
+	}
+
+	constexpr size_t Chunk::Size;
+	constexpr size_t Chunk::ColumnAlignment;
+	constexpr std::uint32_t Archetype::NoColumn;
+
+	Archetype::Archetype(ComponentMask nMask, ChunkArena* pArena)
+		: m_nMask(nMask),
+		m_pArena(pArena)
+	{
+		size_t nRowSize = sizeof(EntityHandle);
+		for (ComponentTypeId nId = 0; nId < MaxComponentTypes; ++nId)
+		{
+			if (!HasComponent(nId)) continue;
+
+			auto const& info = GetComponentTypeInfo(nId);
+			if (info.nAlignment > Chunk::ColumnAlignment)
+			{
+				throw std::invalid_argument{ std::string{ "The alignment of component " } + info.psName + " is too large for a chunk" };
+			}
+			m_cComponentTypes.push_back(nId);
+			nRowSize += info.nSize;
+		}
+
+		// Leaves room for the padding at the start of each column
+		auto const nColumns = m_cComponentTypes.size() + 1;
+		auto const nUsable = Chunk::Size - nColumns * Chunk::ColumnAlignment;
+		m_nChunkCapacity = static_cast<std::uint32_t>(nUsable / nRowSize);
+		if (m_nChunkCapacity == 0)
+		{
+			throw std::length_error{ "The components of an archetype do not fit in a chunk" };
+		}
+
+		m_aColumnOffsets.fill(NoColumn);
+		size_t nOffset = AlignUp(m_nChunkCapacity * sizeof(EntityHandle), Chunk::ColumnAlignment);
+		for (auto const nId : m_cComponentTypes)
+		{
+			m_aColumnOffsets[nId] = static_cast<std::uint32_t>(nOffset);
+			nOffset = AlignUp(nOffset + m_nChunkCapacity * GetComponentTypeInfo(nId).nSize, Chunk::ColumnAlignment);
+		}
+		ENSURES(nOffset <= Chunk::Size);
+	}
+
+	Archetype::~Archetype()
+	{
+		DestroyRows(0, m_nEntityCount);
+
+		for (auto const& chunk : m_cChunks)
+		{
+			FreeChunk(chunk.pData);
+		}
+	}
+
+	EntityLocation Archetype::Allocate(EntityHandle entity)
+	{
+		auto const nChunk = m_nEntityCount / m_nChunkCapacity;
+		if (nChunk == m_cChunks.size())
+		{
+			AllocateChunk();
+		}
+
+		auto& chunk = m_cChunks[nChunk];
+		EntityLocation const location{ this, static_cast<std::uint32_t>(nChunk), chunk.nCount };
+		GetEntities(chunk)[location.nRow] = entity;
+		++chunk.nCount;
+		MarkChanged(nChunk);
+		++m_nEntityCount;
+		return location;
+	}
+
+	void Archetype::Reserve(size_t nEntityCount)
+	{
+		while (m_cChunks.size() * m_nChunkCapacity < nEntityCount)
+		{
+			AllocateChunk();
+		}
+	}
+
+	void Archetype::Resize(size_t nEntityCount) noexcept
+	{
+		EXPECTS(nEntityCount <= m_cChunks.size() * m_nChunkCapacity);
+
+		if (nEntityCount < m_nEntityCount) DestroyRows(nEntityCount, m_nEntityCount);
+		m_nEntityCount = nEntityCount;
+
+		for (size_t i = 0; i < m_cChunks.size(); ++i)
+		{
+			auto const nFirst = i * m_nChunkCapacity;
+			auto const nCount = static_cast<std::uint32_t>(nEntityCount > nFirst ? std::min<size_t>(nEntityCount - nFirst, m_nChunkCapacity) : 0);
+			auto& chunk = m_cChunks[i];
+			if (chunk.nCount == nCount) continue;
+
+			chunk.nCount = nCount;
+			MarkChanged(i);
+		}
+
+		FreeUnusedChunks();
+	}
+
+	EntityHandle Archetype::Remove(const EntityLocation& location) noexcept
+	{
+		auto const& chunk = m_cChunks[location.nChunk];
+		for (auto const nId : m_cComponentTypes)
+		{
+			auto const& info = GetComponentTypeInfo(nId);
+			if (!info.bTriviallyCopyable)
+			{
+				info.pDestroy(chunk.pData + m_aColumnOffsets[nId] + location.nRow * info.nSize);
+			}
+		}
+
+		return FillRow(location);
+	}
+
+	EntityHandle Archetype::RemoveRelocated(const EntityLocation& location) noexcept
+	{
+		return FillRow(location);
+	}
+
+	void Archetype::AllocateChunk()
+	{
+		unsigned char* pData;
+		if (m_pArena != nullptr)
+		{
+			pData = m_pArena->Allocate();
+		}
+		else
+		{
+			auto const b = AlignedMallocAllocator::it.allocate(Chunk::Size, Chunk::ColumnAlignment);
+			if (!b.ptr) throw std::bad_alloc{};
+			pData = static_cast<unsigned char*>(b.ptr);
+		}
+
+		try
+		{
+			m_cColumnVersions.resize(m_cColumnVersions.size() + GetColumnCount(), m_nChangeVersion);
+			m_cChunks.push_back({ pData, 0, m_nChangeVersion });
+		}
+		catch (...)
+		{
+			m_cColumnVersions.resize(m_cChunks.size() * GetColumnCount());
+			FreeChunk(pData);
+			throw;
+		}
+	}
+
+	void Archetype::FreeChunk(unsigned char* pData) noexcept
+	{
+		if (m_pArena != nullptr) m_pArena->Free(pData);
+		else AlignedMallocAllocator::it.deallocate({ pData, Chunk::Size });
+	}
+
+	void Archetype::FreeUnusedChunks() noexcept
+	{
+		auto const nUsedChunks = GetChunkCount();
+		while (m_cChunks.size() > nUsedChunks + 1)
+		{
+			FreeChunk(m_cChunks.back().pData);
+			m_cChunks.pop_back();
+			m_cColumnVersions.resize(m_cChunks.size() * GetColumnCount());
+		}
+	}
+
+	void Archetype::DestroyRows(size_t nBegin, size_t nEnd) noexcept
+	{
+		for (auto const nId : m_cComponentTypes)
+		{
+			auto const& info = GetComponentTypeInfo(nId);
+			if (info.bTriviallyCopyable) continue;
+
+			for (size_t i = nBegin; i < nEnd; ++i)
+			{
+				auto const& chunk = m_cChunks[i / m_nChunkCapacity];
+				info.pDestroy(chunk.pData + m_aColumnOffsets[nId] + (i % m_nChunkCapacity) * info.nSize);
+			}
+		}
+	}
+
+	EntityHandle Archetype::FillRow(const EntityLocation& location) noexcept
+	{
+		auto const nLast = m_nEntityCount - 1;
+		auto& lastChunk = m_cChunks[nLast / m_nChunkCapacity];
+		auto const nLastRow = static_cast<std::uint32_t>(nLast % m_nChunkCapacity);
+
+		EntityHandle moved;
+		if (&lastChunk != &m_cChunks[location.nChunk] || nLastRow != location.nRow)
+		{
+			auto& chunk = m_cChunks[location.nChunk];
+			moved = GetEntities(lastChunk)[nLastRow];
+			GetEntities(chunk)[location.nRow] = moved;
+
+			for (auto const nId : m_cComponentTypes)
+			{
+				auto const& info = GetComponentTypeInfo(nId);
+				auto const pColumn = chunk.pData + m_aColumnOffsets[nId];
+				auto const pLastColumn = lastChunk.pData + m_aColumnOffsets[nId];
+				if (info.bTriviallyCopyable)
+				{
+					std::memcpy(pColumn + location.nRow * info.nSize, pLastColumn + nLastRow * info.nSize, info.nSize);
+				}
+				else
+				{
+					info.pRelocate(pColumn + location.nRow * info.nSize, pLastColumn + nLastRow * info.nSize);
+				}
+			}
+		}
+
+		MarkChanged(location.nChunk);
+		MarkChanged(nLast / m_nChunkCapacity);
+		--lastChunk.nCount;
+		--m_nEntityCount;
+
+		FreeUnusedChunks();
+		return moved;
+	}
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "Component.h"
+#include "Entity.h"
+
+namespace HE
+{
+	class Archetype;
+	class ChunkArena;
+
+	// Fixed-size block of entities of one archetype
+	// Columns are laid out one after the other: the entities, then one array per component type.
+	// Each column starts on its own cache line
+	struct Chunk
+	{
+		static constexpr size_t Size = 16 * 1024;
+		static constexpr size_t ColumnAlignment = 64;
+
+		unsigned char* pData;
+		std::uint32_t nCount;
+		// Change version of the Model when the chunk was last written to (see Model::GetChangeVersion)
+		std::uint64_t nChangeVersion;
+	};
+
+	struct EntityLocation
+	{
+		Archetype* pArchetype;
+		std::uint32_t nChunk;
+		std::uint32_t nRow;
+	};
+
+	// Storage of all the entities with the same set of component types
+	//
+	// Entities are packed in chunk order: every chunk is full except the last used one, so that
+	// iterating the chunks visits contiguous, dense arrays. Removing an entity moves the last entity
+	// of the archetype into its row
+	class Archetype
+	{
+	public:
+		// The chunks come from the arena if there is one, from the heap otherwise
+		explicit Archetype(ComponentMask nMask, ChunkArena* pArena = nullptr);
+		Archetype(const Archetype&) = delete;
+		void operator=(const Archetype&) = delete;
+		// Destroys the components of the remaining entities
+		~Archetype();
+
+		ComponentMask GetMask() const noexcept { return m_nMask; }
+		// In increasing id order
+		const std::vector<ComponentTypeId>& GetComponentTypes() const noexcept { return m_cComponentTypes; }
+		bool HasComponent(ComponentTypeId nId) const noexcept { return (m_nMask & GetComponentBit(nId)) != 0; }
+
+		std::uint32_t GetChunkCapacity() const noexcept { return m_nChunkCapacity; }
+		size_t GetEntityCount() const noexcept { return m_nEntityCount; }
+
+		// Chunks holding at least one entity
+		size_t GetChunkCount() const noexcept { return (m_nEntityCount + m_nChunkCapacity - 1) / m_nChunkCapacity; }
+		const Chunk& GetChunk(size_t nChunk) const noexcept { return m_cChunks[nChunk]; }
+		// Including the spare one
+		size_t GetAllocatedChunkCount() const noexcept { return m_cChunks.size(); }
+
+		EntityHandle* GetEntities(const Chunk& chunk) const noexcept
+		{
+			return reinterpret_cast<EntityHandle*>(chunk.pData);
+		}
+
+		// Returns nullptr if the archetype does not have the component
+		void* GetColumn(const Chunk& chunk, ComponentTypeId nId) const noexcept
+		{
+			auto const nOffset = m_aColumnOffsets[nId];
+			return nOffset != NoColumn ? chunk.pData + nOffset : nullptr;
+		}
+
+		template<class T>
+		T* GetColumn(const Chunk& chunk) const
+		{
+			return static_cast<T*>(GetColumn(chunk, GetComponentTypeId<T>()));
+		}
+
+		void* GetComponent(const EntityLocation& location, ComponentTypeId nId) const noexcept
+		{
+			auto const& chunk = m_cChunks[location.nChunk];
+			auto const nOffset = m_aColumnOffsets[nId];
+			return nOffset != NoColumn ? chunk.pData + nOffset + location.nRow * GetComponentTypeInfo(nId).nSize : nullptr;
+		}
+
+		// Stamped on the chunks written to from now on
+		void SetChangeVersion(std::uint64_t nVersion) noexcept { m_nChangeVersion = nVersion; }
+		// Stamps the chunk and all its columns, before its components are written to
+		// Different chunks can be marked concurrently, but not the same chunk, even for different columns
+		void MarkChanged(size_t nChunk) noexcept
+		{
+			m_cChunks[nChunk].nChangeVersion = m_nChangeVersion;
+			std::fill_n(m_cColumnVersions.begin() + nChunk * GetColumnCount(), GetColumnCount(), m_nChangeVersion);
+		}
+		// Same, for the columns of the component types in nWrites only
+		void MarkChanged(size_t nChunk, ComponentMask nWrites) noexcept
+		{
+			m_cChunks[nChunk].nChangeVersion = m_nChangeVersion;
+			auto const pVersions = m_cColumnVersions.data() + nChunk * GetColumnCount();
+			for (size_t i = 0; i < m_cComponentTypes.size(); ++i)
+			{
+				if (nWrites & GetComponentBit(m_cComponentTypes[i])) pVersions[i + 1] = m_nChangeVersion;
+			}
+		}
+
+		// The entities, then one per component type, in the order of GetComponentTypes
+		size_t GetColumnCount() const noexcept { return m_cComponentTypes.size() + 1; }
+		// Change version of the Model when the column of the chunk was last written to, at most the one of the chunk
+		std::uint64_t GetColumnVersion(size_t nChunk, size_t nColumn) const noexcept { return m_cColumnVersions[nChunk * GetColumnCount() + nColumn]; }
+
+		// Appends a row for the entity, with its components left uninitialized
+		// Throws std::bad_alloc if a new chunk is needed and cannot be allocated
+		EntityLocation Allocate(EntityHandle entity);
+
+		// Allocates the chunks to hold nEntityCount entities, ex: before Resize
+		// Throws std::bad_alloc if a chunk cannot be allocated
+		void Reserve(size_t nEntityCount);
+
+		// Sets the number of entities, ex: to copy the rows of a saved state back (see ModelState). The new rows
+		// are left uninitialized, and the components of the removed rows are destroyed. The chunks must be reserved
+		// Stamps the chunks whose count changes
+		void Resize(size_t nEntityCount) noexcept;
+
+		// Destroys the components of the row, then fills it with the last entity of the archetype
+		// Returns the entity moved into the row, or the invalid entity if the row was the last one
+		EntityHandle Remove(const EntityLocation& location) noexcept;
+
+		// Same as Remove, for a row whose components were already relocated or destroyed
+		EntityHandle RemoveRelocated(const EntityLocation& location) noexcept;
+
+		// Cached results of adding or removing one component type from this archetype
+		Archetype* GetAddEdge(ComponentTypeId nId) const noexcept { return m_aAddEdges[nId]; }
+		Archetype* GetRemoveEdge(ComponentTypeId nId) const noexcept { return m_aRemoveEdges[nId]; }
+		void SetAddEdge(ComponentTypeId nId, Archetype* pArchetype) noexcept { m_aAddEdges[nId] = pArchetype; }
+		void SetRemoveEdge(ComponentTypeId nId, Archetype* pArchetype) noexcept { m_aRemoveEdges[nId] = pArchetype; }
+
+	private:
+		static constexpr std::uint32_t NoColumn = ~std::uint32_t{ 0 };
+
+		void AllocateChunk();
+		void FreeChunk(unsigned char* pData) noexcept;
+		// Keeps one empty chunk as a spare
+		void FreeUnusedChunks() noexcept;
+		void DestroyRows(size_t nBegin, size_t nEnd) noexcept;
+		EntityHandle FillRow(const EntityLocation& location) noexcept;
+
+		ComponentMask const m_nMask;
+		ChunkArena* const m_pArena;
+		std::vector<ComponentTypeId> m_cComponentTypes;
+		std::array<std::uint32_t, MaxComponentTypes> m_aColumnOffsets;
+		std::uint32_t m_nChunkCapacity;
+
+		// Holds one spare chunk at most past the used ones, so that an archetype going back and forth
+		// over a chunk boundary does not allocate every time
+		std::vector<Chunk> m_cChunks;
+		// GetColumnCount() per chunk
+		std::vector<std::uint64_t> m_cColumnVersions;
+		size_t m_nEntityCount{ 0 };
+		std::uint64_t m_nChangeVersion{ 0 };
+
+		std::array<Archetype*, MaxComponentTypes> m_aAddEdges{};
+		std::array<Archetype*, MaxComponentTypes> m_aRemoveEdges{};
+	};
+
+	// Columns of one chunk matched by a Query or a system: the arrays of Ts, in chunk order
+	template<class... Ts>
+	class ChunkView
+	{
+	public:
+		ChunkView(const EntityHandle* pEntities, std::tuple<Ts*...> columns, std::uint32_t nCount) noexcept
+			: m_pEntities(pEntities),
+			m_columns(columns),
+			m_nCount(nCount)
+		{
+
+		}
+
+		std::uint32_t GetCount() const noexcept { return m_nCount; }
+		const EntityHandle* GetEntities() const noexcept { return m_pEntities; }
+
+		// Form: Get<T>() -> array of GetCount() T, where T is one of Ts (with the same constness)
+		template<class T>
+		T* Get() const noexcept { return std::get<T*>(m_columns); }
+
+		template<size_t I>
+		auto Get() const noexcept { return std::get<I>(m_columns); }
+
+	private:
+		const EntityHandle* m_pEntities;
+		std::tuple<Ts*...> m_columns;
+		std::uint32_t m_nCount;
+	};
+
+	// Form: MakeChunkView<Ts...>(archetype, chunk), where the archetype has all of Ts
+	template<class... Ts>
+	ChunkView<Ts...> MakeChunkView(const Archetype& archetype, const Chunk& chunk)
+	{
+		return{ archetype.GetEntities(chunk), std::tuple<Ts*...>{ archetype.template GetColumn<std::remove_cv_t<Ts>>(chunk)... }, chunk.nCount };
+	}
+}
@@ -0,0 +1,67 @@
+#include "ChunkArena.h"
+
+#include <algorithm>
+#include <new>
+
+#include "HE_Assert.h"
+
+namespace HE
+{
+	constexpr size_t ChunkArena::DefaultChunksPerSlab;
+
+	ChunkArena::ChunkArena(size_t nMaxBytes, size_t nChunksPerSlab)
+		: m_nMaxBytes(nMaxBytes),
+		m_nChunksPerSlab(nChunksPerSlab)
+	{
+		EXPECTS(nChunksPerSlab > 0);
+	}
+
+	ChunkArena::~ChunkArena()
+	{
+		ASSERT_MSG(m_nUsedChunks == 0, "A HE::ChunkArena was destroyed before the chunks allocated from it");
+		for (auto const& slab : m_cSlabs)
+		{
+			AlignedMallocAllocator::it.deallocate(slab);
+		}
+	}
+
+	unsigned char* ChunkArena::Allocate()
+	{
+		if (m_cFreeChunks.empty())
+		{
+			// The last slab within the budget may be smaller
+			auto nChunks = m_nChunksPerSlab;
+			if (m_nMaxBytes != 0)
+			{
+				auto const nBudget = m_nMaxBytes / Chunk::Size;
+				nChunks = std::min(nChunks, nBudget > m_nReservedChunks ? nBudget - m_nReservedChunks : 0);
+				if (nChunks == 0) throw std::bad_alloc{};
+			}
+
+			m_cFreeChunks.reserve(m_nReservedChunks + nChunks);
+			m_cSlabs.reserve(m_cSlabs.size() + 1);
+			auto const b = AlignedMallocAllocator::it.allocate(nChunks * Chunk::Size, Chunk::ColumnAlignment);
+			if (!b.ptr) throw std::bad_alloc{};
+			m_cSlabs.push_back(b);
+			m_nReservedChunks += nChunks;
+
+			// The first chunks of the slab are used first
+			auto const pSlab = static_cast<unsigned char*>(b.ptr);
+			for (auto i = nChunks; i > 0; --i)
+			{
+				m_cFreeChunks.push_back(pSlab + (i - 1) * Chunk::Size);
+			}
+		}
+
+		auto const pChunk = m_cFreeChunks.back();
+		m_cFreeChunks.pop_back();
+		++m_nUsedChunks;
+		return pChunk;
+	}
+
+	void ChunkArena::Free(unsigned char* pChunk) noexcept
+	{
+		m_cFreeChunks.push_back(pChunk);
+		--m_nUsedChunks;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+#include "Archetype.h"
+#include "HE_Allocator.h"
+
+namespace HE
+{
+	// Chunk memory of a Model, reserved in slabs and recycled through a free list, within an optional budget
+	// A Model with its own arena neither contends on the global heap for its chunks, nor grows past its budget,
+	// ex: one per game session of a server
+	// Not thread-safe: a Model only allocates chunks from one thread at a time. Must outlive its Model
+	class ChunkArena
+	{
+	public:
+		static constexpr size_t DefaultChunksPerSlab = 16;
+
+		// nMaxBytes of zero is unbounded
+		explicit ChunkArena(size_t nMaxBytes = 0, size_t nChunksPerSlab = DefaultChunksPerSlab);
+		ChunkArena(const ChunkArena&) = delete;
+		void operator=(const ChunkArena&) = delete;
+		~ChunkArena();
+
+		// Memory for Chunk::Size bytes, aligned to Chunk::ColumnAlignment
+		// Throws std::bad_alloc past the budget, or if a slab cannot be allocated
+		unsigned char* Allocate();
+		void Free(unsigned char* pChunk) noexcept;
+
+		size_t GetUsedBytes() const noexcept { return m_nUsedChunks * Chunk::Size; }
+		// Of the slabs, used or not
+		size_t GetReservedBytes() const noexcept { return m_nReservedChunks * Chunk::Size; }
+		size_t GetMaxBytes() const noexcept { return m_nMaxBytes; }
+
+	private:
+		size_t const m_nMaxBytes;
+		size_t const m_nChunksPerSlab;
+
+		std::vector<Blk> m_cSlabs;
+		// Can hold every chunk, so that Free never allocates
+		std::vector<unsigned char*> m_cFreeChunks;
+		size_t m_nReservedChunks{ 0 };
+		size_t m_nUsedChunks{ 0 };
+	};
+}
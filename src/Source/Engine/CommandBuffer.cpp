@@ -0,0 +1,175 @@
+#include "CommandBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "HE_Assert.h"
+#include "Model.h"
+
+namespace HE
+{
+	constexpr size_t CommandBuffer::PageSize;
+
+	CommandBuffer::~CommandBuffer()
+	{
+		Clear();
+		for (auto const& page : m_cPages)
+		{
+			AlignedMallocAllocator::it.deallocate(page);
+		}
+	}
+
+	void CommandBuffer::Clear() noexcept
+	{
+		DropCommands(0);
+		m_nPendingEntities = 0;
+		m_nPage = 0;
+		m_nPageOffset = 0;
+	}
+
+	void CommandBuffer::Playback(Model& model)
+	{
+		EXPECTS(&model == &m_model);
+
+		m_cCreatedEntities.clear();
+		try
+		{
+			m_cCreatedEntities.reserve(m_nPendingEntities);
+
+			// Pending handles come from this buffer, and refer to an entity it created before
+			auto const resolve = [this](EntityHandle entity) {
+				if (!entity.IsPending()) return entity;
+				EXPECTS(entity.GetIndex() < m_cCreatedEntities.size());
+				return m_cCreatedEntities[entity.GetIndex()];
+			};
+
+			EntityLocation created{};
+			for (auto& command : m_cCommands)
+			{
+				switch (command.eType)
+				{
+				case CommandType::CreateEntity:
+					m_cCreatedEntities.push_back(model.InsertEntity(Model::AutoGlobalUniqueID, command.nMask));
+					created = model.GetLocation(m_cCreatedEntities.back());
+					break;
+
+				case CommandType::InitComponent:
+					MovePayload(command, created.pArchetype->GetComponent(created, command.nComponentType));
+					break;
+
+				case CommandType::DestroyEntity:
+				{
+					auto const entity = resolve(command.entity);
+					if (model.IsAlive(entity))
+					{
+						model.DestroyEntity(entity);
+					}
+					break;
+				}
+
+				case CommandType::AddComponent:
+				{
+					auto const entity = resolve(command.entity);
+					if (!model.IsAlive(entity)) break;
+
+					if (auto const pExisting = model.GetComponent(entity, command.nComponentType))
+					{
+						auto const& info = GetComponentTypeInfo(command.nComponentType);
+						info.pDestroy(pExisting);
+						MovePayload(command, pExisting);
+						model.MarkChanged(entity, GetComponentBit(command.nComponentType));
+					}
+					else
+					{
+						MovePayload(command, model.AddComponent(entity, command.nComponentType));
+					}
+					break;
+				}
+
+				case CommandType::RemoveComponent:
+				{
+					auto const entity = resolve(command.entity);
+					if (model.IsAlive(entity))
+					{
+						model.RemoveComponent(entity, command.nComponentType);
+					}
+					break;
+				}
+				}
+			}
+		}
+		catch (...)
+		{
+			Clear();
+			throw;
+		}
+
+		Clear();
+	}
+
+	void CommandBuffer::DropCommands(size_t nFirst) noexcept
+	{
+		for (auto i = nFirst; i < m_cCommands.size(); ++i)
+		{
+			auto const& command = m_cCommands[i];
+			if (!command.pPayload) continue;
+
+			auto const& info = GetComponentTypeInfo(command.nComponentType);
+			if (!info.bTriviallyCopyable)
+			{
+				info.pDestroy(command.pPayload);
+			}
+		}
+		m_cCommands.erase(m_cCommands.begin() + nFirst, m_cCommands.end());
+	}
+
+	void* CommandBuffer::AllocatePayload(size_t nSize, size_t nAlignment)
+	{
+		while (true)
+		{
+			if (m_nPage < m_cPages.size())
+			{
+				auto const& page = m_cPages[m_nPage];
+				auto const nOffset = (m_nPageOffset + nAlignment - 1) / nAlignment * nAlignment;
+				if (nOffset + nSize <= page.length)
+				{
+					m_nPageOffset = nOffset + nSize;
+					return static_cast<unsigned char*>(page.ptr) + nOffset;
+				}
+
+				++m_nPage;
+				m_nPageOffset = 0;
+				continue;
+			}
+
+			// Large components get a page of their own
+			auto const nPageSize = std::max(PageSize, nSize);
+			auto const b = AlignedMallocAllocator::it.allocate(nPageSize, Chunk::ColumnAlignment);
+			if (!b.ptr) throw std::bad_alloc{};
+
+			try
+			{
+				m_cPages.push_back({ b.ptr, nPageSize });
+			}
+			catch (...)
+			{
+				AlignedMallocAllocator::it.deallocate(b);
+				throw;
+			}
+		}
+	}
+
+	void CommandBuffer::MovePayload(Command& command, void* pDestination) noexcept
+	{
+		auto const& info = GetComponentTypeInfo(command.nComponentType);
+		if (info.bTriviallyCopyable)
+		{
+			std::memcpy(pDestination, command.pPayload, info.nSize);
+		}
+		else
+		{
+			info.pRelocate(pDestination, command.pPayload);
+		}
+		command.pPayload = nullptr;
+	}
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Component.h"
+#include "Entity.h"
+#include "HE_Allocator.h"
+
+namespace HE
+{
+	class Model;
+
+	// Records structural changes to a Model, to apply them later with Model::Apply, ex: once the systems
+	// iterating the Model are done
+	//
+	// CreateEntity returns a pending handle, which later commands of the same buffer can refer to. The entity
+	// gets its real handle when the buffer is applied, so that the handles only depend on the order of the
+	// commands. Commands on an entity that no longer exists when the buffer is applied are dropped.
+	// Components are moved into the buffer, then moved again into the Model when applied
+	//
+	// A CommandBuffer is not thread-safe: use one per thread
+	class CommandBuffer
+	{
+	public:
+		explicit CommandBuffer(Model& model) noexcept : m_model(model) { }
+		CommandBuffer(const CommandBuffer&) = delete;
+		void operator=(const CommandBuffer&) = delete;
+		// Destroys the components of the commands that were not applied
+		~CommandBuffer();
+
+		// Form: CreateEntity(components...) -> pending handle of the entity to create
+		template<class... Ts>
+		EntityHandle CreateEntity(Ts&&... components)
+		{
+			EntityHandle const entity{ m_nPendingEntities, EntityHandle::PendingGeneration };
+			auto const nFirstCommand = m_cCommands.size();
+			try
+			{
+				Record({ CommandType::CreateEntity, 0, entity, MakeComponentMask<std::decay_t<Ts>...>(), nullptr });
+				int aRecord[] = { 0, (RecordComponent(CommandType::InitComponent, entity, std::forward<Ts>(components)), 0)... };
+				(void)aRecord;
+			}
+			catch (...)
+			{
+				// An entity created without all its components would be left with uninitialized ones
+				DropCommands(nFirstCommand);
+				throw;
+			}
+			++m_nPendingEntities;
+			return entity;
+		}
+
+		void DestroyEntity(EntityHandle entity)
+		{
+			Record({ CommandType::DestroyEntity, 0, entity, 0, nullptr });
+		}
+
+		// Replaces the component if the entity already has one of the type
+		template<class T>
+		void AddComponent(EntityHandle entity, T&& component)
+		{
+			RecordComponent(CommandType::AddComponent, entity, std::forward<T>(component));
+		}
+
+		template<class T>
+		void RemoveComponent(EntityHandle entity)
+		{
+			Record({ CommandType::RemoveComponent, GetComponentTypeId<T>(), entity, 0, nullptr });
+		}
+
+		bool IsEmpty() const noexcept { return m_cCommands.empty(); }
+		size_t GetCommandCount() const noexcept { return m_cCommands.size(); }
+
+		// Drops the commands. Keeps the memory for the next ones
+		void Clear() noexcept;
+
+		// Use Model::Apply. Applies the commands, then clears the buffer
+		// If a command throws, the commands after it are dropped
+		void Playback(Model& model);
+
+		// The entities created by the last Playback, in the order of the CreateEntity calls: the index of a
+		// pending handle in this array is its index
+		const std::vector<EntityHandle>& GetCreatedEntities() const noexcept { return m_cCreatedEntities; }
+
+	private:
+		enum class CommandType : std::uint8_t
+		{
+			CreateEntity,
+			// Constructs a component of the entity created by the previous CreateEntity
+			InitComponent,
+			DestroyEntity,
+			AddComponent,
+			RemoveComponent,
+		};
+
+		struct Command
+		{
+			CommandType eType;
+			ComponentTypeId nComponentType;
+			EntityHandle entity;
+			ComponentMask nMask;
+			// Component moved into the buffer, owned until applied
+			void* pPayload;
+		};
+
+		static constexpr size_t PageSize = 16 * 1024;
+
+		void Record(const Command& command)
+		{
+			ReserveCommand();
+			m_cCommands.push_back(command);
+		}
+
+		void ReserveCommand()
+		{
+			if (m_cCommands.size() == m_cCommands.capacity())
+			{
+				m_cCommands.reserve(m_cCommands.size() < 16 ? 16 : m_cCommands.size() * 2);
+			}
+		}
+
+		// Destroys the payloads of the commands from nFirst, then removes them
+		void DropCommands(size_t nFirst) noexcept;
+
+		template<class T>
+		void RecordComponent(CommandType eType, EntityHandle entity, T&& component)
+		{
+			using Component = std::decay_t<T>;
+			auto const nId = GetComponentTypeId<Component>();
+			ReserveCommand();
+
+			// Nothing can throw between the construction and the push_back, so the payload is never leaked
+			auto const pPayload = new (AllocatePayload(sizeof(Component), alignof(Component))) Component(std::forward<T>(component));
+			m_cCommands.push_back({ eType, nId, entity, 0, pPayload });
+		}
+
+		// Bump allocation in the pages, which are kept until the buffer is destroyed
+		void* AllocatePayload(size_t nSize, size_t nAlignment);
+		// Relocates the payload into pDestination, which is uninitialized
+		static void MovePayload(Command& command, void* pDestination) noexcept;
+
+		Model& m_model;
+		std::vector<Command> m_cCommands;
+		std::uint32_t m_nPendingEntities{ 0 };
+		std::vector<EntityHandle> m_cCreatedEntities;
+
+		std::vector<Blk> m_cPages;
+		size_t m_nPage{ 0 };
+		size_t m_nPageOffset{ 0 };
+	};
+}
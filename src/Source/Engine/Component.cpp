@@ -0,0 +1,47 @@
+#include "Component.h"
+
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace HE
+{
+	namespace
+	{
+		// Only written on registration, under the mutex. Entries never move once written,
+		// so they can be read without the lock by anyone who already has their id
+		ComponentTypeInfo s_aComponentTypes[MaxComponentTypes];
+		ComponentTypeId s_nComponentTypeCount = 0;
+		std::mutex s_mutComponentTypes;
+	}
+
+	namespace Private
+	{
+		ComponentTypeId RegisterComponentType(const ComponentTypeInfo& info)
+		{
+			std::lock_guard<std::mutex> lock{ s_mutComponentTypes };
+			if (s_nComponentTypeCount == MaxComponentTypes)
+			{
+				throw std::length_error{ "Too many component types" };
+			}
+
+			s_aComponentTypes[s_nComponentTypeCount] = info;
+			return s_nComponentTypeCount++;
+		}
+	}
+
+	const ComponentTypeInfo& GetComponentTypeInfo(ComponentTypeId nId) noexcept
+	{
+		return s_aComponentTypes[nId];
+	}
+
+	ComponentTypeId FindComponentType(const char* psName) noexcept
+	{
+		std::lock_guard<std::mutex> lock{ s_mutComponentTypes };
+		for (ComponentTypeId nId = 0; nId < s_nComponentTypeCount; ++nId)
+		{
+			if (std::strcmp(s_aComponentTypes[nId].psName, psName) == 0) return nId;
+		}
+		return MaxComponentTypes;
+	}
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+#include "HE_Reflection.h"
+
+namespace HE
+{
+	// Components are plain types attached to entities, stored by the Model in archetype chunks
+	// Any type can be a component as long as it is default constructible and nothrow move constructible.
+	// Trivially copyable components are moved around with memcpy
+	constexpr size_t MaxComponentTypes = 64;
+
+	using ComponentTypeId = std::uint32_t;
+	// One bit per ComponentTypeId
+	using ComponentMask = std::uint64_t;
+	static_assert(sizeof(ComponentMask) * 8 >= MaxComponentTypes, "ComponentMask is too small for MaxComponentTypes");
+
+	struct ComponentTypeInfo
+	{
+		const char* psName;
+		size_t nSize;
+		size_t nAlignment;
+		bool bTriviallyCopyable;
+		void (*pDefaultConstruct)(void* p);
+		// Move constructs pDst from pSrc, then destroys pSrc
+		void (*pRelocate)(void* pDst, void* pSrc);
+		void (*pDestroy)(void* p);
+		// For the types described with HE_REFLECT, nullptr otherwise
+		// Form: pHash(p, nCount, nHash) -> FNV-1a of the fields of the nCount components at p, continued from nHash
+		std::uint64_t (*pHash)(const void* p, size_t nCount, std::uint64_t nHash);
+		std::string (*pToString)(const void* p);
+	};
+
+	namespace Private
+	{
+		// Thread-safe. Throws std::length_error past MaxComponentTypes
+		ComponentTypeId RegisterComponentType(const ComponentTypeInfo& info);
+
+		template<class T>
+		auto GetHashFunction(std::true_type /*reflected*/) noexcept
+		{
+			return [](const void* p, size_t nCount, std::uint64_t nHash) {
+				auto const pComponents = static_cast<const T*>(p);
+				for (size_t i = 0; i < nCount; ++i)
+				{
+					nHash = Reflection::Hash(pComponents[i], nHash);
+				}
+				return nHash;
+			};
+		}
+
+		template<class T>
+		std::uint64_t (*GetHashFunction(std::false_type) noexcept)(const void*, size_t, std::uint64_t)
+		{
+			return nullptr;
+		}
+
+		template<class T>
+		auto GetToStringFunction(std::true_type /*reflected*/) noexcept
+		{
+			return [](const void* p) { return Reflection::ToString(*static_cast<const T*>(p)); };
+		}
+
+		template<class T>
+		std::string (*GetToStringFunction(std::false_type) noexcept)(const void*)
+		{
+			return nullptr;
+		}
+
+		template<class T>
+		ComponentTypeInfo MakeComponentTypeInfo() noexcept
+		{
+			static_assert(std::is_default_constructible<T>::value, "Components must be default constructible");
+			static_assert(std::is_nothrow_move_constructible<T>::value, "Components must be nothrow move constructible");
+
+			return{
+				typeid(T).name(),
+				sizeof(T),
+				alignof(T),
+				std::is_trivially_copyable<T>::value,
+				[](void* p) { new (p) T(); },
+				[](void* pDst, void* pSrc) { auto& src = *static_cast<T*>(pSrc); new (pDst) T(std::move(src)); src.~T(); },
+				[](void* p) { static_cast<T*>(p)->~T(); },
+				GetHashFunction<T>(Reflection::IsReflected<T>{}),
+				GetToStringFunction<T>(Reflection::IsReflected<T>{})
+			};
+		}
+	}
+
+	namespace Private
+	{
+		template<class T>
+		ComponentTypeId GetComponentTypeIdImpl()
+		{
+			static ComponentTypeId const s_nId = RegisterComponentType(MakeComponentTypeInfo<T>());
+			return s_nId;
+		}
+	}
+
+	// Ids are given in order of first use, so they are only stable within a process
+	// T and const T have the same id
+	template<class T>
+	ComponentTypeId GetComponentTypeId()
+	{
+		return Private::GetComponentTypeIdImpl<std::remove_cv_t<std::remove_reference_t<T>>>();
+	}
+
+	const ComponentTypeInfo& GetComponentTypeInfo(ComponentTypeId nId) noexcept;
+
+	// Returns the id of the component type registered with the name, or MaxComponentTypes if there is none
+	// Only finds the types used at least once in the process, ex: by GetComponentTypeId
+	ComponentTypeId FindComponentType(const char* psName) noexcept;
+
+	inline ComponentMask GetComponentBit(ComponentTypeId nId) noexcept
+	{
+		return ComponentMask{ 1 } << nId;
+	}
+
+	template<class... Ts>
+	ComponentMask MakeComponentMask()
+	{
+		ComponentMask nMask = 0;
+		int aBits[] = { 0, (nMask |= GetComponentBit(GetComponentTypeId<Ts>()), 0)... };
+		(void)aBits;
+		return nMask;
+	}
+
+	// Form: MakeWriteMask<Ts...>() -> mask of the Ts that are not const, ex: the components a Query writes
+	template<class... Ts>
+	ComponentMask MakeWriteMask()
+	{
+		ComponentMask nMask = 0;
+		int aBits[] = { 0, (nMask |= std::is_const<Ts>::value ? 0 : GetComponentBit(GetComponentTypeId<Ts>()), 0)... };
+		(void)aBits;
+		return nMask;
+	}
+}
@@ -1,16 +1,56 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 
 namespace HE
 {
-	class Entity
+	// Reference to an entity of a Model, valid for the lifetime of the entity
+	//
+	// The index is the slot of the entity in the Model, reused once the entity is destroyed. The generation
+	// is bumped every time the slot is freed, so that a handle to a destroyed entity never resolves to
+	// the entity that took its slot. Handles are not persistent: use the global unique ID of the entity
+	// to refer to it across runs (see Model::GetGlobalUniqueID)
+	class EntityHandle
 	{
 	public:
+		// Never given by a Model, for handles standing for entities that are not created yet (see CommandBuffer)
+		static constexpr std::uint32_t PendingGeneration = ~std::uint32_t{ 0 };
 
-		auto GetGlobalUniqueID() const noexcept { return m_nGlobalUniqueID; }
+		// The invalid handle
+		constexpr EntityHandle() noexcept = default;
+		constexpr EntityHandle(std::uint32_t nIndex, std::uint32_t nGeneration) noexcept
+			: m_nIndex(nIndex),
+			m_nGeneration(nGeneration)
+		{
+
+		}
+
+		std::uint32_t GetIndex() const noexcept { return m_nIndex; }
+		std::uint32_t GetGeneration() const noexcept { return m_nGeneration; }
+		bool IsValid() const noexcept { return m_nGeneration != 0; }
+		bool IsPending() const noexcept { return m_nGeneration == PendingGeneration; }
+
+		// Both, as a single value
+		std::uint64_t GetValue() const noexcept { return (std::uint64_t{ m_nGeneration } << 32) | m_nIndex; }
 
 	private:
-		std::uint64_t m_nGlobalUniqueID;
+		std::uint32_t m_nIndex{ 0 };
+		std::uint32_t m_nGeneration{ 0 };
+	};
+
+	inline bool operator==(EntityHandle lhs, EntityHandle rhs) noexcept { return lhs.GetValue() == rhs.GetValue(); }
+	inline bool operator!=(EntityHandle lhs, EntityHandle rhs) noexcept { return !(lhs == rhs); }
+}
+
+namespace std
+{
+	template<>
+	struct hash<HE::EntityHandle>
+	{
+		size_t operator()(HE::EntityHandle entity) const noexcept
+		{
+			return std::hash<std::uint64_t>{}(entity.GetValue());
+		}
 	};
-}
\ No newline at end of file
+}
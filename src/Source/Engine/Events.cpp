@@ -0,0 +1,15 @@
+#include "Events.h"
+
+#include <atomic>
+
+namespace HE
+{
+	namespace Private
+	{
+		EventTypeId NextEventTypeId() noexcept
+		{
+			static std::atomic<EventTypeId> s_nNextId{ 0 };
+			return s_nNextId.fetch_add(1);
+		}
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace HE
+{
+	using EventTypeId = std::uint32_t;
+
+	namespace Private
+	{
+		EventTypeId NextEventTypeId() noexcept;
+
+		template<class T>
+		EventTypeId GetEventTypeIdImpl() noexcept
+		{
+			static EventTypeId const s_nId = NextEventTypeId();
+			return s_nId;
+		}
+
+		struct EventListBase
+		{
+			virtual ~EventListBase() = default;
+			// Moves the events to the end of other, which holds the same type
+			virtual void AppendTo(EventListBase& other) = 0;
+			virtual void Clear() noexcept = 0;
+			virtual std::unique_ptr<EventListBase> CloneEmpty() const = 0;
+		};
+
+		template<class T>
+		struct EventList : EventListBase
+		{
+			std::vector<T> cEvents;
+
+			void AppendTo(EventListBase& other) override
+			{
+				auto& cOther = static_cast<EventList&>(other).cEvents;
+				cOther.insert(cOther.end(), std::make_move_iterator(cEvents.begin()), std::make_move_iterator(cEvents.end()));
+				cEvents.clear();
+			}
+
+			void Clear() noexcept override { cEvents.clear(); }
+			std::unique_ptr<EventListBase> CloneEmpty() const override { return std::make_unique<EventList>(); }
+		};
+	}
+
+	// Ids are given in order of first use, so they are only stable within a process
+	template<class T>
+	EventTypeId GetEventTypeId() noexcept
+	{
+		return Private::GetEventTypeIdImpl<std::remove_cv_t<std::remove_reference_t<T>>>();
+	}
+
+	// Events of any type, each type in emission order
+	// Events are plain values, ex: a collision between two entities, that systems emit for later systems to react to
+	class EventStore
+	{
+	public:
+		template<class T>
+		void Emit(T&& event)
+		{
+			GetList<std::decay_t<T>>().cEvents.push_back(std::forward<T>(event));
+		}
+
+		// The events of the type, in emission order
+		template<class T>
+		const std::vector<T>& Get() const noexcept
+		{
+			static std::vector<T> const s_cNone;
+			auto const nId = GetEventTypeId<T>();
+			return nId < m_cLists.size() && m_cLists[nId] ? static_cast<const Private::EventList<T>&>(*m_cLists[nId]).cEvents : s_cNone;
+		}
+
+		// Moves the events to the end of the ones of other
+		void AppendTo(EventStore& other)
+		{
+			for (size_t i = 0; i < m_cLists.size(); ++i)
+			{
+				if (!m_cLists[i]) continue;
+
+				if (other.m_cLists.size() <= i) other.m_cLists.resize(i + 1);
+				if (!other.m_cLists[i]) other.m_cLists[i] = m_cLists[i]->CloneEmpty();
+				m_cLists[i]->AppendTo(*other.m_cLists[i]);
+			}
+		}
+
+		// Keeps the memory for the next events
+		void Clear() noexcept
+		{
+			for (auto& pList : m_cLists)
+			{
+				if (pList) pList->Clear();
+			}
+		}
+
+	private:
+		template<class T>
+		Private::EventList<T>& GetList()
+		{
+			auto const nId = GetEventTypeId<T>();
+			if (m_cLists.size() <= nId) m_cLists.resize(nId + 1);
+			if (!m_cLists[nId]) m_cLists[nId] = std::make_unique<Private::EventList<T>>();
+			return static_cast<Private::EventList<T>&>(*m_cLists[nId]);
+		}
+
+		// By EventTypeId
+		std::vector<std::unique_ptr<Private::EventListBase>> m_cLists;
+	};
+}
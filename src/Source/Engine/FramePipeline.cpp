@@ -0,0 +1,168 @@
+#include "FramePipeline.h"
+
+#include <algorithm>
+
+#include "HE_Assert.h"
+#include "HE_Profiler.h"
+
+namespace HE
+{
+	FramePipeline::FramePipeline(JobSystem& jobSystem, size_t nDepth)
+		: m_jobSystem(jobSystem),
+		m_nDepth(nDepth),
+		m_aFrames(std::make_unique<Frame[]>(nDepth))
+	{
+		EXPECTS(nDepth > 0);
+	}
+
+	FramePipeline::~FramePipeline()
+	{
+		try
+		{
+			Flush();
+		}
+		catch (...)
+		{
+			// Nobody is left to handle it
+		}
+	}
+
+	size_t FramePipeline::AddStage(std::string sName, StageFunction f)
+	{
+		auto const nStage = m_cStages.size();
+		auto const psProfileName = InternProfileName(sName);
+		m_cStages.push_back({ std::move(sName), psProfileName, std::move(f), nStage });
+		return nStage;
+	}
+
+	void FramePipeline::AddPreviousFrameDependency(size_t nStage, size_t nPreviousFrameStage)
+	{
+		EXPECTS(nStage <= nPreviousFrameStage && nPreviousFrameStage < m_cStages.size());
+		auto& stage = m_cStages[nStage];
+		stage.nPreviousFrameStage = std::max(stage.nPreviousFrameStage, nPreviousFrameStage);
+	}
+
+	PipelineFrame FramePipeline::StartFrame(const std::function<void(const PipelineFrame&)>& prepare)
+	{
+		EXPECTS(!m_cStages.empty());
+
+		std::unique_lock<std::mutex> lock{ m_mutFrames };
+		RethrowException(lock);
+		// Backpressure
+		while (m_nNext - m_nOldest == m_nDepth)
+		{
+			WaitOldest(lock);
+		}
+		RethrowException(lock);
+
+		PipelineFrame const started{ m_nNext, static_cast<size_t>(m_nNext % m_nDepth) };
+		if (prepare)
+		{
+			// The slot is free, and only this thread starts frames
+			lock.unlock();
+			prepare(started);
+			lock.lock();
+		}
+
+		auto& frame = GetFrame(m_nNext);
+		frame.nNumber = m_nNext;
+		frame.nNextStage = 0;
+		frame.bRunning = false;
+		++m_nNext;
+
+		TrySchedule(started.nNumber);
+		return started;
+	}
+
+	void FramePipeline::Flush()
+	{
+		std::unique_lock<std::mutex> lock{ m_mutFrames };
+		while (m_nOldest != m_nNext)
+		{
+			WaitOldest(lock);
+		}
+		RethrowException(lock);
+	}
+
+	size_t FramePipeline::GetFramesInFlight() const
+	{
+		std::lock_guard<std::mutex> lock{ m_mutFrames };
+		return static_cast<size_t>(m_nNext - m_nOldest);
+	}
+
+	void FramePipeline::WaitOldest(std::unique_lock<std::mutex>& lock)
+	{
+		auto& counter = GetFrame(m_nOldest).counter;
+		lock.unlock();
+		m_jobSystem.Wait(counter);
+		lock.lock();
+	}
+
+	void FramePipeline::RethrowException(std::unique_lock<std::mutex>& lock)
+	{
+		if (!m_pException) return;
+
+		// The frames left in flight skip their stages
+		while (m_nOldest != m_nNext)
+		{
+			WaitOldest(lock);
+		}
+
+		auto const pException = m_pException;
+		m_pException = nullptr;
+		std::rethrow_exception(pException);
+	}
+
+	void FramePipeline::TrySchedule(std::uint64_t nNumber)
+	{
+		if (nNumber < m_nOldest || nNumber >= m_nNext) return;
+
+		auto& frame = GetFrame(nNumber);
+		if (frame.bRunning || frame.nNextStage == m_cStages.size()) return;
+
+		// The oldest frame never waits, so the pipeline always moves
+		if (nNumber != m_nOldest && GetFrame(nNumber - 1).nNextStage <= m_cStages[frame.nNextStage].nPreviousFrameStage) return;
+
+		frame.bRunning = true;
+		m_jobSystem.Run(frame.counter, [this, &frame]() { RunStage(frame); });
+	}
+
+	void FramePipeline::RunStage(Frame& frame) noexcept
+	{
+		size_t nStage;
+		PipelineFrame info;
+		bool bSkip;
+		{
+			std::lock_guard<std::mutex> lock{ m_mutFrames };
+			nStage = frame.nNextStage;
+			info = { frame.nNumber, static_cast<size_t>(frame.nNumber % m_nDepth) };
+			bSkip = m_pException != nullptr;
+		}
+
+		if (!bSkip)
+		{
+			try
+			{
+				HE_PROFILE_SCOPE(m_cStages[nStage].psProfileName);
+				m_cStages[nStage].f(info);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock{ m_mutFrames };
+				if (!m_pException) m_pException = std::current_exception();
+			}
+		}
+
+		std::lock_guard<std::mutex> lock{ m_mutFrames };
+		frame.bRunning = false;
+		if (++frame.nNextStage == m_cStages.size())
+		{
+			// Frames finish in order, since the last stage runs in frame order
+			++m_nOldest;
+		}
+
+		// Scheduled before this job ends, so that the counter of the oldest frame stays pending
+		TrySchedule(info.nNumber);
+		TrySchedule(info.nNumber + 1);
+	}
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "HE_JobSystem.h"
+
+namespace HE
+{
+	struct PipelineFrame
+	{
+		// Number of the frame, from 0
+		std::uint64_t nNumber;
+		// In [0, depth). Frames in flight have different slots, to index per-frame data
+		size_t nSlot;
+	};
+
+	// Runs frames through a sequence of stages on the JobSystem, ex: simulate, extract, cull, record, submit,
+	// with several frames in flight
+	//
+	// Each stage runs on one frame at a time, in frame order: a stage of a frame runs after the previous stage
+	// of the same frame, and after the same stage of the previous frame. So different stages work on different
+	// frames at the same time, and once the pipeline is full, a frame is done every time the slowest stage is,
+	// instead of after all the stages. A stage can also wait for a later stage of the previous frame, ex: the
+	// simulation waits for the previous extraction to be done reading the Model
+	//
+	// StartFrame blocks while depth frames are in flight, which bounds the latency and the per-frame data
+	// Stages must not throw: an exception skips the stages left in the pipeline, and is rethrown by the next
+	// StartFrame or Flush
+	class FramePipeline
+	{
+	public:
+		using StageFunction = std::function<void(const PipelineFrame&)>;
+
+		FramePipeline(JobSystem& jobSystem, size_t nDepth);
+		FramePipeline(const FramePipeline&) = delete;
+		void operator=(const FramePipeline&) = delete;
+		// Flushes, and drops the exception of a stage if there is one
+		~FramePipeline();
+
+		size_t GetDepth() const noexcept { return m_nDepth; }
+		size_t GetStageCount() const noexcept { return m_cStages.size(); }
+		const std::string& GetStageName(size_t nStage) const noexcept { return m_cStages[nStage].sName; }
+
+		// Not thread-safe: add the stages before the first frame
+		// Returns the index of the stage
+		size_t AddStage(std::string sName, StageFunction f);
+		// The stage of a frame also waits for nPreviousFrameStage of the previous frame, which comes after it
+		void AddPreviousFrameDependency(size_t nStage, size_t nPreviousFrameStage);
+
+		// Starts the next frame through the stages, and returns it. Only call from one thread
+		// Waits, running jobs meanwhile, while depth frames are in flight. Then calls prepare(frame), if any, to fill
+		// the per-frame data of its slot before its stages run
+		PipelineFrame StartFrame(const std::function<void(const PipelineFrame&)>& prepare = nullptr);
+
+		// Waits for all the frames in flight to be done
+		void Flush();
+
+		size_t GetFramesInFlight() const;
+
+	private:
+		struct Stage
+		{
+			std::string sName;
+			const char* psProfileName;
+			StageFunction f;
+			// The stage of the previous frame this stage waits for
+			size_t nPreviousFrameStage;
+		};
+
+		struct Frame
+		{
+			std::uint64_t nNumber{ 0 };
+			// Stages before it are done
+			size_t nNextStage{ 0 };
+			bool bRunning{ false };
+			// Counts the job running the stage of the frame. Not done while the frame is the oldest in flight,
+			// since each stage of the oldest frame schedules the next one before finishing
+			JobCounter counter;
+		};
+
+		Frame& GetFrame(std::uint64_t nNumber) noexcept { return m_aFrames[nNumber % m_nDepth]; }
+
+		// Waits for the oldest frame, then rethrows the exception of a stage, if any
+		void WaitOldest(std::unique_lock<std::mutex>& lock);
+		void RethrowException(std::unique_lock<std::mutex>& lock);
+		// Requires the lock. Schedules the next stage of the frame if it is in flight and ready to run
+		void TrySchedule(std::uint64_t nNumber);
+		void RunStage(Frame& frame) noexcept;
+
+		JobSystem& m_jobSystem;
+		size_t const m_nDepth;
+		std::vector<Stage> m_cStages;
+		std::unique_ptr<Frame[]> m_aFrames;
+
+		mutable std::mutex m_mutFrames;
+		// Frames in [m_nOldest, m_nNext) are in flight
+		std::uint64_t m_nOldest{ 0 };
+		std::uint64_t m_nNext{ 0 };
+		std::exception_ptr m_pException;
+	};
+}
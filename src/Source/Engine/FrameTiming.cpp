@@ -0,0 +1,76 @@
+#include "FrameTiming.h"
+
+#include <algorithm>
+
+#include "HE_String.h"
+
+namespace HE
+{
+	constexpr size_t FrameTimingHistory::HistorySize;
+
+	void FrameTimingHistory::Add(const FrameTiming& timing) noexcept
+	{
+		m_aFrames[m_nNext] = timing;
+		m_nNext = (m_nNext + 1) % HistorySize;
+		m_nCount = std::min(m_nCount + 1, HistorySize);
+
+		++m_nTotalFrames;
+		m_nTotalTicks += timing.nTicks;
+		if (timing.bOverrun) ++m_nTotalOverruns;
+	}
+
+	FrameTimingSummary FrameTimingHistory::GetSummary() const noexcept
+	{
+		using std::chrono::nanoseconds;
+
+		FrameTimingSummary summary;
+		summary.nTotalFrames = m_nTotalFrames;
+		summary.nTotalTicks = m_nTotalTicks;
+		summary.nTotalOverruns = m_nTotalOverruns;
+		summary.nFrames = static_cast<std::uint32_t>(m_nCount);
+		if (m_nCount == 0) return summary;
+
+		nanoseconds tTotalInterval{ 0 }, tTotalWork{ 0 }, tTotalJitter{ 0 };
+		std::uint64_t nTicks = 0;
+		for (size_t i = 0; i < m_nCount; ++i)
+		{
+			auto const& frame = m_aFrames[i];
+			auto const tJitter = m_tTargetPeriod.count() > 0 ? (frame.tInterval > m_tTargetPeriod ? frame.tInterval - m_tTargetPeriod : m_tTargetPeriod - frame.tInterval) : nanoseconds{ 0 };
+
+			tTotalInterval += frame.tInterval;
+			tTotalWork += frame.tWork;
+			tTotalJitter += tJitter;
+			nTicks += frame.nTicks;
+			if (frame.bOverrun) ++summary.nOverruns;
+
+			summary.tMaxInterval = std::max(summary.tMaxInterval, frame.tInterval);
+			summary.tMaxWork = std::max(summary.tMaxWork, frame.tWork);
+			summary.tMaxJitter = std::max(summary.tMaxJitter, tJitter);
+		}
+
+		auto const nCount = static_cast<nanoseconds::rep>(m_nCount);
+		summary.tMeanInterval = tTotalInterval / nCount;
+		summary.tMeanWork = tTotalWork / nCount;
+		summary.tMeanJitter = tTotalJitter / nCount;
+
+		if (tTotalInterval.count() > 0)
+		{
+			auto const fSeconds = std::chrono::duration<double>(tTotalInterval).count();
+			summary.fFrameRate = m_nCount / fSeconds;
+			summary.fTickRate = nTicks / fSeconds;
+		}
+
+		return summary;
+	}
+
+	std::string to_string(const FrameTimingSummary& summary)
+	{
+		auto const ToMs = [](std::chrono::nanoseconds t) { return std::chrono::duration<double, std::milli>(t).count(); };
+		return Format("{_:.1} fps, {_:.1} ticks/s, frame {_:.3}ms (max {_:.3}ms), work {_:.3}ms (max {_:.3}ms), jitter {_:.3}ms (max {_:.3}ms), {_} overruns ({_} total)",
+			summary.fFrameRate, summary.fTickRate,
+			ToMs(summary.tMeanInterval), ToMs(summary.tMaxInterval),
+			ToMs(summary.tMeanWork), ToMs(summary.tMaxWork),
+			ToMs(summary.tMeanJitter), ToMs(summary.tMaxJitter),
+			summary.nOverruns, summary.nTotalOverruns);
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace HE
+{
+	// Timing of a single iteration of the Engine loop
+	struct FrameTiming
+	{
+		// Time between the start of the previous frame and the start of this one
+		std::chrono::nanoseconds tInterval{ 0 };
+		// Time from the start of the frame to the end of its last stage in the pipeline. With several frames in
+		// flight, it can be longer than the frame period without the frames falling behind
+		std::chrono::nanoseconds tWork{ 0 };
+		// Simulation ticks run during the frame
+		std::uint32_t nTicks{ 0 };
+		// The stages of the frame ended after the frame that reuses its slot in the pipeline was due to start,
+		// which delays that frame. With one frame in flight, after the deadline of the next frame
+		bool bOverrun{ false };
+	};
+
+	// Statistics over the recent frames of a FrameTimingHistory
+	struct FrameTimingSummary
+	{
+		// Totals since the start
+		std::uint64_t nTotalFrames{ 0 };
+		std::uint64_t nTotalTicks{ 0 };
+		std::uint64_t nTotalOverruns{ 0 };
+
+		// Over the recent frames
+		std::uint32_t nFrames{ 0 };
+		std::uint32_t nOverruns{ 0 };
+		std::chrono::nanoseconds tMeanInterval{ 0 };
+		std::chrono::nanoseconds tMaxInterval{ 0 };
+		std::chrono::nanoseconds tMeanWork{ 0 };
+		std::chrono::nanoseconds tMaxWork{ 0 };
+		// Mean and max of |tInterval - target frame period|
+		std::chrono::nanoseconds tMeanJitter{ 0 };
+		std::chrono::nanoseconds tMaxJitter{ 0 };
+		double fFrameRate{ 0.0 };
+		double fTickRate{ 0.0 };
+	};
+
+	// Keeps the timings of the last HistorySize frames, and running totals
+	// Not thread-safe
+	class FrameTimingHistory
+	{
+	public:
+		static constexpr size_t HistorySize = 256;
+
+		// tTargetPeriod is the interval the frames should have, used for jitter. Zero if uncapped
+		explicit FrameTimingHistory(std::chrono::nanoseconds tTargetPeriod) noexcept
+			: m_tTargetPeriod(tTargetPeriod)
+		{
+
+		}
+
+		void Add(const FrameTiming& timing) noexcept;
+
+		FrameTimingSummary GetSummary() const noexcept;
+
+	private:
+		std::chrono::nanoseconds m_tTargetPeriod;
+		std::array<FrameTiming, HistorySize> m_aFrames;
+		size_t m_nNext{ 0 };
+		size_t m_nCount{ 0 };
+
+		std::uint64_t m_nTotalFrames{ 0 };
+		std::uint64_t m_nTotalTicks{ 0 };
+		std::uint64_t m_nTotalOverruns{ 0 };
+	};
+
+	std::string to_string(const FrameTimingSummary& summary);
+}
@@ -1,48 +1,193 @@
 #include "HazelEngine.h"
 
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+#include "Entity.h"
 #include "HE_Assert.h"
+#include "HE_Log.h"
 #include "HE_String.h"
 
+HE_DEFINE_LOG_CATEGORY(Engine, Info);
+
 namespace HE
 {
+	namespace
+	{
+		// The Engine stops if its Model stays empty for that long
+		constexpr auto BoredomDelay = std::chrono::seconds{ 10 };
+		// Bounds how long the summaries of the deduplicating sinks and the mapped log file lag behind
+		constexpr auto LogFlushPeriod = std::chrono::seconds{ 1 };
+
+		[[noreturn]] void ThrowInvalidArgument(const std::string& sName, const std::string& sValue)
+		{
+			throw std::invalid_argument{ Format("Invalid value for {_}: \"{_}\"", sName, sValue) };
+		}
+
+		// Form: ParseNumber(sName, sValue) -> finite value, positive or zero
+		double ParseNumber(const std::string& sName, const std::string& sValue)
+		{
+			size_t nEnd = 0;
+			double f = 0.0;
+			try
+			{
+				f = std::stod(sValue, &nEnd);
+			}
+			catch (const std::exception&)
+			{
+				ThrowInvalidArgument(sName, sValue);
+			}
+			if (nEnd != sValue.size() || !(f >= 0.0) || std::isinf(f)) ThrowInvalidArgument(sName, sValue);
+			return f;
+		}
+
+		std::uint64_t ParseCount(const std::string& sName, const std::string& sValue)
+		{
+			auto const f = ParseNumber(sName, sValue);
+			if (f != std::floor(f) || f > 9007199254740992.0) ThrowInvalidArgument(sName, sValue);
+			return static_cast<std::uint64_t>(f);
+		}
+
+		// Form: ParsePeriod(sName, sValue, bZeroAllowed) -> period of the rate in sValue, zero for a rate of zero
+		std::chrono::nanoseconds ParsePeriod(const std::string& sName, const std::string& sValue, bool bZeroAllowed)
+		{
+			auto const fRate = ParseNumber(sName, sValue);
+			if (fRate == 0.0)
+			{
+				if (!bZeroAllowed) ThrowInvalidArgument(sName, sValue);
+				return std::chrono::nanoseconds{ 0 };
+			}
+			auto const fPeriod = std::round(1e9 / fRate);
+			if (fPeriod < 1.0) ThrowInvalidArgument(sName, sValue);
+			return std::chrono::nanoseconds{ static_cast<std::chrono::nanoseconds::rep>(fPeriod) };
+		}
+	}
+
+	EngineSettings ParseEngineSettings(const std::vector<std::string>& cArgs, const EngineSettings& defaults)
+	{
+		auto settings = defaults;
+		for (auto const& sArg : cArgs)
+		{
+			auto const nEquals = sArg.find('=');
+			auto const sName = sArg.substr(0, nEquals);
+			auto const sValue = nEquals != std::string::npos ? sArg.substr(nEquals + 1) : std::string{};
+			if (sName == "--headless")
+			{
+				// Takes no value
+				if (nEquals != std::string::npos) ThrowInvalidArgument(sName, sValue);
+				settings.bHeadless = true;
+			}
+			else if (sName == "--tick-rate")
+			{
+				settings.tTickPeriod = ParsePeriod(sName, sValue, false);
+			}
+			else if (sName == "--frame-rate")
+			{
+				settings.tFramePeriod = ParsePeriod(sName, sValue, true);
+			}
+			else if (sName == "--time-scale")
+			{
+				settings.fTimeScale = ParseNumber(sName, sValue);
+			}
+			else if (sName == "--max-ticks")
+			{
+				settings.nMaxTicks = ParseCount(sName, sValue);
+			}
+			else if (sName == "--max-ticks-per-frame")
+			{
+				auto const nTicks = ParseCount(sName, sValue);
+				if (nTicks == 0 || nTicks > 0xFFFFFFFF) ThrowInvalidArgument(sName, sValue);
+				settings.nMaxTicksPerFrame = static_cast<std::uint32_t>(nTicks);
+			}
+			else if (sName == "--workers")
+			{
+				settings.nWorkerThreads = static_cast<size_t>(ParseCount(sName, sValue));
+			}
+			else if (sName == "--metrics-log-period")
+			{
+				auto const fSeconds = ParseNumber(sName, sValue);
+				settings.tMetricsLogPeriod = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>{ fSeconds });
+			}
+			else if (sName == "--record-replay")
+			{
+				if (sValue.empty()) ThrowInvalidArgument(sName, sValue);
+				settings.sRecordReplayPath = sValue;
+			}
+			else if (sName.compare(0, 2, "--") == 0)
+			{
+				// Most likely meant for the application, but a misspelled Engine argument would go unnoticed otherwise
+				HE_LOG(Warning, Engine, "Unknown Engine argument \"{_}\", left to the application", sArg);
+			}
+		}
+		return settings;
+	}
+
+	Engine::Engine()
+		: Engine(EngineSettings{})
+	{
+
+	}
+
+	Engine::Engine(const EngineSettings& settings)
+		: m_settings(settings)
+	{
+		EXPECTS(m_settings.tTickPeriod.count() > 0 && m_settings.nMaxTicksPerFrame > 0 && m_settings.fTimeScale >= 0.0);
+
+		m_model.GetSystems().SetMetrics(&m_metrics);
+
+		if (!m_settings.sRecordReplayPath.empty())
+		{
+			m_replayFile.open(m_settings.sRecordReplayPath, std::ios::binary | std::ios::trunc);
+			if (!m_replayFile) throw std::runtime_error{ Format("Could not create the replay file \"{_}\"", m_settings.sRecordReplayPath) };
+		}
+
+		for (size_t i = 0; i < m_settings.nPipelineDepth; ++i)
+		{
+			m_cFrames.push_back({ 0, 0.0, ModelSnapshot{ m_settings.nSnapshotComponents }, {}, {} });
+		}
+
+		auto const nSimulate = m_pipeline.AddStage("Simulate", [this](const PipelineFrame& frame) { Simulate(frame); });
+		if (m_settings.bHeadless) return;
+
+		auto const nExtract = m_pipeline.AddStage("Extract", [this](const PipelineFrame& frame) { Extract(frame); });
+		// The extraction reads the Model that the next simulation writes
+		m_pipeline.AddPreviousFrameDependency(nSimulate, nExtract);
+	}
+
 	Engine::Engine(const std::vector<std::string>& args)
+		: Engine(ParseEngineSettings(args))
 	{
 
 	}
 
-	Engine::~Engine() { Stop(); }
+	Engine::~Engine()
+	{
+		Stop();
+		if (m_runThread.joinable()) m_runThread.join();
+	}
 
 	std::future<void> Engine::Run()
 	{
 		EXPECTS(!m_bRunning);
 
 		m_bRunning = true;
+		// After the render stages
+		m_pipeline.AddStage("EndFrame", [this](const PipelineFrame& frame) { EndFrame(frame); });
 
 		std::packaged_task<void()> engineRun([this]() {
-			using namespace std::literals::chrono_literals;
-
-			Log("Hello, this is HazelEngine");
+			HE_LOG(Info, Engine, "Hello, this is HazelEngine");
 
-			auto i = 0;
-			while (!m_bShouldStop) 
-			{ 
-				std::this_thread::sleep_for(100ms); 
-				++i;
-				if (i > 100)
-				{
-					Log("HazelEngine got bored doing nothing, it will now stop");
-					Stop();
-					break;
-				}
-			}
+			RunLoop();
 
-			Log("HazelEngine has stopped");
+			HE_LOG(Info, Engine, "HazelEngine has stopped. {_}", GetFrameTimingSummary());
+			FlushLogSinks();
 			return;
 		});
 		auto futEngineEnd = engineRun.get_future();
 
-		std::thread task_td(std::move(engineRun));
-		task_td.detach();
+		m_runThread = std::thread{ std::move(engineRun) };
 
 		return futEngineEnd;
 	}
@@ -50,5 +195,257 @@ namespace HE
 	void Engine::Stop()
 	{
 		m_bShouldStop = true;
+		m_pacer.Wake();
+	}
+
+	void Engine::AddRenderStage(std::string sName, std::function<void(const ModelSnapshot&, const PipelineFrame&)> f)
+	{
+		EXPECTS(!m_bRunning && !m_settings.bHeadless);
+
+		m_bRenderStages = true;
+		m_pipeline.AddStage(std::move(sName), [this, f](const PipelineFrame& frame) {
+			f(m_cFrames[frame.nSlot].snapshot, frame);
+		});
+	}
+
+	void Engine::QueueInput(const void* pData, size_t nSize)
+	{
+		auto const pBytes = static_cast<const unsigned char*>(pData);
+		std::lock_guard<std::mutex> lock{ m_mutInput };
+		m_cQueuedInput.insert(m_cQueuedInput.end(), pBytes, pBytes + nSize);
+	}
+
+	FrameTimingSummary Engine::GetFrameTimingSummary() const
+	{
+		std::lock_guard<std::mutex> lock{ m_mutFrameTiming };
+		return m_frameTiming.GetSummary();
+	}
+
+	ProfileCapture Engine::CaptureProfile() const
+	{
+		std::lock_guard<std::mutex> lock{ m_mutProfile };
+		return m_profile.Capture();
+	}
+
+	void Engine::RunLoop()
+	{
+		using Clock = FramePacer::Clock;
+		using std::chrono::nanoseconds;
+
+		auto const tTick = m_settings.tTickPeriod;
+		// Elapsed time beyond what the tick cap can consume is dropped
+		auto const tMaxElapsed = tTick * m_settings.nMaxTicksPerFrame;
+
+		auto const tStart = Clock::now();
+		auto tFrameStart = tStart;
+		auto tNextFrame = tStart;
+		nanoseconds tAccumulator{ 0 };
+		auto tLastActivity = tStart;
+		std::uint64_t nTotalTicks = 0;
+		SetProfileThreadName("Engine");
+		if (m_replayFile.is_open())
+		{
+			m_pReplayRecorder = std::make_unique<ReplayRecorder>(m_replayFile, m_model);
+		}
+
+		auto& frameInterval = m_metrics.GetHistogram("Engine.FrameInterval");
+		auto& frames = m_metrics.GetCounter("Engine.Frames");
+		auto& ticks = m_metrics.GetCounter("Engine.Ticks");
+		m_pFrameWork = &m_metrics.GetHistogram("Engine.FrameWork");
+		m_pOverruns = &m_metrics.GetCounter("Engine.Overruns");
+		auto& queuedJobs = m_metrics.GetGauge("Jobs.Queued");
+		auto& jobMemory = m_metrics.GetGauge("Jobs.Memory", MetricUnit::Bytes);
+		auto& entities = m_metrics.GetGauge("Model.Entities");
+		auto& chunkMemory = m_metrics.GetGauge("Model.ChunkMemory", MetricUnit::Bytes);
+		auto tLastLogFlush = tStart;
+		auto tLastMetricsLog = tStart;
+		MetricsSnapshot lastMetricsLog;
+		auto const LogMetrics = [&](Clock::time_point tNow) {
+			auto snapshot = m_metrics.GetSnapshot();
+			HE_LOG(Info, Engine, "Metrics of the last {_:.1}s:\n{_}", std::chrono::duration<double>(tNow - tLastMetricsLog).count(), snapshot.Since(lastMetricsLog));
+			lastMetricsLog = std::move(snapshot);
+			tLastMetricsLog = tNow;
+		};
+
+		while (!m_bShouldStop)
+		{
+			auto const tNow = Clock::now();
+			auto const tInterval = std::chrono::duration_cast<nanoseconds>(tNow - tFrameStart);
+			tFrameStart = tNow;
+
+			std::uint32_t nTicks = 0;
+			if (m_settings.fTimeScale > 0.0)
+			{
+				auto const tSimulated = nanoseconds{ static_cast<nanoseconds::rep>(tInterval.count() * m_settings.fTimeScale) };
+				tAccumulator += std::min(tSimulated, tMaxElapsed);
+				while (tAccumulator >= tTick && nTicks < m_settings.nMaxTicksPerFrame)
+				{
+					tAccumulator -= tTick;
+					++nTicks;
+				}
+			}
+			else
+			{
+				// Not tied to time: the accumulator stays empty
+				nTicks = m_settings.nMaxTicksPerFrame;
+			}
+			if (m_settings.nMaxTicks != 0)
+			{
+				nTicks = static_cast<std::uint32_t>(std::min<std::uint64_t>(nTicks, m_settings.nMaxTicks - nTotalTicks));
+			}
+			nTotalTicks += nTicks;
+
+			// The stages of the frame run on the JobSystem, while this thread paces the next frames
+			auto const fInterpolation = static_cast<double>(tAccumulator.count()) / tTick.count();
+			{
+				HE_PROFILE_SCOPE("Engine::StartFrame");
+				m_pipeline.StartFrame([this, nTicks, fInterpolation, tFrameStart, tInterval](const PipelineFrame& frame) {
+					auto& data = m_cFrames[frame.nSlot];
+					data.nTicks = nTicks;
+					data.fInterpolation = fInterpolation;
+					data.tStart = tFrameStart;
+					data.timing = FrameTiming{};
+					data.timing.tInterval = tInterval;
+					data.timing.nTicks = nTicks;
+				});
+				queuedJobs.Set(static_cast<std::int64_t>(m_jobSystem.GetQueuedJobCount()));
+				if (m_jobSystem.GetWorkerCount() == 0)
+				{
+					// Jobs only run when waited on: nothing would run the stages while this thread sleeps
+					m_pipeline.Flush();
+				}
+			}
+
+			auto const tStarted = Clock::now();
+			if (m_settings.tFramePeriod.count() > 0)
+			{
+				tNextFrame += m_settings.tFramePeriod;
+				if (tNextFrame < tStarted)
+				{
+					// Missed the deadline: start the next frame now, instead of running late frames back to back
+					tNextFrame = tStarted;
+				}
+			}
+
+			if (m_settings.nProfileFrames > 0)
+			{
+				std::lock_guard<std::mutex> lock{ m_mutProfile };
+				m_profile.EndFrame();
+			}
+
+			frameInterval.Record(tInterval);
+			frames.Add();
+			ticks.Add(nTicks);
+			jobMemory.Set(static_cast<std::int64_t>(JobSystem::GetJobMemory()));
+			entities.Set(static_cast<std::int64_t>(m_nEntityCount.load(std::memory_order_relaxed)));
+			chunkMemory.Set(static_cast<std::int64_t>(m_nChunkMemory.load(std::memory_order_relaxed)));
+			m_metrics.Merge();
+			if (m_settings.tMetricsLogPeriod.count() > 0 && tStarted - tLastMetricsLog >= m_settings.tMetricsLogPeriod)
+			{
+				LogMetrics(tStarted);
+			}
+			if (tStarted - tLastLogFlush >= LogFlushPeriod)
+			{
+				FlushLogSinks();
+				tLastLogFlush = tStarted;
+			}
+
+			if (m_settings.nMaxTicks != 0 && nTotalTicks >= m_settings.nMaxTicks)
+			{
+				Stop();
+				break;
+			}
+
+			if (m_nEntityCount.load(std::memory_order_relaxed) > 0)
+			{
+				tLastActivity = tStarted;
+			}
+			else if (tStarted - tLastActivity > BoredomDelay)
+			{
+				HE_LOG(Info, Engine, "HazelEngine got bored doing nothing, it will now stop");
+				Stop();
+				break;
+			}
+
+			if (m_settings.tFramePeriod.count() > 0)
+			{
+				m_pacer.WaitUntil(tNextFrame);
+			}
+		}
+
+		m_pipeline.Flush();
+		if (m_settings.nProfileFrames > 0)
+		{
+			// With the stages of the last frames
+			std::lock_guard<std::mutex> lock{ m_mutProfile };
+			m_profile.EndFrame();
+		}
+		m_metrics.Merge();
+		if (m_pReplayRecorder)
+		{
+			m_replayFile.flush();
+			if (!m_replayFile) HE_LOG(Error, Engine, "Could not write the replay file \"{_}\"", m_settings.sRecordReplayPath);
+		}
+		auto const tEnd = Clock::now();
+		if (m_settings.tMetricsLogPeriod.count() > 0)
+		{
+			LogMetrics(tEnd);
+		}
+
+		auto const fSeconds = std::chrono::duration<double>(tEnd - tStart).count();
+		auto const fSimulatedSeconds = std::chrono::duration<double>(tTick).count() * nTotalTicks;
+		HE_LOG(Info, Engine, "Simulated {_} ticks in {_:.3}s: {_:.1} ticks/s, {_:.2}x real time",
+			nTotalTicks, fSeconds, nTotalTicks / fSeconds, fSimulatedSeconds / fSeconds);
+	}
+
+	void Engine::Simulate(const PipelineFrame& frame)
+	{
+		auto const fTickSeconds = std::chrono::duration<double>(m_settings.tTickPeriod).count();
+		for (std::uint32_t i = 0; i < m_cFrames[frame.nSlot].nTicks; ++i)
+		{
+			{
+				std::lock_guard<std::mutex> lock{ m_mutInput };
+				m_model.SetInput(m_cQueuedInput.data(), m_cQueuedInput.size());
+				m_cQueuedInput.clear();
+			}
+
+			if (m_pReplayRecorder) m_pReplayRecorder->Update(m_model, fTickSeconds, m_jobSystem);
+			else m_model.Update(fTickSeconds, m_jobSystem);
+		}
+		m_nEntityCount.store(m_model.GetEntityCount(), std::memory_order_relaxed);
+		m_nChunkMemory.store(m_model.GetChunkMemory(), std::memory_order_relaxed);
+	}
+
+	void Engine::Extract(const PipelineFrame& frame)
+	{
+		auto& data = m_cFrames[frame.nSlot];
+		if (m_bRenderStages)
+		{
+			data.snapshot.Capture(m_model);
+			data.snapshot.SetInterpolation(data.fInterpolation);
+		}
+
+		// For a render thread of its own
+		if (m_settings.nSnapshotComponents != 0)
+		{
+			auto& snapshot = m_snapshots.GetBack();
+			snapshot.Capture(m_model);
+			snapshot.SetInterpolation(data.fInterpolation);
+			m_snapshots.Publish();
+		}
+	}
+
+	void Engine::EndFrame(const PipelineFrame& frame)
+	{
+		auto& data = m_cFrames[frame.nSlot];
+		data.timing.tWork = std::chrono::duration_cast<std::chrono::nanoseconds>(FramePacer::Clock::now() - data.tStart);
+		data.timing.bOverrun = m_settings.tFramePeriod.count() > 0 && data.timing.tWork > m_settings.tFramePeriod * m_settings.nPipelineDepth;
+
+		{
+			std::lock_guard<std::mutex> lock{ m_mutFrameTiming };
+			m_frameTiming.Add(data.timing);
+		}
+		m_pFrameWork->Record(data.timing.tWork);
+		if (data.timing.bOverrun) m_pOverruns->Add();
 	}
-}
\ No newline at end of file
+}
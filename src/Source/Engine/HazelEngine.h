@@ -1,7 +1,26 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <future>
 #include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "FramePipeline.h"
+#include "FrameTiming.h"
+#include "HE_FramePacer.h"
+#include "HE_JobSystem.h"
+#include "HE_Metrics.h"
+#include "HE_Profiler.h"
+#include "HE_TripleBuffer.h"
+#include "Model.h"
+#include "ModelSnapshot.h"
+#include "Replay.h"
 
 namespace HE
 {
@@ -40,19 +59,85 @@ namespace HE
 	}
 	
 
+	// Timing of the Engine loop
+	struct EngineSettings
+	{
+		// Fixed simulation step. Model::Update is always called with this dt
+		std::chrono::nanoseconds tTickPeriod{ std::chrono::nanoseconds{ std::chrono::seconds{ 1 } } / 60 };
+		// Target time between two presented frames. Zero runs frames as fast as possible
+		std::chrono::nanoseconds tFramePeriod{ std::chrono::nanoseconds{ std::chrono::seconds{ 1 } } / 60 };
+		// Upper bound of ticks run in a single frame. When the simulation can't keep up, the rest of the
+		// elapsed time is dropped rather than accumulating ever more ticks to catch up
+		std::uint32_t nMaxTicksPerFrame{ 8 };
+		// Time left to spin before a frame deadline instead of sleeping
+		std::chrono::nanoseconds tSpinThreshold{ std::chrono::milliseconds{ 2 } };
+		// Workers of the JobSystem. The Engine thread runs jobs too while it waits on them
+		size_t nWorkerThreads{ JobSystem::GetDefaultWorkerCount() };
+		// Components copied into the snapshot of the Model at the end of each frame, for AcquireSnapshot.
+		// They must be trivially copyable. Empty captures no snapshot
+		ComponentMask nSnapshotComponents{ 0 };
+		// Frames in flight through the stages of the frame pipeline. 1 runs each frame through all the stages
+		// before starting the next one
+		size_t nPipelineDepth{ 2 };
+		// Frames of profile events kept for CaptureProfile. Zero keeps none
+		size_t nProfileFrames{ 120 };
+		// Time between two dumps of the metrics to the log, each over the frames since the previous one. Zero
+		// never dumps them
+		std::chrono::nanoseconds tMetricsLogPeriod{ 0 };
+		// Simulated time per real time: above 1 runs faster than real time, as far as nMaxTicksPerFrame allows
+		// Zero runs nMaxTicksPerFrame ticks every frame, as fast as the simulation goes, ex: for batch simulations
+		double fTimeScale{ 1.0 };
+		// The Engine stops after that many ticks. Zero never stops on ticks
+		std::uint64_t nMaxTicks{ 0 };
+		// Simulation only, ex: on servers without a GPU. The frames have no extraction and no render stages, and
+		// the application should not create a view
+		bool bHeadless{ false };
+		// Records the ticks of the Model from the start of Run to the file, to be replayed with RunReplay. Empty
+		// records nothing
+		std::string sRecordReplayPath;
+	};
+
+	// Form: ParseEngineSettings(cArgs, defaults) -> defaults with the Engine arguments of cArgs applied
+	// The other arguments are left to the application. The Engine arguments are:
+	//   --headless                  bHeadless
+	//   --tick-rate=<ticks/s>       tTickPeriod
+	//   --frame-rate=<frames/s>     tFramePeriod, 0 is uncapped
+	//   --time-scale=<scale>        fTimeScale, 0 is as fast as possible
+	//   --max-ticks=<count>         nMaxTicks
+	//   --max-ticks-per-frame=<n>   nMaxTicksPerFrame
+	//   --workers=<count>           nWorkerThreads
+	//   --metrics-log-period=<s>    tMetricsLogPeriod
+	//   --record-replay=<path>      sRecordReplayPath
+	// Throws std::invalid_argument if the value of an Engine argument is missing or invalid
+	// Logs a warning for the other arguments starting with "--", in case they are misspelled Engine arguments
+	EngineSettings ParseEngineSettings(const std::vector<std::string>& cArgs, const EngineSettings& defaults = EngineSettings{});
+
 	// Represents a game engine that wraps both a Model of a game and
 	// a View of the Model
 	// The Engine can be customized on construction
 	// The Engine should be Run after being constructed. The Engine
 	// will then run on its own and do its own thing, until told to stop or 
 	// decides to stop
+	//
+	// Each frame, the elapsed time is added to an accumulator, which is consumed in fixed steps
+	// of tTickPeriod by Model::Update. The View is then presented once with the fraction of
+	// a tick left in the accumulator, to interpolate between the last two simulation states
+	// The loop then waits for the next frame deadline, sleeping then spinning to limit jitter
+	//
+	// Frames go through a FramePipeline on the JobSystem: the simulation runs the ticks of the frame, then the
+	// extraction captures the snapshots of the Model. The render stages then work on the snapshot of the frame,
+	// while the next frames simulate. A render thread of its own can acquire snapshots instead: it never blocks
+	// the simulation, nor the other way around
 
-	// Ensures: Stops on destruction
+	// Ensures: Stops on destruction, and waits for the Engine thread to end
 	class Engine
 	{
 	public:
-		Engine() noexcept = default;
-		Engine(const std::vector<std::string>& Args);
+		Engine();
+		// Throws std::runtime_error if the replay file cannot be created
+		explicit Engine(const EngineSettings& settings);
+		// With the settings of ParseEngineSettings(Args)
+		explicit Engine(const std::vector<std::string>& Args);
 		Engine(const Engine&) = delete;
 		Engine(Engine&&) = delete;
 		void operator=(const Engine&) = delete;
@@ -63,11 +148,99 @@ namespace HE
 		// Should only be called once on the object
 		std::future<void> Run();
 
-		// Thread-safe. Signals the Engine to stop running
+		// Thread-safe. Signals the Engine to stop running, waking it if it is waiting for the next frame
 		void Stop();
 
+		// Thread-safe. Timing statistics of the recent frames
+		FrameTimingSummary GetFrameTimingSummary() const;
+
+		// Thread-safe. The HE_PROFILE_SCOPE events of the last nProfileFrames frames of the Engine loop, of all the
+		// threads, ex: to write them with WriteChromeTrace. A frame holds the scopes that ended during its loop
+		// iteration, so the stages of a pipelined frame show up in the following ones
+		ProfileCapture CaptureProfile() const;
+
+		// Thread-safe. The metrics as of the end of the last frame: the frame interval and work time histograms,
+		// the time of each system per tick, the entities and chunk memory of the Model, and the job queue depth
+		// and memory. Counters and histograms count from the start: use MetricsSnapshot::Since for an interval
+		MetricsSnapshot GetMetrics() const { return m_metrics.GetSnapshot(); }
+
+		// Thread-safe. To add metrics of the game, merged at the end of every frame along with those of the Engine
+		MetricsRegistry& GetMetricsRegistry() noexcept { return m_metrics; }
+
+		const EngineSettings& GetSettings() const noexcept { return m_settings; }
+
+		// Shared by all the subsystems, and passed to Model::Update
+		JobSystem& GetJobSystem() noexcept { return m_jobSystem; }
+
+		// Not thread-safe: set up the systems and entities before Run, and read the Model after it ended
+		Model& GetModel() noexcept { return m_model; }
+
+		// Thread-safe. Appends to the input of the next tick (see Model::SetInput), ex: the commands of a player as
+		// they arrive. The ticks that get no input run with an empty one
+		void QueueInput(const void* pData, size_t nSize);
+
+		// Not thread-safe: add the stages before Run. Not in headless mode
+		// Runs f(snapshot, frame) after the extraction of each frame, in the order of the calls, ex: to cull the
+		// snapshot, then record and submit the rendering commands. The snapshot holds nSnapshotComponents
+		void AddRenderStage(std::string sName, std::function<void(const ModelSnapshot&, const PipelineFrame&)> f);
+
+		// Thread-safe for a single reader thread, ex: a render thread. The snapshot captured by the latest frame,
+		// or the previous one if no frame ended since. It is left untouched until the next call
+		const ModelSnapshot& AcquireSnapshot() noexcept
+		{
+			m_snapshots.Acquire();
+			return m_snapshots.GetFront();
+		}
+
 	private:
+		// Per slot of the pipeline
+		struct FrameData
+		{
+			std::uint32_t nTicks;
+			double fInterpolation;
+			ModelSnapshot snapshot;
+			FramePacer::Clock::time_point tStart;
+			FrameTiming timing;
+		};
+
+		void RunLoop();
+		void Simulate(const PipelineFrame& frame);
+		void Extract(const PipelineFrame& frame);
+		// Last stage of every frame: records its timing
+		void EndFrame(const PipelineFrame& frame);
+
+		EngineSettings m_settings;
+		// Outlives the histograms of the systems of the Model
+		MetricsRegistry m_metrics;
+		JobSystem m_jobSystem{ m_settings.nWorkerThreads };
+		Model m_model;
+		TripleBuffer<ModelSnapshot> m_snapshots{ m_settings.nSnapshotComponents };
+		std::vector<FrameData> m_cFrames;
+		bool m_bRenderStages{ false };
+		// Destroyed before the data of its stages
+		FramePipeline m_pipeline{ m_jobSystem, m_settings.nPipelineDepth };
+		std::thread m_runThread;
+
+		std::mutex m_mutInput;
+		std::vector<unsigned char> m_cQueuedInput;
+		std::ofstream m_replayFile;
+		// From the start of Run, once the game has set up the Model
+		std::unique_ptr<ReplayRecorder> m_pReplayRecorder;
+
 		std::atomic<bool> m_bShouldStop{false};
+		// Of the Model, after the last simulated frame
+		std::atomic<size_t> m_nEntityCount{ 0 };
+		std::atomic<size_t> m_nChunkMemory{ 0 };
 		bool m_bRunning{ false };
+		FramePacer m_pacer{ m_settings.tSpinThreshold };
+
+		mutable std::mutex m_mutFrameTiming;
+		FrameTimingHistory m_frameTiming{ m_settings.tFramePeriod };
+		// Set by RunLoop, for EndFrame
+		Histogram* m_pFrameWork{ nullptr };
+		Counter* m_pOverruns{ nullptr };
+
+		mutable std::mutex m_mutProfile;
+		ProfileHistory m_profile{ m_settings.nProfileFrames };
 	};
 }
\ No newline at end of file
@@ -0,0 +1,417 @@
+#include "Model.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "CommandBuffer.h"
+#include "HE_Profiler.h"
+
+namespace HE
+{
+	namespace
+	{
+		size_t HashID(std::uint64_t nGlobalUniqueID) noexcept
+		{
+			// IDs are mostly consecutive: spreads them over the table
+			auto const nHash = nGlobalUniqueID * 0x9E3779B97F4A7C15ull;
+			return static_cast<size_t>(nHash ^ (nHash >> 32));
+		}
+	}
+
+	constexpr std::uint64_t Model::AutoGlobalUniqueID;
+	constexpr size_t Model::SlotBlockSize;
+
+	Model::Model() = default;
+
+	Model::Model(ChunkArena& arena)
+		: m_pArena(&arena)
+	{
+
+	}
+
+	Model::~Model() = default;
+
+	void Model::Update(double dt, JobSystem& jobSystem)
+	{
+		HE_PROFILE_SCOPE("Model::Update");
+		try
+		{
+			m_systems.Run(dt, jobSystem);
+		}
+		catch (...)
+		{
+			m_cInput.clear();
+			throw;
+		}
+		m_cInput.clear();
+	}
+
+	void Model::SetInput(const void* pData, size_t nSize)
+	{
+		auto const pBytes = static_cast<const unsigned char*>(pData);
+		m_cInput.assign(pBytes, pBytes + nSize);
+	}
+
+	EntityHandle Model::InsertEntity(std::uint64_t nGlobalUniqueID, ComponentMask nMask)
+	{
+		if (nGlobalUniqueID == AutoGlobalUniqueID)
+		{
+			nGlobalUniqueID = m_nNextGlobalUniqueID;
+		}
+
+		EXPECTS(!FindEntity(nGlobalUniqueID).IsValid());
+
+		auto& archetype = GetArchetype(nMask);
+		ReserveIDs(m_nEntityCount + 1);
+
+		if (m_cFreeSlots.empty())
+		{
+			// The free list can hold every slot, so that DestroyEntity never allocates
+			if (m_cFreeSlots.capacity() <= m_cSlots.size())
+			{
+				m_cFreeSlots.reserve(std::max<size_t>(16, m_cSlots.size() * 2));
+			}
+			if (m_cSlotVersions.size() * SlotBlockSize <= m_cSlots.size())
+			{
+				m_cSlotVersions.push_back(m_nChangeVersion);
+			}
+			m_cSlots.push_back({ { nullptr, 0, 0 }, 0, 1 });
+			m_cFreeSlots.push_back(static_cast<std::uint32_t>(m_cSlots.size() - 1));
+		}
+
+		auto const nIndex = m_cFreeSlots.back();
+		auto& slot = m_cSlots[nIndex];
+		EntityHandle const entity{ nIndex, slot.nGeneration };
+
+		slot.location = archetype.Allocate(entity);
+
+		m_cFreeSlots.pop_back();
+		slot.nGlobalUniqueID = nGlobalUniqueID;
+		MarkSlotChanged(nIndex);
+		InsertID(nIndex);
+		++m_nEntityCount;
+		m_nNextGlobalUniqueID = std::max(m_nNextGlobalUniqueID, nGlobalUniqueID + 1);
+		return entity;
+	}
+
+	void Model::DestroyEntity(EntityHandle entity)
+	{
+		EXPECTS(IsAlive(entity));
+
+		auto& slot = m_cSlots[entity.GetIndex()];
+		auto const location = slot.location;
+		EraseID(slot.nGlobalUniqueID);
+		--m_nEntityCount;
+
+		slot.location.pArchetype = nullptr;
+		// Skips the invalid and pending generations when wrapping
+		if (++slot.nGeneration == EntityHandle::PendingGeneration) slot.nGeneration = 1;
+		m_cFreeSlots.push_back(entity.GetIndex());
+		MarkSlotChanged(entity.GetIndex());
+
+		OnRowFilled(location.pArchetype->Remove(location), location);
+	}
+
+	EntityHandle Model::FindEntity(std::uint64_t nGlobalUniqueID) const noexcept
+	{
+		if (m_cIDTable.empty()) return{};
+
+		auto const nEntry = m_cIDTable[FindIDEntry(nGlobalUniqueID)];
+		if (nEntry == 0) return{};
+
+		return{ nEntry - 1, m_cSlots[nEntry - 1].nGeneration };
+	}
+
+	size_t Model::GetChunkMemory() const noexcept
+	{
+		size_t nChunks = 0;
+		for (auto const pArchetype : m_cArchetypes)
+		{
+			nChunks += pArchetype->GetAllocatedChunkCount();
+		}
+		return nChunks * Chunk::Size;
+	}
+
+	void* Model::AddComponent(EntityHandle entity, ComponentTypeId nId)
+	{
+		EXPECTS(IsAlive(entity));
+		auto& location = m_cSlots[entity.GetIndex()].location;
+		EXPECTS(!location.pArchetype->HasComponent(nId));
+
+		auto const newLocation = MoveEntity(entity, location, GetArchetypeWith(*location.pArchetype, nId));
+		return newLocation.pArchetype->GetComponent(newLocation, nId);
+	}
+
+	void Model::RemoveComponent(EntityHandle entity, ComponentTypeId nId)
+	{
+		EXPECTS(IsAlive(entity));
+
+		auto& location = m_cSlots[entity.GetIndex()].location;
+		if (!location.pArchetype->HasComponent(nId)) return;
+
+		// Destroyed first, since MoveEntity only relocates the components of the destination
+		auto const& info = GetComponentTypeInfo(nId);
+		if (!info.bTriviallyCopyable)
+		{
+			info.pDestroy(location.pArchetype->GetComponent(location, nId));
+		}
+
+		try
+		{
+			MoveEntity(entity, location, GetArchetypeWithout(*location.pArchetype, nId));
+		}
+		catch (...)
+		{
+			// Could not allocate the destination: restores the component in place
+			info.pDefaultConstruct(location.pArchetype->GetComponent(location, nId));
+			throw;
+		}
+	}
+
+	void* Model::GetComponent(EntityHandle entity, ComponentTypeId nId) const noexcept
+	{
+		if (!IsAlive(entity)) return nullptr;
+
+		auto const& location = m_cSlots[entity.GetIndex()].location;
+		return location.pArchetype->GetComponent(location, nId);
+	}
+
+	void Model::Apply(CommandBuffer& commands)
+	{
+		commands.Playback(*this);
+	}
+
+	void Model::AdvanceChangeVersion() noexcept
+	{
+		++m_nChangeVersion;
+		for (auto const pArchetype : m_cArchetypes)
+		{
+			pArchetype->SetChangeVersion(m_nChangeVersion);
+		}
+	}
+
+	void Model::MarkChanged(EntityHandle entity) noexcept
+	{
+		if (!IsAlive(entity)) return;
+
+		auto const& location = m_cSlots[entity.GetIndex()].location;
+		location.pArchetype->MarkChanged(location.nChunk);
+	}
+
+	void Model::MarkChanged(EntityHandle entity, ComponentMask nWrites) noexcept
+	{
+		if (!IsAlive(entity)) return;
+
+		auto const& location = m_cSlots[entity.GetIndex()].location;
+		location.pArchetype->MarkChanged(location.nChunk, nWrites);
+	}
+
+	std::uint64_t Model::ComputeStateHash() const noexcept
+	{
+		// FNV-1a
+		std::uint64_t nHash = 14695981039346656037ull;
+		auto const hash = [&nHash](const void* pData, size_t nSize) {
+			auto const pBytes = static_cast<const unsigned char*>(pData);
+			for (size_t i = 0; i < nSize; ++i)
+			{
+				nHash = (nHash ^ pBytes[i]) * 1099511628211ull;
+			}
+		};
+
+		for (auto const pArchetype : m_cArchetypes)
+		{
+			// Archetypes are never destroyed: the empty ones are not part of the state, ex: after a ModelState::Restore
+			if (pArchetype->GetEntityCount() == 0) continue;
+
+			auto const nMask = pArchetype->GetMask();
+			auto const nCount = static_cast<std::uint64_t>(pArchetype->GetEntityCount());
+			hash(&nMask, sizeof(nMask));
+			hash(&nCount, sizeof(nCount));
+
+			for (size_t i = 0; i < pArchetype->GetChunkCount(); ++i)
+			{
+				auto const& chunk = pArchetype->GetChunk(i);
+				hash(pArchetype->GetEntities(chunk), chunk.nCount * sizeof(EntityHandle));
+
+				// Described components are hashed by field, leaving out their padding. The bytes of other components
+				// that are not trivially copyable can hold addresses, which differ from run to run
+				for (auto const nId : pArchetype->GetComponentTypes())
+				{
+					auto const& info = GetComponentTypeInfo(nId);
+					if (info.pHash)
+					{
+						nHash = info.pHash(pArchetype->GetColumn(chunk, nId), chunk.nCount, nHash);
+					}
+					else if (info.bTriviallyCopyable)
+					{
+						hash(pArchetype->GetColumn(chunk, nId), chunk.nCount * info.nSize);
+					}
+				}
+			}
+		}
+
+		for (auto const& slot : m_cSlots)
+		{
+			hash(&slot.nGeneration, sizeof(slot.nGeneration));
+			if (!slot.location.pArchetype) continue;
+
+			hash(&slot.nGlobalUniqueID, sizeof(slot.nGlobalUniqueID));
+			hash(&slot.location.nChunk, sizeof(slot.location.nChunk));
+			hash(&slot.location.nRow, sizeof(slot.location.nRow));
+		}
+		// Which handles the next entities get
+		hash(m_cFreeSlots.data(), m_cFreeSlots.size() * sizeof(std::uint32_t));
+
+		return nHash;
+	}
+
+	std::string Model::DescribeEntity(EntityHandle entity) const
+	{
+		EXPECTS(IsAlive(entity));
+
+		auto const& location = m_cSlots[entity.GetIndex()].location;
+		std::string sDescription;
+		for (auto const nId : location.pArchetype->GetComponentTypes())
+		{
+			auto const& info = GetComponentTypeInfo(nId);
+			sDescription += info.psName;
+			if (info.pToString)
+			{
+				sDescription += ' ';
+				sDescription += info.pToString(location.pArchetype->GetComponent(location, nId));
+			}
+			sDescription += '\n';
+		}
+		return sDescription;
+	}
+
+	Archetype& Model::GetArchetype(ComponentMask nMask)
+	{
+		auto& pArchetype = m_cArchetypesByMask[nMask];
+		if (!pArchetype)
+		{
+			try
+			{
+				pArchetype = std::make_unique<Archetype>(nMask, m_pArena);
+				pArchetype->SetChangeVersion(m_nChangeVersion);
+				m_cArchetypes.push_back(pArchetype.get());
+			}
+			catch (...)
+			{
+				m_cArchetypesByMask.erase(nMask);
+				throw;
+			}
+		}
+		return *pArchetype;
+	}
+
+	Archetype& Model::GetArchetypeWith(Archetype& archetype, ComponentTypeId nId)
+	{
+		if (auto const pEdge = archetype.GetAddEdge(nId)) return *pEdge;
+
+		auto& destination = GetArchetype(archetype.GetMask() | GetComponentBit(nId));
+		archetype.SetAddEdge(nId, &destination);
+		destination.SetRemoveEdge(nId, &archetype);
+		return destination;
+	}
+
+	Archetype& Model::GetArchetypeWithout(Archetype& archetype, ComponentTypeId nId)
+	{
+		if (auto const pEdge = archetype.GetRemoveEdge(nId)) return *pEdge;
+
+		auto& destination = GetArchetype(archetype.GetMask() & ~GetComponentBit(nId));
+		archetype.SetRemoveEdge(nId, &destination);
+		destination.SetAddEdge(nId, &archetype);
+		return destination;
+	}
+
+	EntityLocation Model::MoveEntity(EntityHandle entity, EntityLocation& location, Archetype& destination)
+	{
+		auto const source = location;
+		auto const newLocation = destination.Allocate(entity);
+
+		for (auto const nId : destination.GetComponentTypes())
+		{
+			auto const pSource = source.pArchetype->GetComponent(source, nId);
+			if (!pSource) continue;
+
+			auto const& info = GetComponentTypeInfo(nId);
+			auto const pDestination = destination.GetComponent(newLocation, nId);
+			if (info.bTriviallyCopyable)
+			{
+				std::memcpy(pDestination, pSource, info.nSize);
+			}
+			else
+			{
+				info.pRelocate(pDestination, pSource);
+			}
+		}
+
+		location = newLocation;
+		MarkSlotChanged(entity.GetIndex());
+		OnRowFilled(source.pArchetype->RemoveRelocated(source), source);
+		return newLocation;
+	}
+
+	void Model::OnRowFilled(EntityHandle moved, const EntityLocation& location) noexcept
+	{
+		if (moved.IsValid())
+		{
+			m_cSlots[moved.GetIndex()].location = location;
+			MarkSlotChanged(moved.GetIndex());
+		}
+	}
+
+	size_t Model::FindIDEntry(std::uint64_t nGlobalUniqueID) const noexcept
+	{
+		// Never full, so there is always an empty entry to stop at
+		auto const nMask = m_cIDTable.size() - 1;
+		for (auto i = HashID(nGlobalUniqueID) & nMask;; i = (i + 1) & nMask)
+		{
+			auto const nEntry = m_cIDTable[i];
+			if (nEntry == 0 || m_cSlots[nEntry - 1].nGlobalUniqueID == nGlobalUniqueID) return i;
+		}
+	}
+
+	void Model::ReserveIDs(size_t nCount)
+	{
+		if (nCount * 2 <= m_cIDTable.size()) return;
+
+		auto nSize = std::max<size_t>(64, m_cIDTable.size());
+		while (nSize < nCount * 2) nSize *= 2;
+
+		std::vector<std::uint32_t> cTable(nSize, 0);
+		cTable.swap(m_cIDTable);
+		for (auto const nEntry : cTable)
+		{
+			if (nEntry != 0) m_cIDTable[FindIDEntry(m_cSlots[nEntry - 1].nGlobalUniqueID)] = nEntry;
+		}
+	}
+
+	void Model::InsertID(std::uint32_t nSlot) noexcept
+	{
+		auto& nEntry = m_cIDTable[FindIDEntry(m_cSlots[nSlot].nGlobalUniqueID)];
+		EXPECTS(nEntry == 0);
+		nEntry = nSlot + 1;
+	}
+
+	void Model::EraseID(std::uint64_t nGlobalUniqueID) noexcept
+	{
+		auto const nMask = m_cIDTable.size() - 1;
+		auto nHole = FindIDEntry(nGlobalUniqueID);
+		EXPECTS(m_cIDTable[nHole] != 0);
+
+		// Moves back the entries after the hole that can go in it, so that no probe stops early
+		for (auto i = (nHole + 1) & nMask; m_cIDTable[i] != 0; i = (i + 1) & nMask)
+		{
+			auto const nHome = HashID(m_cSlots[m_cIDTable[i] - 1].nGlobalUniqueID) & nMask;
+			// The entry can move to the hole if its home is not in (nHole, i], cyclically
+			auto const bBetween = nHole < i ? (nHome > nHole && nHome <= i) : (nHome > nHole || nHome <= i);
+			if (bBetween) continue;
+
+			m_cIDTable[nHole] = m_cIDTable[i];
+			nHole = i;
+		}
+		m_cIDTable[nHole] = 0;
+	}
+}
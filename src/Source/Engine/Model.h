@@ -1,25 +1,262 @@
 #pragma once
 
-#include <vector>
+#include <cstdint>
 #include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "Archetype.h"
+#include "Component.h"
+#include "Entity.h"
+#include "HE_Assert.h"
+#include "SystemScheduler.h"
 
 namespace HE
 {
-	class Entity;
+	class ChunkArena;
+	class CommandBuffer;
+	class JobSystem;
+	class ModelState;
 
+	// State of a game: its entities and their components
+	//
+	// Components are stored by archetype, the set of component types of an entity, in chunks of
+	// contiguous arrays (see Archetype). Systems go through them with a Query.
+	//
+	// Entities are referred to by EntityHandle. The handle indexes a sparse array of slots, which hold the
+	// location of the entity in the chunks, so that finding an entity and checking that it is still alive
+	// are O(1). Each entity also has a global unique ID, which persists across runs, ex: in saved games.
+	// None of this state holds pointers outside of the Model, so that a ModelState saves and restores it by copying
+	// arrays.
+	//
+	// Structural changes (creating and destroying entities, adding and removing components) move
+	// entities between rows and archetypes. They invalidate the component references and must not
+	// happen while a Query runs: record them in a CommandBuffer instead, and Apply it afterwards
 	class Model
 	{
 	public:
+		// Lets CreateEntityWithID pick the next free global unique ID
+		static constexpr std::uint64_t AutoGlobalUniqueID = 0;
+
+		Model();
+		// The chunks of the entities come from the arena, which must outlive the Model
+		explicit Model(ChunkArena& arena);
+		Model(const Model&) = delete;
+		void operator=(const Model&) = delete;
+		~Model();
+
+		// The JobSystem is shared with the rest of the Engine. Update runs the systems on it,
+		// and waits on all the jobs it schedules before returning
+		void Update(double dt, JobSystem& jobSystem);
+
+		// Input of the next Update only, ex: the commands of the players received since the last tick, in a form of
+		// the game's choosing. It is the only outside data the systems should read, so that the same inputs give
+		// the same states, ex: to replay a match. Systems read it through GetModel().GetInput()
+		void SetInput(const void* pData, size_t nSize);
+		const std::vector<unsigned char>& GetInput() const noexcept { return m_cInput; }
+
+		// The systems that Update runs
+		SystemScheduler& GetSystems() noexcept { return m_systems; }
+		const SystemScheduler& GetSystems() const noexcept { return m_systems; }
+
+		// Form: CreateEntity(components...) -> entity with exactly those components
+		template<class... Ts>
+		EntityHandle CreateEntity(Ts&&... components)
+		{
+			return CreateEntityWithID(AutoGlobalUniqueID, std::forward<Ts>(components)...);
+		}
+
+		// Creates an entity with a known global unique ID, ex: when loading it
+		template<class... Ts>
+		EntityHandle CreateEntityWithID(std::uint64_t nGlobalUniqueID, Ts&&... components)
+		{
+			auto const entity = InsertEntity(nGlobalUniqueID, MakeComponentMask<std::decay_t<Ts>...>());
+			auto const& location = GetLocation(entity);
+			// Nothrow, since components are nothrow move constructible
+			int aConstruct[] = { 0, (ConstructComponent(location, std::forward<Ts>(components)), 0)... };
+			(void)aConstruct;
+			return entity;
+		}
+
+		void DestroyEntity(EntityHandle entity);
+
+		// Replaces the component if the entity already has one of the type
+		template<class T>
+		std::decay_t<T>& AddComponent(EntityHandle entity, T&& component)
+		{
+			using Component = std::decay_t<T>;
+			// Copied first, so that a throwing copy leaves the entity untouched
+			Component value(std::forward<T>(component));
+
+			auto const nId = GetComponentTypeId<Component>();
+			if (auto const pExisting = static_cast<Component*>(GetComponent(entity, nId)))
+			{
+				MarkChanged(entity, GetComponentBit(nId));
+				return *pExisting = std::move(value);
+			}
+			return *new (AddComponent(entity, nId)) Component(std::move(value));
+		}
+
+		// Does nothing if the entity does not have the component
+		template<class T>
+		void RemoveComponent(EntityHandle entity)
+		{
+			RemoveComponent(entity, GetComponentTypeId<T>());
+		}
+
+		// Returns nullptr if the entity does not have the component, or is not alive
+		// Marks the entity as changed: use the const version to only read the component
+		template<class T>
+		T* GetComponent(EntityHandle entity)
+		{
+			auto const nId = GetComponentTypeId<T>();
+			auto const pComponent = static_cast<T*>(GetComponent(entity, nId));
+			if (pComponent) MarkChanged(entity, GetComponentBit(nId));
+			return pComponent;
+		}
+
+		template<class T>
+		const T* GetComponent(EntityHandle entity) const
+		{
+			return static_cast<const T*>(GetComponent(entity, GetComponentTypeId<T>()));
+		}
+
+		template<class T>
+		bool HasComponent(EntityHandle entity) const
+		{
+			return GetComponent<T>(entity) != nullptr;
+		}
+
+		bool IsAlive(EntityHandle entity) const noexcept
+		{
+			return entity.GetIndex() < m_cSlots.size() && m_cSlots[entity.GetIndex()].nGeneration == entity.GetGeneration()
+				&& m_cSlots[entity.GetIndex()].location.pArchetype != nullptr;
+		}
+
+		size_t GetEntityCount() const noexcept { return m_nEntityCount; }
 
-		void Update(double dt);
+		std::uint64_t GetGlobalUniqueID(EntityHandle entity) const
+		{
+			EXPECTS(IsAlive(entity));
+			return m_cSlots[entity.GetIndex()].nGlobalUniqueID;
+		}
 
-		auto& GetEntities() noexcept { return m_cEntities; }
-		auto const& GetEntities() const noexcept { return m_cEntities; }
+		// Returns the invalid handle if no entity has the ID
+		EntityHandle FindEntity(std::uint64_t nGlobalUniqueID) const noexcept;
+
+		// Runs the commands in the order they were recorded, then clears the buffer
+		void Apply(CommandBuffer& commands);
+
+		// In creation order. Archetypes are never destroyed before the Model
+		const std::vector<Archetype*>& GetArchetypes() const noexcept { return m_cArchetypes; }
+
+		// Bytes allocated for the chunks of all the archetypes
+		size_t GetChunkMemory() const noexcept;
+
+		// Type-erased versions of the operations above, for the CommandBuffer
+		// Returns the uninitialized storage of the new component, which the caller must construct
+		void* AddComponent(EntityHandle entity, ComponentTypeId nId);
+		void RemoveComponent(EntityHandle entity, ComponentTypeId nId);
+		void* GetComponent(EntityHandle entity, ComponentTypeId nId) const noexcept;
+		// Returns the new entity, with its components uninitialized
+		EntityHandle InsertEntity(std::uint64_t nGlobalUniqueID, ComponentMask nMask);
+
+		const EntityLocation& GetLocation(EntityHandle entity) const
+		{
+			EXPECTS(IsAlive(entity));
+			return m_cSlots[entity.GetIndex()].location;
+		}
+
+		// Every write to the components is stamped with the change version on its chunk, so that copies of the
+		// Model (ex: ModelSnapshot) only copy the chunks that changed since their last copy
+		// Systems and Queries stamp the chunks they write to, and structural changes the chunks they move
+		// entities in and out of
+		std::uint64_t GetChangeVersion() const noexcept { return m_nChangeVersion; }
+		// The writes from now on get a greater change version, ex: after copying the current state
+		void AdvanceChangeVersion() noexcept;
+		// Stamps the chunk of the entity, ex: after writing to its components through a pointer from the type-erased GetComponent
+		void MarkChanged(EntityHandle entity) noexcept;
+		// Same, for the columns of the component types in nWrites only
+		void MarkChanged(EntityHandle entity, ComponentMask nWrites) noexcept;
+
+		// Slots are stamped with the change version by block, when an entity is created, destroyed or moved, so that
+		// a DeltaEncoder only sends the blocks that changed
+		static constexpr size_t SlotBlockSize = 256;
+		size_t GetSlotBlockCount() const noexcept { return m_cSlotVersions.size(); }
+		std::uint64_t GetSlotBlockVersion(size_t nBlock) const noexcept { return m_cSlotVersions[nBlock]; }
+
+		// Hash of the entities, their handles, IDs and locations, and the bytes of their trivially
+		// copyable components, or their fields for the components described with HE_REFLECT. Equal for two
+		// Models in the same state, ex: to check that two runs are deterministic
+		std::uint64_t ComputeStateHash() const noexcept;
+
+		// "Position { x: 1, y: 2 }" for each component of the entity, one per line, for debugging
+		// Components not described with HE_REFLECT only show their type
+		std::string DescribeEntity(EntityHandle entity) const;
 
 	private:
-		std::vector<std::unique_ptr<Entity>> m_cEntities;
+		friend class DeltaDecoder;
+		friend class DeltaEncoder;
+		friend class ModelState;
+		friend class SceneFile;
 
-	};
+		struct EntitySlot
+		{
+			// The archetype is nullptr while the slot is free
+			EntityLocation location;
+			std::uint64_t nGlobalUniqueID;
+			std::uint32_t nGeneration;
+		};
+
+		template<class T>
+		void ConstructComponent(const EntityLocation& location, T&& component)
+		{
+			using Component = std::decay_t<T>;
+			new (location.pArchetype->GetComponent(location, GetComponentTypeId<Component>())) Component(std::forward<T>(component));
+		}
+
+		Archetype& GetArchetype(ComponentMask nMask);
+		Archetype& GetArchetypeWith(Archetype& archetype, ComponentTypeId nId);
+		Archetype& GetArchetypeWithout(Archetype& archetype, ComponentTypeId nId);
+
+		// Moves the entity to another archetype, relocating the components they have in common.
+		// The components only in the destination are left uninitialized
+		EntityLocation MoveEntity(EntityHandle entity, EntityLocation& location, Archetype& destination);
+		void OnRowFilled(EntityHandle moved, const EntityLocation& location) noexcept;
+		void MarkSlotChanged(std::uint32_t nSlot) noexcept { m_cSlotVersions[nSlot / SlotBlockSize] = m_nChangeVersion; }
 
-}
\ No newline at end of file
+		// Returns the entry of the ID in m_cIDTable, or the empty entry where it would go. The table must not be empty
+		size_t FindIDEntry(std::uint64_t nGlobalUniqueID) const noexcept;
+		// Grows the table so that it can hold nCount entities
+		void ReserveIDs(size_t nCount);
+		// The table must be reserved
+		void InsertID(std::uint32_t nSlot) noexcept;
+		void EraseID(std::uint64_t nGlobalUniqueID) noexcept;
+
+		ChunkArena* const m_pArena{ nullptr };
+		// Cleared after each Update, keeping its memory
+		std::vector<unsigned char> m_cInput;
+		std::unordered_map<ComponentMask, std::unique_ptr<Archetype>> m_cArchetypesByMask;
+		std::vector<Archetype*> m_cArchetypes;
+
+		std::vector<EntitySlot> m_cSlots;
+		// Change version of each block of SlotBlockSize slots
+		std::vector<std::uint64_t> m_cSlotVersions;
+		// Indices of the free slots, reused last freed first
+		std::vector<std::uint32_t> m_cFreeSlots;
+		// Alive entities by global unique ID, in open addressing with linear probing, at most half full
+		// Each entry is the index of the slot of the entity plus one, or 0 if empty
+		std::vector<std::uint32_t> m_cIDTable;
+		size_t m_nEntityCount{ 0 };
+		std::uint64_t m_nNextGlobalUniqueID{ 1 };
+		// Starts above the version of a copy that never happened
+		std::uint64_t m_nChangeVersion{ 1 };
+
+		// Last, since its systems may refer to the entities
+		SystemScheduler m_systems{ *this };
+	};
+}
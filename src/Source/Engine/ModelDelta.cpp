@@ -0,0 +1,582 @@
+#include "ModelDelta.h"
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include "HE_Assert.h"
+#include "HE_Binary.h"
+#include "HE_Profiler.h"
+#include "Model.h"
+
+namespace HE
+{
+	constexpr std::uint32_t DeltaSlot::NoArchetype;
+
+	namespace
+	{
+		// Binary form, integers in LEB128:
+		// - the magic, the version, and the size of the rest
+		// - the sequence number of the delta
+		// - the component types sent for the first time: size of the name, name, size and alignment
+		// - the archetypes created since the previous delta: number of types, then their indices, in column order
+		// - per changed archetype: its index + 1, its entity count, then per changed chunk its index + 1, then per
+		//   changed column its index + 1 and its bytes. Each list ends with a 0
+		// - the slot count, then per changed block of slots its index + 1 and its DeltaSlots, ending with a 0
+		// - the free slots: their count, how many are the same as in the previous delta, then the others
+		// - the next global unique ID and the entity count
+		// Bytes are sent as their XOR with the previous delta, in pairs of a run of zeros and a run of other bytes.
+		// Past the rows of the previous delta, the bytes are sent as they are
+		constexpr char DeltaMagic[4] = { 'H', 'E', 'D', 'L' };
+		constexpr std::uint64_t DeltaVersion = 1;
+		constexpr std::uint32_t NoType = ~std::uint32_t{ 0 };
+		// Shorter runs of zeros are sent along with the bytes around them
+		constexpr size_t MinZeroRun = 8;
+
+		static_assert(sizeof(DeltaSlot) == 24, "DeltaSlot is sent as it is: it must not have padding");
+
+		constexpr const char* InvalidDelta = "Invalid delta";
+
+		[[noreturn]] void ThrowInvalidDelta(const char* psReason)
+		{
+			throw std::runtime_error{ std::string{ InvalidDelta } + ": " + psReason };
+		}
+
+		size_t SkipZeros(const unsigned char* pData, size_t i, size_t nSize) noexcept
+		{
+			for (; i + sizeof(std::uint64_t) <= nSize; i += sizeof(std::uint64_t))
+			{
+				std::uint64_t n;
+				std::memcpy(&n, pData + i, sizeof(n));
+				if (n != 0) break;
+			}
+			while (i < nSize && pData[i] == 0) ++i;
+			return i;
+		}
+
+		// Form: WriteXor(cOutput, pNew, pOld, nOldSize, nSize, cBuffer): writes the nSize bytes of pNew, as their XOR with
+		// the first nOldSize bytes of pOld
+		void WriteXor(std::vector<unsigned char>& cOutput, const void* pNew, const void* pOld, size_t nOldSize, size_t nSize, std::vector<unsigned char>& cBuffer)
+		{
+			auto const pNewBytes = static_cast<const unsigned char*>(pNew);
+			auto const pOldBytes = static_cast<const unsigned char*>(pOld);
+			cBuffer.resize(nSize);
+			auto const pDiff = cBuffer.data();
+			size_t i = 0;
+			for (; i + sizeof(std::uint64_t) <= nOldSize; i += sizeof(std::uint64_t))
+			{
+				std::uint64_t nNew, nOld;
+				std::memcpy(&nNew, pNewBytes + i, sizeof(nNew));
+				std::memcpy(&nOld, pOldBytes + i, sizeof(nOld));
+				nNew ^= nOld;
+				std::memcpy(pDiff + i, &nNew, sizeof(nNew));
+			}
+			for (; i < nOldSize; ++i)
+			{
+				pDiff[i] = pNewBytes[i] ^ pOldBytes[i];
+			}
+			std::memcpy(pDiff + nOldSize, pNewBytes + nOldSize, nSize - nOldSize);
+
+			i = 0;
+			while (i < nSize)
+			{
+				auto const nZerosBegin = i;
+				i = SkipZeros(pDiff, i, nSize);
+				auto const nBytesBegin = i;
+				while (i < nSize)
+				{
+					if (pDiff[i] != 0)
+					{
+						++i;
+						continue;
+					}
+					auto const nZerosEnd = SkipZeros(pDiff, i, nSize);
+					if (nZerosEnd - i >= MinZeroRun || nZerosEnd == nSize) break;
+					i = nZerosEnd;
+				}
+
+				WriteVarint(cOutput, nBytesBegin - nZerosBegin);
+				WriteVarint(cOutput, i - nBytesBegin);
+				cOutput.insert(cOutput.end(), pDiff + nBytesBegin, pDiff + i);
+			}
+		}
+
+		// Column 0 is the entities, then the component types of the archetype in order
+		std::pair<unsigned char*, size_t> GetColumn(const Archetype& archetype, const Chunk& chunk, ComponentTypeId const* pTypes, size_t nColumn) noexcept
+		{
+			if (nColumn == 0) return{ reinterpret_cast<unsigned char*>(archetype.GetEntities(chunk)), sizeof(EntityHandle) };
+
+			auto const nId = pTypes[nColumn - 1];
+			return{ static_cast<unsigned char*>(archetype.GetColumn(chunk, nId)), GetComponentTypeInfo(nId).nSize };
+		}
+	}
+
+	// The bytes of a delta, read into memory at once
+	class DeltaDecoder::Reader : public BinaryMemoryReader
+	{
+	public:
+		Reader(const unsigned char* pData, size_t nSize) noexcept
+			: BinaryMemoryReader(pData, nSize, InvalidDelta)
+		{
+
+		}
+
+		// Form: ReadXor(pData, nOldSize, nSize): reads the nSize bytes written by WriteXor into pData, which holds the
+		// old bytes
+		void ReadXor(void* pData, size_t nOldSize, size_t nSize)
+		{
+			auto const pBytes = static_cast<unsigned char*>(pData);
+			size_t i = 0;
+			while (i < nSize)
+			{
+				auto const nZeros = ReadSize(nSize - i);
+				if (i + nZeros > nOldSize)
+				{
+					auto const nBegin = std::max(i, nOldSize);
+					std::memset(pBytes + nBegin, 0, i + nZeros - nBegin);
+				}
+				i += nZeros;
+
+				auto const nCount = ReadSize(nSize - i);
+				if (nZeros == 0 && nCount == 0) ThrowInvalid("empty run");
+				auto const pDiff = ReadBytes(nCount);
+				for (size_t j = 0; j < nCount; ++j, ++i)
+				{
+					pBytes[i] = i < nOldSize ? pBytes[i] ^ pDiff[j] : pDiff[j];
+				}
+			}
+		}
+	};
+
+	DeltaEncoder::DeltaEncoder() noexcept
+	{
+		m_aTypeIndices.fill(NoType);
+	}
+
+	DeltaEncoder::DeltaEncoder(DeltaEncoder&&) noexcept = default;
+	DeltaEncoder& DeltaEncoder::operator=(DeltaEncoder&&) noexcept = default;
+	DeltaEncoder::~DeltaEncoder() = default;
+
+	void DeltaEncoder::Encode(Model& model, std::ostream& stream)
+	{
+		HE_PROFILE_SCOPE("DeltaEncoder::Encode");
+		EXPECTS(m_pModel == nullptr || m_pModel == &model);
+
+		// Checked first, so that nothing is written if it throws
+		auto const& cArchetypes = model.GetArchetypes();
+		for (auto i = m_cArchetypes.size(); i < cArchetypes.size(); ++i)
+		{
+			for (auto const nId : cArchetypes[i]->GetComponentTypes())
+			{
+				auto const& info = GetComponentTypeInfo(nId);
+				if (!info.bTriviallyCopyable)
+				{
+					throw std::invalid_argument{ std::string{ "Component " } + info.psName + " cannot be sent in a delta" };
+				}
+			}
+		}
+		m_pModel = &model;
+
+		m_cOutput.clear();
+		WriteVarint(m_cOutput, m_nSequence);
+
+		std::vector<ComponentTypeId> cNewTypes;
+		for (auto i = m_cArchetypes.size(); i < cArchetypes.size(); ++i)
+		{
+			for (auto const nId : cArchetypes[i]->GetComponentTypes())
+			{
+				if (m_aTypeIndices[nId] != NoType) continue;
+
+				m_aTypeIndices[nId] = m_nTypeCount++;
+				cNewTypes.push_back(nId);
+			}
+		}
+		WriteVarint(m_cOutput, cNewTypes.size());
+		for (auto const nId : cNewTypes)
+		{
+			auto const& info = GetComponentTypeInfo(nId);
+			auto const nNameSize = std::strlen(info.psName);
+			WriteVarint(m_cOutput, nNameSize);
+			m_cOutput.insert(m_cOutput.end(), info.psName, info.psName + nNameSize);
+			WriteVarint(m_cOutput, info.nSize);
+			WriteVarint(m_cOutput, info.nAlignment);
+		}
+
+		WriteVarint(m_cOutput, cArchetypes.size() - m_cArchetypes.size());
+		for (auto i = m_cArchetypes.size(); i < cArchetypes.size(); ++i)
+		{
+			auto const& cTypes = cArchetypes[i]->GetComponentTypes();
+			WriteVarint(m_cOutput, cTypes.size());
+			for (auto const nId : cTypes)
+			{
+				WriteVarint(m_cOutput, m_aTypeIndices[nId]);
+			}
+			m_cArchetypeIndices.emplace(cArchetypes[i], static_cast<std::uint32_t>(i));
+		}
+		m_cArchetypes.resize(cArchetypes.size());
+
+		for (size_t i = 0; i < cArchetypes.size(); ++i)
+		{
+			auto const& archetype = *cArchetypes[i];
+			auto& cCopies = m_cArchetypes[i];
+			auto const nChunks = archetype.GetChunkCount();
+
+			// Chunks that were written to, or gained or lost entities
+			auto bChanged = false;
+			for (size_t j = 0; j < std::max(nChunks, cCopies.size()) && !bChanged; ++j)
+			{
+				auto const nCount = j < nChunks ? archetype.GetChunk(j).nCount : 0;
+				auto const nCopyCount = j < cCopies.size() ? cCopies[j].nCount : 0;
+				bChanged = nCount != nCopyCount || (j < nChunks && archetype.GetChunk(j).nChangeVersion > m_nVersion);
+			}
+			if (!bChanged) continue;
+
+			WriteVarint(m_cOutput, i + 1);
+			WriteVarint(m_cOutput, archetype.GetEntityCount());
+			auto const pTypes = archetype.GetComponentTypes().data();
+			for (size_t j = 0; j < nChunks; ++j)
+			{
+				auto const& chunk = archetype.GetChunk(j);
+				if (j == cCopies.size())
+				{
+					cCopies.push_back({ std::unique_ptr<unsigned char[]>{ new unsigned char[Chunk::Size] }, 0 });
+				}
+				auto& copy = cCopies[j];
+				// Rows past the copy are sent in all the columns
+				auto const bCountChanged = copy.nCount != chunk.nCount;
+				if (!bCountChanged && chunk.nChangeVersion <= m_nVersion) continue;
+
+				WriteVarint(m_cOutput, j + 1);
+				for (size_t nColumn = 0; nColumn < archetype.GetColumnCount(); ++nColumn)
+				{
+					if (!bCountChanged && archetype.GetColumnVersion(j, nColumn) <= m_nVersion) continue;
+
+					auto const column = GetColumn(archetype, chunk, pTypes, nColumn);
+					auto const pCopy = copy.pData.get() + (column.first - chunk.pData);
+					WriteVarint(m_cOutput, nColumn + 1);
+					WriteXor(m_cOutput, column.first, pCopy, std::min(copy.nCount, chunk.nCount) * column.second, chunk.nCount * column.second, m_cBuffer);
+					std::memcpy(pCopy, column.first, chunk.nCount * column.second);
+				}
+				WriteVarint(m_cOutput, 0);
+				copy.nCount = chunk.nCount;
+			}
+			WriteVarint(m_cOutput, 0);
+
+			for (auto j = nChunks; j < cCopies.size(); ++j)
+			{
+				cCopies[j].nCount = 0;
+			}
+		}
+		WriteVarint(m_cOutput, 0);
+
+		// The copies of the slots are zeros past the previous delta, so they are always sent as a XOR
+		auto const& cSlots = model.m_cSlots;
+		auto const nOldSlotCount = m_cSlots.size();
+		m_cSlots.resize(cSlots.size());
+		WriteVarint(m_cOutput, cSlots.size());
+		std::vector<DeltaSlot> cBlock;
+		for (size_t nBlock = 0; nBlock < model.GetSlotBlockCount(); ++nBlock)
+		{
+			auto const nBegin = nBlock * Model::SlotBlockSize;
+			auto const nEnd = std::min(nBegin + Model::SlotBlockSize, cSlots.size());
+			if (model.GetSlotBlockVersion(nBlock) <= m_nVersion && nEnd <= nOldSlotCount) continue;
+
+			cBlock.clear();
+			for (auto i = nBegin; i < nEnd; ++i)
+			{
+				auto const& slot = cSlots[i];
+				if (slot.location.pArchetype)
+				{
+					cBlock.push_back({ slot.nGlobalUniqueID, slot.nGeneration, m_cArchetypeIndices.at(slot.location.pArchetype), slot.location.nChunk, slot.location.nRow });
+				}
+				else
+				{
+					cBlock.push_back({ slot.nGlobalUniqueID, slot.nGeneration, DeltaSlot::NoArchetype, 0, 0 });
+				}
+			}
+
+			auto const nSize = cBlock.size() * sizeof(DeltaSlot);
+			WriteVarint(m_cOutput, nBlock + 1);
+			WriteXor(m_cOutput, cBlock.data(), &m_cSlots[nBegin], nSize, nSize, m_cBuffer);
+			std::copy(cBlock.begin(), cBlock.end(), m_cSlots.begin() + nBegin);
+		}
+		WriteVarint(m_cOutput, 0);
+
+		auto const& cFreeSlots = model.m_cFreeSlots;
+		auto const nCommon = static_cast<size_t>(std::mismatch(cFreeSlots.begin(), cFreeSlots.begin() + std::min(cFreeSlots.size(), m_cFreeSlots.size()), m_cFreeSlots.begin()).first - cFreeSlots.begin());
+		WriteVarint(m_cOutput, cFreeSlots.size());
+		WriteVarint(m_cOutput, nCommon);
+		for (auto i = nCommon; i < cFreeSlots.size(); ++i)
+		{
+			WriteVarint(m_cOutput, cFreeSlots[i]);
+		}
+		m_cFreeSlots.assign(cFreeSlots.begin(), cFreeSlots.end());
+
+		WriteVarint(m_cOutput, model.m_nNextGlobalUniqueID);
+		WriteVarint(m_cOutput, model.GetEntityCount());
+
+		// Written at once, after the header
+		std::vector<unsigned char> cHeader{ std::begin(DeltaMagic), std::end(DeltaMagic) };
+		WriteVarint(cHeader, DeltaVersion);
+		WriteVarint(cHeader, m_cOutput.size());
+		stream.write(reinterpret_cast<const char*>(cHeader.data()), static_cast<std::streamsize>(cHeader.size()));
+		stream.write(reinterpret_cast<const char*>(m_cOutput.data()), static_cast<std::streamsize>(m_cOutput.size()));
+
+		m_nVersion = model.GetChangeVersion();
+		++m_nSequence;
+		// The writes after this delta must be newer than the copies
+		model.AdvanceChangeVersion();
+	}
+
+	DeltaDecoder::DeltaDecoder() noexcept = default;
+	DeltaDecoder::DeltaDecoder(DeltaDecoder&&) noexcept = default;
+	DeltaDecoder& DeltaDecoder::operator=(DeltaDecoder&&) noexcept = default;
+	DeltaDecoder::~DeltaDecoder() = default;
+
+	void DeltaDecoder::Apply(std::istream& stream, Model& model)
+	{
+		HE_PROFILE_SCOPE("DeltaDecoder::Apply");
+		if (m_nSequence == 0)
+		{
+			EXPECTS(model.m_cSlots.empty());
+			m_pModel = &model;
+		}
+		EXPECTS(m_pModel == &model);
+
+		BinaryStreamReader streamReader{ stream, InvalidDelta };
+		char aMagic[sizeof(DeltaMagic)];
+		if (!stream.read(aMagic, sizeof(aMagic)) || std::memcmp(aMagic, DeltaMagic, sizeof(aMagic)) != 0) ThrowInvalidDelta("not a delta");
+		if (streamReader.ReadVarint() != DeltaVersion) ThrowInvalidDelta("unknown version");
+		streamReader.ReadBytes(m_cBuffer);
+
+		Reader reader{ m_cBuffer.data(), m_cBuffer.size() };
+		if (reader.ReadVarint() != m_nSequence) ThrowInvalidDelta("out of order");
+
+		auto const nNewTypes = reader.ReadSize(MaxComponentTypes - m_cTypes.size());
+		for (size_t i = 0; i < nNewTypes; ++i)
+		{
+			auto const nNameSize = reader.ReadSize(4096);
+			auto const pName = reader.ReadBytes(nNameSize);
+			std::string const sName{ reinterpret_cast<const char*>(pName), nNameSize };
+			auto const nSize = reader.ReadVarint();
+			auto const nAlignment = reader.ReadVarint();
+
+			auto const nId = FindComponentType(sName.c_str());
+			if (nId == MaxComponentTypes)
+			{
+				throw std::invalid_argument{ "Component " + sName + " of the delta is not used by this process" };
+			}
+
+			auto const& info = GetComponentTypeInfo(nId);
+			if (info.nSize != nSize || info.nAlignment != nAlignment || !info.bTriviallyCopyable)
+			{
+				throw std::invalid_argument{ "Component " + sName + " of the delta has a different layout in this process" };
+			}
+			if (std::find(m_cTypes.begin(), m_cTypes.end(), nId) != m_cTypes.end()) ThrowInvalidDelta("duplicate component type");
+			m_cTypes.push_back(nId);
+		}
+
+		auto const nNewArchetypes = reader.ReadVarint();
+		for (std::uint64_t i = 0; i < nNewArchetypes; ++i)
+		{
+			ArchetypeMapping mapping{ nullptr, {} };
+			ComponentMask nMask = 0;
+			auto const nTypes = reader.ReadSize(m_cTypes.size());
+			for (size_t j = 0; j < nTypes; ++j)
+			{
+				auto const nId = m_cTypes[reader.ReadSize(m_cTypes.size() - 1)];
+				if (nMask & GetComponentBit(nId)) ThrowInvalidDelta("duplicate component type");
+				nMask |= GetComponentBit(nId);
+				mapping.cTypes.push_back(nId);
+			}
+
+			mapping.pArchetype = &model.GetArchetype(nMask);
+			auto const bMapped = std::any_of(m_cArchetypes.begin(), m_cArchetypes.end(), [&mapping](const ArchetypeMapping& other) {
+				return other.pArchetype == mapping.pArchetype;
+			});
+			if (bMapped) ThrowInvalidDelta("duplicate archetype");
+			m_cArchetypes.push_back(std::move(mapping));
+		}
+
+		ApplyArchetypes(reader);
+		ApplySlots(reader, model);
+		if (!reader.IsAtEnd()) ThrowInvalidDelta("trailing bytes");
+		++m_nSequence;
+	}
+
+	void DeltaDecoder::ApplyArchetypes(Reader& reader)
+	{
+		std::vector<std::uint32_t> cOldCounts;
+		size_t nPrevious = 0;
+		for (;;)
+		{
+			auto const nIndex = reader.ReadSize(m_cArchetypes.size());
+			if (nIndex == 0) break;
+			if (nIndex <= nPrevious) ThrowInvalidDelta("archetypes out of order");
+			nPrevious = nIndex;
+
+			auto const& mapping = m_cArchetypes[nIndex - 1];
+			auto& archetype = *mapping.pArchetype;
+			auto const nEntityCount = reader.ReadSize(~std::uint32_t{ 0 });
+
+			// The rows below the old counts are sent as a XOR
+			cOldCounts.clear();
+			for (size_t j = 0; j < archetype.GetChunkCount(); ++j)
+			{
+				cOldCounts.push_back(archetype.GetChunk(j).nCount);
+			}
+			archetype.Reserve(nEntityCount);
+			archetype.Resize(nEntityCount);
+
+			size_t nPreviousChunk = 0;
+			for (;;)
+			{
+				auto const nChunk = reader.ReadSize(archetype.GetChunkCount());
+				if (nChunk == 0) break;
+				if (nChunk <= nPreviousChunk) ThrowInvalidDelta("chunks out of order");
+				nPreviousChunk = nChunk;
+
+				auto const& chunk = archetype.GetChunk(nChunk - 1);
+				auto const nOldCount = nChunk - 1 < cOldCounts.size() ? std::min(cOldCounts[nChunk - 1], chunk.nCount) : 0;
+				size_t nPreviousColumn = 0;
+				for (;;)
+				{
+					auto const nColumn = reader.ReadSize(mapping.cTypes.size() + 1);
+					if (nColumn == 0) break;
+					if (nColumn <= nPreviousColumn) ThrowInvalidDelta("columns out of order");
+					nPreviousColumn = nColumn;
+
+					auto const column = GetColumn(archetype, chunk, mapping.cTypes.data(), nColumn - 1);
+					reader.ReadXor(column.first, nOldCount * column.second, chunk.nCount * column.second);
+				}
+				archetype.MarkChanged(nChunk - 1);
+			}
+		}
+	}
+
+	void DeltaDecoder::ApplySlots(Reader& reader, Model& model)
+	{
+		// Read and checked before changing the slots of the Model
+		auto const nSlotCount = reader.ReadSize(~std::uint32_t{ 0 });
+		auto const nSlotBlocks = (nSlotCount + Model::SlotBlockSize - 1) / Model::SlotBlockSize;
+		auto const getBlockEnd = [nSlotCount](size_t nBlock) { return std::min((nBlock + 1) * Model::SlotBlockSize, nSlotCount); };
+
+		// The changed blocks, one after the other. Past the slots of the previous delta, the copies are zeros
+		std::vector<size_t> cBlocks;
+		std::vector<DeltaSlot> cSlots;
+		for (;;)
+		{
+			auto const nBlock = reader.ReadSize(nSlotBlocks);
+			if (nBlock == 0) break;
+			if (!cBlocks.empty() && nBlock - 1 <= cBlocks.back()) ThrowInvalidDelta("slots out of order");
+			cBlocks.push_back(nBlock - 1);
+
+			auto const nFirst = cSlots.size();
+			for (auto i = (nBlock - 1) * Model::SlotBlockSize; i < getBlockEnd(nBlock - 1); ++i)
+			{
+				cSlots.push_back(i < m_cSlots.size() ? m_cSlots[i] : DeltaSlot{});
+			}
+			auto const nSize = (cSlots.size() - nFirst) * sizeof(DeltaSlot);
+			reader.ReadXor(&cSlots[nFirst], nSize, nSize);
+		}
+
+		auto const nFreeSlotCount = reader.ReadSize(nSlotCount);
+		auto const nCommon = reader.ReadSize(std::min(nFreeSlotCount, model.m_cFreeSlots.size()));
+		std::vector<std::uint32_t> cFreeSlots;
+		for (auto i = nCommon; i < nFreeSlotCount; ++i)
+		{
+			cFreeSlots.push_back(static_cast<std::uint32_t>(reader.ReadSize(nSlotCount - 1)));
+		}
+		auto const nNextGlobalUniqueID = reader.ReadVarint();
+		auto const nEntityCount = reader.ReadSize(nSlotCount);
+
+		size_t nArchetypeEntities = 0;
+		for (auto const& mapping : m_cArchetypes)
+		{
+			nArchetypeEntities += mapping.pArchetype->GetEntityCount();
+		}
+		if (nArchetypeEntities != nEntityCount) ThrowInvalidDelta("invalid entity count");
+
+		// Each changed slot refers to a row of its archetype that refers back to it
+		auto pSlot = cSlots.data();
+		for (auto const nBlock : cBlocks)
+		{
+			for (auto i = nBlock * Model::SlotBlockSize; i < getBlockEnd(nBlock); ++i)
+			{
+				auto const& slot = *pSlot++;
+				if (slot.nGeneration == 0 || slot.nGeneration == EntityHandle::PendingGeneration) ThrowInvalidDelta("invalid generation");
+				if (slot.nArchetype == DeltaSlot::NoArchetype) continue;
+
+				if (slot.nArchetype >= m_cArchetypes.size() || slot.nGlobalUniqueID == Model::AutoGlobalUniqueID) ThrowInvalidDelta("invalid entity");
+				auto const& archetype = *m_cArchetypes[slot.nArchetype].pArchetype;
+				if (slot.nChunk >= archetype.GetChunkCount() || slot.nRow >= archetype.GetChunk(slot.nChunk).nCount) ThrowInvalidDelta("invalid entity");
+				auto const& chunk = archetype.GetChunk(slot.nChunk);
+				if (archetype.GetEntities(chunk)[slot.nRow] != EntityHandle{ static_cast<std::uint32_t>(i), slot.nGeneration }) ThrowInvalidDelta("invalid entity");
+			}
+		}
+
+		model.m_cSlots.reserve(nSlotCount);
+		m_cSlots.reserve(nSlotCount);
+		model.m_cSlotVersions.reserve(nSlotBlocks);
+		// So that DestroyEntity never allocates
+		model.m_cFreeSlots.reserve(nSlotCount);
+
+		// The IDs of the slots that change leave the table first, while it still matches the slots
+		auto const eraseID = [&model](size_t i) {
+			auto const& slot = model.m_cSlots[i];
+			if (slot.location.pArchetype) model.EraseID(slot.nGlobalUniqueID);
+		};
+		for (auto i = nSlotCount; i < model.m_cSlots.size(); ++i)
+		{
+			eraseID(i);
+		}
+		for (auto const nBlock : cBlocks)
+		{
+			for (auto i = nBlock * Model::SlotBlockSize; i < std::min(getBlockEnd(nBlock), model.m_cSlots.size()); ++i)
+			{
+				eraseID(i);
+			}
+		}
+
+		model.m_cSlots.resize(nSlotCount, { { nullptr, 0, 0 }, 0, 0 });
+		model.m_cSlotVersions.resize(nSlotBlocks, model.GetChangeVersion());
+		m_cSlots.resize(nSlotCount);
+		pSlot = cSlots.data();
+		for (auto const nBlock : cBlocks)
+		{
+			for (auto i = nBlock * Model::SlotBlockSize; i < getBlockEnd(nBlock); ++i)
+			{
+				auto const& slot = *pSlot++;
+				auto const pArchetype = slot.nArchetype != DeltaSlot::NoArchetype ? m_cArchetypes[slot.nArchetype].pArchetype : nullptr;
+				model.m_cSlots[i] = { { pArchetype, slot.nChunk, slot.nRow }, slot.nGlobalUniqueID, slot.nGeneration };
+				m_cSlots[i] = slot;
+			}
+			model.m_cSlotVersions[nBlock] = model.GetChangeVersion();
+		}
+
+		model.ReserveIDs(nEntityCount);
+		for (auto const nBlock : cBlocks)
+		{
+			for (auto i = nBlock * Model::SlotBlockSize; i < getBlockEnd(nBlock); ++i)
+			{
+				auto const& slot = model.m_cSlots[i];
+				if (!slot.location.pArchetype) continue;
+
+				if (model.m_cIDTable[model.FindIDEntry(slot.nGlobalUniqueID)] != 0) ThrowInvalidDelta("duplicate global unique ID");
+				model.InsertID(static_cast<std::uint32_t>(i));
+			}
+		}
+
+		model.m_cFreeSlots.resize(nCommon);
+		model.m_cFreeSlots.insert(model.m_cFreeSlots.end(), cFreeSlots.begin(), cFreeSlots.end());
+		for (auto const nSlot : cFreeSlots)
+		{
+			if (model.m_cSlots[nSlot].location.pArchetype) ThrowInvalidDelta("invalid free slot");
+		}
+		model.m_nEntityCount = nEntityCount;
+		model.m_nNextGlobalUniqueID = nNextGlobalUniqueID;
+	}
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Component.h"
+
+namespace HE
+{
+	class Archetype;
+	class Model;
+
+	// Entity slot in the form sent in deltas, with no pointer
+	struct DeltaSlot
+	{
+		std::uint64_t nGlobalUniqueID;
+		std::uint32_t nGeneration;
+		// Index of the archetype in the delta stream, or NoArchetype while the slot is free
+		std::uint32_t nArchetype;
+		std::uint32_t nChunk;
+		std::uint32_t nRow;
+
+		static constexpr std::uint32_t NoArchetype = ~std::uint32_t{ 0 };
+	};
+
+	// Writes the changes of a Model since the previous Encode, for a DeltaDecoder to apply to a replica of the Model,
+	// ex: to send the state of a server to its clients, or to keep a copy of the Model in another process
+	//
+	// Only the parts of the Model stamped with a change version newer than the previous Encode are read: the columns
+	// of the chunks (see Archetype::GetColumnVersion) and the blocks of entity slots (see Model::GetSlotBlockVersion).
+	// These are sent as the XOR with the encoder's copy of what was sent last, in runs of zero and non-zero bytes, so
+	// that a component written with the same value costs a few bytes and an unchanged chunk costs nothing. The first
+	// Encode sends the whole Model
+	//
+	// Components must be trivially copyable, and are identified by the name and size of their type (see SceneFile)
+	class DeltaEncoder
+	{
+	public:
+		DeltaEncoder() noexcept;
+		DeltaEncoder(DeltaEncoder&&) noexcept;
+		DeltaEncoder& operator=(DeltaEncoder&&) noexcept;
+		~DeltaEncoder();
+
+		// Writes the delta since the previous Encode of the same Model, then advances the change version of the Model
+		// Throws std::invalid_argument if a component of the Model is not trivially copyable, before writing anything
+		// Write errors are left in the state of the stream: the deltas after it cannot be applied
+		void Encode(Model& model, std::ostream& stream);
+
+		// Number of deltas written
+		std::uint64_t GetSequence() const noexcept { return m_nSequence; }
+
+	private:
+		struct ChunkCopy
+		{
+			std::unique_ptr<unsigned char[]> pData;
+			std::uint32_t nCount;
+		};
+
+		const Model* m_pModel{ nullptr };
+		// Index in the stream of each component type sent, by ComponentTypeId
+		std::array<std::uint32_t, MaxComponentTypes> m_aTypeIndices;
+		std::uint32_t m_nTypeCount{ 0 };
+		// Index in the stream of each archetype of the Model
+		std::unordered_map<const Archetype*, std::uint32_t> m_cArchetypeIndices;
+		// What was sent of each archetype of the Model, in the same order
+		std::vector<std::vector<ChunkCopy>> m_cArchetypes;
+		std::vector<DeltaSlot> m_cSlots;
+		std::vector<std::uint32_t> m_cFreeSlots;
+		// Change version of the Model at the previous Encode
+		std::uint64_t m_nVersion{ 0 };
+		std::uint64_t m_nSequence{ 0 };
+		std::vector<unsigned char> m_cBuffer;
+		std::vector<unsigned char> m_cOutput;
+	};
+
+	// Applies the deltas of a DeltaEncoder to a replica of its Model, in the order they were written
+	class DeltaDecoder
+	{
+	public:
+		DeltaDecoder() noexcept;
+		DeltaDecoder(DeltaDecoder&&) noexcept;
+		DeltaDecoder& operator=(DeltaDecoder&&) noexcept;
+		~DeltaDecoder();
+
+		// The first delta must be applied to a Model with no entities, and the next ones to the same Model, which must
+		// not change in between. Afterwards, the Model has the same entities, handles, IDs and components as the
+		// Model that was encoded
+		// Throws std::invalid_argument if a component type of the delta is not used in this process or has a different
+		// size, std::runtime_error if the delta is invalid or out of order. If it throws, the Model and the decoder
+		// are left in an unspecified state: start over with a new Model, decoder and encoder
+		void Apply(std::istream& stream, Model& model);
+
+		// Number of deltas applied
+		std::uint64_t GetSequence() const noexcept { return m_nSequence; }
+
+	private:
+		class Reader;
+
+		struct ArchetypeMapping
+		{
+			Archetype* pArchetype;
+			// In the order of the columns of the stream
+			std::vector<ComponentTypeId> cTypes;
+		};
+
+		void ApplyArchetypes(Reader& reader);
+		void ApplySlots(Reader& reader, Model& model);
+
+		const Model* m_pModel{ nullptr };
+		std::vector<ComponentTypeId> m_cTypes;
+		std::vector<ArchetypeMapping> m_cArchetypes;
+		std::vector<DeltaSlot> m_cSlots;
+		std::uint64_t m_nSequence{ 0 };
+		std::vector<unsigned char> m_cBuffer;
+	};
+}
@@ -0,0 +1,97 @@
+#include "ModelSnapshot.h"
+
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include "HE_Allocator.h"
+#include "Model.h"
+
+namespace HE
+{
+	ModelSnapshot::ModelSnapshot(ComponentMask nMask)
+		: m_nMask(nMask)
+	{
+		for (ComponentTypeId nId = 0; nId < MaxComponentTypes; ++nId)
+		{
+			if ((nMask & GetComponentBit(nId)) == 0) continue;
+
+			auto const& info = GetComponentTypeInfo(nId);
+			if (!info.bTriviallyCopyable)
+			{
+				throw std::invalid_argument{ std::string{ "Component " } + info.psName + " cannot be copied into a snapshot" };
+			}
+		}
+	}
+
+	ModelSnapshot::~ModelSnapshot() = default;
+
+	void ModelSnapshot::ChunkDeleter::operator()(unsigned char* pData) const noexcept
+	{
+		AlignedMallocAllocator::it.deallocate({ pData, Chunk::Size });
+	}
+
+	void ModelSnapshot::Capture(Model& model)
+	{
+		// Picks up the archetypes created since the last Capture
+		auto const& cArchetypes = model.GetArchetypes();
+		for (; m_nArchetypesMatched < cArchetypes.size(); ++m_nArchetypesMatched)
+		{
+			auto const pArchetype = cArchetypes[m_nArchetypesMatched];
+			if ((pArchetype->GetMask() & m_nMask) == m_nMask)
+			{
+				m_cArchetypes.push_back({ pArchetype, {}, 0 });
+			}
+		}
+
+		m_nEntityCount = 0;
+		for (auto& archetype : m_cArchetypes)
+		{
+			auto const nChunks = archetype.pArchetype->GetChunkCount();
+			while (archetype.cChunks.size() < nChunks)
+			{
+				auto const b = AlignedMallocAllocator::it.allocate(Chunk::Size, Chunk::ColumnAlignment);
+				if (!b.ptr) throw std::bad_alloc{};
+
+				std::unique_ptr<unsigned char, ChunkDeleter> pData{ static_cast<unsigned char*>(b.ptr) };
+				// Never copied: older than any change
+				archetype.cChunks.push_back({ std::move(pData), 0, 0 });
+			}
+
+			for (size_t i = 0; i < nChunks; ++i)
+			{
+				auto const& chunk = archetype.pArchetype->GetChunk(i);
+				auto& copy = archetype.cChunks[i];
+				if (chunk.nChangeVersion > copy.nVersion)
+				{
+					CopyChunk(*archetype.pArchetype, chunk, copy);
+					copy.nVersion = model.GetChangeVersion();
+				}
+			}
+
+			archetype.nChunkCount = nChunks;
+			m_nEntityCount += archetype.pArchetype->GetEntityCount();
+		}
+
+		m_nVersion = model.GetChangeVersion();
+		// The writes after this Capture must be newer than the copies
+		model.AdvanceChangeVersion();
+	}
+
+	void ModelSnapshot::CopyChunk(const Archetype& archetype, const Chunk& chunk, ChunkCopy& copy) const
+	{
+		// Same offsets as the chunk, so that the copy is read with the layout of the archetype
+		auto const pEntities = archetype.GetEntities(chunk);
+		std::memcpy(copy.pData.get() + (reinterpret_cast<unsigned char*>(pEntities) - chunk.pData), pEntities, chunk.nCount * sizeof(EntityHandle));
+
+		for (auto const nId : archetype.GetComponentTypes())
+		{
+			if ((m_nMask & GetComponentBit(nId)) == 0) continue;
+
+			auto const pColumn = static_cast<unsigned char*>(archetype.GetColumn(chunk, nId));
+			std::memcpy(copy.pData.get() + (pColumn - chunk.pData), pColumn, chunk.nCount * GetComponentTypeInfo(nId).nSize);
+		}
+		copy.nCount = chunk.nCount;
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Archetype.h"
+#include "Component.h"
+#include "Entity.h"
+#include "HE_Assert.h"
+
+namespace HE
+{
+	class Model;
+
+	// Copy of some components of a Model, for a thread that reads it while the Model updates, ex: a render thread
+	// Use one per TripleBuffer slot: see Engine::AcquireSnapshot
+	//
+	// Holds the entities that have all the components of its mask, and copies of those components only.
+	// The copies are laid out like the chunks of the Model, so they are read with the same ChunkView. Capture only
+	// copies the chunks whose change version is past the one of their last copy (see Model::GetChangeVersion),
+	// so a Model where few entities change is cheap to capture
+	//
+	// Components must be trivially copyable. Reading a snapshot only refers to the layout of the archetypes,
+	// which never changes, so the Model can update concurrently, but must outlive its snapshots
+	class ModelSnapshot
+	{
+	public:
+		// With an empty mask, only copies the handles of the entities
+		ModelSnapshot() noexcept = default;
+		// Throws std::invalid_argument if one of the components is not trivially copyable
+		explicit ModelSnapshot(ComponentMask nMask);
+		ModelSnapshot(ModelSnapshot&&) noexcept = default;
+		ModelSnapshot& operator=(ModelSnapshot&&) noexcept = default;
+		~ModelSnapshot();
+
+		ComponentMask GetMask() const noexcept { return m_nMask; }
+
+		// Copies the entities of the model that changed since the last Capture into this snapshot, then advances
+		// the change version of the model
+		void Capture(Model& model);
+
+		// The change version of the Model at the last Capture, or 0 if there was none
+		std::uint64_t GetVersion() const noexcept { return m_nVersion; }
+
+		// Fraction of a tick the reader should interpolate by, ex: Engine::Present sets it
+		double GetInterpolation() const noexcept { return m_fInterpolation; }
+		void SetInterpolation(double fInterpolation) noexcept { m_fInterpolation = fInterpolation; }
+
+		size_t GetEntityCount() const noexcept { return m_nEntityCount; }
+
+		// Form: ForEachChunk<Ts...>(f(const ChunkView<const Ts...>&)), where the mask has all of Ts
+		template<class... Ts, class F>
+		void ForEachChunk(F&& f) const
+		{
+			auto const nMask = MakeComponentMask<Ts...>();
+			EXPECTS((m_nMask & nMask) == nMask);
+
+			for (auto const& archetype : m_cArchetypes)
+			{
+				for (size_t i = 0; i < archetype.nChunkCount; ++i)
+				{
+					auto const& copy = archetype.cChunks[i];
+					f(MakeChunkView<const Ts...>(*archetype.pArchetype, Chunk{ copy.pData.get(), copy.nCount, copy.nVersion }));
+				}
+			}
+		}
+
+		// Form: ForEach<Ts...>(f(EntityHandle, const Ts&...))
+		template<class... Ts, class F>
+		void ForEach(F&& f) const
+		{
+			ForEachChunk<Ts...>([&f](const ChunkView<const Ts...>& view) {
+				ForEachInView(f, view, std::index_sequence_for<Ts...>{});
+			});
+		}
+
+	private:
+		struct ChunkDeleter
+		{
+			void operator()(unsigned char* pData) const noexcept;
+		};
+
+		// Copy of one chunk of an archetype, with only the columns of the mask
+		struct ChunkCopy
+		{
+			std::unique_ptr<unsigned char, ChunkDeleter> pData;
+			std::uint32_t nCount;
+			// Change version of the Model when the chunk was copied
+			std::uint64_t nVersion;
+		};
+
+		struct ArchetypeCopy
+		{
+			const Archetype* pArchetype;
+			// Past nChunkCount, copies kept for when the archetype grows back
+			std::vector<ChunkCopy> cChunks;
+			size_t nChunkCount;
+		};
+
+		template<class F, class... Ts, size_t... Is>
+		static void ForEachInView(F& f, const ChunkView<const Ts...>& view, std::index_sequence<Is...>)
+		{
+			auto const nCount = view.GetCount();
+			auto const pEntities = view.GetEntities();
+			auto const columns = std::make_tuple(view.template Get<Is>()...);
+			for (std::uint32_t i = 0; i < nCount; ++i)
+			{
+				f(pEntities[i], std::get<Is>(columns)[i]...);
+			}
+		}
+
+		void CopyChunk(const Archetype& archetype, const Chunk& chunk, ChunkCopy& copy) const;
+
+		ComponentMask m_nMask{ 0 };
+		// Same order as the archetypes of the Model
+		std::vector<ArchetypeCopy> m_cArchetypes;
+		size_t m_nArchetypesMatched{ 0 };
+
+		std::uint64_t m_nVersion{ 0 };
+		size_t m_nEntityCount{ 0 };
+		double m_fInterpolation{ 0.0 };
+	};
+}
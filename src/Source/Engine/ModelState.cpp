@@ -0,0 +1,162 @@
+#include "ModelState.h"
+
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include "HE_Allocator.h"
+#include "HE_Profiler.h"
+
+namespace HE
+{
+	namespace
+	{
+		// Form: CopyRows(archetype, chunk, pFrom, pTo, nCount): copies the first nCount rows of every column between
+		// two chunk-sized blocks laid out like the chunks of the archetype
+		void CopyRows(const Archetype& archetype, const Chunk& chunk, const unsigned char* pFrom, unsigned char* pTo, size_t nCount) noexcept
+		{
+			auto const copy = [&](const void* pColumn, size_t nSize) {
+				auto const nOffset = static_cast<const unsigned char*>(pColumn) - chunk.pData;
+				std::memcpy(pTo + nOffset, pFrom + nOffset, nCount * nSize);
+			};
+
+			copy(archetype.GetEntities(chunk), sizeof(EntityHandle));
+			for (auto const nId : archetype.GetComponentTypes())
+			{
+				copy(archetype.GetColumn(chunk, nId), GetComponentTypeInfo(nId).nSize);
+			}
+		}
+	}
+
+	ModelState::~ModelState() = default;
+
+	void ModelState::ChunkDeleter::operator()(unsigned char* pData) const noexcept
+	{
+		AlignedMallocAllocator::it.deallocate({ pData, Chunk::Size });
+	}
+
+	void ModelState::Save(Model& model)
+	{
+		HE_PROFILE_SCOPE("ModelState::Save");
+
+		if (m_pModel != &model)
+		{
+			m_cArchetypes.clear();
+			m_pModel = &model;
+		}
+		// Until the copies below are complete
+		m_nVersion = 0;
+
+		// Picks up the archetypes created since the last Save
+		auto const& cArchetypes = model.GetArchetypes();
+		for (auto i = m_cArchetypes.size(); i < cArchetypes.size(); ++i)
+		{
+			for (auto const nId : cArchetypes[i]->GetComponentTypes())
+			{
+				auto const& info = GetComponentTypeInfo(nId);
+				if (!info.bTriviallyCopyable)
+				{
+					throw std::invalid_argument{ std::string{ "Component " } + info.psName + " cannot be copied into a saved state" };
+				}
+			}
+			m_cArchetypes.push_back({ {}, 0 });
+		}
+
+		for (size_t i = 0; i < cArchetypes.size(); ++i)
+		{
+			auto const& archetype = *cArchetypes[i];
+			auto& copy = m_cArchetypes[i];
+
+			auto const nChunks = archetype.GetChunkCount();
+			while (copy.cChunks.size() < nChunks)
+			{
+				auto const b = AlignedMallocAllocator::it.allocate(Chunk::Size, Chunk::ColumnAlignment);
+				if (!b.ptr) throw std::bad_alloc{};
+
+				std::unique_ptr<unsigned char, ChunkDeleter> pData{ static_cast<unsigned char*>(b.ptr) };
+				// Never copied: older than any change
+				copy.cChunks.push_back({ std::move(pData), 0, 0 });
+			}
+
+			for (size_t j = 0; j < nChunks; ++j)
+			{
+				auto const& chunk = archetype.GetChunk(j);
+				auto& chunkCopy = copy.cChunks[j];
+				if (chunk.nChangeVersion > chunkCopy.nVersion)
+				{
+					CopyRows(archetype, chunk, chunk.pData, chunkCopy.pData.get(), chunk.nCount);
+					chunkCopy.nCount = chunk.nCount;
+					chunkCopy.nVersion = model.GetChangeVersion();
+				}
+			}
+			copy.nEntityCount = archetype.GetEntityCount();
+		}
+
+		m_cSlots = model.m_cSlots;
+		m_cFreeSlots = model.m_cFreeSlots;
+		m_cIDTable = model.m_cIDTable;
+		m_nEntityCount = model.m_nEntityCount;
+		m_nNextGlobalUniqueID = model.m_nNextGlobalUniqueID;
+
+		m_nVersion = model.GetChangeVersion();
+		// The writes after this Save must be newer than the copies
+		model.AdvanceChangeVersion();
+	}
+
+	void ModelState::Restore(Model& model) const
+	{
+		HE_PROFILE_SCOPE("ModelState::Restore");
+		EXPECTS(m_pModel == &model && IsSaved());
+
+		// Allocates first, so that nothing has changed if it throws
+		auto const& cArchetypes = model.GetArchetypes();
+		for (size_t i = 0; i < m_cArchetypes.size(); ++i)
+		{
+			cArchetypes[i]->Reserve(m_cArchetypes[i].nEntityCount);
+		}
+		model.m_cSlots.reserve(m_cSlots.size());
+		auto const nSlotBlocks = (m_cSlots.size() + Model::SlotBlockSize - 1) / Model::SlotBlockSize;
+		model.m_cSlotVersions.reserve(nSlotBlocks);
+		// So that DestroyEntity never allocates
+		model.m_cFreeSlots.reserve(m_cSlots.size());
+		model.m_cIDTable.reserve(m_cIDTable.size());
+
+		for (size_t i = 0; i < cArchetypes.size(); ++i)
+		{
+			auto& archetype = *cArchetypes[i];
+			// The archetypes created since the Save lose all their entities
+			archetype.Resize(i < m_cArchetypes.size() ? m_cArchetypes[i].nEntityCount : 0);
+
+			for (size_t j = 0; j < archetype.GetChunkCount(); ++j)
+			{
+				// Not written to since the Save, or the copy would be older than the chunk
+				auto const& chunk = archetype.GetChunk(j);
+				if (chunk.nChangeVersion <= m_nVersion) continue;
+
+				auto const& chunkCopy = m_cArchetypes[i].cChunks[j];
+				ENSURES(chunkCopy.nCount == chunk.nCount);
+				CopyRows(archetype, chunk, chunkCopy.pData.get(), chunk.pData, chunk.nCount);
+				// Copies of the Model made after the Save are older than this
+				archetype.MarkChanged(j);
+			}
+		}
+
+		model.m_cSlots.assign(m_cSlots.begin(), m_cSlots.end());
+		model.m_cSlotVersions.assign(nSlotBlocks, model.GetChangeVersion());
+		model.m_cFreeSlots.assign(m_cFreeSlots.begin(), m_cFreeSlots.end());
+		model.m_cIDTable.assign(m_cIDTable.begin(), m_cIDTable.end());
+		model.m_nEntityCount = m_nEntityCount;
+		model.m_nNextGlobalUniqueID = m_nNextGlobalUniqueID;
+	}
+
+	size_t ModelState::GetChunkMemory() const noexcept
+	{
+		size_t nChunks = 0;
+		for (auto const& copy : m_cArchetypes)
+		{
+			nChunks += copy.cChunks.size();
+		}
+		return nChunks * Chunk::Size;
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Model.h"
+
+namespace HE
+{
+	// Full copy of the entities and components of a Model, restored into it later, ex: for rollback or autosaves
+	//
+	// The Model only refers to its own state by handle and index, so saving and restoring copy its arrays and
+	// chunks as they are, with no fix-up. Both only copy the chunks that changed since, going by their change
+	// version (see Model::GetChangeVersion): reuse states, ex: a ring of them for the last ticks, so that a
+	// Model where few entities change is cheap to save and restore
+	//
+	// Components must be trivially copyable. The systems and the input of the Model are not part of its state
+	class ModelState
+	{
+	public:
+		ModelState() noexcept = default;
+		ModelState(ModelState&&) noexcept = default;
+		ModelState& operator=(ModelState&&) noexcept = default;
+		~ModelState();
+
+		// Copies the Model into this state, then advances the change version of the Model
+		// Throws std::invalid_argument if a component of the Model is not trivially copyable. If it throws, the
+		// state cannot be restored until the next Save
+		void Save(Model& model);
+
+		// Puts the Model back in the state of the last Save, which must be from the same Model
+		// Entities created since then are destroyed, and the entities destroyed since then come back with the same
+		// handles. Throws std::bad_alloc if the chunks cannot be allocated, leaving the Model as it was
+		void Restore(Model& model) const;
+
+		bool IsSaved() const noexcept { return m_nVersion != 0; }
+		// The change version of the Model at the last Save, or 0 if there was none
+		std::uint64_t GetVersion() const noexcept { return m_nVersion; }
+
+		size_t GetEntityCount() const noexcept { return m_nEntityCount; }
+		// Bytes allocated for the copies of the chunks
+		size_t GetChunkMemory() const noexcept;
+
+	private:
+		struct ChunkDeleter
+		{
+			void operator()(unsigned char* pData) const noexcept;
+		};
+
+		struct ChunkCopy
+		{
+			std::unique_ptr<unsigned char, ChunkDeleter> pData;
+			std::uint32_t nCount;
+			// Change version of the Model when the chunk was copied
+			std::uint64_t nVersion;
+		};
+
+		struct ArchetypeCopy
+		{
+			// Past the chunks of nEntityCount, copies kept for when the archetype grows back
+			std::vector<ChunkCopy> cChunks;
+			size_t nEntityCount;
+		};
+
+		const Model* m_pModel{ nullptr };
+		// Same order as the archetypes of the Model
+		std::vector<ArchetypeCopy> m_cArchetypes;
+
+		std::vector<Model::EntitySlot> m_cSlots;
+		std::vector<std::uint32_t> m_cFreeSlots;
+		std::vector<std::uint32_t> m_cIDTable;
+		size_t m_nEntityCount{ 0 };
+		std::uint64_t m_nNextGlobalUniqueID{ 0 };
+
+		std::uint64_t m_nVersion{ 0 };
+	};
+}
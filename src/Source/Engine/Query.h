@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Archetype.h"
+#include "Component.h"
+#include "Model.h"
+
+namespace HE
+{
+	// Iterates the entities of a Model that have all the component types Ts
+	// Mark the components that are only read as const, ex: Query<Position, const Velocity>
+	//
+	// The Query keeps the list of matching archetypes, and only checks the archetypes created since its last use.
+	// Keep the Query around to avoid matching all the archetypes every time
+	template<class... Ts>
+	class Query
+	{
+	public:
+		explicit Query(Model& model)
+			: m_model(model),
+			m_nMask(MakeComponentMask<Ts...>()),
+			m_nWrites(MakeWriteMask<Ts...>())
+		{
+
+		}
+
+		// Form: ForEach(f(Ts&...))
+		template<class F>
+		void ForEach(F&& f)
+		{
+			ForEachChunk([&f](const ChunkView<Ts...>& view) {
+				ForEachInView(f, view, std::index_sequence_for<Ts...>{});
+			});
+		}
+
+		// Form: ForEachEntity(f(EntityHandle, Ts&...))
+		template<class F>
+		void ForEachEntity(F&& f)
+		{
+			ForEachChunk([&f](const ChunkView<Ts...>& view) {
+				ForEachEntityInView(f, view, std::index_sequence_for<Ts...>{});
+			});
+		}
+
+		// Form: ForEachChunk(f(const ChunkView<Ts...>&)), to process the components as arrays
+		// Chunks are marked as changed if any of Ts is not const, in the columns of those only
+		template<class F>
+		void ForEachChunk(F&& f)
+		{
+			for (auto const pArchetype : GetArchetypes())
+			{
+				auto const nChunks = pArchetype->GetChunkCount();
+				for (size_t i = 0; i < nChunks; ++i)
+				{
+					if (m_nWrites != 0) pArchetype->MarkChanged(i, m_nWrites);
+					f(MakeChunkView<Ts...>(*pArchetype, pArchetype->GetChunk(i)));
+				}
+			}
+		}
+
+		size_t GetEntityCount()
+		{
+			size_t nCount = 0;
+			for (auto const pArchetype : GetArchetypes())
+			{
+				nCount += pArchetype->GetEntityCount();
+			}
+			return nCount;
+		}
+
+		// The archetypes with all of Ts
+		const std::vector<Archetype*>& GetArchetypes()
+		{
+			auto const& cArchetypes = m_model.GetArchetypes();
+			for (; m_nArchetypesMatched < cArchetypes.size(); ++m_nArchetypesMatched)
+			{
+				auto const pArchetype = cArchetypes[m_nArchetypesMatched];
+				if ((pArchetype->GetMask() & m_nMask) == m_nMask)
+				{
+					m_cArchetypes.push_back(pArchetype);
+				}
+			}
+			return m_cArchetypes;
+		}
+
+	private:
+		template<class F, size_t... Is>
+		static void ForEachInView(F& f, const ChunkView<Ts...>& view, std::index_sequence<Is...>)
+		{
+			auto const nCount = view.GetCount();
+			auto const columns = std::make_tuple(view.template Get<Is>()...);
+			for (std::uint32_t i = 0; i < nCount; ++i)
+			{
+				f(std::get<Is>(columns)[i]...);
+			}
+		}
+
+		template<class F, size_t... Is>
+		static void ForEachEntityInView(F& f, const ChunkView<Ts...>& view, std::index_sequence<Is...>)
+		{
+			auto const nCount = view.GetCount();
+			auto const pEntities = view.GetEntities();
+			auto const columns = std::make_tuple(view.template Get<Is>()...);
+			for (std::uint32_t i = 0; i < nCount; ++i)
+			{
+				f(pEntities[i], std::get<Is>(columns)[i]...);
+			}
+		}
+
+		Model& m_model;
+		ComponentMask const m_nMask;
+		ComponentMask const m_nWrites;
+		std::vector<Archetype*> m_cArchetypes;
+		size_t m_nArchetypesMatched{ 0 };
+	};
+}
@@ -0,0 +1,116 @@
+#include "Replay.h"
+
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "HE_Assert.h"
+#include "HE_Binary.h"
+#include "HE_JobSystem.h"
+#include "HE_String.h"
+#include "Model.h"
+
+namespace HE
+{
+	constexpr std::uint32_t ReplayRecorder::DefaultChecksumPeriod;
+	constexpr std::uint64_t ReplayResult::NoDivergence;
+
+	namespace
+	{
+		// Binary form: the header, then per tick its dt, the size of its input then its bytes, and the state hash
+		// after every nChecksumPeriod ticks. Integers are LEB128, the dt as the bits of its double
+		constexpr char ReplayMagic[4] = { 'H', 'E', 'R', 'P' };
+		constexpr std::uint64_t ReplayVersion = 1;
+
+		bool IsChecksumTick(std::uint64_t nTick, std::uint32_t nChecksumPeriod) noexcept
+		{
+			return nChecksumPeriod != 0 && nTick % nChecksumPeriod == 0;
+		}
+	}
+
+	ReplayRecorder::ReplayRecorder(std::ostream& stream, const Model& model, std::uint32_t nChecksumPeriod)
+		: m_stream(stream),
+		m_nChecksumPeriod(nChecksumPeriod)
+	{
+		m_stream.write(ReplayMagic, sizeof(ReplayMagic));
+		WriteVarint(m_stream, ReplayVersion);
+		WriteVarint(m_stream, m_nChecksumPeriod);
+		WriteVarint(m_stream, model.ComputeStateHash());
+	}
+
+	void ReplayRecorder::Update(Model& model, double dt, JobSystem& jobSystem)
+	{
+		std::uint64_t nDt;
+		static_assert(sizeof(nDt) == sizeof(dt), "Unexpected size of double");
+		std::memcpy(&nDt, &dt, sizeof(nDt));
+		WriteVarint(m_stream, nDt);
+		auto const& cInput = model.GetInput();
+		WriteBytes(m_stream, cInput.data(), cInput.size());
+
+		model.Update(dt, jobSystem);
+
+		++m_nTicks;
+		if (IsChecksumTick(m_nTicks, m_nChecksumPeriod))
+		{
+			WriteVarint(m_stream, model.ComputeStateHash());
+		}
+	}
+
+	std::string to_string(const ReplayResult& result)
+	{
+		MetricsSnapshot snapshot;
+		snapshot.cHistograms["Replay.TickTime"] = result.tickTime;
+
+		auto const fSeconds = std::chrono::duration<double>(result.tTotal).count();
+		auto s = Format("Replayed {_} ticks in {_:.3}s: {_:.1} ticks/s, {_} checksums, ", result.nTicks, fSeconds,
+			fSeconds > 0.0 ? result.nTicks / fSeconds : 0.0, result.nChecksums);
+		s += result.HasDiverged() ? Format("diverged at tick {_}", result.nDivergentTick) : std::string{ "no divergence" };
+		return s + '\n' + to_string(snapshot);
+	}
+
+	ReplayResult RunReplay(std::istream& stream, Model& model, JobSystem& jobSystem)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		BinaryStreamReader reader{ stream, "Invalid replay" };
+		char aMagic[sizeof(ReplayMagic)];
+		if (!stream.read(aMagic, sizeof(aMagic)) || std::memcmp(aMagic, ReplayMagic, sizeof(aMagic)) != 0) reader.ThrowInvalid("not a replay");
+		if (reader.ReadVarint() != ReplayVersion) reader.ThrowInvalid("unknown version");
+		auto const nChecksumPeriod = reader.ReadVarint();
+		if (nChecksumPeriod > ~std::uint32_t{ 0 }) reader.ThrowInvalid("invalid checksum period");
+
+		MetricsRegistry metrics;
+		auto& tickTime = metrics.GetHistogram("Replay.TickTime");
+		ReplayResult result;
+		auto const Check = [&](std::uint64_t nTick) {
+			++result.nChecksums;
+			if (reader.ReadVarint() != model.ComputeStateHash()) result.nDivergentTick = nTick;
+		};
+
+		auto const tStart = Clock::now();
+		Check(0);
+		std::vector<unsigned char> cInput;
+		while (!result.HasDiverged() && stream.peek() != std::char_traits<char>::eof())
+		{
+			auto const nDt = reader.ReadVarint();
+			double dt;
+			std::memcpy(&dt, &nDt, sizeof(dt));
+
+			reader.ReadBytes(cInput);
+			model.SetInput(cInput.data(), cInput.size());
+
+			auto const tTickStart = Clock::now();
+			model.Update(dt, jobSystem);
+			tickTime.Record(Clock::now() - tTickStart);
+
+			++result.nTicks;
+			if (IsChecksumTick(result.nTicks, static_cast<std::uint32_t>(nChecksumPeriod))) Check(result.nTicks);
+		}
+		result.tTotal = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - tStart);
+
+		metrics.Merge();
+		result.tickTime = metrics.GetSnapshot().cHistograms.at("Replay.TickTime");
+		return result;
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+#include "HE_Metrics.h"
+
+namespace HE
+{
+	class JobSystem;
+	class Model;
+
+	// Records what reaches Model::Update, tick after tick: its dt and its input, along with the state hash of the
+	// Model every nChecksumPeriod ticks. Since the systems only depend on those, RunReplay can then run the same
+	// ticks again on a Model set up the same way, ex: a recorded match as a regression benchmark and determinism test
+	// The stream must outlive the recorder. Write errors are left in the state of the stream
+	class ReplayRecorder
+	{
+	public:
+		static constexpr std::uint32_t DefaultChecksumPeriod = 60;
+
+		// Writes the header, with the state hash of the Model before the first tick
+		ReplayRecorder(std::ostream& stream, const Model& model, std::uint32_t nChecksumPeriod = DefaultChecksumPeriod);
+		ReplayRecorder(const ReplayRecorder&) = delete;
+		void operator=(const ReplayRecorder&) = delete;
+
+		// Records the tick, then runs it with model.Update(dt, jobSystem)
+		void Update(Model& model, double dt, JobSystem& jobSystem);
+
+		std::uint64_t GetTickCount() const noexcept { return m_nTicks; }
+
+	private:
+		std::ostream& m_stream;
+		std::uint32_t const m_nChecksumPeriod;
+		std::uint64_t m_nTicks{ 0 };
+	};
+
+	struct ReplayResult
+	{
+		static constexpr std::uint64_t NoDivergence = ~std::uint64_t{ 0 };
+
+		bool HasDiverged() const noexcept { return nDivergentTick != NoDivergence; }
+
+		std::uint64_t nTicks{ 0 };
+		std::uint64_t nChecksums{ 0 };
+		// The tick of the first state hash that differs from the recording, 0 for the state before the first tick,
+		// ex: a Model set up differently. The state diverged during one of the ticks since the previous hash. The
+		// replay stops there
+		std::uint64_t nDivergentTick{ NoDivergence };
+		// Of each Model::Update
+		HistogramSnapshot tickTime;
+		std::chrono::nanoseconds tTotal{ 0 };
+	};
+
+	// Ticks, time per tick percentiles, and the divergent tick if any
+	std::string to_string(const ReplayResult& result);
+
+	// Runs the ticks recorded by a ReplayRecorder on the model, as fast as possible, and checks the state hashes
+	// The Model must be set up as it was when the recording started: same systems, same entities
+	// Throws std::runtime_error if the stream does not hold a recording
+	ReplayResult RunReplay(std::istream& stream, Model& model, JobSystem& jobSystem);
+}
@@ -0,0 +1,648 @@
+#include "SceneFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "HE_Assert.h"
+#include "HE_Math.h"
+#include "HE_Profiler.h"
+#include "Model.h"
+
+namespace HE
+{
+	constexpr std::uint32_t SceneFile::NoColumn;
+
+	namespace
+	{
+		// Binary form, little-endian, in this order:
+		// - the header
+		// - the component types, the archetypes, the column offsets of the archetypes, and the names of the types
+		// - the entity slots, then the free slots
+		// - the chunks of each archetype, starting on a page
+		// Tables are 8-byte aligned, so that they are read in place
+		constexpr char SceneMagic[4] = { 'H', 'E', 'S', 'C' };
+		constexpr std::uint32_t SceneVersion = 1;
+		constexpr std::uint32_t ChecksumsFlag = 1;
+		constexpr std::uint64_t ChunksAlignment = 4096;
+		constexpr std::uint32_t NoArchetype = ~std::uint32_t{ 0 };
+
+		struct FileHeader
+		{
+			char aMagic[4];
+			std::uint32_t nVersion;
+			std::uint32_t nFlags;
+			std::uint32_t nChunkSize;
+			std::uint32_t nComponentTypeCount;
+			std::uint32_t nArchetypeCount;
+			std::uint64_t nColumnCount;
+			std::uint64_t nFileSize;
+			std::uint64_t nEntityCount;
+			std::uint64_t nSlotCount;
+			std::uint64_t nFreeSlotCount;
+			std::uint64_t nNextGlobalUniqueID;
+			std::uint64_t nComponentTypesOffset;
+			std::uint64_t nArchetypesOffset;
+			std::uint64_t nColumnsOffset;
+			std::uint64_t nNamesOffset;
+			std::uint64_t nNamesSize;
+			std::uint64_t nSlotsOffset;
+			std::uint64_t nFreeSlotsOffset;
+			// Of the tables, from the component types to the names
+			std::uint64_t nTablesChecksum;
+			// Of the slots and the free slots
+			std::uint64_t nSlotsChecksum;
+		};
+
+		struct FileComponentType
+		{
+			// In the names
+			std::uint64_t nNameOffset;
+			std::uint32_t nNameSize;
+			std::uint32_t nSize;
+			std::uint32_t nAlignment;
+			std::uint32_t nPadding;
+		};
+
+		struct FileArchetype
+		{
+			// Bits of the component types of the file
+			std::uint64_t nTypes;
+			std::uint64_t nEntityCount;
+			std::uint64_t nChunksOffset;
+			// Of the chunks
+			std::uint64_t nChecksum;
+			std::uint32_t nChunkCapacity;
+			std::uint32_t nChunkCount;
+			// Column offsets of its types, in increasing type order
+			std::uint32_t nFirstColumn;
+			std::uint32_t nPadding;
+		};
+
+		struct FileSlot
+		{
+			std::uint64_t nGlobalUniqueID;
+			std::uint32_t nGeneration;
+			// NoArchetype if the slot is free
+			std::uint32_t nArchetype;
+			std::uint32_t nChunk;
+			std::uint32_t nRow;
+		};
+
+		static_assert(sizeof(FileHeader) % 8 == 0 && sizeof(FileComponentType) % 8 == 0 && sizeof(FileArchetype) % 8 == 0
+			&& sizeof(FileSlot) % 8 == 0, "The tables of a scene file must keep their 8-byte alignment");
+
+		[[noreturn]] void ThrowInvalidScene(const char* psReason)
+		{
+			throw std::runtime_error{ std::string{ "Invalid scene: " } + psReason };
+		}
+
+		std::uint64_t AlignUp(std::uint64_t n, std::uint64_t nAlignment) noexcept
+		{
+			return (n + nAlignment - 1) / nAlignment * nAlignment;
+		}
+
+		size_t CountBits(std::uint64_t n) noexcept
+		{
+			size_t nCount = 0;
+			for (; n != 0; n &= n - 1) ++nCount;
+			return nCount;
+		}
+
+		// Form: HashBytes(pData, nSize) -> checksum. 8 bytes at a time, so that verifying a large scene is not
+		// much slower than reading it
+		std::uint64_t HashBytes(const void* pData, size_t nSize, std::uint64_t nHash = 14695981039346656037ull) noexcept
+		{
+			auto const pBytes = static_cast<const unsigned char*>(pData);
+			size_t i = 0;
+			for (; i + 8 <= nSize; i += 8)
+			{
+				std::uint64_t n;
+				std::memcpy(&n, pBytes + i, 8);
+				nHash = (nHash ^ n) * 0x100000001B3ull;
+				nHash ^= nHash >> 29;
+			}
+			for (; i < nSize; ++i)
+			{
+				nHash = (nHash ^ pBytes[i]) * 0x100000001B3ull;
+			}
+			return nHash;
+		}
+
+		// Whether [nOffset, nOffset + nCount * nSize) is within the file and aligned
+		bool IsInFile(std::uint64_t nOffset, std::uint64_t nCount, std::uint64_t nSize, std::uint64_t nAlignment, std::uint64_t nFileSize) noexcept
+		{
+			return nOffset % nAlignment == 0 && nOffset <= nFileSize && (nSize == 0 || nCount <= (nFileSize - nOffset) / nSize);
+		}
+
+		class FileWriter
+		{
+		public:
+			explicit FileWriter(const std::string& sPath)
+				: m_file(sPath, std::ios::binary | std::ios::trunc)
+			{
+				if (!m_file) throw std::runtime_error{ "Could not open \"" + sPath + "\" to save the scene" };
+			}
+
+			std::uint64_t GetOffset() const noexcept { return m_nOffset; }
+
+			void Write(const void* pData, size_t nSize)
+			{
+				m_file.write(static_cast<const char*>(pData), static_cast<std::streamsize>(nSize));
+				m_nOffset += nSize;
+			}
+
+			void PadTo(std::uint64_t nAlignment)
+			{
+				static char const aZeros[ChunksAlignment] = {};
+				Write(aZeros, static_cast<size_t>(AlignUp(m_nOffset, nAlignment) - m_nOffset));
+			}
+
+			// Writes over what was written at nOffset, ex: a table whose checksums are known at the end
+			void Rewrite(std::uint64_t nOffset, const void* pData, size_t nSize)
+			{
+				m_file.seekp(static_cast<std::streamoff>(nOffset));
+				m_file.write(static_cast<const char*>(pData), static_cast<std::streamsize>(nSize));
+				m_file.seekp(static_cast<std::streamoff>(m_nOffset));
+			}
+
+			void Close(const std::string& sPath)
+			{
+				m_file.close();
+				if (!m_file) throw std::runtime_error{ "Could not write the scene to \"" + sPath + "\"" };
+			}
+
+		private:
+			std::ofstream m_file;
+			std::uint64_t m_nOffset{ 0 };
+		};
+	}
+
+	SceneFile::SceneFile(SceneFile&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	SceneFile& SceneFile::operator=(SceneFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			m_file.Unmap(m_view);
+			m_file = std::move(other.m_file);
+			m_view = std::exchange(other.m_view, Blk{ nullptr, 0 });
+			m_cArchetypes = std::move(other.m_cArchetypes);
+			m_nEntityCount = std::exchange(other.m_nEntityCount, 0);
+		}
+		return *this;
+	}
+
+	SceneFile::~SceneFile()
+	{
+		m_file.Unmap(m_view);
+	}
+
+	void SceneFile::Save(const Model& model, const std::string& sPath, bool bChecksums)
+	{
+		HE_PROFILE_SCOPE("SceneFile::Save");
+
+		// The archetypes with entities, and the types they use, in the order of the file
+		std::vector<const Archetype*> cArchetypes;
+		std::unordered_map<const Archetype*, std::uint32_t> cArchetypeIndices;
+		std::vector<ComponentTypeId> cTypes;
+		std::uint32_t aFileTypes[MaxComponentTypes];
+		std::fill(std::begin(aFileTypes), std::end(aFileTypes), NoColumn);
+		for (auto const pArchetype : model.GetArchetypes())
+		{
+			if (pArchetype->GetEntityCount() == 0) continue;
+
+			for (auto const nId : pArchetype->GetComponentTypes())
+			{
+				auto const& info = GetComponentTypeInfo(nId);
+				if (!info.bTriviallyCopyable)
+				{
+					throw std::invalid_argument{ std::string{ "Component " } + info.psName + " cannot be saved in a scene" };
+				}
+				if (aFileTypes[nId] == NoColumn)
+				{
+					aFileTypes[nId] = static_cast<std::uint32_t>(cTypes.size());
+					cTypes.push_back(nId);
+				}
+			}
+			cArchetypeIndices[pArchetype] = static_cast<std::uint32_t>(cArchetypes.size());
+			cArchetypes.push_back(pArchetype);
+		}
+
+		FileHeader header{};
+		std::memcpy(header.aMagic, SceneMagic, sizeof(SceneMagic));
+		header.nVersion = SceneVersion;
+		header.nFlags = bChecksums ? ChecksumsFlag : 0;
+		header.nChunkSize = static_cast<std::uint32_t>(Chunk::Size);
+		header.nComponentTypeCount = static_cast<std::uint32_t>(cTypes.size());
+		header.nArchetypeCount = static_cast<std::uint32_t>(cArchetypes.size());
+		header.nEntityCount = model.GetEntityCount();
+		header.nSlotCount = model.m_cSlots.size();
+		header.nFreeSlotCount = model.m_cFreeSlots.size();
+		header.nNextGlobalUniqueID = model.m_nNextGlobalUniqueID;
+
+		std::vector<unsigned char> cTables;
+		auto const append = [&cTables](const void* pData, size_t nSize) {
+			auto const pBytes = static_cast<const unsigned char*>(pData);
+			cTables.insert(cTables.end(), pBytes, pBytes + nSize);
+			cTables.resize(static_cast<size_t>(AlignUp(cTables.size(), 8)));
+		};
+
+		// Names first, to know the offsets of the tables
+		std::string sNames;
+		std::vector<FileComponentType> cFileTypes;
+		for (auto const nId : cTypes)
+		{
+			auto const& info = GetComponentTypeInfo(nId);
+			auto const nNameSize = std::strlen(info.psName);
+			cFileTypes.push_back({ sNames.size(), static_cast<std::uint32_t>(nNameSize), static_cast<std::uint32_t>(info.nSize),
+				static_cast<std::uint32_t>(info.nAlignment), 0 });
+			sNames.append(info.psName, nNameSize);
+		}
+
+		std::vector<FileArchetype> cFileArchetypes;
+		std::vector<std::uint32_t> cColumns;
+		for (auto const pArchetype : cArchetypes)
+		{
+			FileArchetype archetype{};
+			archetype.nEntityCount = pArchetype->GetEntityCount();
+			archetype.nChunkCapacity = pArchetype->GetChunkCapacity();
+			archetype.nChunkCount = static_cast<std::uint32_t>(pArchetype->GetChunkCount());
+			archetype.nFirstColumn = static_cast<std::uint32_t>(cColumns.size());
+
+			// In increasing type order of the file
+			std::vector<ComponentTypeId> cIds = pArchetype->GetComponentTypes();
+			std::sort(cIds.begin(), cIds.end(), [&aFileTypes](ComponentTypeId a, ComponentTypeId b) { return aFileTypes[a] < aFileTypes[b]; });
+			auto const& chunk = pArchetype->GetChunk(0);
+			for (auto const nId : cIds)
+			{
+				archetype.nTypes |= std::uint64_t{ 1 } << aFileTypes[nId];
+				cColumns.push_back(static_cast<std::uint32_t>(static_cast<unsigned char*>(pArchetype->GetColumn(chunk, nId)) - chunk.pData));
+			}
+			cFileArchetypes.push_back(archetype);
+		}
+		header.nColumnCount = cColumns.size();
+
+		header.nComponentTypesOffset = sizeof(FileHeader);
+		append(cFileTypes.data(), cFileTypes.size() * sizeof(FileComponentType));
+		header.nArchetypesOffset = sizeof(FileHeader) + cTables.size();
+		append(cFileArchetypes.data(), cFileArchetypes.size() * sizeof(FileArchetype));
+		header.nColumnsOffset = sizeof(FileHeader) + cTables.size();
+		append(cColumns.data(), cColumns.size() * sizeof(std::uint32_t));
+		header.nNamesOffset = sizeof(FileHeader) + cTables.size();
+		header.nNamesSize = sNames.size();
+		append(sNames.data(), sNames.size());
+
+		std::vector<FileSlot> cSlots;
+		cSlots.reserve(model.m_cSlots.size());
+		for (auto const& slot : model.m_cSlots)
+		{
+			auto const nArchetype = slot.location.pArchetype ? cArchetypeIndices[slot.location.pArchetype] : NoArchetype;
+			cSlots.push_back({ slot.nGlobalUniqueID, slot.nGeneration, nArchetype, slot.location.nChunk, slot.location.nRow });
+		}
+		header.nSlotsOffset = sizeof(FileHeader) + cTables.size();
+		header.nFreeSlotsOffset = header.nSlotsOffset + cSlots.size() * sizeof(FileSlot);
+
+		FileWriter file{ sPath };
+		file.Write(&header, sizeof(header));
+		file.Write(cTables.data(), cTables.size());
+		file.Write(cSlots.data(), cSlots.size() * sizeof(FileSlot));
+		file.Write(model.m_cFreeSlots.data(), model.m_cFreeSlots.size() * sizeof(std::uint32_t));
+		if (bChecksums)
+		{
+			header.nTablesChecksum = HashBytes(cTables.data(), cTables.size());
+			header.nSlotsChecksum = HashBytes(model.m_cFreeSlots.data(), model.m_cFreeSlots.size() * sizeof(std::uint32_t),
+				HashBytes(cSlots.data(), cSlots.size() * sizeof(FileSlot)));
+		}
+
+		// The used rows of each column, with zeros in between rather than what was left in memory
+		std::vector<unsigned char> cChunk(Chunk::Size);
+		for (size_t i = 0; i < cArchetypes.size(); ++i)
+		{
+			auto const& archetype = *cArchetypes[i];
+			file.PadTo(ChunksAlignment);
+			cFileArchetypes[i].nChunksOffset = file.GetOffset();
+
+			auto nChecksum = HashBytes(nullptr, 0);
+			for (size_t j = 0; j < archetype.GetChunkCount(); ++j)
+			{
+				auto const& chunk = archetype.GetChunk(j);
+				std::fill(cChunk.begin(), cChunk.end(), static_cast<unsigned char>(0));
+				std::memcpy(cChunk.data(), archetype.GetEntities(chunk), chunk.nCount * sizeof(EntityHandle));
+				for (auto const nId : archetype.GetComponentTypes())
+				{
+					auto const pColumn = static_cast<unsigned char*>(archetype.GetColumn(chunk, nId));
+					std::memcpy(cChunk.data() + (pColumn - chunk.pData), pColumn, chunk.nCount * GetComponentTypeInfo(nId).nSize);
+				}
+
+				if (bChecksums) nChecksum = HashBytes(cChunk.data(), cChunk.size(), nChecksum);
+				file.Write(cChunk.data(), cChunk.size());
+			}
+			cFileArchetypes[i].nChecksum = bChecksums ? nChecksum : 0;
+		}
+		header.nFileSize = file.GetOffset();
+
+		// The offsets of the chunks and the checksums are only known now
+		auto const nArchetypesInTables = header.nArchetypesOffset - sizeof(FileHeader);
+		std::memcpy(cTables.data() + nArchetypesInTables, cFileArchetypes.data(), cFileArchetypes.size() * sizeof(FileArchetype));
+		if (bChecksums) header.nTablesChecksum = HashBytes(cTables.data(), cTables.size());
+		file.Rewrite(0, &header, sizeof(header));
+		file.Rewrite(header.nArchetypesOffset, cFileArchetypes.data(), cFileArchetypes.size() * sizeof(FileArchetype));
+		file.Close(sPath);
+	}
+
+	SceneFile SceneFile::Open(const std::string& sPath, bool bVerifyChecksums)
+	{
+		HE_PROFILE_SCOPE("SceneFile::Open");
+
+		SceneFile scene;
+		scene.m_file = MappedFile::Open(sPath, MappedFile::Access::Read);
+		auto const nFileSize = scene.m_file.GetSize();
+		if (nFileSize < sizeof(FileHeader)) ThrowInvalidScene("too small");
+		scene.m_view = scene.m_file.Map(0, static_cast<size_t>(nFileSize));
+		// The view stays mapped once the file is closed
+		scene.m_file.Close();
+
+		auto const pFile = static_cast<const unsigned char*>(scene.m_view.ptr);
+		auto const& header = *reinterpret_cast<const FileHeader*>(pFile);
+		if (std::memcmp(header.aMagic, SceneMagic, sizeof(SceneMagic)) != 0) ThrowInvalidScene("not a scene file");
+		if (header.nVersion != SceneVersion) ThrowInvalidScene("unsupported version");
+		if (header.nChunkSize != Chunk::Size) ThrowInvalidScene("different chunk size");
+		if (header.nFileSize != nFileSize) ThrowInvalidScene("truncated");
+		if (header.nComponentTypeCount > MaxComponentTypes) ThrowInvalidScene("too many component types");
+
+		if (!IsInFile(header.nComponentTypesOffset, header.nComponentTypeCount, sizeof(FileComponentType), 8, nFileSize)
+			|| !IsInFile(header.nArchetypesOffset, header.nArchetypeCount, sizeof(FileArchetype), 8, nFileSize)
+			|| !IsInFile(header.nColumnsOffset, header.nColumnCount, sizeof(std::uint32_t), 8, nFileSize)
+			|| !IsInFile(header.nNamesOffset, header.nNamesSize, 1, 8, nFileSize)
+			|| !IsInFile(header.nSlotsOffset, header.nSlotCount, sizeof(FileSlot), 8, nFileSize)
+			|| !IsInFile(header.nFreeSlotsOffset, header.nFreeSlotCount, sizeof(std::uint32_t), 4, nFileSize)
+			|| header.nSlotsOffset < header.nComponentTypesOffset)
+		{
+			ThrowInvalidScene("table out of the file");
+		}
+
+		auto const bChecksums = bVerifyChecksums && (header.nFlags & ChecksumsFlag) != 0;
+		if (bChecksums)
+		{
+			auto const pSlots = pFile + header.nSlotsOffset;
+			auto const nSlotsChecksum = HashBytes(pFile + header.nFreeSlotsOffset, static_cast<size_t>(header.nFreeSlotCount * sizeof(std::uint32_t)),
+				HashBytes(pSlots, static_cast<size_t>(header.nSlotCount * sizeof(FileSlot))));
+			if (HashBytes(pFile + header.nComponentTypesOffset, static_cast<size_t>(header.nSlotsOffset - header.nComponentTypesOffset)) != header.nTablesChecksum
+				|| nSlotsChecksum != header.nSlotsChecksum)
+			{
+				ThrowInvalidScene("checksum mismatch");
+			}
+		}
+
+		auto const pTypes = reinterpret_cast<const FileComponentType*>(pFile + header.nComponentTypesOffset);
+		for (std::uint32_t i = 0; i < header.nComponentTypeCount; ++i)
+		{
+			auto const& type = pTypes[i];
+			if (type.nNameOffset > header.nNamesSize || type.nNameSize > header.nNamesSize - type.nNameOffset
+				|| type.nSize == 0 || !Math::IsPow2(type.nAlignment) || type.nAlignment > Chunk::ColumnAlignment)
+			{
+				ThrowInvalidScene("invalid component type");
+			}
+		}
+
+		auto const pArchetypes = reinterpret_cast<const FileArchetype*>(pFile + header.nArchetypesOffset);
+		auto const pColumns = reinterpret_cast<const std::uint32_t*>(pFile + header.nColumnsOffset);
+		std::uint64_t nEntityCount = 0;
+		for (std::uint32_t i = 0; i < header.nArchetypeCount; ++i)
+		{
+			auto const& archetype = pArchetypes[i];
+			auto const nTypeCount = CountBits(archetype.nTypes);
+			// Archetypes without entities are not saved: loading them would read a chunk they do not have
+			if (archetype.nEntityCount == 0 || archetype.nChunkCapacity == 0 || archetype.nChunkCapacity > Chunk::Size / sizeof(EntityHandle)
+				|| (header.nComponentTypeCount < 64 && (archetype.nTypes >> header.nComponentTypeCount) != 0)
+				|| archetype.nChunkCount != (archetype.nEntityCount + archetype.nChunkCapacity - 1) / archetype.nChunkCapacity
+				|| !IsInFile(archetype.nChunksOffset, archetype.nChunkCount, Chunk::Size, Chunk::ColumnAlignment, nFileSize)
+				|| archetype.nFirstColumn > header.nColumnCount || nTypeCount > header.nColumnCount - archetype.nFirstColumn)
+			{
+				ThrowInvalidScene("invalid archetype");
+			}
+
+			// Every column within the chunk, after the entities
+			auto const nEntitiesEnd = archetype.nChunkCapacity * sizeof(EntityHandle);
+			size_t nColumn = archetype.nFirstColumn;
+			for (std::uint32_t nType = 0; nType < header.nComponentTypeCount; ++nType)
+			{
+				if ((archetype.nTypes & (std::uint64_t{ 1 } << nType)) == 0) continue;
+
+				auto const nOffset = pColumns[nColumn++];
+				if (nOffset < nEntitiesEnd || nOffset % pTypes[nType].nAlignment != 0
+					|| std::uint64_t{ archetype.nChunkCapacity } * pTypes[nType].nSize > Chunk::Size - std::min<size_t>(nOffset, Chunk::Size))
+				{
+					ThrowInvalidScene("column out of its chunk");
+				}
+			}
+
+			auto const pChunks = pFile + archetype.nChunksOffset;
+			if (bChecksums && HashBytes(pChunks, archetype.nChunkCount * Chunk::Size) != archetype.nChecksum)
+			{
+				ThrowInvalidScene("checksum mismatch");
+			}
+
+			scene.m_cArchetypes.push_back({ pChunks, archetype.nChunkCount, static_cast<size_t>(archetype.nEntityCount),
+				archetype.nChunkCapacity, archetype.nFirstColumn, archetype.nTypes });
+			nEntityCount += archetype.nEntityCount;
+		}
+		if (nEntityCount != header.nEntityCount || header.nEntityCount > header.nSlotCount
+			|| header.nFreeSlotCount != header.nSlotCount - header.nEntityCount || header.nSlotCount > NoArchetype)
+		{
+			ThrowInvalidScene("invalid entity count");
+		}
+
+		scene.m_nEntityCount = static_cast<size_t>(header.nEntityCount);
+		return scene;
+	}
+
+	void SceneFile::Load(Model& model) const
+	{
+		HE_PROFILE_SCOPE("SceneFile::Load");
+		EXPECTS(IsOpen() && model.m_cSlots.empty());
+
+		auto const pFile = static_cast<const unsigned char*>(m_view.ptr);
+		auto const& header = *reinterpret_cast<const FileHeader*>(pFile);
+		auto const pTypes = reinterpret_cast<const FileComponentType*>(pFile + header.nComponentTypesOffset);
+		auto const pColumns = reinterpret_cast<const std::uint32_t*>(pFile + header.nColumnsOffset);
+		auto const pSlots = reinterpret_cast<const FileSlot*>(pFile + header.nSlotsOffset);
+		auto const pFreeSlots = reinterpret_cast<const std::uint32_t*>(pFile + header.nFreeSlotsOffset);
+
+		// The component types of the file in this process
+		std::vector<ComponentTypeId> cIds;
+		for (std::uint32_t i = 0; i < header.nComponentTypeCount; ++i)
+		{
+			auto const& type = pTypes[i];
+			std::string const sName{ reinterpret_cast<const char*>(pFile + header.nNamesOffset + type.nNameOffset), type.nNameSize };
+			auto const nId = FindComponentType(sName.c_str());
+			if (nId == MaxComponentTypes)
+			{
+				throw std::invalid_argument{ "Component " + sName + " of the scene is not used by this process" };
+			}
+
+			auto const& info = GetComponentTypeInfo(nId);
+			if (info.nSize != type.nSize || info.nAlignment != type.nAlignment || !info.bTriviallyCopyable)
+			{
+				throw std::invalid_argument{ "Component " + sName + " of the scene has a different layout in this process" };
+			}
+			cIds.push_back(nId);
+		}
+
+		// Validates the entities before changing the Model: each slot refers to a row of its archetype that refers
+		// back to it, and the free slots are the others
+		std::vector<size_t> cCounts(m_cArchetypes.size(), 0);
+		for (std::uint64_t i = 0; i < header.nSlotCount; ++i)
+		{
+			auto const& slot = pSlots[i];
+			if (slot.nGeneration == 0 || slot.nGeneration == EntityHandle::PendingGeneration) ThrowInvalidScene("invalid generation");
+			if (slot.nArchetype == NoArchetype) continue;
+
+			if (slot.nArchetype >= m_cArchetypes.size() || slot.nGlobalUniqueID == Model::AutoGlobalUniqueID) ThrowInvalidScene("invalid entity");
+			auto const& archetype = m_cArchetypes[slot.nArchetype];
+			auto const nIndex = std::uint64_t{ slot.nChunk } * archetype.nChunkCapacity + slot.nRow;
+			if (slot.nRow >= archetype.nChunkCapacity || nIndex >= archetype.nEntityCount) ThrowInvalidScene("invalid entity");
+
+			EntityHandle entity;
+			std::memcpy(&entity, archetype.pChunks + slot.nChunk * Chunk::Size + slot.nRow * sizeof(EntityHandle), sizeof(entity));
+			if (entity != EntityHandle{ static_cast<std::uint32_t>(i), slot.nGeneration }) ThrowInvalidScene("invalid entity");
+			++cCounts[slot.nArchetype];
+		}
+		for (size_t i = 0; i < m_cArchetypes.size(); ++i)
+		{
+			if (cCounts[i] != m_cArchetypes[i].nEntityCount) ThrowInvalidScene("invalid entity count");
+		}
+
+		std::vector<bool> cFree(static_cast<size_t>(header.nSlotCount), false);
+		for (std::uint64_t i = 0; i < header.nFreeSlotCount; ++i)
+		{
+			auto const nSlot = pFreeSlots[i];
+			if (nSlot >= header.nSlotCount || pSlots[nSlot].nArchetype != NoArchetype || cFree[nSlot]) ThrowInvalidScene("invalid free slot");
+			cFree[nSlot] = true;
+		}
+
+		// Allocates everything, so that only a duplicate ID can fail past this
+		std::vector<Archetype*> cArchetypes;
+		for (size_t i = 0; i < m_cArchetypes.size(); ++i)
+		{
+			ComponentMask nMask = 0;
+			for (std::uint32_t nType = 0; nType < header.nComponentTypeCount; ++nType)
+			{
+				if (m_cArchetypes[i].nTypes & (std::uint64_t{ 1 } << nType)) nMask |= GetComponentBit(cIds[nType]);
+			}
+
+			auto& archetype = model.GetArchetype(nMask);
+			if (archetype.GetChunkCapacity() != m_cArchetypes[i].nChunkCapacity
+				|| std::find(cArchetypes.begin(), cArchetypes.end(), &archetype) != cArchetypes.end())
+			{
+				ThrowInvalidScene("invalid archetype");
+			}
+			archetype.Reserve(m_cArchetypes[i].nEntityCount);
+			cArchetypes.push_back(&archetype);
+		}
+		model.m_cSlots.reserve(static_cast<size_t>(header.nSlotCount));
+		auto const nSlotBlocks = (static_cast<size_t>(header.nSlotCount) + Model::SlotBlockSize - 1) / Model::SlotBlockSize;
+		model.m_cSlotVersions.reserve(nSlotBlocks);
+		model.m_cFreeSlots.reserve(static_cast<size_t>(header.nSlotCount));
+		model.ReserveIDs(static_cast<size_t>(header.nEntityCount));
+
+		auto nNextGlobalUniqueID = header.nNextGlobalUniqueID;
+		for (std::uint64_t i = 0; i < header.nSlotCount; ++i)
+		{
+			auto const& slot = pSlots[i];
+			auto const pArchetype = slot.nArchetype != NoArchetype ? cArchetypes[slot.nArchetype] : nullptr;
+			model.m_cSlots.push_back({ { pArchetype, slot.nChunk, slot.nRow }, slot.nGlobalUniqueID, slot.nGeneration });
+			if (!pArchetype) continue;
+
+			auto& nEntry = model.m_cIDTable[model.FindIDEntry(slot.nGlobalUniqueID)];
+			if (nEntry != 0)
+			{
+				model.m_cSlots.clear();
+				std::fill(model.m_cIDTable.begin(), model.m_cIDTable.end(), 0u);
+				ThrowInvalidScene("duplicate global unique ID");
+			}
+			nEntry = static_cast<std::uint32_t>(i + 1);
+			nNextGlobalUniqueID = std::max(nNextGlobalUniqueID, slot.nGlobalUniqueID + 1);
+		}
+		model.m_cSlotVersions.assign(nSlotBlocks, model.GetChangeVersion());
+		model.m_cFreeSlots.assign(pFreeSlots, pFreeSlots + header.nFreeSlotCount);
+		model.m_nEntityCount = static_cast<size_t>(header.nEntityCount);
+		model.m_nNextGlobalUniqueID = nNextGlobalUniqueID;
+
+		// The chunks, as a whole when the layout in this process is the same, by column otherwise
+		for (size_t i = 0; i < m_cArchetypes.size(); ++i)
+		{
+			auto const& view = m_cArchetypes[i];
+			auto& archetype = *cArchetypes[i];
+			archetype.Resize(view.nEntityCount);
+
+			std::vector<std::pair<std::uint32_t, std::uint32_t>> cColumns;
+			auto bSameLayout = true;
+			auto const& first = archetype.GetChunk(0);
+			size_t nColumn = view.nFirstColumn;
+			for (std::uint32_t nType = 0; nType < header.nComponentTypeCount; ++nType)
+			{
+				if ((view.nTypes & (std::uint64_t{ 1 } << nType)) == 0) continue;
+
+				auto const nOffset = static_cast<std::uint32_t>(static_cast<unsigned char*>(archetype.GetColumn(first, cIds[nType])) - first.pData);
+				cColumns.emplace_back(pColumns[nColumn++], nOffset);
+				bSameLayout = bSameLayout && cColumns.back().first == nOffset;
+			}
+
+			for (size_t j = 0; j < archetype.GetChunkCount(); ++j)
+			{
+				auto const& chunk = archetype.GetChunk(j);
+				auto const pSource = view.pChunks + j * Chunk::Size;
+				if (bSameLayout)
+				{
+					std::memcpy(chunk.pData, pSource, Chunk::Size);
+					continue;
+				}
+
+				std::memcpy(chunk.pData, pSource, chunk.nCount * sizeof(EntityHandle));
+				size_t nColumnIndex = 0;
+				for (std::uint32_t nType = 0; nType < header.nComponentTypeCount; ++nType)
+				{
+					if ((view.nTypes & (std::uint64_t{ 1 } << nType)) == 0) continue;
+
+					auto const& column = cColumns[nColumnIndex++];
+					std::memcpy(chunk.pData + column.second, pSource + column.first, chunk.nCount * GetComponentTypeInfo(cIds[nType]).nSize);
+				}
+			}
+		}
+	}
+
+	std::uint32_t SceneFile::FindColumn(size_t nArchetype, ComponentTypeId nId) const
+	{
+		auto const pFile = static_cast<const unsigned char*>(m_view.ptr);
+		auto const& header = *reinterpret_cast<const FileHeader*>(pFile);
+		auto const pTypes = reinterpret_cast<const FileComponentType*>(pFile + header.nComponentTypesOffset);
+		auto const pColumns = reinterpret_cast<const std::uint32_t*>(pFile + header.nColumnsOffset);
+		auto const& info = GetComponentTypeInfo(nId);
+		auto const nNameSize = std::strlen(info.psName);
+
+		auto const& archetype = m_cArchetypes[nArchetype];
+		size_t nColumn = archetype.nFirstColumn;
+		for (std::uint32_t nType = 0; nType < header.nComponentTypeCount; ++nType)
+		{
+			if ((archetype.nTypes & (std::uint64_t{ 1 } << nType)) == 0) continue;
+
+			auto const& type = pTypes[nType];
+			auto const nOffset = pColumns[nColumn++];
+			if (type.nNameSize != nNameSize || std::memcmp(pFile + header.nNamesOffset + type.nNameOffset, info.psName, nNameSize) != 0) continue;
+
+			if (type.nSize != info.nSize)
+			{
+				throw std::invalid_argument{ std::string{ "Component " } + info.psName + " has a different size in the scene" };
+			}
+			return nOffset;
+		}
+		return NoColumn;
+	}
+}
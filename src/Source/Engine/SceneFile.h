@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "Archetype.h"
+#include "Component.h"
+#include "HE_Allocator.h"
+#include "HE_MappedFile.h"
+
+namespace HE
+{
+	class Model;
+
+	// Binary scene file: the entities of a Model, with their handles, global unique IDs and components
+	//
+	// Components are stored in chunks laid out as the chunks of the Model, so that loading is mapping the file,
+	// validating its tables, and copying the chunks as they are, with no parsing of the components. The file refers
+	// to its parts by offsets from its start, never by address. The components can also be read in place, where
+	// only the pages read are loaded from the disk (see ForEachChunk)
+	//
+	// Components must be trivially copyable. They are identified by the name and size of their type, so a file
+	// is only portable between builds of the same compiler for platforms with the same data layout. Their
+	// names must be unique: types in anonymous namespaces of different files can share one
+	class SceneFile
+	{
+	public:
+		SceneFile() noexcept = default;
+		SceneFile(SceneFile&& other) noexcept;
+		SceneFile& operator=(SceneFile&& other) noexcept;
+		~SceneFile();
+
+		// Writes the entities of the Model to the file at sPath. With bChecksums, each section of the file gets a
+		// checksum, for Open to verify
+		// Throws std::invalid_argument if a component is not trivially copyable, std::runtime_error if the file
+		// cannot be written
+		static void Save(const Model& model, const std::string& sPath, bool bChecksums = true);
+
+		// Maps the file and validates its tables. With bVerifyChecksums, also reads the whole file to verify its
+		// checksums, if it has some: skip it to only load the pages of the components as they are read
+		// Throws std::system_error if the file cannot be mapped, std::runtime_error if it is not a valid scene
+		static SceneFile Open(const std::string& sPath, bool bVerifyChecksums = true);
+
+		bool IsOpen() const noexcept { return m_view.ptr != nullptr; }
+		size_t GetEntityCount() const noexcept { return m_nEntityCount; }
+
+		// Creates the entities of the scene in a Model with no entities, with the same handles and global unique IDs
+		// Throws std::invalid_argument if a component type of the scene is not used in this process, or has a
+		// different size, std::runtime_error if the entities of the scene are invalid. If it throws, the Model
+		// has no entities
+		void Load(Model& model) const;
+
+		// Form: ForEachChunk<Ts...>(f(const ChunkView<const Ts...>&)), over the chunks of the entities with all of Ts,
+		// read in place from the mapped file
+		// Throws std::invalid_argument if one of Ts has a different size in the scene
+		template<class... Ts, class F>
+		void ForEachChunk(F&& f) const
+		{
+			static_assert(sizeof...(Ts) > 0, "ForEachChunk needs at least one component type");
+
+			for (size_t i = 0; i < m_cArchetypes.size(); ++i)
+			{
+				std::uint32_t const aOffsets[] = { FindColumn(i, GetComponentTypeId<Ts>())... };
+				bool bMatch = true;
+				for (auto const nOffset : aOffsets) bMatch = bMatch && nOffset != NoColumn;
+				if (!bMatch) continue;
+
+				auto const& archetype = m_cArchetypes[i];
+				for (size_t j = 0; j < archetype.nChunkCount; ++j)
+				{
+					auto const pChunk = archetype.pChunks + j * Chunk::Size;
+					auto const nCount = static_cast<std::uint32_t>(std::min<size_t>(archetype.nEntityCount - j * archetype.nChunkCapacity, archetype.nChunkCapacity));
+					f(MakeView<Ts...>(pChunk, aOffsets, nCount, std::index_sequence_for<Ts...>{}));
+				}
+			}
+		}
+
+	private:
+		static constexpr std::uint32_t NoColumn = ~std::uint32_t{ 0 };
+
+		struct ArchetypeView
+		{
+			const unsigned char* pChunks;
+			size_t nChunkCount;
+			size_t nEntityCount;
+			std::uint32_t nChunkCapacity;
+			// Index in the columns of the file of the column of the first component type
+			std::uint32_t nFirstColumn;
+			// Bits of the component types of the file
+			std::uint64_t nTypes;
+		};
+
+		template<class... Ts, size_t... Is>
+		static ChunkView<const Ts...> MakeView(const unsigned char* pChunk, const std::uint32_t* pOffsets, std::uint32_t nCount, std::index_sequence<Is...>) noexcept
+		{
+			return{ reinterpret_cast<const EntityHandle*>(pChunk), std::tuple<const Ts*...>{ reinterpret_cast<const Ts*>(pChunk + pOffsets[Is])... }, nCount };
+		}
+
+		// Returns the offset of the column of the component in the chunks of the archetype, or NoColumn
+		std::uint32_t FindColumn(size_t nArchetype, ComponentTypeId nId) const;
+
+		MappedFile m_file;
+		Blk m_view{ nullptr, 0 };
+		std::vector<ArchetypeView> m_cArchetypes;
+		size_t m_nEntityCount{ 0 };
+	};
+}
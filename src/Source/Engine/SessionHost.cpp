@@ -0,0 +1,245 @@
+#include "SessionHost.h"
+
+#include <exception>
+
+#include "HE_Assert.h"
+#include "HE_Log.h"
+#include "HE_Profiler.h"
+
+HE_DEFINE_LOG_CATEGORY(SessionHost, Info);
+
+namespace HE
+{
+	namespace
+	{
+		// Upper bound of the sleep of the host thread, when no session is due
+		constexpr auto IdleWait = std::chrono::milliseconds{ 100 };
+	}
+
+	Session::Session(std::string sName, const SessionSettings& settings)
+		: m_sName(std::move(sName)),
+		m_settings(settings),
+		m_tickTime(m_metrics.GetHistogram("Session.TickTime")),
+		m_lateness(m_metrics.GetHistogram("Session.Lateness")),
+		m_ticks(m_metrics.GetCounter("Session.Ticks")),
+		m_droppedTicks(m_metrics.GetCounter("Session.DroppedTicks")),
+		m_missedDeadlines(m_metrics.GetCounter("Session.MissedDeadlines")),
+		m_entities(m_metrics.GetGauge("Model.Entities")),
+		m_arenaUsed(m_metrics.GetGauge("Session.ArenaUsed", MetricUnit::Bytes)),
+		m_arenaReserved(m_metrics.GetGauge("Session.ArenaReserved", MetricUnit::Bytes)),
+		m_tNextTick(FramePacer::Clock::now())
+	{
+		EXPECTS(m_settings.tTickPeriod.count() > 0 && m_settings.nMaxTicksPerUpdate > 0);
+
+		m_model.GetSystems().SetExecutionMode(m_settings.eExecutionMode);
+		m_model.GetSystems().SetMetrics(&m_metrics);
+	}
+
+	SessionHost::SessionHost()
+		: SessionHost(SessionHostSettings{})
+	{
+
+	}
+
+	SessionHost::SessionHost(const SessionHostSettings& settings)
+		: m_settings(settings)
+	{
+
+	}
+
+	SessionHost::~SessionHost()
+	{
+		Stop();
+		if (m_runThread.joinable()) m_runThread.join();
+	}
+
+	Session& SessionHost::AddSession(std::string sName, const SessionSettings& settings, const std::function<void(Model&)>& setup)
+	{
+		std::unique_ptr<Session> pSession{ new Session{ std::move(sName), settings } };
+		if (setup) setup(pSession->m_model);
+		pSession->m_tNextTick = Clock::now();
+
+		auto& session = *pSession;
+		{
+			std::lock_guard<std::mutex> lock{ m_mutSessions };
+			m_cSessions.push_back(std::move(pSession));
+		}
+		m_pacer.Wake();
+		return session;
+	}
+
+	void SessionHost::RemoveSession(Session& session)
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutSessions };
+			session.m_bRemoved = true;
+		}
+
+		// No update starts once removed
+		m_jobSystem.Wait(session.m_counter);
+
+		std::lock_guard<std::mutex> lock{ m_mutSessions };
+		auto const it = std::find_if(m_cSessions.begin(), m_cSessions.end(), [&session](const std::unique_ptr<Session>& pSession) {
+			return pSession.get() == &session;
+		});
+		EXPECTS(it != m_cSessions.end());
+		m_cSessions.erase(it);
+	}
+
+	size_t SessionHost::GetSessionCount() const
+	{
+		std::lock_guard<std::mutex> lock{ m_mutSessions };
+		return m_cSessions.size();
+	}
+
+	std::future<void> SessionHost::Run()
+	{
+		EXPECTS(!m_bRunning);
+
+		m_bRunning = true;
+
+		std::packaged_task<void()> hostRun([this]() {
+			HE_LOG(Info, SessionHost, "Hosting sessions on {_} workers", m_jobSystem.GetWorkerCount());
+
+			RunLoop();
+
+			HE_LOG(Info, SessionHost, "The SessionHost has stopped");
+		});
+		auto futHostEnd = hostRun.get_future();
+
+		m_runThread = std::thread{ std::move(hostRun) };
+
+		return futHostEnd;
+	}
+
+	void SessionHost::Stop()
+	{
+		m_bShouldStop = true;
+		m_pacer.Wake();
+	}
+
+	void SessionHost::RunLoop()
+	{
+		SetProfileThreadName("SessionHost");
+
+		{
+			// The sessions added before Run do not start late
+			auto const tStart = Clock::now();
+			std::lock_guard<std::mutex> lock{ m_mutSessions };
+			for (auto const& pSession : m_cSessions)
+			{
+				pSession->m_tNextTick = tStart;
+			}
+		}
+
+		std::vector<Session*> cDue;
+		while (!m_bShouldStop)
+		{
+			auto const tNow = Clock::now();
+			auto tWake = tNow + IdleWait;
+			{
+				std::lock_guard<std::mutex> lock{ m_mutSessions };
+				cDue.clear();
+				for (auto const& pSession : m_cSessions)
+				{
+					auto& session = *pSession;
+					// An update that ends wakes the host
+					if (session.m_bRemoved || session.m_bFailed.load() || session.m_bUpdating.load(std::memory_order_acquire)) continue;
+
+					if (session.m_tNextTick <= tNow) cDue.push_back(&session);
+					else tWake = std::min(tWake, session.m_tNextTick);
+				}
+
+				// Earliest deadline first
+				std::sort(cDue.begin(), cDue.end(), [](const Session* pLeft, const Session* pRight) {
+					return pLeft->m_tNextTick < pRight->m_tNextTick;
+				});
+				for (auto const pSession : cDue)
+				{
+					StartUpdate(*pSession, tNow);
+				}
+
+				if (m_jobSystem.GetWorkerCount() == 0)
+				{
+					// Jobs only run when waited on. Under the lock, since RemoveSession destroys a session as soon as
+					// its updates are done
+					for (auto const pSession : cDue)
+					{
+						m_jobSystem.Wait(pSession->m_counter);
+						tWake = std::min(tWake, pSession->m_tNextTick);
+					}
+				}
+			}
+
+			m_pacer.WaitUntil(tWake);
+		}
+
+		std::lock_guard<std::mutex> lock{ m_mutSessions };
+		for (auto const& pSession : m_cSessions)
+		{
+			m_jobSystem.Wait(pSession->m_counter);
+		}
+	}
+
+	void SessionHost::StartUpdate(Session& session, Clock::time_point tNow)
+	{
+		auto const tTick = session.m_settings.tTickPeriod;
+		auto const tLateness = tNow - session.m_tNextTick;
+		auto const nDue = static_cast<std::uint64_t>(tLateness / tTick) + 1;
+		auto const nTicks = static_cast<std::uint32_t>(std::min<std::uint64_t>(nDue, session.m_settings.nMaxTicksPerUpdate));
+
+		// The update should end before the next tick is due
+		session.m_tNextTick += tTick * nDue;
+		session.m_lateness.Record(tLateness);
+		if (nDue > nTicks) session.m_droppedTicks.Add(nDue - nTicks);
+
+		session.m_bUpdating.store(true, std::memory_order_relaxed);
+		auto const tDeadline = session.m_tNextTick;
+		m_jobSystem.Run(session.m_counter, [this, &session, nTicks, tDeadline]() {
+			Update(session, nTicks, tDeadline);
+		});
+	}
+
+	void SessionHost::Update(Session& session, std::uint32_t nTicks, Clock::time_point tDeadline) noexcept
+	{
+		HE_PROFILE_SCOPE("SessionHost::Update");
+
+		auto const fTickSeconds = std::chrono::duration<double>(session.m_settings.tTickPeriod).count();
+		try
+		{
+			for (std::uint32_t i = 0; i < nTicks; ++i)
+			{
+				auto const tStart = Clock::now();
+				session.m_model.Update(fTickSeconds, m_jobSystem);
+				session.m_tickTime.Record(Clock::now() - tStart);
+				session.m_ticks.Add();
+			}
+		}
+		catch (const std::exception& e)
+		{
+			HE_LOG(Error, SessionHost, "Session {_} failed, it will not tick anymore: {_}", session.m_sName, e.what());
+			session.m_bFailed = true;
+		}
+		catch (...)
+		{
+			HE_LOG(Error, SessionHost, "Session {_} failed, it will not tick anymore", session.m_sName);
+			session.m_bFailed = true;
+		}
+
+		if (Clock::now() > tDeadline) session.m_missedDeadlines.Add();
+		session.m_entities.Set(static_cast<std::int64_t>(session.m_model.GetEntityCount()));
+		session.m_arenaUsed.Set(static_cast<std::int64_t>(session.m_arena.GetUsedBytes()));
+		session.m_arenaReserved.Set(static_cast<std::int64_t>(session.m_arena.GetReservedBytes()));
+		try
+		{
+			session.m_metrics.Merge();
+		}
+		catch (const std::exception& e)
+		{
+			HE_LOG(Warning, SessionHost, "Could not merge the metrics of session {_}: {_}", session.m_sName, e.what());
+		}
+
+		session.m_bUpdating.store(false, std::memory_order_release);
+		m_pacer.Wake();
+	}
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ChunkArena.h"
+#include "HE_FramePacer.h"
+#include "HE_JobSystem.h"
+#include "HE_Metrics.h"
+#include "Model.h"
+#include "SystemScheduler.h"
+
+namespace HE
+{
+	struct SessionSettings
+	{
+		// Fixed simulation step of the session. Model::Update is always called with this dt
+		std::chrono::nanoseconds tTickPeriod{ std::chrono::nanoseconds{ std::chrono::seconds{ 1 } } / 60 };
+		// Upper bound of ticks run back to back by one update of a late session. The other late ticks are dropped
+		std::uint32_t nMaxTicksPerUpdate{ 4 };
+		// Budget of the chunk memory of the Model. Zero is unbounded
+		size_t nMaxChunkMemory{ 0 };
+		// Sequential keeps each update on one worker: a Parallel session waiting on its tasks may run the update of
+		// another session in the meantime, and finish late because of it
+		ExecutionMode eExecutionMode{ ExecutionMode::Sequential };
+	};
+
+	struct SessionHostSettings
+	{
+		// Workers shared by all the sessions. The host thread only schedules the updates
+		size_t nWorkerThreads{ std::max<size_t>(1, std::thread::hardware_concurrency()) };
+	};
+
+	// A Model ticking at its own rate on a SessionHost, ex: one match of a game server
+	// The session owns its chunk memory and its metrics, so that it neither contends with the others on them, nor
+	// takes more than its budget
+	class Session
+	{
+	public:
+		Session(const Session&) = delete;
+		void operator=(const Session&) = delete;
+
+		const std::string& GetName() const noexcept { return m_sName; }
+		const SessionSettings& GetSettings() const noexcept { return m_settings; }
+
+		// Only from the setup of the session, or while the host is not running
+		Model& GetModel() noexcept { return m_model; }
+		const ChunkArena& GetArena() const noexcept { return m_arena; }
+
+		// Thread-safe. The metrics as of the end of the last update: the time of each tick and system, the lateness
+		// of the updates, the ticks run, dropped and past their deadline, the entities and the arena memory
+		MetricsSnapshot GetMetrics() const { return m_metrics.GetSnapshot(); }
+
+		// Thread-safe. To add metrics of the game, merged at the end of every update
+		MetricsRegistry& GetMetricsRegistry() noexcept { return m_metrics; }
+
+		// Thread-safe. An update threw: the session does not tick anymore
+		bool HasFailed() const noexcept { return m_bFailed.load(); }
+
+	private:
+		friend class SessionHost;
+
+		Session(std::string sName, const SessionSettings& settings);
+
+		std::string const m_sName;
+		SessionSettings const m_settings;
+		ChunkArena m_arena{ m_settings.nMaxChunkMemory };
+		// Outlives the histograms of the systems of the Model
+		// Single-sharded: a session updates one at a time, and a shard per worker in every session would take
+		// megabytes per session on a big host
+		MetricsRegistry m_metrics{ MetricSharding::Single };
+		Model m_model{ m_arena };
+
+		Histogram& m_tickTime;
+		Histogram& m_lateness;
+		Counter& m_ticks;
+		Counter& m_droppedTicks;
+		Counter& m_missedDeadlines;
+		Gauge& m_entities;
+		Gauge& m_arenaUsed;
+		Gauge& m_arenaReserved;
+
+		// Written by the host thread only
+		FramePacer::Clock::time_point m_tNextTick;
+		bool m_bRemoved{ false };
+		// Set by the host when it starts an update, cleared by the update when it ends
+		std::atomic<bool> m_bUpdating{ false };
+		std::atomic<bool> m_bFailed{ false };
+		// Of the updates in flight
+		JobCounter m_counter;
+	};
+
+	// Runs many sessions on one JobSystem
+	//
+	// The host thread starts the update of every session that is due, earliest deadline first, then sleeps until the
+	// next tick of a session. An update runs the ticks of its session on a worker, at most one update per session at
+	// a time: a slow session falls behind, drops ticks and counts its missed deadlines, while the others keep their
+	// rate. A session that throws is logged and stops ticking, the others go on
+	//
+	// Ensures: Stops on destruction, and waits for the updates in flight
+	class SessionHost
+	{
+	public:
+		SessionHost();
+		explicit SessionHost(const SessionHostSettings& settings);
+		SessionHost(const SessionHost&) = delete;
+		void operator=(const SessionHost&) = delete;
+		~SessionHost();
+
+		// Thread-safe. Creates a session, and runs setup(model) on this thread to add its systems and entities before
+		// its first tick
+		Session& AddSession(std::string sName, const SessionSettings& settings, const std::function<void(Model&)>& setup);
+
+		// Thread-safe, but not from an update. Waits for the update in flight of the session, then destroys it
+		void RemoveSession(Session& session);
+
+		size_t GetSessionCount() const;
+
+		// Thread-safe. Calls f(session) for every session. Sessions cannot be added or removed from f
+		template<class F>
+		void ForEachSession(F&& f) const
+		{
+			std::lock_guard<std::mutex> lock{ m_mutSessions };
+			for (auto const& pSession : m_cSessions)
+			{
+				f(static_cast<const Session&>(*pSession));
+			}
+		}
+
+		// Getting the future will block until the host has stopped running
+		// Should only be called once on the object
+		std::future<void> Run();
+
+		// Thread-safe. Signals the host to stop running, waking it if it is waiting for the next tick
+		void Stop();
+
+		JobSystem& GetJobSystem() noexcept { return m_jobSystem; }
+
+	private:
+		using Clock = FramePacer::Clock;
+
+		void RunLoop();
+		void StartUpdate(Session& session, Clock::time_point tNow);
+		void Update(Session& session, std::uint32_t nTicks, Clock::time_point tDeadline) noexcept;
+
+		SessionHostSettings const m_settings;
+		JobSystem m_jobSystem{ m_settings.nWorkerThreads };
+
+		// Destroyed before the JobSystem
+		mutable std::mutex m_mutSessions;
+		std::vector<std::unique_ptr<Session>> m_cSessions;
+
+		std::thread m_runThread;
+		std::atomic<bool> m_bShouldStop{ false };
+		bool m_bRunning{ false };
+		// Never spins: the host thread only starts updates
+		FramePacer m_pacer{ Clock::duration{ 0 } };
+	};
+}
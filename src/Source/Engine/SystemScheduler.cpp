@@ -0,0 +1,270 @@
+#include "SystemScheduler.h"
+
+#include <algorithm>
+
+#include "HE_JobSystem.h"
+#include "HE_Metrics.h"
+#include "HE_Profiler.h"
+#include "Model.h"
+
+namespace HE
+{
+	namespace
+	{
+		// Tasks per thread for each system, so that stealing can balance chunks of uneven cost
+		constexpr size_t TasksPerThread = 4;
+	}
+
+	SystemScheduler::~SystemScheduler() = default;
+
+	void SystemScheduler::AddTask(std::string sName, ComponentMask nReads, ComponentMask nWrites, std::function<void(SystemContext&)> f)
+	{
+		System system;
+		system.sName = std::move(sName);
+		system.nReads = nReads & ~nWrites;
+		system.nWrites = nWrites;
+		system.runTask = std::move(f);
+		Add(std::move(system));
+	}
+
+	void SystemScheduler::AddSyncPoint()
+	{
+		m_bSyncPending = !m_cSystems.empty();
+	}
+
+	void SystemScheduler::SetMetrics(MetricsRegistry* pMetrics)
+	{
+		m_pMetrics = pMetrics;
+		for (auto& system : m_cSystems)
+		{
+			system.pTimeHistogram = pMetrics != nullptr ? &pMetrics->GetHistogram("System." + system.sName) : nullptr;
+		}
+	}
+
+	void SystemScheduler::Add(System system)
+	{
+		system.psProfileName = InternProfileName(system.sName);
+		if (m_pMetrics != nullptr)
+		{
+			system.pTimeHistogram = &m_pMetrics->GetHistogram("System." + system.sName);
+		}
+		if (m_bSyncPending)
+		{
+			++m_nStageCount;
+			m_bSyncPending = false;
+		}
+		system.nStage = m_nStageCount - 1;
+
+		// After every system of the stage it conflicts with
+		for (auto const& other : m_cSystems)
+		{
+			if (other.nStage == system.nStage && Conflict(other, system))
+			{
+				system.nWave = std::max(system.nWave, other.nWave + 1);
+			}
+		}
+
+		m_cSystems.push_back(std::move(system));
+	}
+
+	void SystemScheduler::Run(double dt, JobSystem& jobSystem)
+	{
+		m_fDt = dt;
+		m_events.Clear();
+
+		for (size_t nStage = 0; nStage < m_nStageCount; ++nStage)
+		{
+			size_t nWaves = 0;
+			for (auto const& system : m_cSystems)
+			{
+				if (system.nStage == nStage) nWaves = std::max(nWaves, system.nWave + 1);
+			}
+
+			try
+			{
+				for (size_t nWave = 0; nWave < nWaves; ++nWave)
+				{
+					RunWave(nStage, nWave, jobSystem);
+				}
+			}
+			catch (...)
+			{
+				for (size_t i = 0; i < m_nContextsUsed; ++i)
+				{
+					m_cContexts[i]->m_commands.Clear();
+					m_cContexts[i]->m_emitted.Clear();
+				}
+				m_nContextsUsed = 0;
+				throw;
+			}
+
+			Sync();
+		}
+	}
+
+	void SystemScheduler::RunWave(size_t nStage, size_t nWave, JobSystem& jobSystem)
+	{
+		auto const nTasksPerSystem = m_eMode == ExecutionMode::Parallel ? jobSystem.GetThreadCount() * TasksPerThread : 1;
+
+		m_cChunks.clear();
+		m_cTasks.clear();
+		for (auto& system : m_cSystems)
+		{
+			if (system.nStage != nStage || system.nWave != nWave) continue;
+
+			if (system.runTask)
+			{
+				m_cTasks.push_back({ &system, 0, 0, &GetContext(), {} });
+				continue;
+			}
+
+			// Picks up the archetypes created since the last run
+			auto const& cArchetypes = m_model.GetArchetypes();
+			for (; system.nArchetypesMatched < cArchetypes.size(); ++system.nArchetypesMatched)
+			{
+				auto const pArchetype = cArchetypes[system.nArchetypesMatched];
+				if ((pArchetype->GetMask() & system.nQueryMask) == system.nQueryMask)
+				{
+					system.cArchetypes.push_back(pArchetype);
+				}
+			}
+
+			auto const nFirstChunk = m_cChunks.size();
+			for (auto const pArchetype : system.cArchetypes)
+			{
+				for (size_t i = 0; i < pArchetype->GetChunkCount(); ++i)
+				{
+					m_cChunks.push_back({ pArchetype, i });
+				}
+			}
+
+			// Contiguous ranges of about the same number of chunks
+			auto const nChunks = m_cChunks.size() - nFirstChunk;
+			auto const nTasks = std::min(nChunks, nTasksPerSystem);
+			for (size_t i = 0; i < nTasks; ++i)
+			{
+				m_cTasks.push_back({ &system, nFirstChunk + i * nChunks / nTasks, nFirstChunk + (i + 1) * nChunks / nTasks, &GetContext(), {} });
+			}
+		}
+
+		if (m_eMode == ExecutionMode::Parallel)
+		{
+			jobSystem.ParallelFor(0, m_cTasks.size(), [this](size_t i) { RunTask(m_cTasks[i]); }, 1);
+		}
+		else
+		{
+			for (auto& task : m_cTasks)
+			{
+				RunTask(task);
+			}
+		}
+
+		if (m_pMetrics != nullptr) RecordTimes();
+		MarkChanged();
+
+		for (auto const& task : m_cTasks)
+		{
+			if (task.pContext->m_pException)
+			{
+				std::rethrow_exception(std::exchange(task.pContext->m_pException, nullptr));
+			}
+		}
+	}
+
+	void SystemScheduler::RunTask(Task& task) noexcept
+	{
+		auto& context = *task.pContext;
+		HE_PROFILE_SCOPE(task.pSystem->psProfileName);
+		auto const bTimed = task.pSystem->pTimeHistogram != nullptr;
+		auto const tStart = bTimed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+		try
+		{
+			if (task.pSystem->runTask)
+			{
+				task.pSystem->runTask(context);
+			}
+			else
+			{
+				for (auto i = task.nFirstChunk; i < task.nEndChunk; ++i)
+				{
+					auto const& ref = m_cChunks[i];
+					task.pSystem->runChunk(context, *ref.pArchetype, ref.pArchetype->GetChunk(ref.nChunk));
+				}
+			}
+		}
+		catch (...)
+		{
+			// Jobs must not throw: rethrown by RunWave
+			context.m_pException = std::current_exception();
+		}
+		if (bTimed) task.tTime = std::chrono::steady_clock::now() - tStart;
+	}
+
+	void SystemScheduler::MarkChanged() noexcept
+	{
+		// Systems of a wave can write different columns of the same chunk, and all of them stamp the chunk itself:
+		// stamped here rather than by the tasks. Nothing reads the versions while the wave runs
+		for (auto const& task : m_cTasks)
+		{
+			if (task.pSystem->runTask || task.pSystem->nWrites == 0) continue;
+
+			for (auto i = task.nFirstChunk; i < task.nEndChunk; ++i)
+			{
+				m_cChunks[i].pArchetype->MarkChanged(m_cChunks[i].nChunk, task.pSystem->nWrites);
+			}
+		}
+	}
+
+	void SystemScheduler::RecordTimes()
+	{
+		// The tasks of a system are next to each other
+		for (size_t i = 0; i < m_cTasks.size(); )
+		{
+			auto const pSystem = m_cTasks[i].pSystem;
+			std::chrono::steady_clock::duration tTime{ 0 };
+			for (; i < m_cTasks.size() && m_cTasks[i].pSystem == pSystem; ++i)
+			{
+				tTime += m_cTasks[i].tTime;
+			}
+			if (pSystem->pTimeHistogram != nullptr) pSystem->pTimeHistogram->Record(tTime);
+		}
+	}
+
+	SystemContext& SystemScheduler::GetContext()
+	{
+		if (m_nContextsUsed == m_cContexts.size())
+		{
+			m_cContexts.push_back(std::make_unique<SystemContext>(m_model));
+		}
+
+		auto& context = *m_cContexts[m_nContextsUsed++];
+		context.m_fDt = m_fDt;
+		context.m_pPublished = &m_events;
+		context.m_pException = nullptr;
+		return context;
+	}
+
+	void SystemScheduler::Sync()
+	{
+		// Merge order: waves, then systems in the order they were added, then chunks
+		auto const nContexts = std::exchange(m_nContextsUsed, 0);
+		try
+		{
+			for (size_t i = 0; i < nContexts; ++i)
+			{
+				auto& context = *m_cContexts[i];
+				m_model.Apply(context.m_commands);
+				context.m_emitted.AppendTo(m_events);
+			}
+		}
+		catch (...)
+		{
+			for (size_t i = 0; i < nContexts; ++i)
+			{
+				m_cContexts[i]->m_commands.Clear();
+				m_cContexts[i]->m_emitted.Clear();
+			}
+			throw;
+		}
+	}
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Archetype.h"
+#include "CommandBuffer.h"
+#include "Component.h"
+#include "Events.h"
+
+namespace HE
+{
+	class Histogram;
+	class JobSystem;
+	class MetricsRegistry;
+	class Model;
+
+	// What a system sees while it runs
+	// Each parallel task of a system has its own context, so a system can use it without synchronization
+	class SystemContext
+	{
+	public:
+		explicit SystemContext(Model& model) noexcept : m_model(model), m_commands(model) { }
+
+		double GetDt() const noexcept { return m_fDt; }
+
+		// To look up other entities. Only read the components in the read or write set of the system:
+		// the other ones can be written concurrently by other systems
+		const Model& GetModel() const noexcept { return m_model; }
+
+		// Structural changes, applied at the next sync point
+		CommandBuffer& GetCommands() noexcept { return m_commands; }
+
+		// Published at the next sync point
+		template<class T>
+		void Emit(T&& event)
+		{
+			m_emitted.Emit(std::forward<T>(event));
+		}
+
+		// The events published by the sync points before this system, during this update
+		template<class T>
+		const std::vector<T>& GetEvents() const noexcept
+		{
+			return m_pPublished->Get<T>();
+		}
+
+	private:
+		friend class SystemScheduler;
+
+		Model& m_model;
+		double m_fDt{ 0.0 };
+		const EventStore* m_pPublished{ nullptr };
+		CommandBuffer m_commands;
+		EventStore m_emitted;
+		std::exception_ptr m_pException;
+	};
+
+	enum class ExecutionMode
+	{
+		// Independent systems run concurrently, and each system is split in tasks over its chunks
+		Parallel,
+		// Everything runs on the calling thread, one system after the other, each in a single task
+		Sequential,
+	};
+
+	// Runs the systems of a Model
+	//
+	// Systems declare the components they read and write. Systems that write a component another one reads or
+	// writes conflict, and run in the order they were added. Independent systems run concurrently. Each system
+	// runs in parallel tasks over contiguous ranges of its chunks, and must only write to the components of the
+	// entities it is given.
+	//
+	// Structural changes and events are buffered per task, and merged at sync points wave by wave, then in the
+	// order the systems of the wave were added, then in chunk order: a system added later can merge before one
+	// added earlier, if it runs in an earlier wave. The waves only depend on the systems and their components, and
+	// the order depends neither on how the chunks were split nor on which thread ran what: the Parallel mode gives
+	// the same results as the Sequential mode, bit for bit
+	class SystemScheduler
+	{
+	public:
+		explicit SystemScheduler(Model& model) noexcept : m_model(model) { }
+		SystemScheduler(const SystemScheduler&) = delete;
+		void operator=(const SystemScheduler&) = delete;
+		~SystemScheduler();
+
+		// Form: AddSystem<Ts...>(sName, f(SystemContext&, const ChunkView<Ts...>&))
+		// Runs f on every chunk with all of Ts, concurrently. Ts marked const are read, the others are written
+		template<class... Ts, class F>
+		void AddSystem(std::string sName, F f)
+		{
+			System system;
+			system.sName = std::move(sName);
+			system.nQueryMask = MakeComponentMask<Ts...>();
+			system.nWrites = MakeWriteMask<Ts...>();
+			system.nReads = system.nQueryMask & ~system.nWrites;
+			system.runChunk = [f](SystemContext& context, const Archetype& archetype, const Chunk& chunk) {
+				f(context, MakeChunkView<Ts...>(archetype, chunk));
+			};
+			Add(std::move(system));
+		}
+
+		// Form: AddTask(sName, nReads, nWrites, f(SystemContext&))
+		// Runs f once per update, ex: to react to events. Declare the components f accesses through the Model
+		void AddTask(std::string sName, ComponentMask nReads, ComponentMask nWrites, std::function<void(SystemContext&)> f);
+
+		// The systems added after this see the structural changes and events of the ones added before
+		// There is always a sync point at the end of an update
+		void AddSyncPoint();
+
+		size_t GetSystemCount() const noexcept { return m_cSystems.size(); }
+
+		ExecutionMode GetExecutionMode() const noexcept { return m_eMode; }
+		void SetExecutionMode(ExecutionMode eMode) noexcept { m_eMode = eMode; }
+
+		// Records the time each system takes per Run in the histogram "System.<name>" of the registry, summed over
+		// its tasks, when it has chunks to run on. nullptr stops recording. The registry must outlive the scheduler
+		void SetMetrics(MetricsRegistry* pMetrics);
+
+		// Runs all the systems, then applies their changes
+		// If a system throws, the changes of the current stage are dropped and the exception is rethrown
+		void Run(double dt, JobSystem& jobSystem);
+
+		// The events published during the last Run
+		template<class T>
+		const std::vector<T>& GetEvents() const noexcept
+		{
+			return m_events.Get<T>();
+		}
+
+	private:
+		struct System
+		{
+			std::string sName;
+			const char* psProfileName{ nullptr };
+			Histogram* pTimeHistogram{ nullptr };
+			ComponentMask nQueryMask{ 0 };
+			ComponentMask nReads{ 0 };
+			ComponentMask nWrites{ 0 };
+			// One of them is set
+			std::function<void(SystemContext&, const Archetype&, const Chunk&)> runChunk;
+			std::function<void(SystemContext&)> runTask;
+
+			std::vector<Archetype*> cArchetypes;
+			size_t nArchetypesMatched{ 0 };
+
+			// Systems of the same stage and wave run concurrently
+			size_t nStage{ 0 };
+			size_t nWave{ 0 };
+		};
+
+		struct ChunkRef
+		{
+			Archetype* pArchetype;
+			size_t nChunk;
+		};
+
+		struct Task
+		{
+			System* pSystem;
+			// Range of m_cChunks
+			size_t nFirstChunk;
+			size_t nEndChunk;
+			SystemContext* pContext;
+			// Measured when recording metrics
+			std::chrono::steady_clock::duration tTime;
+		};
+
+		static bool Conflict(const System& a, const System& b) noexcept
+		{
+			return (a.nWrites & (b.nReads | b.nWrites)) != 0 || (b.nWrites & (a.nReads | a.nWrites)) != 0;
+		}
+
+		void Add(System system);
+		void RunWave(size_t nStage, size_t nWave, JobSystem& jobSystem);
+		void RunTask(Task& task) noexcept;
+		// Stamps the chunks written by the tasks of the wave
+		void MarkChanged() noexcept;
+		void RecordTimes();
+		SystemContext& GetContext();
+		void Sync();
+
+		Model& m_model;
+		ExecutionMode m_eMode{ ExecutionMode::Parallel };
+		MetricsRegistry* m_pMetrics{ nullptr };
+
+		std::vector<System> m_cSystems;
+		size_t m_nStageCount{ 1 };
+		// The next system starts a new stage
+		bool m_bSyncPending{ false };
+
+		// Reused from one update to the next
+		std::vector<ChunkRef> m_cChunks;
+		std::vector<Task> m_cTasks;
+		std::vector<std::unique_ptr<SystemContext>> m_cContexts;
+		// Contexts in use in the current stage, in merge order
+		size_t m_nContextsUsed{ 0 };
+
+		EventStore m_events;
+		double m_fDt{ 0.0 };
+	};
+}
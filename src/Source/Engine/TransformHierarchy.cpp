@@ -0,0 +1,527 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "HE_Assert.h"
+#include "HE_JobSystem.h"
+#include "HE_Profiler.h"
+
+namespace HE
+{
+	namespace
+	{
+		// Grows by doubling, so that reserving before each push_back stays amortized constant
+		template<class T>
+		void ReserveMore(std::vector<T>& cValues, size_t nCount)
+		{
+			if (cValues.capacity() - cValues.size() < nCount)
+			{
+				cValues.reserve(std::max<size_t>({ 16, cValues.capacity() * 2, cValues.size() + nCount }));
+			}
+		}
+
+		// Free positions a depth before the last grows by at least, as a fraction of its size, so that growing them,
+		// which moves the depths after, stays rare
+		constexpr size_t MinGrowth = 16;
+		constexpr size_t GrowthDivisor = 8;
+
+		// Free positions above which Update compacts the arrays, as a fraction of the nodes, and at least, so that
+		// small hierarchies rarely compact
+		constexpr size_t CompactionDivisor = 4;
+		constexpr size_t MinCompactedCount = 256;
+	}
+
+	constexpr size_t TransformHierarchy::ParallelGrain;
+	constexpr std::uint32_t TransformHierarchy::NoPosition;
+
+	void TransformHierarchy::Add(EntityHandle entity, const Math::Mat4& local, EntityHandle parent)
+	{
+		EXPECTS(entity.IsValid() && !Contains(entity));
+
+		std::uint32_t nDepth = 0;
+		if (parent.IsValid())
+		{
+			auto const nParent = GetPosition(parent);
+			EXPECTS(nParent != NoPosition);
+			nDepth = m_cDepths[nParent] + 1;
+		}
+
+		// Everything that can throw comes first
+		if (entity.GetIndex() >= m_cSlots.size())
+		{
+			m_cSlots.resize(entity.GetIndex() + 1);
+		}
+		ReservePositions(nDepth, 1);
+
+		// Growing a depth may have moved the parent
+		auto const nParent = parent.IsValid() ? GetPosition(parent) : NoPosition;
+		auto const nPosition = TakePosition(nDepth);
+		m_cLocal[nPosition] = local;
+		m_cWorld[nPosition] = local;
+		m_cParents[nPosition] = nParent;
+		m_cEntities[nPosition] = entity;
+		m_cDirty[nPosition] = 1;
+		m_cSlots[entity.GetIndex()] = Slot{ entity, nPosition };
+		Link(entity.GetIndex(), parent.IsValid() ? parent.GetIndex() : NoPosition);
+		++m_nNodeCount;
+	}
+
+	void TransformHierarchy::Remove(EntityHandle entity)
+	{
+		EXPECTS(Contains(entity));
+
+		// Everything that can throw comes first
+		CollectSubtree(entity.GetIndex());
+		ReserveVacated();
+
+		Unlink(entity.GetIndex());
+		for (auto const nIndex : m_cSubtree)
+		{
+			auto& slot = m_cSlots[nIndex];
+			Vacate(slot.nPosition);
+			slot = Slot{};
+		}
+		m_nNodeCount -= m_cSubtree.size();
+	}
+
+	void TransformHierarchy::SetParent(EntityHandle entity, EntityHandle parent)
+	{
+		auto const nPosition = GetPosition(entity);
+		EXPECTS(nPosition != NoPosition);
+
+		std::uint32_t nDepth = 0;
+		if (parent.IsValid())
+		{
+			auto const nParent = GetPosition(parent);
+			EXPECTS(nParent != NoPosition && !IsAncestor(nPosition, nParent));
+			nDepth = m_cDepths[nParent] + 1;
+		}
+
+		auto const nOldDepth = m_cDepths[nPosition];
+		if (nDepth != nOldDepth)
+		{
+			// Everything that can throw comes first. The subtree is in breadth-first order: one run of nodes per depth
+			CollectSubtree(entity.GetIndex());
+			for (size_t i = 0; i < m_cSubtree.size();)
+			{
+				auto const nSubtreeDepth = m_cDepths[m_cSlots[m_cSubtree[i]].nPosition];
+				auto j = i + 1;
+				while (j < m_cSubtree.size() && m_cDepths[m_cSlots[m_cSubtree[j]].nPosition] == nSubtreeDepth) ++j;
+				ReservePositions(nSubtreeDepth - nOldDepth + nDepth, j - i);
+				i = j;
+			}
+			ReserveVacated();
+		}
+
+		Unlink(entity.GetIndex());
+		Link(entity.GetIndex(), parent.IsValid() ? parent.GetIndex() : NoPosition);
+
+		if (nDepth == nOldDepth)
+		{
+			// The node and its descendants keep their place
+			m_cParents[nPosition] = parent.IsValid() ? GetPosition(parent) : NoPosition;
+			m_cDirty[nPosition] = 1;
+			return;
+		}
+
+		// Growing the depths may have moved the nodes: the parents first, so that each node finds the new position of
+		// its parent
+		for (auto const nIndex : m_cSubtree)
+		{
+			auto& slot = m_cSlots[nIndex];
+			auto const nOld = slot.nPosition;
+			auto const nNew = TakePosition(m_cDepths[nOld] - nOldDepth + nDepth);
+			m_cLocal[nNew] = m_cLocal[nOld];
+			m_cWorld[nNew] = m_cWorld[nOld];
+			m_cParents[nNew] = slot.nParent != NoPosition ? m_cSlots[slot.nParent].nPosition : NoPosition;
+			m_cEntities[nNew] = m_cEntities[nOld];
+			m_cDirty[nNew] = 1;
+			slot.nPosition = nNew;
+			Vacate(nOld);
+		}
+	}
+
+	bool TransformHierarchy::Contains(EntityHandle entity) const noexcept
+	{
+		return GetPosition(entity) != NoPosition;
+	}
+
+	EntityHandle TransformHierarchy::GetParent(EntityHandle entity) const noexcept
+	{
+		auto const nPosition = GetPosition(entity);
+		EXPECTS(nPosition != NoPosition);
+
+		auto const nParent = m_cParents[nPosition];
+		return nParent != NoPosition ? m_cEntities[nParent] : EntityHandle{};
+	}
+
+	const Math::Mat4& TransformHierarchy::GetLocal(EntityHandle entity) const noexcept
+	{
+		auto const nPosition = GetPosition(entity);
+		EXPECTS(nPosition != NoPosition);
+		return m_cLocal[nPosition];
+	}
+
+	void TransformHierarchy::SetLocal(EntityHandle entity, const Math::Mat4& local) noexcept
+	{
+		auto const nPosition = GetPosition(entity);
+		EXPECTS(nPosition != NoPosition);
+		m_cLocal[nPosition] = local;
+		m_cDirty[nPosition] = 1;
+	}
+
+	const Math::Mat4& TransformHierarchy::GetWorld(EntityHandle entity) const noexcept
+	{
+		auto const nPosition = GetPosition(entity);
+		EXPECTS(nPosition != NoPosition);
+		return m_cWorld[nPosition];
+	}
+
+	void TransformHierarchy::Update()
+	{
+		HE_PROFILE_SCOPE("TransformHierarchy::Update");
+		if (NeedsCompaction())
+		{
+			Reorder();
+		}
+
+		size_t nBegin = 0;
+		for (auto const nEnd : m_cDepthEnds)
+		{
+			UpdateRange(nBegin, nEnd);
+			nBegin = nEnd;
+		}
+		std::fill(m_cDirty.begin(), m_cDirty.end(), std::uint8_t{ 0 });
+	}
+
+	void TransformHierarchy::Update(JobSystem& jobSystem)
+	{
+		HE_PROFILE_SCOPE("TransformHierarchy::Update");
+		if (NeedsCompaction())
+		{
+			Reorder();
+		}
+
+		size_t nBegin = 0;
+		for (auto const nEnd : m_cDepthEnds)
+		{
+			if (nEnd - nBegin > ParallelGrain)
+			{
+				jobSystem.ParallelForRange(nBegin, nEnd, [this](size_t nRangeBegin, size_t nRangeEnd) {
+					UpdateRange(nRangeBegin, nRangeEnd);
+				}, ParallelGrain);
+			}
+			else
+			{
+				UpdateRange(nBegin, nEnd);
+			}
+			nBegin = nEnd;
+		}
+		std::fill(m_cDirty.begin(), m_cDirty.end(), std::uint8_t{ 0 });
+	}
+
+	std::uint32_t TransformHierarchy::GetPosition(EntityHandle entity) const noexcept
+	{
+		if (entity.GetIndex() >= m_cSlots.size()) return NoPosition;
+
+		auto const& slot = m_cSlots[entity.GetIndex()];
+		return slot.entity == entity ? slot.nPosition : NoPosition;
+	}
+
+	bool TransformHierarchy::IsAncestor(std::uint32_t nAncestor, std::uint32_t nPosition) const noexcept
+	{
+		for (; nPosition != NoPosition; nPosition = m_cParents[nPosition])
+		{
+			if (nPosition == nAncestor) return true;
+		}
+		return false;
+	}
+
+	void TransformHierarchy::Link(std::uint32_t nIndex, std::uint32_t nParentIndex) noexcept
+	{
+		auto& slot = m_cSlots[nIndex];
+		slot.nParent = nParentIndex;
+		slot.nPreviousSibling = NoPosition;
+		slot.nNextSibling = NoPosition;
+		if (nParentIndex == NoPosition) return;
+
+		auto& parent = m_cSlots[nParentIndex];
+		slot.nNextSibling = parent.nFirstChild;
+		if (parent.nFirstChild != NoPosition)
+		{
+			m_cSlots[parent.nFirstChild].nPreviousSibling = nIndex;
+		}
+		parent.nFirstChild = nIndex;
+	}
+
+	void TransformHierarchy::Unlink(std::uint32_t nIndex) noexcept
+	{
+		auto const& slot = m_cSlots[nIndex];
+		if (slot.nPreviousSibling != NoPosition)
+		{
+			m_cSlots[slot.nPreviousSibling].nNextSibling = slot.nNextSibling;
+		}
+		else if (slot.nParent != NoPosition)
+		{
+			m_cSlots[slot.nParent].nFirstChild = slot.nNextSibling;
+		}
+		if (slot.nNextSibling != NoPosition)
+		{
+			m_cSlots[slot.nNextSibling].nPreviousSibling = slot.nPreviousSibling;
+		}
+	}
+
+	void TransformHierarchy::CollectSubtree(std::uint32_t nIndex)
+	{
+		m_cSubtree.clear();
+		m_cSubtree.push_back(nIndex);
+		for (size_t i = 0; i < m_cSubtree.size(); ++i)
+		{
+			for (auto nChild = m_cSlots[m_cSubtree[i]].nFirstChild; nChild != NoPosition; nChild = m_cSlots[nChild].nNextSibling)
+			{
+				m_cSubtree.push_back(nChild);
+			}
+		}
+	}
+
+	// Makes sure the depth has nCount free positions, adding the depths before it if needed
+	void TransformHierarchy::ReservePositions(std::uint32_t nDepth, size_t nCount)
+	{
+		if (nDepth >= m_cDepthEnds.size())
+		{
+			m_cDepthEnds.reserve(nDepth + 1);
+			m_cFreePositions.reserve(nDepth + 1);
+			// Empty, at the end of the arrays
+			m_cDepthEnds.resize(nDepth + 1, static_cast<std::uint32_t>(m_cEntities.size()));
+			m_cFreePositions.resize(nDepth + 1);
+		}
+
+		auto const nFree = m_cFreePositions[nDepth].size();
+		if (nFree >= nCount) return;
+
+		// The last depth grows at the end of the arrays, without moving any node
+		auto nGrowth = nCount - nFree;
+		if (nDepth + 1 < m_cDepthEnds.size())
+		{
+			auto const nDepthSize = m_cDepthEnds[nDepth] - (nDepth > 0 ? m_cDepthEnds[nDepth - 1] : 0);
+			nGrowth = std::max({ nGrowth, MinGrowth, nDepthSize / GrowthDivisor });
+		}
+		Grow(nDepth, nGrowth);
+	}
+
+	// Makes room in the free positions for the ones the nodes of the subtree leave
+	void TransformHierarchy::ReserveVacated()
+	{
+		// The subtree is in breadth-first order: one run of nodes per depth
+		size_t nRunBegin = 0;
+		for (size_t i = 1; i <= m_cSubtree.size(); ++i)
+		{
+			auto const nDepth = m_cDepths[m_cSlots[m_cSubtree[nRunBegin]].nPosition];
+			if (i == m_cSubtree.size() || m_cDepths[m_cSlots[m_cSubtree[i]].nPosition] != nDepth)
+			{
+				ReserveMore(m_cFreePositions[nDepth], i - nRunBegin);
+				nRunBegin = i;
+			}
+		}
+	}
+
+	// Adds nCount free positions at the end of the depth
+	void TransformHierarchy::Grow(std::uint32_t nDepth, size_t nCount)
+	{
+		auto& cFree = m_cFreePositions[nDepth];
+
+		// Everything that can throw comes first. Inserting then copies without allocating
+		ReserveMore(m_cLocal, nCount);
+		ReserveMore(m_cWorld, nCount);
+		ReserveMore(m_cParents, nCount);
+		ReserveMore(m_cDepths, nCount);
+		ReserveMore(m_cEntities, nCount);
+		ReserveMore(m_cDirty, nCount);
+		ReserveMore(cFree, nCount);
+
+		auto const nEnd = m_cDepthEnds[nDepth];
+		m_cLocal.insert(m_cLocal.begin() + nEnd, nCount, Math::Mat4{});
+		m_cWorld.insert(m_cWorld.begin() + nEnd, nCount, Math::Mat4{});
+		m_cParents.insert(m_cParents.begin() + nEnd, nCount, NoPosition);
+		m_cDepths.insert(m_cDepths.begin() + nEnd, nCount, nDepth);
+		m_cEntities.insert(m_cEntities.begin() + nEnd, nCount, EntityHandle{});
+		m_cDirty.insert(m_cDirty.begin() + nEnd, nCount, std::uint8_t{ 0 });
+
+		// The positions after the new ones moved by nCount
+		auto const nShift = static_cast<std::uint32_t>(nCount);
+		for (auto i = nEnd + nShift; i < m_cEntities.size(); ++i)
+		{
+			if (m_cEntities[i].IsValid())
+			{
+				m_cSlots[m_cEntities[i].GetIndex()].nPosition += nShift;
+			}
+			if (m_cParents[i] != NoPosition && m_cParents[i] >= nEnd)
+			{
+				m_cParents[i] += nShift;
+			}
+		}
+		for (auto d = nDepth + 1; d < m_cFreePositions.size(); ++d)
+		{
+			for (auto& nPosition : m_cFreePositions[d]) nPosition += nShift;
+		}
+		for (auto d = nDepth; d < m_cDepthEnds.size(); ++d)
+		{
+			m_cDepthEnds[d] += nShift;
+		}
+
+		// Taken from the back: the first new position first
+		for (auto nPosition = nEnd + nShift; nPosition > nEnd; --nPosition)
+		{
+			cFree.push_back(nPosition - 1);
+		}
+	}
+
+	// Pre-condition: the depth has a free position
+	std::uint32_t TransformHierarchy::TakePosition(std::uint32_t nDepth) noexcept
+	{
+		auto& cFree = m_cFreePositions[nDepth];
+		auto const nPosition = cFree.back();
+		cFree.pop_back();
+		return nPosition;
+	}
+
+	// Pre-condition: the free positions of the depth have room for it
+	void TransformHierarchy::Vacate(std::uint32_t nPosition) noexcept
+	{
+		m_cParents[nPosition] = NoPosition;
+		m_cEntities[nPosition] = EntityHandle{};
+		m_cDirty[nPosition] = 0;
+		m_cFreePositions[m_cDepths[nPosition]].push_back(nPosition);
+	}
+
+	bool TransformHierarchy::NeedsCompaction() const noexcept
+	{
+		auto const nFree = m_cEntities.size() - m_nNodeCount;
+		return nFree > m_nNodeCount / CompactionDivisor && nFree > MinCompactedCount;
+	}
+
+	// Rebuilds the breadth-first order without the free positions
+	void TransformHierarchy::Reorder()
+	{
+		HE_PROFILE_SCOPE("TransformHierarchy::Reorder");
+		auto const nCount = m_cEntities.size();
+
+		// Children of each node, in the order of their positions
+		std::vector<std::uint32_t> cChildEnds(nCount + 1, 0);
+		std::vector<std::uint32_t> cOrder;
+		cOrder.reserve(m_nNodeCount);
+		for (std::uint32_t i = 0; i < nCount; ++i)
+		{
+			if (!m_cEntities[i].IsValid()) continue;
+
+			if (m_cParents[i] == NoPosition)
+			{
+				cOrder.push_back(i);
+			}
+			else
+			{
+				++cChildEnds[m_cParents[i] + 1];
+			}
+		}
+		for (size_t i = 1; i <= nCount; ++i)
+		{
+			cChildEnds[i] += cChildEnds[i - 1];
+		}
+		std::vector<std::uint32_t> cChildren(cChildEnds[nCount]);
+		for (std::uint32_t i = 0; i < nCount; ++i)
+		{
+			if (m_cEntities[i].IsValid() && m_cParents[i] != NoPosition)
+			{
+				cChildren[cChildEnds[m_cParents[i]]++] = i;
+			}
+		}
+		// Each end was moved to the next start
+		for (auto i = nCount; i > 0; --i)
+		{
+			cChildEnds[i] = cChildEnds[i - 1];
+		}
+		cChildEnds[0] = 0;
+
+		// Breadth-first, from the roots
+		std::vector<std::uint32_t> cDepthEnds;
+		for (size_t nBegin = 0; nBegin < cOrder.size();)
+		{
+			auto const nEnd = cOrder.size();
+			cDepthEnds.push_back(static_cast<std::uint32_t>(nEnd));
+			for (auto j = nBegin; j < nEnd; ++j)
+			{
+				auto const nNode = cOrder[j];
+				cOrder.insert(cOrder.end(), cChildren.begin() + cChildEnds[nNode], cChildren.begin() + cChildEnds[nNode + 1]);
+			}
+			nBegin = nEnd;
+		}
+
+		std::vector<std::uint32_t> cNewPositions(nCount, NoPosition);
+		for (size_t i = 0; i < cOrder.size(); ++i)
+		{
+			cNewPositions[cOrder[i]] = static_cast<std::uint32_t>(i);
+		}
+
+		std::vector<Math::Mat4> cLocal(cOrder.size());
+		std::vector<Math::Mat4> cWorld(cOrder.size());
+		std::vector<std::uint32_t> cParents(cOrder.size());
+		std::vector<std::uint32_t> cDepths(cOrder.size());
+		std::vector<EntityHandle> cEntities(cOrder.size());
+		std::vector<std::uint8_t> cDirty(cOrder.size());
+		std::vector<std::vector<std::uint32_t>> cFreePositions(cDepthEnds.size());
+		std::uint32_t nDepth = 0;
+		for (std::uint32_t i = 0; i < cOrder.size(); ++i)
+		{
+			if (i == cDepthEnds[nDepth]) ++nDepth;
+
+			auto const nOld = cOrder[i];
+			auto const nParent = m_cParents[nOld];
+			cLocal[i] = m_cLocal[nOld];
+			cWorld[i] = m_cWorld[nOld];
+			cParents[i] = nParent != NoPosition ? cNewPositions[nParent] : NoPosition;
+			cDepths[i] = nDepth;
+			cEntities[i] = m_cEntities[nOld];
+			cDirty[i] = m_cDirty[nOld];
+		}
+
+		// Nothing throws from here
+		for (std::uint32_t i = 0; i < cEntities.size(); ++i)
+		{
+			m_cSlots[cEntities[i].GetIndex()].nPosition = i;
+		}
+		m_cLocal = std::move(cLocal);
+		m_cWorld = std::move(cWorld);
+		m_cParents = std::move(cParents);
+		m_cDepths = std::move(cDepths);
+		m_cEntities = std::move(cEntities);
+		m_cDirty = std::move(cDirty);
+		m_cDepthEnds = std::move(cDepthEnds);
+		m_cFreePositions = std::move(cFreePositions);
+	}
+
+	void TransformHierarchy::UpdateRange(size_t nBegin, size_t nEnd) noexcept
+	{
+		// The dirty flags are bytes, which may alias the members of the vectors: through them, every store to a flag
+		// would reload the arrays for the next node
+		auto const pLocal = m_cLocal.data();
+		auto const pWorld = m_cWorld.data();
+		auto const pParents = m_cParents.data();
+		auto const pDirty = m_cDirty.data();
+
+		// The parents are in the depth before, already up to date
+		for (auto i = nBegin; i < nEnd; ++i)
+		{
+			auto const nParent = pParents[i];
+			if (nParent == NoPosition)
+			{
+				if (pDirty[i]) pWorld[i] = pLocal[i];
+			}
+			else if (pDirty[i] | pDirty[nParent])
+			{
+				pWorld[i] = pWorld[nParent] * pLocal[i];
+				pDirty[i] = 1;
+			}
+		}
+	}
+}
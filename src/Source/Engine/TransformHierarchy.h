@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Entity.h"
+#include "HE_Math.h"
+
+namespace HE
+{
+	class JobSystem;
+
+	// Parent/child relationships between entities, and their local and world transforms
+	//
+	// Nodes are stored in breadth-first order, as one array per field: the parent of a node is always before it, and
+	// all the nodes of a depth are contiguous. Update computes the world transforms in one pass over the arrays,
+	// recomputing only the nodes whose local transform changed, and their descendants. The nodes of a depth only
+	// read the depth before them, so each depth is split in ranges of independent subtrees on the JobSystem
+	//
+	// The changes keep the order without rebuilding it. A removed node leaves a free position in its depth, for the next
+	// node added to the depth, and a depth without free positions grows with room to spare, moving the depths after it.
+	// Moving a node to another depth moves its subtree the same way, depth by depth. Once the free positions are more
+	// than a quarter of the nodes, Update compacts the arrays
+	//
+	// The hierarchy does not follow the lifetime of the entities: remove them from it when they are destroyed
+	class TransformHierarchy
+	{
+	public:
+		// Depths with fewer nodes are updated on the calling thread
+		static constexpr size_t ParallelGrain = 4096;
+
+		// The entity must not be in the hierarchy already. With an invalid parent, the entity is a root
+		// Its world transform is its local one until the next Update
+		void Add(EntityHandle entity, const Math::Mat4& local, EntityHandle parent = {});
+		// Removes the entity and all its descendants
+		void Remove(EntityHandle entity);
+		// The parent must not be the entity or one of its descendants. With an invalid parent, the entity is a root
+		void SetParent(EntityHandle entity, EntityHandle parent);
+
+		bool Contains(EntityHandle entity) const noexcept;
+		// Invalid handle for roots
+		EntityHandle GetParent(EntityHandle entity) const noexcept;
+		size_t GetNodeCount() const noexcept { return m_nNodeCount; }
+
+		const Math::Mat4& GetLocal(EntityHandle entity) const noexcept;
+		void SetLocal(EntityHandle entity, const Math::Mat4& local) noexcept;
+		// As of the last Update
+		const Math::Mat4& GetWorld(EntityHandle entity) const noexcept;
+
+		void Update();
+		void Update(JobSystem& jobSystem);
+
+	private:
+		// Parent of the roots, position of the entities not in the hierarchy, and end of the lists of children
+		static constexpr std::uint32_t NoPosition = ~std::uint32_t{ 0 };
+
+		std::uint32_t GetPosition(EntityHandle entity) const noexcept;
+		bool IsAncestor(std::uint32_t nAncestor, std::uint32_t nPosition) const noexcept;
+		void Link(std::uint32_t nIndex, std::uint32_t nParentIndex) noexcept;
+		void Unlink(std::uint32_t nIndex) noexcept;
+		void CollectSubtree(std::uint32_t nIndex);
+		void ReservePositions(std::uint32_t nDepth, size_t nCount);
+		void ReserveVacated();
+		void Grow(std::uint32_t nDepth, size_t nCount);
+		std::uint32_t TakePosition(std::uint32_t nDepth) noexcept;
+		void Vacate(std::uint32_t nPosition) noexcept;
+		bool NeedsCompaction() const noexcept;
+		void Reorder();
+		void UpdateRange(size_t nBegin, size_t nEnd) noexcept;
+
+		// Position of each entity in the arrays, and its children, by index of the entity
+		struct Slot
+		{
+			EntityHandle entity;
+			std::uint32_t nPosition{ NoPosition };
+			// Entity indices
+			std::uint32_t nParent{ NoPosition };
+			std::uint32_t nFirstChild{ NoPosition };
+			std::uint32_t nNextSibling{ NoPosition };
+			std::uint32_t nPreviousSibling{ NoPosition };
+		};
+		std::vector<Slot> m_cSlots;
+
+		// By position. Free positions have an invalid entity, no parent, and are not dirty
+		std::vector<Math::Mat4> m_cLocal;
+		std::vector<Math::Mat4> m_cWorld;
+		std::vector<std::uint32_t> m_cParents;
+		std::vector<std::uint32_t> m_cDepths;
+		std::vector<EntityHandle> m_cEntities;
+		// The world transform needs to be recomputed, and so do the ones of the descendants
+		std::vector<std::uint8_t> m_cDirty;
+		// End position of each depth
+		std::vector<std::uint32_t> m_cDepthEnds;
+		// Free positions of each depth
+		std::vector<std::vector<std::uint32_t>> m_cFreePositions;
+		size_t m_nNodeCount{ 0 };
+
+		// Entity indices of the subtree being removed or moved, in breadth-first order
+		std::vector<std::uint32_t> m_cSubtree;
+	};
+}
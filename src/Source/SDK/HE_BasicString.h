@@ -0,0 +1,405 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <utility>
+
+#include "HE_Allocator.h"
+#include "HE_Assert.h"
+#include "HE_String.h"
+
+namespace HE
+{
+	// String with a small buffer of InlineN characters stored in the object itself
+	// Strings up to InlineN characters (excluding the null terminator) never allocate. Longer strings
+	// fall back to Allocator, which can be any stateless HE allocator
+	// The storage is a FallbackAllocator<LightInlineAllocator, Allocator>, so the inline buffer and the
+	// heap are told apart the same way as for any other fallback allocation
+	//
+	// Unlike std::basic_string, moving a string that fits in the inline buffer copies its characters
+	template<class Char, class Allocator = MallocAllocator, size_t InlineN = 32>
+	class BasicString
+	{
+		static_assert(IsStatelessAllocator<Allocator>(), "BasicString requires a stateless HE::Allocator");
+		static_assert(std::is_trivial<Char>::value, "BasicString only supports trivial character types");
+
+		using Traits = std::char_traits<Char>;
+		static constexpr size_t InlineBytes = (InlineN + 1) * sizeof(Char);
+		using StorageAllocator = FallbackAllocator<LightInlineAllocator<InlineBytes>, Allocator>;
+
+	public:
+		using value_type = Char;
+		using size_type = size_t;
+		using iterator = Char*;
+		using const_iterator = const Char*;
+
+		static constexpr size_t npos = static_cast<size_t>(-1);
+		static constexpr size_t inline_capacity = InlineN;
+
+		BasicString() noexcept
+		{
+			SetInline();
+		}
+
+		BasicString(const Char* ps)
+			: BasicString(ps, Traits::length(ps))
+		{
+
+		}
+
+		BasicString(const Char* p, size_t n)
+		{
+			SetInline();
+			append(p, n);
+		}
+
+		BasicString(size_t n, Char c)
+		{
+			SetInline();
+			resize(n, c);
+		}
+
+		template<class Traits2, class Allocator2>
+		explicit BasicString(const std::basic_string<Char, Traits2, Allocator2>& s)
+			: BasicString(s.data(), s.size())
+		{
+
+		}
+
+		BasicString(const BasicString& other)
+			: BasicString(other.data(), other.size())
+		{
+
+		}
+
+		template<class Allocator2, size_t InlineN2>
+		BasicString(const BasicString<Char, Allocator2, InlineN2>& other)
+			: BasicString(other.data(), other.size())
+		{
+
+		}
+
+		BasicString(BasicString&& other) noexcept
+		{
+			SetInline();
+			Steal(other);
+		}
+
+		~BasicString()
+		{
+			Release();
+		}
+
+		BasicString& operator=(const BasicString& other)
+		{
+			if (this != &other) assign(other.data(), other.size());
+			return *this;
+		}
+
+		template<class Allocator2, size_t InlineN2>
+		BasicString& operator=(const BasicString<Char, Allocator2, InlineN2>& other)
+		{
+			return assign(other.data(), other.size());
+		}
+
+		BasicString& operator=(BasicString&& other) noexcept
+		{
+			if (this != &other)
+			{
+				Release();
+				SetInline();
+				Steal(other);
+			}
+			return *this;
+		}
+
+		BasicString& operator=(const Char* ps)
+		{
+			return assign(ps, Traits::length(ps));
+		}
+
+		BasicString& assign(const Char* p, size_t n)
+		{
+			// p might point inside this string, which reserve would invalidate
+			if (n > m_nCapacity)
+			{
+				BasicString s(p, n);
+				return *this = std::move(s);
+			}
+
+			Traits::move(m_pData, p, n);
+			SetSize(n);
+			return *this;
+		}
+
+		size_t size() const noexcept { return m_nSize; }
+		size_t length() const noexcept { return m_nSize; }
+		size_t capacity() const noexcept { return m_nCapacity; }
+		bool empty() const noexcept { return m_nSize == 0; }
+
+		// True if the characters are in the inline buffer
+		bool is_inline() const noexcept { return m_nCapacity == InlineN; }
+
+		const Char* data() const noexcept { return m_pData; }
+		Char* data() noexcept { return m_pData; }
+		const Char* c_str() const noexcept { return m_pData; }
+
+		Char& operator[](size_t i) noexcept { EXPECTS(i < m_nSize); return m_pData[i]; }
+		const Char& operator[](size_t i) const noexcept { EXPECTS(i <= m_nSize); return m_pData[i]; }
+
+		Char& front() noexcept { EXPECTS(!empty()); return m_pData[0]; }
+		const Char& front() const noexcept { EXPECTS(!empty()); return m_pData[0]; }
+		Char& back() noexcept { EXPECTS(!empty()); return m_pData[m_nSize - 1]; }
+		const Char& back() const noexcept { EXPECTS(!empty()); return m_pData[m_nSize - 1]; }
+
+		iterator begin() noexcept { return m_pData; }
+		iterator end() noexcept { return m_pData + m_nSize; }
+		const_iterator begin() const noexcept { return m_pData; }
+		const_iterator end() const noexcept { return m_pData + m_nSize; }
+		const_iterator cbegin() const noexcept { return m_pData; }
+		const_iterator cend() const noexcept { return m_pData + m_nSize; }
+
+		// Keeps the capacity
+		void clear() noexcept
+		{
+			SetSize(0);
+		}
+
+		// Throws std::bad_alloc if the allocator fails
+		void reserve(size_t nCapacity)
+		{
+			if (nCapacity <= m_nCapacity) return;
+
+			auto const b = m_allocator.allocate((nCapacity + 1) * sizeof(Char));
+			if (!b.ptr) throw std::bad_alloc{};
+
+			auto const pData = static_cast<Char*>(b.ptr);
+			Traits::copy(pData, m_pData, m_nSize + 1);
+			Release();
+			m_pData = pData;
+			m_nCapacity = nCapacity;
+		}
+
+		void resize(size_t n, Char c = Char{})
+		{
+			if (n > m_nSize)
+			{
+				Grow(n);
+				Traits::assign(m_pData + m_nSize, n - m_nSize, c);
+			}
+			SetSize(n);
+		}
+
+		void push_back(Char c)
+		{
+			Grow(m_nSize + 1);
+			m_pData[m_nSize] = c;
+			SetSize(m_nSize + 1);
+		}
+
+		void pop_back() noexcept
+		{
+			EXPECTS(!empty());
+			SetSize(m_nSize - 1);
+		}
+
+		BasicString& append(const Char* p, size_t n)
+		{
+			if (n == 0) return *this;
+
+			if (m_nSize + n > m_nCapacity)
+			{
+				// p might point inside this string, which Grow would invalidate
+				if (p >= m_pData && p < m_pData + m_nSize)
+				{
+					auto const nOffset = static_cast<size_t>(p - m_pData);
+					Grow(m_nSize + n);
+					p = m_pData + nOffset;
+				}
+				else
+				{
+					Grow(m_nSize + n);
+				}
+			}
+
+			Traits::copy(m_pData + m_nSize, p, n);
+			SetSize(m_nSize + n);
+			return *this;
+		}
+
+		BasicString& append(const Char* ps)
+		{
+			return append(ps, Traits::length(ps));
+		}
+
+		BasicString& append(size_t n, Char c)
+		{
+			resize(m_nSize + n, c);
+			return *this;
+		}
+
+		template<class Allocator2, size_t InlineN2>
+		BasicString& append(const BasicString<Char, Allocator2, InlineN2>& s)
+		{
+			return append(s.data(), s.size());
+		}
+
+		template<class Traits2, class Allocator2>
+		BasicString& append(const std::basic_string<Char, Traits2, Allocator2>& s)
+		{
+			return append(s.data(), s.size());
+		}
+
+		BasicString& operator+=(Char c) { push_back(c); return *this; }
+		BasicString& operator+=(const Char* ps) { return append(ps); }
+		template<class S>
+		auto operator+=(const S& s) -> decltype(append(s)) { return append(s); }
+
+		size_t find(Char c, size_t nPos = 0) const noexcept
+		{
+			if (nPos >= m_nSize) return npos;
+			auto const p = Traits::find(m_pData + nPos, m_nSize - nPos, c);
+			return p ? static_cast<size_t>(p - m_pData) : npos;
+		}
+
+		BasicString substr(size_t nPos, size_t n = npos) const
+		{
+			EXPECTS(nPos <= m_nSize);
+			return BasicString(m_pData + nPos, std::min(n, m_nSize - nPos));
+		}
+
+		int compare(const Char* p, size_t n) const noexcept
+		{
+			auto const nResult = Traits::compare(m_pData, p, std::min(m_nSize, n));
+			if (nResult != 0) return nResult;
+			return m_nSize < n ? -1 : (m_nSize > n ? 1 : 0);
+		}
+
+		std::basic_string<Char> str() const
+		{
+			return{ m_pData, m_nSize };
+		}
+
+	private:
+		template<class, class, size_t>
+		friend class BasicString;
+
+		void SetInline() noexcept
+		{
+			// Always succeeds, LightInlineAllocator returns its buffer for any size that fits
+			m_pData = static_cast<Char*>(m_allocator.allocate(InlineBytes).ptr);
+			m_nCapacity = InlineN;
+			SetSize(0);
+		}
+
+		void SetSize(size_t n) noexcept
+		{
+			m_nSize = n;
+			m_pData[n] = Char{};
+		}
+
+		void Grow(size_t nCapacity)
+		{
+			if (nCapacity > m_nCapacity) reserve(std::max(nCapacity, m_nCapacity * 2));
+		}
+
+		void Release() noexcept
+		{
+			m_allocator.deallocate({ m_pData, (m_nCapacity + 1) * sizeof(Char) });
+		}
+
+		// Pre-condition: this string is empty and inline
+		void Steal(BasicString& other) noexcept
+		{
+			if (other.is_inline())
+			{
+				Traits::copy(m_pData, other.m_pData, other.m_nSize);
+				SetSize(other.m_nSize);
+			}
+			else
+			{
+				// The allocator is stateless, so any instance can free the other's block
+				m_pData = other.m_pData;
+				m_nSize = other.m_nSize;
+				m_nCapacity = other.m_nCapacity;
+				other.SetInline();
+			}
+			other.SetSize(0);
+		}
+
+		StorageAllocator m_allocator;
+		Char* m_pData;
+		size_t m_nSize;
+		size_t m_nCapacity;
+	};
+
+	template<class Char, class Allocator, size_t InlineN>
+	constexpr size_t BasicString<Char, Allocator, InlineN>::npos;
+	template<class Char, class Allocator, size_t InlineN>
+	constexpr size_t BasicString<Char, Allocator, InlineN>::inline_capacity;
+
+	using String = BasicString<char>;
+	using WString = BasicString<wchar_t>;
+
+	template<class Char, class A1, size_t N1, class A2, size_t N2>
+	bool operator==(const BasicString<Char, A1, N1>& a, const BasicString<Char, A2, N2>& b) noexcept { return a.compare(b.data(), b.size()) == 0; }
+	template<class Char, class A1, size_t N1, class A2, size_t N2>
+	bool operator!=(const BasicString<Char, A1, N1>& a, const BasicString<Char, A2, N2>& b) noexcept { return a.compare(b.data(), b.size()) != 0; }
+	template<class Char, class A1, size_t N1, class A2, size_t N2>
+	bool operator<(const BasicString<Char, A1, N1>& a, const BasicString<Char, A2, N2>& b) noexcept { return a.compare(b.data(), b.size()) < 0; }
+
+	template<class Char, class A, size_t N>
+	bool operator==(const BasicString<Char, A, N>& a, const Char* b) noexcept { return a.compare(b, std::char_traits<Char>::length(b)) == 0; }
+	template<class Char, class A, size_t N>
+	bool operator==(const Char* a, const BasicString<Char, A, N>& b) noexcept { return b == a; }
+	template<class Char, class A, size_t N>
+	bool operator!=(const BasicString<Char, A, N>& a, const Char* b) noexcept { return !(a == b); }
+	template<class Char, class A, size_t N>
+	bool operator!=(const Char* a, const BasicString<Char, A, N>& b) noexcept { return !(b == a); }
+
+	template<class Char, class A, size_t N, class Traits, class A2>
+	bool operator==(const BasicString<Char, A, N>& a, const std::basic_string<Char, Traits, A2>& b) noexcept { return a.compare(b.data(), b.size()) == 0; }
+	template<class Char, class A, size_t N, class Traits, class A2>
+	bool operator==(const std::basic_string<Char, Traits, A2>& a, const BasicString<Char, A, N>& b) noexcept { return b == a; }
+	template<class Char, class A, size_t N, class Traits, class A2>
+	bool operator!=(const BasicString<Char, A, N>& a, const std::basic_string<Char, Traits, A2>& b) noexcept { return !(a == b); }
+	template<class Char, class A, size_t N, class Traits, class A2>
+	bool operator!=(const std::basic_string<Char, Traits, A2>& a, const BasicString<Char, A, N>& b) noexcept { return !(b == a); }
+
+	template<class Char, class A, size_t N, class S>
+	BasicString<Char, A, N> operator+(BasicString<Char, A, N> a, const S& b)
+	{
+		a += b;
+		return a;
+	}
+
+	// Makes BasicString usable as a Format argument
+	template<class A, size_t N>
+	std::string to_string(const BasicString<char, A, N>& s)
+	{
+		return s.str();
+	}
+}
+
+namespace std
+{
+	template<class Char, class A, size_t N>
+	struct hash<HE::BasicString<Char, A, N>>
+	{
+		size_t operator()(const HE::BasicString<Char, A, N>& s) const noexcept
+		{
+			// FNV-1a, over the bytes of the characters
+			size_t nHash = sizeof(size_t) == 8 ? static_cast<size_t>(14695981039346656037ull) : 2166136261u;
+			size_t const nPrime = sizeof(size_t) == 8 ? static_cast<size_t>(1099511628211ull) : 16777619u;
+			auto const p = reinterpret_cast<const unsigned char*>(s.data());
+			for (size_t i = 0; i < s.size() * sizeof(Char); ++i)
+			{
+				nHash = (nHash ^ p[i]) * nPrime;
+			}
+			return nHash;
+		}
+	};
+}
@@ -0,0 +1,146 @@
+#include "HE_Binary.h"
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+namespace HE
+{
+	namespace
+	{
+		// Bytes read at once for strings and byte arrays
+		constexpr size_t ReadPieceSize = 1 << 20;
+
+		// Form: DecodeVarint(next, n) -> false if the integer is truncated or longer than 64 bits
+		// next() returns the next byte, or a negative value at the end
+		template<class NextByte>
+		bool DecodeVarint(NextByte next, std::uint64_t& n)
+		{
+			n = 0;
+			for (unsigned nShift = 0; nShift < 64; nShift += 7)
+			{
+				int const c = next();
+				if (c < 0) return false;
+				n |= static_cast<std::uint64_t>(c & 0x7F) << nShift;
+				if ((c & 0x80) == 0) return true;
+			}
+			return false;
+		}
+
+		template<class Output>
+		void EncodeVarint(Output put, std::uint64_t n)
+		{
+			while (n >= 0x80)
+			{
+				put(static_cast<unsigned char>((n & 0x7F) | 0x80));
+				n >>= 7;
+			}
+			put(static_cast<unsigned char>(n));
+		}
+
+		[[noreturn]] void ThrowInvalidBinary(const char* psError, const char* psReason)
+		{
+			throw std::runtime_error{ std::string{ psError } + ": " + psReason };
+		}
+	}
+
+	void WriteVarint(std::ostream& stream, std::uint64_t n)
+	{
+		EncodeVarint([&stream](unsigned char c) { stream.put(static_cast<char>(c)); }, n);
+	}
+
+	void WriteVarint(std::vector<unsigned char>& cOutput, std::uint64_t n)
+	{
+		EncodeVarint([&cOutput](unsigned char c) { cOutput.push_back(c); }, n);
+	}
+
+	void WriteString(std::ostream& stream, const std::string& s)
+	{
+		WriteBytes(stream, s.data(), s.size());
+	}
+
+	void WriteBytes(std::ostream& stream, const void* pData, size_t nSize)
+	{
+		WriteVarint(stream, nSize);
+		stream.write(static_cast<const char*>(pData), static_cast<std::streamsize>(nSize));
+	}
+
+	BinaryStreamReader::BinaryStreamReader(std::istream& stream, const char* psError) noexcept
+		: m_stream(stream),
+		m_psError(psError)
+	{
+
+	}
+
+	std::uint64_t BinaryStreamReader::ReadVarint()
+	{
+		std::uint64_t n;
+		auto const next = [this] {
+			auto const c = m_stream.get();
+			return c == std::char_traits<char>::eof() ? -1 : static_cast<int>(static_cast<unsigned char>(c));
+		};
+		if (!DecodeVarint(next, n))
+		{
+			ThrowInvalid(m_stream.eof() ? "truncated" : "invalid integer");
+		}
+		return n;
+	}
+
+	std::string BinaryStreamReader::ReadString()
+	{
+		auto const nSize = ReadVarint();
+		std::string s;
+		// Grows as it reads, so that a corrupted size fails on the end of the stream rather than on allocating it
+		while (s.size() < nSize)
+		{
+			auto const nRead = s.size();
+			s.resize(nRead + static_cast<size_t>(std::min<std::uint64_t>(nSize - nRead, ReadPieceSize)));
+			if (!m_stream.read(&s[nRead], static_cast<std::streamsize>(s.size() - nRead))) ThrowInvalid("truncated");
+		}
+		return s;
+	}
+
+	void BinaryStreamReader::ReadBytes(std::vector<unsigned char>& cBytes)
+	{
+		auto const nSize = ReadVarint();
+		cBytes.clear();
+		// As ReadString
+		while (cBytes.size() < nSize)
+		{
+			auto const nRead = cBytes.size();
+			cBytes.resize(nRead + static_cast<size_t>(std::min<std::uint64_t>(nSize - nRead, ReadPieceSize)));
+			auto const pData = reinterpret_cast<char*>(cBytes.data() + nRead);
+			if (!m_stream.read(pData, static_cast<std::streamsize>(cBytes.size() - nRead))) ThrowInvalid("truncated");
+		}
+	}
+
+	void BinaryStreamReader::ThrowInvalid(const char* psReason) const
+	{
+		ThrowInvalidBinary(m_psError, psReason);
+	}
+
+	BinaryMemoryReader::BinaryMemoryReader(const unsigned char* pData, size_t nSize, const char* psError) noexcept
+		: m_pData(pData),
+		m_pEnd(pData + nSize),
+		m_psError(psError)
+	{
+
+	}
+
+	void BinaryMemoryReader::ThrowInvalid(const char* psReason) const
+	{
+		ThrowInvalidBinary(m_psError, psReason);
+	}
+
+	std::uint64_t BinaryMemoryReader::ReadLongVarint()
+	{
+		std::uint64_t n;
+		auto const next = [this] { return m_pData != m_pEnd ? static_cast<int>(*m_pData++) : -1; };
+		if (!DecodeVarint(next, n))
+		{
+			ThrowInvalid(m_pData == m_pEnd ? "truncated" : "invalid integer");
+		}
+		return n;
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace HE
+{
+	// Building blocks of the binary formats: integers in LEB128, 7 bits per byte from the lowest ones, and strings and
+	// byte arrays as their size then their bytes
+
+	void WriteVarint(std::ostream& stream, std::uint64_t n);
+	void WriteVarint(std::vector<unsigned char>& cOutput, std::uint64_t n);
+	void WriteString(std::ostream& stream, const std::string& s);
+	void WriteBytes(std::ostream& stream, const void* pData, size_t nSize);
+
+	// Signed values small in absolute value, ex: deltas, as small unsigned ones: 0, -1, 1, -2... -> 0, 1, 2, 3...
+	constexpr std::uint64_t ZigZag(std::int64_t n) noexcept
+	{
+		return (static_cast<std::uint64_t>(n) << 1) ^ static_cast<std::uint64_t>(n >> 63);
+	}
+
+	constexpr std::int64_t UnZigZag(std::uint64_t n) noexcept
+	{
+		return static_cast<std::int64_t>(n >> 1) ^ -static_cast<std::int64_t>(n & 1);
+	}
+
+	// Reads the values of a binary format from a stream
+	// A truncated or invalid value throws std::runtime_error, with the message given on construction and the reason,
+	// ex: "Invalid replay: truncated"
+	class BinaryStreamReader
+	{
+	public:
+		BinaryStreamReader(std::istream& stream, const char* psError) noexcept;
+
+		std::uint64_t ReadVarint();
+		std::string ReadString();
+		// Replaces the content of cBytes
+		void ReadBytes(std::vector<unsigned char>& cBytes);
+
+		[[noreturn]] void ThrowInvalid(const char* psReason) const;
+
+	private:
+		std::istream& m_stream;
+		const char* const m_psError;
+	};
+
+	// Reads the values of a binary format from memory, throwing as BinaryStreamReader
+	class BinaryMemoryReader
+	{
+	public:
+		BinaryMemoryReader(const unsigned char* pData, size_t nSize, const char* psError) noexcept;
+
+		bool IsAtEnd() const noexcept { return m_pData == m_pEnd; }
+
+		std::uint64_t ReadVarint()
+		{
+			// Most integers fit in one byte
+			if (m_pData != m_pEnd && *m_pData < 0x80) return *m_pData++;
+			return ReadLongVarint();
+		}
+
+		// Throws if the integer is above nMax
+		size_t ReadSize(std::uint64_t nMax)
+		{
+			auto const n = ReadVarint();
+			if (n > nMax) ThrowInvalid("out of range");
+			return static_cast<size_t>(n);
+		}
+
+		// Form: ReadBytes(nSize) -> the next nSize bytes, which stay in the memory read
+		const unsigned char* ReadBytes(size_t nSize)
+		{
+			if (nSize > static_cast<size_t>(m_pEnd - m_pData)) ThrowInvalid("truncated");
+			auto const pBytes = m_pData;
+			m_pData += nSize;
+			return pBytes;
+		}
+
+		[[noreturn]] void ThrowInvalid(const char* psReason) const;
+
+	private:
+		std::uint64_t ReadLongVarint();
+
+		const unsigned char* m_pData;
+		const unsigned char* const m_pEnd;
+		const char* const m_psError;
+	};
+}
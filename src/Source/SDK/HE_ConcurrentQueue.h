@@ -0,0 +1,472 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "HE_Allocator.h"
+#include "HE_Assert.h"
+#include "HE_Math.h"
+
+namespace HE
+{
+	// Indices written by different threads are kept on different cache lines, so that a producer and a
+	// consumer do not invalidate each other's line on every operation
+	constexpr size_t CacheLineSize = 64;
+
+	namespace Private
+	{
+		// Array of nCapacity uninitialized T from an aligned allocator, starting on a cache line
+		template<class T, class Allocator>
+		class QueueStorage
+		{
+			static_assert(is_aligned_allocator<Allocator>::value, "The allocator of a queue must support aligned allocations");
+
+		public:
+			QueueStorage(size_t nCapacity, Allocator& allocator)
+				: m_allocator(allocator)
+			{
+				EXPECTS(Math::IsPow2(nCapacity));
+				auto const nSize = Math::RoundUpToMultipleOf(nCapacity * sizeof(T), CacheLineSize);
+				m_blk = m_allocator.allocate(nSize, std::max(CacheLineSize, alignof(T)));
+				if (m_blk.ptr == nullptr) throw std::bad_alloc{};
+			}
+			QueueStorage(const QueueStorage&) = delete;
+			void operator=(const QueueStorage&) = delete;
+			~QueueStorage() { m_allocator.deallocate(m_blk); }
+
+			T* Get() const noexcept { return static_cast<T*>(m_blk.ptr); }
+
+		private:
+			Allocator& m_allocator;
+			Blk m_blk;
+		};
+	}
+
+	// Bounded lock-free queue from one producer thread to one consumer thread
+	// Each side owns one index and only reads the other, which it caches: a side only touches the cache line of
+	// the other one when the queue looks full, or empty, from its cached copy. The batch functions publish their
+	// whole batch with a single store
+	//
+	// Items are moved in and out, and T must be nothrow move constructible. nCapacity must be a power of 2
+	template<class T, class Allocator = AlignedMallocAllocator>
+	class SpscQueue
+	{
+		static_assert(std::is_nothrow_move_constructible<T>::value, "Queue items must be nothrow move constructible");
+
+	public:
+		explicit SpscQueue(size_t nCapacity, Allocator& allocator = Allocator::it)
+			: m_storage(nCapacity, allocator),
+			m_nMask(nCapacity - 1)
+		{
+
+		}
+		SpscQueue(const SpscQueue&) = delete;
+		void operator=(const SpscQueue&) = delete;
+		// Destroys the items left, so no thread may use the queue anymore
+		~SpscQueue()
+		{
+			auto const nTail = m_nTail.load(std::memory_order_relaxed);
+			for (auto nHead = m_nHead.load(std::memory_order_relaxed); nHead != nTail; ++nHead)
+			{
+				m_storage.Get()[nHead & m_nMask].~T();
+			}
+		}
+
+		size_t GetCapacity() const noexcept { return m_nMask + 1; }
+
+		// Producer only. Returns false, without moving from value, if the queue is full
+		template<class U>
+		bool TryPush(U&& value)
+		{
+			auto const nTail = m_nTail.load(std::memory_order_relaxed);
+			if (nTail - m_nHeadCache > m_nMask)
+			{
+				m_nHeadCache = m_nHead.load(std::memory_order_acquire);
+				if (nTail - m_nHeadCache > m_nMask) return false;
+			}
+
+			new (m_storage.Get() + (nTail & m_nMask)) T(std::forward<U>(value));
+			m_nTail.store(nTail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Producer only. Moves the items of [pBegin, pBegin + nCount) in as long as there is room
+		// Returns how many were pushed, from the front
+		size_t TryPushBatch(T* pBegin, size_t nCount)
+		{
+			auto const nTail = m_nTail.load(std::memory_order_relaxed);
+			if (GetCapacity() - (nTail - m_nHeadCache) < nCount)
+			{
+				m_nHeadCache = m_nHead.load(std::memory_order_acquire);
+			}
+			nCount = std::min(nCount, GetCapacity() - (nTail - m_nHeadCache));
+
+			for (size_t i = 0; i < nCount; ++i)
+			{
+				new (m_storage.Get() + ((nTail + i) & m_nMask)) T(std::move(pBegin[i]));
+			}
+			if (nCount > 0) m_nTail.store(nTail + nCount, std::memory_order_release);
+			return nCount;
+		}
+
+		// Consumer only. Returns false if the queue is empty
+		bool TryPop(T& value) noexcept(std::is_nothrow_move_assignable<T>::value)
+		{
+			auto const nHead = m_nHead.load(std::memory_order_relaxed);
+			if (nHead == m_nTailCache)
+			{
+				m_nTailCache = m_nTail.load(std::memory_order_acquire);
+				if (nHead == m_nTailCache) return false;
+			}
+
+			auto const pItem = m_storage.Get() + (nHead & m_nMask);
+			value = std::move(*pItem);
+			pItem->~T();
+			m_nHead.store(nHead + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer only. Moves up to nMax items to pOut. Returns how many were popped
+		size_t TryPopBatch(T* pOut, size_t nMax) noexcept(std::is_nothrow_move_assignable<T>::value)
+		{
+			auto const nHead = m_nHead.load(std::memory_order_relaxed);
+			if (m_nTailCache - nHead < nMax)
+			{
+				m_nTailCache = m_nTail.load(std::memory_order_acquire);
+			}
+			auto const nCount = std::min(nMax, m_nTailCache - nHead);
+
+			for (size_t i = 0; i < nCount; ++i)
+			{
+				auto const pItem = m_storage.Get() + ((nHead + i) & m_nMask);
+				pOut[i] = std::move(*pItem);
+				pItem->~T();
+			}
+			if (nCount > 0) m_nHead.store(nHead + nCount, std::memory_order_release);
+			return nCount;
+		}
+
+		// Approximate when the other side is using the queue
+		size_t GetSize() const noexcept
+		{
+			return m_nTail.load(std::memory_order_relaxed) - m_nHead.load(std::memory_order_relaxed);
+		}
+
+	private:
+		Private::QueueStorage<T, Allocator> m_storage;
+		size_t const m_nMask;
+
+		// The consumer line: its index, and its copy of the tail
+		alignas(CacheLineSize) std::atomic<size_t> m_nHead{ 0 };
+		size_t m_nTailCache{ 0 };
+		// The producer line
+		alignas(CacheLineSize) std::atomic<size_t> m_nTail{ 0 };
+		size_t m_nHeadCache{ 0 };
+	};
+
+	// Bounded lock-free queue for any number of producer and consumer threads
+	// Based on Dmitry Vyukov's bounded MPMC queue: each cell has a sequence number telling whether it is free for
+	// the push at its position, or full for the pop at its position, so producers and consumers only contend on
+	// their own index, with a compare-exchange. Not lock-free in the strict sense: a thread preempted between
+	// claiming a cell and filling or emptying it holds up the threads that wrap around to that cell
+	//
+	// The batch functions claim consecutive cells with a single compare-exchange
+	// Items are moved in and out, and T must be nothrow move constructible. nCapacity must be a power of 2
+	template<class T, class Allocator = AlignedMallocAllocator>
+	class MpmcQueue
+	{
+		static_assert(std::is_nothrow_move_constructible<T>::value, "Queue items must be nothrow move constructible");
+
+	public:
+		explicit MpmcQueue(size_t nCapacity, Allocator& allocator = Allocator::it)
+			: m_storage(nCapacity, allocator),
+			m_nMask(nCapacity - 1)
+		{
+			for (size_t i = 0; i < nCapacity; ++i)
+			{
+				new (&m_storage.Get()[i].nSequence) std::atomic<size_t>(i);
+			}
+		}
+		MpmcQueue(const MpmcQueue&) = delete;
+		void operator=(const MpmcQueue&) = delete;
+		// Destroys the items left, so no thread may use the queue anymore
+		~MpmcQueue()
+		{
+			auto const nEnqueue = m_nEnqueue.load(std::memory_order_relaxed);
+			for (auto nDequeue = m_nDequeue.load(std::memory_order_relaxed); nDequeue != nEnqueue; ++nDequeue)
+			{
+				GetCell(nDequeue).GetItem()->~T();
+			}
+		}
+
+		size_t GetCapacity() const noexcept { return m_nMask + 1; }
+
+		// Thread-safe. Returns false, without moving from value, if the queue is full
+		bool TryPush(T&& value) noexcept
+		{
+			size_t nPosition;
+			if (ClaimPush(1, nPosition) == 0) return false;
+
+			auto& cell = GetCell(nPosition);
+			new (cell.GetItem()) T(std::move(value));
+			cell.nSequence.store(nPosition + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Copies before claiming a cell, since a claimed cell must be filled
+		bool TryPush(const T& value)
+		{
+			T copy(value);
+			return TryPush(std::move(copy));
+		}
+
+		// Thread-safe. Moves the items of [pBegin, pBegin + nCount) in as long as there is room
+		// Returns how many were pushed, from the front
+		size_t TryPushBatch(T* pBegin, size_t nCount) noexcept
+		{
+			size_t nPosition;
+			nCount = ClaimPush(nCount, nPosition);
+			for (size_t i = 0; i < nCount; ++i)
+			{
+				auto& cell = GetCell(nPosition + i);
+				new (cell.GetItem()) T(std::move(pBegin[i]));
+				cell.nSequence.store(nPosition + i + 1, std::memory_order_release);
+			}
+			return nCount;
+		}
+
+		// Thread-safe. Returns false if the queue is empty
+		bool TryPop(T& value) noexcept(std::is_nothrow_move_assignable<T>::value)
+		{
+			size_t nPosition;
+			if (ClaimPop(1, nPosition) == 0) return false;
+
+			PopCell(nPosition, value);
+			return true;
+		}
+
+		// Thread-safe. Moves up to nMax items to pOut. Returns how many were popped
+		size_t TryPopBatch(T* pOut, size_t nMax) noexcept(std::is_nothrow_move_assignable<T>::value)
+		{
+			size_t nPosition;
+			auto const nCount = ClaimPop(nMax, nPosition);
+			for (size_t i = 0; i < nCount; ++i)
+			{
+				PopCell(nPosition + i, pOut[i]);
+			}
+			return nCount;
+		}
+
+		// Approximate when other threads are using the queue
+		size_t GetSize() const noexcept
+		{
+			auto const nEnqueue = m_nEnqueue.load(std::memory_order_relaxed);
+			auto const nDequeue = m_nDequeue.load(std::memory_order_relaxed);
+			return nEnqueue > nDequeue ? nEnqueue - nDequeue : 0;
+		}
+
+	private:
+		struct Cell
+		{
+			// Position of the next push to this cell if it is free, that position + 1 if it is full
+			std::atomic<size_t> nSequence;
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type item;
+
+			T* GetItem() noexcept { return reinterpret_cast<T*>(&item); }
+		};
+
+		Cell& GetCell(size_t nPosition) noexcept { return m_storage.Get()[nPosition & m_nMask]; }
+
+		// Claims up to nMax consecutive cells that are free, from nPosition. Returns how many
+		size_t ClaimPush(size_t nMax, size_t& nPosition) noexcept
+		{
+			nPosition = m_nEnqueue.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				size_t nCount = 0;
+				while (nCount < nMax && nCount <= m_nMask
+					&& GetCell(nPosition + nCount).nSequence.load(std::memory_order_acquire) == nPosition + nCount)
+				{
+					++nCount;
+				}
+
+				if (nCount == 0)
+				{
+					auto const nSequence = GetCell(nPosition).nSequence.load(std::memory_order_acquire);
+					// Still holds the item of the previous lap: full
+					if (static_cast<std::ptrdiff_t>(nSequence - nPosition) < 0) return 0;
+					// Another producer took the cell
+					nPosition = m_nEnqueue.load(std::memory_order_relaxed);
+					continue;
+				}
+
+				if (m_nEnqueue.compare_exchange_weak(nPosition, nPosition + nCount, std::memory_order_relaxed))
+				{
+					return nCount;
+				}
+			}
+		}
+
+		// Claims up to nMax consecutive cells that are full, from nPosition. Returns how many
+		size_t ClaimPop(size_t nMax, size_t& nPosition) noexcept
+		{
+			nPosition = m_nDequeue.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				size_t nCount = 0;
+				while (nCount < nMax && nCount <= m_nMask
+					&& GetCell(nPosition + nCount).nSequence.load(std::memory_order_acquire) == nPosition + nCount + 1)
+				{
+					++nCount;
+				}
+
+				if (nCount == 0)
+				{
+					auto const nSequence = GetCell(nPosition).nSequence.load(std::memory_order_acquire);
+					// Not pushed yet: empty
+					if (static_cast<std::ptrdiff_t>(nSequence - (nPosition + 1)) < 0) return 0;
+					// Another consumer took the cell
+					nPosition = m_nDequeue.load(std::memory_order_relaxed);
+					continue;
+				}
+
+				if (m_nDequeue.compare_exchange_weak(nPosition, nPosition + nCount, std::memory_order_relaxed))
+				{
+					return nCount;
+				}
+			}
+		}
+
+		void PopCell(size_t nPosition, T& value) noexcept(std::is_nothrow_move_assignable<T>::value)
+		{
+			auto& cell = GetCell(nPosition);
+			value = std::move(*cell.GetItem());
+			cell.GetItem()->~T();
+			// Free for the push of the next lap
+			cell.nSequence.store(nPosition + m_nMask + 1, std::memory_order_release);
+		}
+
+		Private::QueueStorage<Cell, Allocator> m_storage;
+		size_t const m_nMask;
+
+		alignas(CacheLineSize) std::atomic<size_t> m_nEnqueue{ 0 };
+		alignas(CacheLineSize) std::atomic<size_t> m_nDequeue{ 0 };
+	};
+
+	// Hook of the items of a MpscQueue
+	struct MpscQueueNode
+	{
+		std::atomic<MpscQueueNode*> pNext{ nullptr };
+	};
+
+	// Unbounded intrusive queue from any number of producer threads to one consumer thread
+	// Based on Dmitry Vyukov's intrusive MPSC queue: a push is a single exchange, so producers never wait, and
+	// never allocate. T derives from MpscQueueNode, and the queue does not own the items: an item must outlive
+	// its time in the queue, and may only be in one queue at a time
+	//
+	// Not lock-free in the strict sense either: while a producer is between its exchange and linking its item,
+	// the consumer sees the items after it as not pushed yet
+	template<class T>
+	class MpscQueue
+	{
+	public:
+		MpscQueue() noexcept
+			: m_pHead(&m_stub),
+			m_pTail(&m_stub)
+		{
+
+		}
+		MpscQueue(const MpscQueue&) = delete;
+		void operator=(const MpscQueue&) = delete;
+
+		// Thread-safe
+		void Push(T* pItem) noexcept
+		{
+			PushChain(pItem, pItem);
+		}
+
+		// Thread-safe. Form: PushBatch(begin, end), over T*. Pushes the items in order, with a single exchange
+		template<class It>
+		void PushBatch(It begin, It end) noexcept
+		{
+			if (begin == end) return;
+
+			MpscQueueNode* const pFirst = *begin;
+			MpscQueueNode* pLast = pFirst;
+			for (++begin; begin != end; ++begin)
+			{
+				MpscQueueNode* const pNode = *begin;
+				pLast->pNext.store(pNode, std::memory_order_relaxed);
+				pLast = pNode;
+			}
+			PushChain(pFirst, pLast);
+		}
+
+		// Consumer only. Returns nullptr if the queue is empty, or if the next item is still being pushed
+		T* Pop() noexcept
+		{
+			auto pTail = m_pTail;
+			auto pNext = pTail->pNext.load(std::memory_order_acquire);
+			if (pTail == &m_stub)
+			{
+				if (pNext == nullptr) return nullptr;
+				m_pTail = pNext;
+				pTail = pNext;
+				pNext = pNext->pNext.load(std::memory_order_acquire);
+			}
+
+			if (pNext != nullptr)
+			{
+				m_pTail = pNext;
+				return static_cast<T*>(pTail);
+			}
+
+			// pTail is the last item linked. Unless it is also the head, a producer is linking the next one
+			if (pTail != m_pHead.load(std::memory_order_acquire)) return nullptr;
+
+			// Puts the stub back behind the last item, so the last item can be popped
+			PushChain(&m_stub, &m_stub);
+			pNext = pTail->pNext.load(std::memory_order_acquire);
+			if (pNext == nullptr) return nullptr;
+
+			m_pTail = pNext;
+			return static_cast<T*>(pTail);
+		}
+
+		// Consumer only. Pops up to nMax items to pOut. Returns how many were popped
+		size_t PopBatch(T** pOut, size_t nMax) noexcept
+		{
+			size_t nCount = 0;
+			while (nCount < nMax && (pOut[nCount] = Pop()) != nullptr)
+			{
+				++nCount;
+			}
+			return nCount;
+		}
+
+		// Consumer only. Approximate when producers are pushing
+		bool IsEmpty() const noexcept
+		{
+			return m_pTail == &m_stub && m_stub.pNext.load(std::memory_order_acquire) == nullptr;
+		}
+
+	private:
+		void PushChain(MpscQueueNode* pFirst, MpscQueueNode* pLast) noexcept
+		{
+			pLast->pNext.store(nullptr, std::memory_order_relaxed);
+			// Release of the items, acquire of the previous head being linked by its producer
+			auto const pPrevious = m_pHead.exchange(pLast, std::memory_order_acq_rel);
+			pPrevious->pNext.store(pFirst, std::memory_order_release);
+		}
+
+		// Last item pushed
+		alignas(CacheLineSize) std::atomic<MpscQueueNode*> m_pHead;
+		// Next item to pop. Owned by the consumer
+		alignas(CacheLineSize) MpscQueueNode* m_pTail;
+		MpscQueueNode m_stub;
+	};
+}
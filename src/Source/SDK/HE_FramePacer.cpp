@@ -0,0 +1,33 @@
+#include "HE_FramePacer.h"
+
+#include <thread>
+
+namespace HE
+{
+	bool FramePacer::WaitUntil(Clock::time_point tDeadline)
+	{
+		auto const tSleepDeadline = tDeadline - m_tSpinThreshold;
+		if (Clock::now() < tSleepDeadline)
+		{
+			std::unique_lock<std::mutex> lock{ m_mutWake };
+			m_cvWake.wait_until(lock, tSleepDeadline, [this]() { return m_bWoken.load(std::memory_order_relaxed); });
+		}
+
+		while (Clock::now() < tDeadline && !m_bWoken.load(std::memory_order_acquire))
+		{
+			std::this_thread::yield();
+		}
+
+		return !m_bWoken.exchange(false, std::memory_order_acq_rel);
+	}
+
+	void FramePacer::Wake()
+	{
+		{
+			// Setting the flag under the lock makes sure a waiter can't miss the notification
+			std::lock_guard<std::mutex> lock{ m_mutWake };
+			m_bWoken.store(true, std::memory_order_release);
+		}
+		m_cvWake.notify_all();
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace HE
+{
+	// Waits for frame deadlines with low jitter
+	// OS sleeps overshoot by up to the scheduler granularity (~1ms on Linux, up to ~15ms on Windows), so
+	// the pacer sleeps until SpinThreshold before the deadline, then yields in a loop until it is reached
+	// A wait can be cut short from any thread with Wake, ex: to stop the frame loop without waiting
+	// for the end of the frame
+	class FramePacer
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		FramePacer() noexcept = default;
+		explicit FramePacer(Clock::duration tSpinThreshold) noexcept
+			: m_tSpinThreshold(tSpinThreshold)
+		{
+
+		}
+		FramePacer(const FramePacer&) = delete;
+		void operator=(const FramePacer&) = delete;
+
+		// Returns false if woken before the deadline
+		// A Wake that happens while not waiting makes the next wait return immediately
+		bool WaitUntil(Clock::time_point tDeadline);
+
+		// Thread-safe
+		void Wake();
+
+		Clock::duration GetSpinThreshold() const noexcept { return m_tSpinThreshold; }
+
+	private:
+		Clock::duration const m_tSpinThreshold{ std::chrono::milliseconds{ 2 } };
+
+		std::mutex m_mutWake;
+		std::condition_variable m_cvWake;
+		std::atomic<bool> m_bWoken{ false };
+	};
+}
@@ -0,0 +1,347 @@
+#include "HE_JobSystem.h"
+
+#include <algorithm>
+
+#include "HE_Profiler.h"
+#include "HE_String.h"
+
+namespace HE
+{
+	namespace
+	{
+		constexpr size_t WorkerDequeCapacity = 4096;
+		// Rounds of stealing attempts before a worker goes to sleep
+		constexpr unsigned IdleSpinCount = 64;
+		// Jobs cached per thread for reuse
+		constexpr size_t JobCacheSize = 1024;
+
+		// Jobs allocated and not freed yet, over all the systems
+		std::atomic<size_t> s_nAllocatedJobs{ 0 };
+
+		// Freed jobs are kept by the thread that ran them, to be reused by the next jobs that thread schedules
+		struct JobCache
+		{
+			std::vector<Private::Job*> cJobs;
+
+			~JobCache()
+			{
+				for (auto const pJob : cJobs)
+				{
+					AlignedMallocAllocator::it.deallocate({ pJob, sizeof(Private::Job) });
+				}
+				s_nAllocatedJobs.fetch_sub(cJobs.size(), std::memory_order_relaxed);
+			}
+		};
+
+		thread_local JobCache t_jobCache;
+
+		// The worker the current thread runs, if any
+		thread_local const JobSystem* t_pWorkerSystem = nullptr;
+		thread_local size_t t_nWorkerIndex = 0;
+
+		std::uint32_t NextRandom(std::uint32_t& nState) noexcept
+		{
+			// xorshift32
+			nState ^= nState << 13;
+			nState ^= nState >> 17;
+			nState ^= nState << 5;
+			return nState;
+		}
+	}
+
+	struct JobSystem::Worker
+	{
+		Worker(size_t nIndex)
+			: deque(WorkerDequeCapacity),
+			nIndex(nIndex),
+			nRandomState(static_cast<std::uint32_t>(nIndex * 2654435761u + 1))
+		{
+
+		}
+
+		WorkStealingDeque<Private::Job> deque;
+		size_t const nIndex;
+		std::uint32_t nRandomState;
+		std::thread thread;
+	};
+
+	size_t JobSystem::GetDefaultWorkerCount() noexcept
+	{
+		auto const nCores = static_cast<size_t>(std::thread::hardware_concurrency());
+		return nCores > 1 ? nCores - 1 : 0;
+	}
+
+	JobSystem::JobSystem(size_t nWorkers)
+	{
+		m_cWorkers.reserve(nWorkers);
+		for (size_t i = 0; i < nWorkers; ++i)
+		{
+			m_cWorkers.push_back(std::make_unique<Worker>(i + 1));
+		}
+
+		// Started after all the deques exist, since workers steal from each other
+		for (auto& pWorker : m_cWorkers)
+		{
+			auto& worker = *pWorker;
+			worker.thread = std::thread{ [this, &worker]() { WorkerThread(worker); } };
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		m_bStop = true;
+		WakeWorkers(true);
+
+		for (auto& pWorker : m_cWorkers)
+		{
+			pWorker->thread.join();
+		}
+
+		// Without workers, nothing ran the jobs that were never waited on
+		while (auto const pJob = FindJob(nullptr))
+		{
+			Execute(pJob);
+		}
+	}
+
+	void JobSystem::Wait(JobCounter& counter)
+	{
+		auto const pWorker = t_pWorkerSystem == this ? m_cWorkers[t_nWorkerIndex - 1].get() : nullptr;
+
+		unsigned nIdleRounds = 0;
+		while (!counter.IsDone())
+		{
+			if (auto const pJob = FindJob(pWorker))
+			{
+				Execute(pJob);
+				nIdleRounds = 0;
+			}
+			else if (++nIdleRounds > IdleSpinCount)
+			{
+				// The remaining jobs are running on other threads
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	size_t JobSystem::GetCurrentThreadIndex() const noexcept
+	{
+		return t_pWorkerSystem == this ? t_nWorkerIndex : 0;
+	}
+
+	size_t JobSystem::GetQueuedJobCount() const noexcept
+	{
+		auto nCount = m_nSharedJobs.load(std::memory_order_relaxed);
+		for (auto const& pWorker : m_cWorkers)
+		{
+			nCount += pWorker->deque.GetSize();
+		}
+		return nCount;
+	}
+
+	size_t JobSystem::GetJobMemory() noexcept
+	{
+		return s_nAllocatedJobs.load(std::memory_order_relaxed) * sizeof(Private::Job);
+	}
+
+	Private::Job* JobSystem::AllocateJob()
+	{
+		auto& cJobs = t_jobCache.cJobs;
+		if (!cJobs.empty())
+		{
+			auto const pJob = cJobs.back();
+			cJobs.pop_back();
+			return pJob;
+		}
+
+		auto const b = AlignedMallocAllocator::it.allocate(sizeof(Private::Job), alignof(Private::Job));
+		if (!b.ptr) throw std::bad_alloc{};
+		s_nAllocatedJobs.fetch_add(1, std::memory_order_relaxed);
+		return static_cast<Private::Job*>(b.ptr);
+	}
+
+	void JobSystem::FreeJob(Private::Job* pJob) noexcept
+	{
+		auto& cJobs = t_jobCache.cJobs;
+		if (cJobs.size() < JobCacheSize)
+		{
+			try
+			{
+				cJobs.push_back(pJob);
+				return;
+			}
+			catch (const std::bad_alloc&)
+			{
+
+			}
+		}
+		AlignedMallocAllocator::it.deallocate({ pJob, sizeof(Private::Job) });
+		s_nAllocatedJobs.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	size_t JobSystem::GetAutoGrain(size_t nCount) const noexcept
+	{
+		// About 8 subranges per thread: enough for stealing to even out uneven work, few enough
+		// for the scheduling cost to stay small next to the work itself
+		return std::max<size_t>(1, nCount / (GetThreadCount() * 8));
+	}
+
+	void JobSystem::Submit(Private::Job* pJob)
+	{
+		if (t_pWorkerSystem != this || !m_cWorkers[t_nWorkerIndex - 1]->deque.Push(pJob))
+		{
+			std::lock_guard<std::mutex> lock{ m_mutShared };
+			m_cSharedJobs.push_back(pJob);
+			m_nSharedJobs.fetch_add(1);
+		}
+
+		// Pairs with the fence of a worker going to sleep: either it sees the new job, or we see it sleeping
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (m_nSleeping.load(std::memory_order_relaxed) > 0)
+		{
+			WakeWorkers(false);
+		}
+	}
+
+	void JobSystem::SubmitAfter(JobCounter& dependency, Private::Job* pJob)
+	{
+		{
+			std::lock_guard<std::mutex> lock{ dependency.m_mutContinuations };
+			if (dependency.m_nPending.load() > 0)
+			{
+				pJob->pNextContinuation = dependency.m_pContinuations;
+				dependency.m_pContinuations = pJob;
+				return;
+			}
+		}
+
+		Submit(pJob);
+	}
+
+	void JobSystem::Execute(Private::Job* pJob)
+	{
+		pJob->pInvoke(*pJob);
+
+		auto const pCounter = pJob->pCounter;
+		FreeJob(pJob);
+
+		if (pCounter) Finish(*pCounter);
+	}
+
+	void JobSystem::Finish(JobCounter& counter)
+	{
+		// Keeps the counter from being seen as done while its continuations are scheduled
+		counter.m_nFinishing.fetch_add(1);
+		if (counter.m_nPending.fetch_sub(1) == 1)
+		{
+			Private::Job* pContinuations;
+			{
+				std::lock_guard<std::mutex> lock{ counter.m_mutContinuations };
+				pContinuations = std::exchange(counter.m_pContinuations, nullptr);
+			}
+
+			while (pContinuations)
+			{
+				auto const pNext = pContinuations->pNextContinuation;
+				Submit(pContinuations);
+				pContinuations = pNext;
+			}
+		}
+		counter.m_nFinishing.fetch_sub(1);
+	}
+
+	Private::Job* JobSystem::FindJob(Worker* pWorker)
+	{
+		if (pWorker)
+		{
+			if (auto const pJob = pWorker->deque.Pop()) return pJob;
+		}
+
+		if (m_nSharedJobs.load(std::memory_order_relaxed) > 0)
+		{
+			std::lock_guard<std::mutex> lock{ m_mutShared };
+			if (!m_cSharedJobs.empty())
+			{
+				auto const pJob = m_cSharedJobs.front();
+				m_cSharedJobs.pop_front();
+				m_nSharedJobs.fetch_sub(1, std::memory_order_relaxed);
+				return pJob;
+			}
+		}
+
+		auto const nWorkers = m_cWorkers.size();
+		if (nWorkers == 0) return nullptr;
+
+		// Visit every other worker once, starting from a random one
+		thread_local std::uint32_t t_nRandomState = 0x9E3779B9u;
+		auto& nRandomState = pWorker ? pWorker->nRandomState : t_nRandomState;
+		auto const nStart = NextRandom(nRandomState) % nWorkers;
+		for (size_t i = 0; i < nWorkers; ++i)
+		{
+			auto& victim = *m_cWorkers[(nStart + i) % nWorkers];
+			if (&victim == pWorker) continue;
+			if (auto const pJob = victim.deque.Steal()) return pJob;
+		}
+
+		return nullptr;
+	}
+
+	void JobSystem::WorkerThread(Worker& worker)
+	{
+		t_pWorkerSystem = this;
+		t_nWorkerIndex = worker.nIndex;
+		SetProfileThreadName(Format("Worker {_}", worker.nIndex));
+
+		unsigned nIdleRounds = 0;
+		while (true)
+		{
+			if (auto const pJob = FindJob(&worker))
+			{
+				Execute(pJob);
+				nIdleRounds = 0;
+				continue;
+			}
+
+			if (m_bStop.load()) break;
+
+			if (++nIdleRounds < IdleSpinCount)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock{ m_mutSleep };
+			auto const nGeneration = m_nWakeGeneration;
+			m_nSleeping.fetch_add(1);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			// A job scheduled before the increment was not seen by Submit's check: look once more
+			auto const bWorkLeft = m_nSharedJobs.load() > 0 || std::any_of(m_cWorkers.begin(), m_cWorkers.end(), [](const std::unique_ptr<Worker>& p) {
+				return !p->deque.IsEmpty();
+			});
+			if (!bWorkLeft && !m_bStop.load())
+			{
+				m_cvSleep.wait(lock, [this, nGeneration]() { return m_nWakeGeneration != nGeneration || m_bStop.load(); });
+			}
+
+			m_nSleeping.fetch_sub(1);
+			nIdleRounds = 0;
+		}
+
+		t_pWorkerSystem = nullptr;
+		t_nWorkerIndex = 0;
+	}
+
+	void JobSystem::WakeWorkers(bool bAll)
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutSleep };
+			++m_nWakeGeneration;
+		}
+
+		if (bAll)
+			m_cvSleep.notify_all();
+		else
+			m_cvSleep.notify_one();
+	}
+}
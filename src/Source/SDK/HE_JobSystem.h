@@ -0,0 +1,227 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "HE_Allocator.h"
+#include "HE_Assert.h"
+#include "HE_WorkStealingDeque.h"
+
+namespace HE
+{
+	class JobCounter;
+	class JobSystem;
+
+	namespace Private
+	{
+		// A scheduled callable, stored inline. Two cache lines, so that jobs don't share lines
+		struct alignas(64) Job
+		{
+			static constexpr size_t Size = 128;
+			static constexpr size_t StorageSize = Size - 3 * sizeof(void*);
+
+			// Runs the callable, then destroys it
+			void (*pInvoke)(Job&);
+			JobCounter* pCounter;
+			// Next job waiting on the same dependency
+			Job* pNextContinuation;
+			std::aligned_storage_t<StorageSize, PlatformMaxAlignment> storage;
+		};
+		static_assert(sizeof(Job) == Job::Size, "HE::Private::Job should fill exactly two cache lines");
+
+		template<class F>
+		void InvokeJob(Job& job)
+		{
+			auto& f = *reinterpret_cast<F*>(&job.storage);
+			f();
+			f.~F();
+		}
+	}
+
+	// Counts the jobs scheduled on it that are not finished yet
+	// A counter is done once all its jobs have finished. Jobs can be added again after that
+	// The counter must outlive its jobs: call JobSystem::Wait before destroying it
+	class JobCounter
+	{
+	public:
+		JobCounter() noexcept = default;
+		JobCounter(const JobCounter&) = delete;
+		void operator=(const JobCounter&) = delete;
+		~JobCounter() { ASSERT_MSG(IsDone(), "A HE::JobCounter was destroyed while its jobs were still running"); }
+
+		bool IsDone() const noexcept
+		{
+			// A finishing job may still be scheduling the continuations after the count reached zero
+			return m_nPending.load() == 0 && m_nFinishing.load() == 0;
+		}
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<std::uint32_t> m_nPending{ 0 };
+		std::atomic<std::uint32_t> m_nFinishing{ 0 };
+
+		// Jobs scheduled with RunAfter on this counter
+		std::mutex m_mutContinuations;
+		Private::Job* m_pContinuations{ nullptr };
+	};
+
+	// Runs jobs on one worker thread per core, with work stealing
+	//
+	// Each worker has its own Chase-Lev deque. A job scheduled from a worker goes to the bottom of its
+	// deque, and the worker runs its most recent jobs first, while idle workers steal the oldest
+	// ones from the top. Jobs scheduled from any other thread go through a shared queue
+	// Idle workers spin for a short while, then sleep until new jobs are scheduled
+	//
+	// Waiting on a counter never blocks a thread: it runs other jobs until the counter is done.
+	// This makes nested parallelism safe (jobs can schedule jobs and wait on them), and lets the
+	// thread that waits (ex: the Engine thread) count as one of the cores
+	//
+	// Jobs are callables of up to Private::Job::StorageSize bytes, stored without allocating.
+	// Capture big state by reference. Jobs must not throw
+	class JobSystem
+	{
+	public:
+		// One worker per core, minus the one of the thread that schedules and waits on the jobs
+		static size_t GetDefaultWorkerCount() noexcept;
+
+		// With 0 workers, jobs only run when waited on
+		explicit JobSystem(size_t nWorkers = GetDefaultWorkerCount());
+		JobSystem(const JobSystem&) = delete;
+		void operator=(const JobSystem&) = delete;
+		// Runs the remaining jobs, then stops the workers
+		~JobSystem();
+
+		size_t GetWorkerCount() const noexcept { return m_cWorkers.size(); }
+		// Workers, plus the waiting thread
+		size_t GetThreadCount() const noexcept { return m_cWorkers.size() + 1; }
+
+		// Thread-safe, approximate. Jobs scheduled and not started yet, ex: to monitor the load
+		size_t GetQueuedJobCount() const noexcept;
+
+		// Thread-safe. Bytes of job storage allocated by all the systems, including the jobs cached for reuse
+		static size_t GetJobMemory() noexcept;
+
+		// Thread-safe. Schedules f()
+		template<class F>
+		void Run(F&& f)
+		{
+			Submit(CreateJob(std::forward<F>(f), nullptr));
+		}
+
+		// Thread-safe. Schedules f(), counted by counter
+		template<class F>
+		void Run(JobCounter& counter, F&& f)
+		{
+			counter.m_nPending.fetch_add(1);
+			Submit(CreateJob(std::forward<F>(f), &counter));
+		}
+
+		// Thread-safe. Schedules f() once dependency is done, counted by counter
+		template<class F>
+		void RunAfter(JobCounter& dependency, JobCounter& counter, F&& f)
+		{
+			counter.m_nPending.fetch_add(1);
+			SubmitAfter(dependency, CreateJob(std::forward<F>(f), &counter));
+		}
+
+		// Thread-safe. Runs jobs until counter is done
+		void Wait(JobCounter& counter);
+
+		// Form: ParallelForRange(nBegin, nEnd, f(nRangeBegin, nRangeEnd), nGrain)
+		// Calls f on subranges covering [nBegin, nEnd), in parallel, and waits for them
+		// The range is split in halves, recursively, until the subranges have at most nGrain elements.
+		// With nGrain 0, the grain is picked to give each thread several subranges to balance the load
+		template<class F>
+		void ParallelForRange(size_t nBegin, size_t nEnd, F&& f, size_t nGrain = 0)
+		{
+			if (nBegin >= nEnd) return;
+			if (nGrain == 0) nGrain = GetAutoGrain(nEnd - nBegin);
+
+			JobCounter counter;
+			SplitRange(counter, nBegin, nEnd, nGrain, f);
+			Wait(counter);
+		}
+
+		// Form: ParallelFor(nBegin, nEnd, f(i))
+		template<class F>
+		void ParallelFor(size_t nBegin, size_t nEnd, F&& f, size_t nGrain = 0)
+		{
+			ParallelForRange(nBegin, nEnd, [&f](size_t nRangeBegin, size_t nRangeEnd) {
+				for (auto i = nRangeBegin; i < nRangeEnd; ++i) f(i);
+			}, nGrain);
+		}
+
+		// Number of the calling worker in [1, GetWorkerCount()], or 0 if the calling thread is not a worker
+		// of this system. Useful to index per-thread data
+		size_t GetCurrentThreadIndex() const noexcept;
+
+	private:
+		struct Worker;
+
+		static Private::Job* AllocateJob();
+		static void FreeJob(Private::Job* pJob) noexcept;
+
+		template<class F>
+		static Private::Job* CreateJob(F&& f, JobCounter* pCounter)
+		{
+			using Callable = std::decay_t<F>;
+			static_assert(sizeof(Callable) <= Private::Job::StorageSize, "Job callable is too big: capture by reference");
+			static_assert(alignof(Callable) <= PlatformMaxAlignment, "Job callable is overaligned");
+
+			auto const pJob = AllocateJob();
+			new (&pJob->storage) Callable(std::forward<F>(f));
+			pJob->pInvoke = &Private::InvokeJob<Callable>;
+			pJob->pCounter = pCounter;
+			pJob->pNextContinuation = nullptr;
+			return pJob;
+		}
+
+		template<class F>
+		void SplitRange(JobCounter& counter, size_t nBegin, size_t nEnd, size_t nGrain, F& f)
+		{
+			// Give away the upper halves, which are the first to be stolen, and keep splitting the lower one
+			while (nEnd - nBegin > nGrain)
+			{
+				auto const nMiddle = nBegin + (nEnd - nBegin) / 2;
+				Run(counter, [this, &counter, nMiddle, nEnd, nGrain, &f]() {
+					SplitRange(counter, nMiddle, nEnd, nGrain, f);
+				});
+				nEnd = nMiddle;
+			}
+			f(nBegin, nEnd);
+		}
+
+		size_t GetAutoGrain(size_t nCount) const noexcept;
+
+		void Submit(Private::Job* pJob);
+		void SubmitAfter(JobCounter& dependency, Private::Job* pJob);
+		void Execute(Private::Job* pJob);
+		void Finish(JobCounter& counter);
+		Private::Job* FindJob(Worker* pWorker);
+		void WorkerThread(Worker& worker);
+		void WakeWorkers(bool bAll);
+
+		std::vector<std::unique_ptr<Worker>> m_cWorkers;
+
+		// Jobs scheduled by threads that are not workers, or that overflowed a worker's deque
+		std::mutex m_mutShared;
+		std::deque<Private::Job*> m_cSharedJobs;
+		std::atomic<size_t> m_nSharedJobs{ 0 };
+
+		std::mutex m_mutSleep;
+		std::condition_variable m_cvSleep;
+		std::atomic<std::uint32_t> m_nSleeping{ 0 };
+		std::uint64_t m_nWakeGeneration{ 0 };
+		std::atomic<bool> m_bStop{ false };
+	};
+}
@@ -0,0 +1,272 @@
+#include "HE_Log.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace HE
+{
+	namespace
+	{
+		const char* const s_apsLevelNames[] = { "Verbose", "Debug", "Info", "Warning", "Error", "Fatal", "Off" };
+
+		bool EqualsNoCase(const std::string& a, const char* b) noexcept
+		{
+			auto const nSize = std::strlen(b);
+			if (a.size() != nSize) return false;
+
+			for (size_t i = 0; i < nSize; ++i)
+			{
+				if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+					return false;
+			}
+			return true;
+		}
+
+		std::string Trim(const std::string& s)
+		{
+			auto const nBegin = s.find_first_not_of(" \t");
+			if (nBegin == std::string::npos) return{};
+			auto const nEnd = s.find_last_not_of(" \t");
+			return s.substr(nBegin, nEnd - nBegin + 1);
+		}
+
+		struct SinkRegistry
+		{
+			std::mutex mutSinks;
+			std::vector<LogSink*> cSinks{ &ConsoleLogSink::it };
+		};
+
+		SinkRegistry& GetSinkRegistry()
+		{
+			static SinkRegistry s_registry;
+			return s_registry;
+		}
+	}
+
+	ConsoleLogSink ConsoleLogSink::it;
+
+	std::atomic<LogCategory*> LogCategory::s_pFirst{ nullptr };
+
+	std::string to_string(LogLevel eLevel)
+	{
+		auto const i = static_cast<size_t>(eLevel);
+		ASSERT_MSG(i < sizeof(s_apsLevelNames) / sizeof(s_apsLevelNames[0]), "Invalid log level");
+		return s_apsLevelNames[i];
+	}
+
+	bool ParseLogLevel(const std::string& sLevel, LogLevel& eLevel) noexcept
+	{
+		for (size_t i = 0; i < sizeof(s_apsLevelNames) / sizeof(s_apsLevelNames[0]); ++i)
+		{
+			if (EqualsNoCase(sLevel, s_apsLevelNames[i]))
+			{
+				eLevel = static_cast<LogLevel>(i);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	LogCategory::LogCategory(const char* psName, LogLevel eDefaultLevel) noexcept
+		: m_psName{ psName }, m_nLevel{ static_cast<int>(eDefaultLevel) }
+	{
+		// Categories are usually registered during static initialization, possibly from several
+		// threads if libraries are loaded dynamically, so the list is pushed to without a lock
+		m_pNext = s_pFirst.load(std::memory_order_relaxed);
+		while (!s_pFirst.compare_exchange_weak(m_pNext, this, std::memory_order_release, std::memory_order_relaxed)) {}
+	}
+
+	LogCategory* LogCategory::Find(const char* psName) noexcept
+	{
+		for (auto p = s_pFirst.load(std::memory_order_acquire); p; p = p->m_pNext)
+		{
+			if (std::strcmp(p->m_psName, psName) == 0) return p;
+		}
+		return nullptr;
+	}
+
+	bool SetLogLevel(const char* psCategory, LogLevel eLevel) noexcept
+	{
+		auto const pCategory = LogCategory::Find(psCategory);
+		if (!pCategory) return false;
+
+		pCategory->SetLevel(eLevel);
+		return true;
+	}
+
+	bool SetLogLevels(const std::string& sSpec)
+	{
+		bool bSuccess = true;
+		size_t nBegin = 0;
+		while (nBegin <= sSpec.size())
+		{
+			auto nEnd = sSpec.find_first_of(',', nBegin);
+			if (nEnd == std::string::npos) nEnd = sSpec.size();
+
+			auto const sEntry = Trim(sSpec.substr(nBegin, nEnd - nBegin));
+			nBegin = nEnd + 1;
+			if (sEntry.empty()) continue;
+
+			auto const nSeparator = sEntry.find_first_of('=');
+			LogLevel eLevel;
+			if (nSeparator == std::string::npos || !ParseLogLevel(Trim(sEntry.substr(nSeparator + 1)), eLevel))
+			{
+				LogError(Format("Invalid log level specification \"{_}\"", sEntry));
+				bSuccess = false;
+				continue;
+			}
+
+			auto const sCategory = Trim(sEntry.substr(0, nSeparator));
+			if (sCategory == "*")
+			{
+				LogCategory::ForEach([eLevel](LogCategory& category) { category.SetLevel(eLevel); });
+			}
+			else if (!SetLogLevel(sCategory.c_str(), eLevel))
+			{
+				LogError(Format("Unknown log category \"{_}\"", sCategory));
+				bSuccess = false;
+			}
+		}
+		return bSuccess;
+	}
+
+	void ConsoleLogSink::Write(LogLevel eLevel, const LogCategory& category, const char* psMsg) noexcept
+	{
+		using namespace std::string_literals;
+
+		try
+		{
+			auto const sMessage = "["s + category.GetName() + "][" + to_string(eLevel) + "] " + psMsg;
+			if (eLevel >= LogLevel::Warning)
+			{
+				LogError(sMessage);
+			}
+			else
+			{
+				Log(sMessage);
+			}
+		}
+		catch (const std::exception& e)
+		{
+			LogError(Format("Error while attempting to log \"{_}\". The returned error was {_}", psMsg, e));
+		}
+	}
+
+	void DedupLogSink::Write(LogLevel eLevel, const LogCategory& category, const char* psMsg) noexcept
+	{
+		try
+		{
+			// The category is part of the key, since the same message can come from different systems
+			auto sKey = std::string{ category.GetName() };
+			sKey += '\0';
+			sKey += psMsg;
+
+			auto const it = m_cEntries.find(sKey);
+			if (it != m_cEntries.end())
+			{
+				++it->second.nRepeats;
+				return;
+			}
+
+			if (m_cEntries.size() < m_nMaxEntries)
+			{
+				m_cEntries.emplace(std::move(sKey), Entry{ eLevel, &category, 0 });
+			}
+		}
+		catch (const std::exception&)
+		{
+			// Could not track the message, forward it as is
+		}
+
+		m_target.Write(eLevel, category, psMsg);
+	}
+
+	void DedupLogSink::Flush() noexcept
+	{
+		for (auto const& entry : m_cEntries)
+		{
+			if (entry.second.nRepeats == 0) continue;
+
+			try
+			{
+				auto const psMsg = entry.first.c_str() + std::strlen(entry.first.c_str()) + 1;
+				auto const sSummary = Format("{_} (repeated {_} times)", psMsg, entry.second.nRepeats);
+				m_target.Write(entry.second.eLevel, *entry.second.pCategory, sSummary.c_str());
+			}
+			catch (const std::exception&)
+			{
+				// Losing a summary is not worth failing the flush
+			}
+		}
+		m_cEntries.clear();
+
+		m_target.Flush();
+	}
+
+	void AddLogSink(LogSink& sink)
+	{
+		auto& registry = GetSinkRegistry();
+		std::lock_guard<std::mutex> lock{ registry.mutSinks };
+		registry.cSinks.push_back(&sink);
+	}
+
+	void RemoveLogSink(LogSink& sink) noexcept
+	{
+		auto& registry = GetSinkRegistry();
+		std::lock_guard<std::mutex> lock{ registry.mutSinks };
+		registry.cSinks.erase(std::remove(registry.cSinks.begin(), registry.cSinks.end(), &sink), registry.cSinks.end());
+	}
+
+	void FlushLogSinks() noexcept
+	{
+		try
+		{
+			auto& registry = GetSinkRegistry();
+			std::lock_guard<std::mutex> lock{ registry.mutSinks };
+			for (auto const pSink : registry.cSinks)
+			{
+				pSink->Flush();
+			}
+		}
+		catch (const std::system_error& e)
+		{
+			LogError(Format("Error while attempting to flush the log sinks. The returned error was {_}", e));
+		}
+	}
+
+	void LogMessage(LogLevel eLevel, const LogCategory& category, const char* psMsg) noexcept
+	{
+		try
+		{
+			auto& registry = GetSinkRegistry();
+			std::lock_guard<std::mutex> lock{ registry.mutSinks };
+			for (auto const pSink : registry.cSinks)
+			{
+				pSink->Write(eLevel, category, psMsg);
+			}
+		}
+		catch (const std::system_error& e)
+		{
+			// Desperate attempt at logging the exception despite the lack of lock
+			LogError(Format("Error while attempting to log \"{_}\". The returned error was {_}", psMsg, e));
+		}
+	}
+
+	bool LogRateGate::ShouldLog(std::uint32_t nPerSecond) noexcept
+	{
+		using namespace std::chrono;
+
+		auto const nSecond = static_cast<std::int64_t>(duration_cast<seconds>(steady_clock::now().time_since_epoch()).count());
+		auto nCurrentSecond = m_nSecond.load(std::memory_order_relaxed);
+		if (nSecond != nCurrentSecond && m_nSecond.compare_exchange_strong(nCurrentSecond, nSecond, std::memory_order_relaxed))
+		{
+			m_nCount.store(0, std::memory_order_relaxed);
+		}
+
+		return m_nCount.fetch_add(1, std::memory_order_relaxed) < nPerSecond;
+	}
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "HE_BasicString.h"
+#include "HE_String.h"
+
+// Compile-time minimum log level, as the integer value of a HE::LogLevel
+// Any HE_LOG call with a lower level is compiled out entirely, arguments included
+// Defaults to Verbose, so that verbose logs can still be enabled at runtime in every build
+#ifndef HE_LOG_MIN_LEVEL
+#define HE_LOG_MIN_LEVEL 0
+#endif
+
+namespace HE
+{
+	enum class LogLevel : int { Verbose, Debug, Info, Warning, Error, Fatal, Off };
+
+	std::string to_string(LogLevel eLevel);
+
+	// Parses the name of a level (ex: "Verbose", "warning"). Case insensitive
+	// Returns false if the name is not a level, in which case eLevel is left untouched
+	bool ParseLogLevel(const std::string& sLevel, LogLevel& eLevel) noexcept;
+
+	// A named group of log messages, with its own runtime level threshold
+	// Define categories at global scope with HE_DEFINE_LOG_CATEGORY in a single translation unit,
+	// and declare them with HE_DECLARE_LOG_CATEGORY in the headers that need them
+	// Every category registers itself on construction, and can then be found by name
+	class LogCategory
+	{
+	public:
+		LogCategory(const char* psName, LogLevel eDefaultLevel) noexcept;
+		LogCategory(const LogCategory&) = delete;
+		void operator=(const LogCategory&) = delete;
+
+		const char* GetName() const noexcept { return m_psName; }
+
+		LogLevel GetLevel() const noexcept
+		{
+			return static_cast<LogLevel>(m_nLevel.load(std::memory_order_relaxed));
+		}
+
+		// Thread-safe. Takes effect on the next log call of any thread
+		void SetLevel(LogLevel eLevel) noexcept
+		{
+			m_nLevel.store(static_cast<int>(eLevel), std::memory_order_relaxed);
+		}
+
+		// Single relaxed load, cheap enough for hot loops
+		bool IsEnabled(LogLevel eLevel) const noexcept
+		{
+			return static_cast<int>(eLevel) >= m_nLevel.load(std::memory_order_relaxed);
+		}
+
+		// Returns nullptr if no category has this name
+		static LogCategory* Find(const char* psName) noexcept;
+
+		// Calls f(LogCategory&) on every registered category
+		template<class F>
+		static void ForEach(F&& f)
+		{
+			for (auto p = s_pFirst.load(std::memory_order_acquire); p; p = p->m_pNext)
+			{
+				f(*p);
+			}
+		}
+
+	private:
+		const char* const m_psName;
+		std::atomic<int> m_nLevel;
+		LogCategory* m_pNext{ nullptr };
+
+		static std::atomic<LogCategory*> s_pFirst;
+	};
+
+	// Sets the level of the category with that name. Returns false if the category does not exist
+	bool SetLogLevel(const char* psCategory, LogLevel eLevel) noexcept;
+
+	// Form: SetLogLevels("Engine=Verbose,Render=Warning") -> bSuccess
+	// Sets the level of multiple categories at once. The category name "*" sets all categories
+	// Entries are applied in order, and invalid entries are skipped. Returns false if any entry was invalid
+	bool SetLogLevels(const std::string& sSpec);
+
+	// Receives every message logged through LogMessage and HE_LOG
+	// Sinks are called under a lock shared by all sinks, so they do not need to be thread-safe
+	// themselves, but they should not log from Write or Flush
+	class LogSink
+	{
+	public:
+		virtual ~LogSink() = default;
+
+		virtual void Write(LogLevel eLevel, const LogCategory& category, const char* psMsg) noexcept = 0;
+		virtual void Flush() noexcept {}
+	};
+
+	// Writes "[Category][Level] Message" to the console. Warning and above go to LogError, the rest to Log
+	// Registered by default
+	class ConsoleLogSink : public LogSink
+	{
+	public:
+		static ConsoleLogSink it;
+
+		void Write(LogLevel eLevel, const LogCategory& category, const char* psMsg) noexcept override;
+	};
+
+	// Forwards each distinct message to the Target sink the first time it is seen, and only counts the
+	// following occurrences. On Flush, emits a "repeated N times" summary for each message that was seen
+	// more than once since the last flush, then forgets them
+	// Once MaxEntries distinct messages are being tracked, new messages are forwarded without deduplication
+	class DedupLogSink : public LogSink
+	{
+	public:
+		explicit DedupLogSink(LogSink& target, size_t nMaxEntries = 1024) noexcept
+			: m_target(target), m_nMaxEntries{ nMaxEntries } {}
+
+		void Write(LogLevel eLevel, const LogCategory& category, const char* psMsg) noexcept override;
+		void Flush() noexcept override;
+
+	private:
+		struct Entry
+		{
+			LogLevel eLevel;
+			const LogCategory* pCategory;
+			std::uint64_t nRepeats;
+		};
+
+		LogSink& m_target;
+		size_t const m_nMaxEntries;
+		std::unordered_map<std::string, Entry> m_cEntries;
+	};
+
+	// Thread-safe. The sink must stay alive until removed
+	void AddLogSink(LogSink& sink);
+	void RemoveLogSink(LogSink& sink) noexcept;
+
+	// Thread-safe. Flushes every registered sink
+	void FlushLogSinks() noexcept;
+
+	// Sends the message to every registered sink
+	// Does not check the level of the category: use HE_LOG for filtering
+	void LogMessage(LogLevel eLevel, const LogCategory& category, const char* psMsg) noexcept;
+	inline void LogMessage(LogLevel eLevel, const LogCategory& category, const std::string& sMsg) noexcept
+	{
+		LogMessage(eLevel, category, sMsg.c_str());
+	}
+
+	// Messages are formatted into an inline buffer, so that most of them don't allocate
+	using LogString = BasicString<char, MallocAllocator, 256>;
+
+	template< typename... Args>
+	void LogMessage(LogLevel eLevel, const LogCategory& category, const char* psFormat, Args&&... args)
+	{
+		LogMessage(eLevel, category, FormatAs<LogString>(psFormat, std::forward<Args>(args)...).c_str());
+	}
+
+	template< typename... Args>
+	void LogMessage(LogLevel eLevel, const LogCategory& category, const std::string& sFormat, Args&&... args)
+	{
+		LogMessage(eLevel, category, FormatAs<LogString>(sFormat, std::forward<Args>(args)...).c_str());
+	}
+}
+
+namespace HE
+{
+	// Per-callsite gates used by the HE_LOG_ONCE, HE_LOG_EVERY and HE_LOG_AT_MOST_PER_SECOND macros
+	// They only use relaxed atomics, and are constant-initialized so that a function-local static
+	// costs no initialization guard
+	class LogOnceGate
+	{
+	public:
+		bool ShouldLog() noexcept
+		{
+			return !m_bDone.load(std::memory_order_relaxed) && !m_bDone.exchange(true, std::memory_order_relaxed);
+		}
+
+	private:
+		std::atomic<bool> m_bDone{ false };
+	};
+
+	class LogEveryNGate
+	{
+	public:
+		// Lets through the 1st, (N+1)th, (2N+1)th... calls. With N = 0, lets none through
+		bool ShouldLog(std::uint32_t n) noexcept
+		{
+			return n != 0 && m_nCount.fetch_add(1, std::memory_order_relaxed) % n == 0;
+		}
+
+	private:
+		std::atomic<std::uint32_t> m_nCount{ 0 };
+	};
+
+	class LogRateGate
+	{
+	public:
+		// Lets through at most about nPerSecond calls per second of steady clock
+		// Calls racing on a new second may let a few extra messages through
+		bool ShouldLog(std::uint32_t nPerSecond) noexcept;
+
+	private:
+		std::atomic<std::int64_t> m_nSecond{ -1 };
+		std::atomic<std::uint32_t> m_nCount{ 0 };
+	};
+}
+
+#define HE_DECLARE_LOG_CATEGORY(Name) extern HE::LogCategory g_LogCategory##Name
+#define HE_DEFINE_LOG_CATEGORY(Name, eDefaultLevel) HE::LogCategory g_LogCategory##Name{ #Name, HE::LogLevel::eDefaultLevel }
+
+// Form: HE_LOG(Level, Category, sFormat, args...)
+// Example: HE_LOG(Verbose, Engine, "Entity {_} moved to {_}", id, pos)
+// Level is the name of a HE::LogLevel, and Category the name given to HE_DEFINE_LOG_CATEGORY
+// Calls below HE_LOG_MIN_LEVEL are compiled out. The others only format the message and
+// evaluate the arguments if the category is enabled for that level
+#define HE_LOG_ENABLED(eLevel, Category)																	\
+	(static_cast<int>(HE::LogLevel::eLevel) >= HE_LOG_MIN_LEVEL && g_LogCategory##Category.IsEnabled(HE::LogLevel::eLevel))
+
+#define HE_LOG(eLevel, Category, ...)																		\
+	do {																									\
+		if (HE_LOG_ENABLED(eLevel, Category)) {																\
+			HE::LogMessage(HE::LogLevel::eLevel, g_LogCategory##Category, __VA_ARGS__);					\
+		}																									\
+	} while (__LINE__ == -1, false)
+
+// Rate-limited variants of HE_LOG, keyed on the callsite. The gate is only touched once the level
+// filter passed, so disabled calls stay as cheap as with HE_LOG
+
+// Form: HE_LOG_ONCE(Level, Category, sFormat, args...)
+// Logs only the first time this callsite passes the level filter
+#define HE_LOG_ONCE(eLevel, Category, ...)																	\
+	do {																									\
+		if (HE_LOG_ENABLED(eLevel, Category)) {																\
+			static HE::LogOnceGate s_logGate;																\
+			if (s_logGate.ShouldLog())																		\
+				HE::LogMessage(HE::LogLevel::eLevel, g_LogCategory##Category, __VA_ARGS__);				\
+		}																									\
+	} while (__LINE__ == -1, false)
+
+// Form: HE_LOG_EVERY(N, Level, Category, sFormat, args...)
+// Logs one out of every N calls of this callsite, starting with the first. N = 0 never logs
+#define HE_LOG_EVERY(N, eLevel, Category, ...)																\
+	do {																									\
+		if (HE_LOG_ENABLED(eLevel, Category)) {																\
+			static HE::LogEveryNGate s_logGate;																\
+			if (s_logGate.ShouldLog(N))																		\
+				HE::LogMessage(HE::LogLevel::eLevel, g_LogCategory##Category, __VA_ARGS__);				\
+		}																									\
+	} while (__LINE__ == -1, false)
+
+// Form: HE_LOG_AT_MOST_PER_SECOND(k, Level, Category, sFormat, args...)
+// Logs at most about k messages per second from this callsite
+#define HE_LOG_AT_MOST_PER_SECOND(k, eLevel, Category, ...)													\
+	do {																									\
+		if (HE_LOG_ENABLED(eLevel, Category)) {																\
+			static HE::LogRateGate s_logGate;																\
+			if (s_logGate.ShouldLog(k))																		\
+				HE::LogMessage(HE::LogLevel::eLevel, g_LogCategory##Category, __VA_ARGS__);				\
+		}																									\
+	} while (__LINE__ == -1, false)
@@ -0,0 +1,373 @@
+#include "HE_LogFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "HE_Assert.h"
+#include "HE_Math.h"
+
+namespace HE
+{
+	namespace
+	{
+		// Writes the UTC time of day as "HH:MM:SS.mmm". The date is part of the file name
+		size_t FormatTimeOfDay(std::chrono::system_clock::time_point t, char (&buffer)[13]) noexcept
+		{
+			using namespace std::chrono;
+
+			auto const nMilliseconds = duration_cast<milliseconds>(t.time_since_epoch()).count();
+			auto const nDayMilliseconds = static_cast<unsigned>(nMilliseconds % (24 * 60 * 60 * 1000));
+			auto const nHours = nDayMilliseconds / (60 * 60 * 1000);
+			auto const nMinutes = nDayMilliseconds / (60 * 1000) % 60;
+			auto const nSeconds = nDayMilliseconds / 1000 % 60;
+			auto const nMillis = nDayMilliseconds % 1000;
+
+			return static_cast<size_t>(std::snprintf(buffer, sizeof(buffer), "%02u:%02u:%02u.%03u", nHours, nMinutes, nSeconds, nMillis));
+		}
+	}
+
+	MappedFileLogSink::MappedFileLogSink(Settings settings)
+		: m_settings(std::move(settings)),
+		m_nSegmentSize{ Math::RoundUpToMultipleOf(Math::Max(m_settings.nSegmentSize, size_t{ 1 }), MappedFile::GetMappingGranularity()) },
+		m_nStartTime{ static_cast<std::int64_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()) }
+	{
+		EXPECTS(m_settings.nFileSize > 0);
+
+		m_pFile = OpenLogFile();
+		m_segment = MapSegment(*m_pFile, 0);
+		m_tRotationDeadline = std::chrono::steady_clock::now() + m_settings.tRotationPeriod;
+
+		m_backgroundThread = std::thread{ [this]() { BackgroundThread(); } };
+	}
+
+	MappedFileLogSink::~MappedFileLogSink()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutMapping };
+			m_bStopBackground = true;
+		}
+		m_cvBackground.notify_one();
+		m_backgroundThread.join();
+
+		// Closes what the background thread did not, and removes the next file
+		m_pFile->nWritten = m_nSegmentOffset + m_nSegmentUsed;
+		m_cRetiredSegments.push_back({ m_pFile.get(), m_segment });
+		m_cRetiredSegments.push_back({ m_pFile.get(), m_nextSegment });
+		m_cRetiredFiles.push_back(std::move(m_pFile));
+
+		std::string sNextPath;
+		if (m_pNextFile)
+		{
+			sNextPath = m_pNextFile->sPath;
+			m_cRetiredSegments.push_back({ m_pNextFile.get(), m_nextFileSegment });
+			m_cRetiredFiles.push_back(std::move(m_pNextFile));
+		}
+
+		Retire(std::move(m_cRetiredSegments), std::move(m_cRetiredFiles));
+		if (!sNextPath.empty()) std::remove(sNextPath.c_str());
+	}
+
+	void MappedFileLogSink::Write(LogLevel eLevel, const LogCategory& category, const char* psMsg) noexcept
+	{
+		try
+		{
+			char acTime[13];
+			auto const nTimeSize = FormatTimeOfDay(std::chrono::system_clock::now(), acTime);
+			auto const sLevel = to_string(eLevel);
+			auto const psCategory = category.GetName();
+			auto const nCategorySize = std::strlen(psCategory);
+			auto nMsgSize = std::strlen(psMsg);
+
+			// "[Time][Category][Level] Message\n"
+			auto const nHeaderSize = 1 + nTimeSize + 2 + nCategorySize + 2 + sLevel.size() + 2;
+			if (nHeaderSize + nMsgSize + 1 > m_settings.nFileSize)
+			{
+				// Could only be a smaller file size than any sane setting, but records must not span files
+				nMsgSize = m_settings.nFileSize > nHeaderSize + 1 ? static_cast<size_t>(m_settings.nFileSize - nHeaderSize - 1) : 0;
+			}
+			auto const nRecordSize = nHeaderSize + nMsgSize + 1;
+
+			auto const nWritten = m_nSegmentOffset + m_nSegmentUsed;
+			auto const bRotationDue = m_settings.tRotationPeriod.count() > 0 && std::chrono::steady_clock::now() >= m_tRotationDeadline;
+			if (nWritten + nRecordSize > m_settings.nFileSize || (bRotationDue && nWritten > 0))
+			{
+				Rotate();
+			}
+
+			Append("[", 1);
+			Append(acTime, nTimeSize);
+			Append("][", 2);
+			Append(psCategory, nCategorySize);
+			Append("][", 2);
+			Append(sLevel.data(), sLevel.size());
+			Append("] ", 2);
+			Append(psMsg, nMsgSize);
+			Append("\n", 1);
+		}
+		catch (const std::exception& e)
+		{
+			LogError(Format("Could not write \"{_}\" to the log file. The returned error was {_}", psMsg, e));
+		}
+	}
+
+	void MappedFileLogSink::Flush() noexcept
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutMapping };
+			m_bFlushRequested = true;
+		}
+		m_cvBackground.notify_one();
+	}
+
+	std::string MappedFileLogSink::GetCurrentPath() const
+	{
+		std::lock_guard<std::mutex> lock{ m_mutMapping };
+		return m_pFile->sPath;
+	}
+
+	std::unique_ptr<MappedFileLogSink::LogFile> MappedFileLogSink::OpenLogFile()
+	{
+		auto pFile = std::make_unique<LogFile>();
+		pFile->sPath = Format("{_}_{_}_{_}.log", m_settings.sPathPrefix, m_nStartTime, m_nFileIndex++);
+		pFile->file = MappedFile::Open(pFile->sPath, MappedFile::Access::ReadWrite);
+		// Drop any previous content, so that the unwritten part of the file reads as zeroes
+		pFile->file.Resize(0);
+		pFile->file.Resize(m_settings.nFileSize);
+		return pFile;
+	}
+
+	Blk MappedFileLogSink::MapSegment(LogFile& file, std::uint64_t nOffset) const
+	{
+		auto const nLength = static_cast<size_t>(Math::Min(static_cast<std::uint64_t>(m_nSegmentSize), file.file.GetSize() - nOffset));
+		return file.file.Map(nOffset, nLength);
+	}
+
+	void MappedFileLogSink::Append(const char* p, size_t n)
+	{
+		while (n > 0)
+		{
+			if (m_nSegmentUsed == m_segment.length)
+			{
+				NextSegment();
+			}
+
+			auto const nCopy = Math::Min(n, m_segment.length - m_nSegmentUsed);
+			std::memcpy(static_cast<char*>(m_segment.ptr) + m_nSegmentUsed, p, nCopy);
+			m_nSegmentUsed += nCopy;
+			p += nCopy;
+			n -= nCopy;
+		}
+	}
+
+	void MappedFileLogSink::NextSegment()
+	{
+		std::unique_lock<std::mutex> lock{ m_mutMapping };
+		WaitPrepared(lock, m_nextSegment);
+
+		m_cRetiredSegments.push_back({ m_pFile.get(), m_segment });
+		m_nSegmentOffset += m_segment.length;
+		m_segment = std::exchange(m_nextSegment, Blk{ nullptr, 0 });
+		m_nSegmentUsed = 0;
+		m_cvBackground.notify_one();
+	}
+
+	void MappedFileLogSink::Rotate()
+	{
+		std::unique_lock<std::mutex> lock{ m_mutMapping };
+		WaitPrepared(lock, m_nextFileSegment);
+
+		m_pFile->nWritten = m_nSegmentOffset + m_nSegmentUsed;
+		m_cRetiredSegments.push_back({ m_pFile.get(), m_segment });
+		m_cRetiredSegments.push_back({ m_pFile.get(), std::exchange(m_nextSegment, Blk{ nullptr, 0 }) });
+		m_cRetiredFiles.push_back(std::move(m_pFile));
+
+		m_pFile = std::move(m_pNextFile);
+		m_segment = std::exchange(m_nextFileSegment, Blk{ nullptr, 0 });
+		m_nSegmentOffset = 0;
+		m_nSegmentUsed = 0;
+		m_tRotationDeadline = std::chrono::steady_clock::now() + m_settings.tRotationPeriod;
+		m_cvBackground.notify_one();
+	}
+
+	void MappedFileLogSink::WaitPrepared(std::unique_lock<std::mutex>& lock, const Blk& prepared)
+	{
+		m_cvPrepared.wait(lock, [this, &prepared]() { return prepared.ptr || m_pPrepareError; });
+		if (!prepared.ptr)
+		{
+			// The background thread tries again once the error is reported
+			auto const pError = std::exchange(m_pPrepareError, nullptr);
+			m_cvBackground.notify_one();
+			std::rethrow_exception(pError);
+		}
+	}
+
+	void MappedFileLogSink::BackgroundThread()
+	{
+		auto const bSync = m_settings.tSyncInterval.count() > 0;
+		auto tNextSync = std::chrono::steady_clock::now() + m_settings.tSyncInterval;
+		auto const isWorkPending = [this]() {
+			return m_bStopBackground || NeedsNextSegment() || (!m_pNextFile && !m_pPrepareError) || m_bFlushRequested ||
+				!m_cRetiredSegments.empty() || !m_cRetiredFiles.empty();
+		};
+
+		std::unique_lock<std::mutex> lock{ m_mutMapping };
+		while (true)
+		{
+			if (bSync)
+			{
+				m_cvBackground.wait_until(lock, tNextSync, isWorkPending);
+			}
+			else
+			{
+				m_cvBackground.wait(lock, isWorkPending);
+			}
+			if (m_bStopBackground) return;
+
+			// What the writer may wait on first
+			if (NeedsNextSegment())
+			{
+				PrepareNextSegment(lock);
+			}
+			else if (!m_pNextFile && !m_pPrepareError)
+			{
+				PrepareNextFile(lock);
+			}
+			else if (bSync && std::chrono::steady_clock::now() >= tNextSync)
+			{
+				WriteBack(lock, true);
+				tNextSync = std::chrono::steady_clock::now() + m_settings.tSyncInterval;
+			}
+			else if (m_bFlushRequested)
+			{
+				m_bFlushRequested = false;
+				WriteBack(lock, false);
+			}
+			else if (!m_cRetiredSegments.empty() || !m_cRetiredFiles.empty())
+			{
+				auto cSegments = std::move(m_cRetiredSegments);
+				auto cFiles = std::move(m_cRetiredFiles);
+				m_cRetiredSegments.clear();
+				m_cRetiredFiles.clear();
+				lock.unlock();
+				Retire(std::move(cSegments), std::move(cFiles));
+				lock.lock();
+			}
+		}
+	}
+
+	bool MappedFileLogSink::NeedsNextSegment() const noexcept
+	{
+		return !m_nextSegment.ptr && !m_pPrepareError && m_nSegmentOffset + m_segment.length < m_pFile->file.GetSize();
+	}
+
+	void MappedFileLogSink::PrepareNextSegment(std::unique_lock<std::mutex>& lock)
+	{
+		auto const pFile = m_pFile.get();
+		auto const nOffset = m_nSegmentOffset + m_segment.length;
+		lock.unlock();
+
+		Blk segment{ nullptr, 0 };
+		std::exception_ptr pError;
+		try
+		{
+			segment = MapSegment(*pFile, nOffset);
+		}
+		catch (...)
+		{
+			pError = std::current_exception();
+		}
+
+		lock.lock();
+		// The writer can only switch segments with this one, but it may have rotated to the next file
+		if (pFile == m_pFile.get())
+		{
+			m_nextSegment = segment;
+			m_pPrepareError = pError;
+			m_cvPrepared.notify_one();
+		}
+		else
+		{
+			m_cRetiredSegments.push_back({ pFile, segment });
+		}
+	}
+
+	void MappedFileLogSink::PrepareNextFile(std::unique_lock<std::mutex>& lock)
+	{
+		lock.unlock();
+
+		std::unique_ptr<LogFile> pFile;
+		Blk segment{ nullptr, 0 };
+		std::exception_ptr pError;
+		try
+		{
+			pFile = OpenLogFile();
+			segment = MapSegment(*pFile, 0);
+		}
+		catch (...)
+		{
+			pFile = nullptr;
+			pError = std::current_exception();
+		}
+
+		lock.lock();
+		m_pNextFile = std::move(pFile);
+		m_nextFileSegment = segment;
+		m_pPrepareError = pError;
+		m_cvPrepared.notify_one();
+	}
+
+	void MappedFileLogSink::WriteBack(std::unique_lock<std::mutex>& lock, bool bSync)
+	{
+		// Only the background thread unmaps and closes: the segment and the file stay valid without the lock
+		auto const pFile = m_pFile.get();
+		auto const segment = m_segment;
+		lock.unlock();
+
+		try
+		{
+			pFile->file.FlushView(segment, bSync);
+			if (bSync) pFile->file.Sync();
+		}
+		catch (const std::exception& e)
+		{
+			LogError(Format("Could not {_} the log file \"{_}\". The returned error was {_}", bSync ? "sync" : "flush", pFile->sPath, e));
+		}
+
+		lock.lock();
+	}
+
+	void MappedFileLogSink::Retire(std::vector<RetiredSegment> cSegments, std::vector<std::unique_ptr<LogFile>> cFiles) const noexcept
+	{
+		auto const bSync = m_settings.tSyncInterval.count() > 0;
+
+		// The segments first: a file can't be truncated below a mapped view
+		for (auto const& retired : cSegments)
+		{
+			try
+			{
+				retired.pFile->file.FlushView(retired.segment, bSync);
+			}
+			catch (const std::exception& e)
+			{
+				LogError(Format("Could not flush the log file \"{_}\". The returned error was {_}", retired.pFile->sPath, e));
+			}
+			retired.pFile->file.Unmap(retired.segment);
+		}
+
+		for (auto const& pFile : cFiles)
+		{
+			try
+			{
+				pFile->file.Resize(pFile->nWritten);
+				if (bSync) pFile->file.Sync();
+			}
+			catch (const std::exception& e)
+			{
+				// The file keeps its zero-filled tail, which readers already have to handle after a crash
+				LogError(Format("Could not close the log file \"{_}\". The returned error was {_}", pFile->sPath, e));
+			}
+		}
+	}
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HE_Log.h"
+#include "HE_MappedFile.h"
+
+namespace HE
+{
+	// Log sink writing "[Time][Category][Level] Message" lines into memory-mapped log files
+	//
+	// Each file is preallocated to its full size, then mapped and filled one segment at a time, so
+	// that writing a message is a copy to memory rather than a write syscall. Since the pages belong to
+	// the file, everything up to the last record survives a crash of the process. The unwritten end of
+	// a file is zero-filled: readers should stop at the first '\0'
+	// Once a file is full or old enough, the sink rotates to a new file. Files are named
+	// "<PathPrefix>_<StartTime>_<Index>.log", and are truncated to their written size when closed
+	//
+	// A background thread does the file system work: it creates and maps the next file and the next
+	// segment ahead of time, so that the writer only swaps pointers, then unmaps, truncates and closes
+	// what the writer is done with. The next file is then on the disk before the sink rotates to it, and
+	// is removed with the sink if still unused. The writer only waits if the messages come faster than
+	// the background thread maps the segments
+	// The background thread also writes the dirty pages back to the disk every SyncInterval, so that the
+	// data survives a crash of the system. Writing to the sink never waits on the disk
+	class MappedFileLogSink : public LogSink
+	{
+	public:
+		struct Settings
+		{
+			std::string sPathPrefix{ "HazelEngine" };
+			// Size of a file before rotating
+			std::uint64_t nFileSize{ 64 * 1024 * 1024 };
+			// Size of the mapped window. Rounded up to the mapping granularity
+			size_t nSegmentSize{ 1024 * 1024 };
+			// Age of a file before rotating. Zero to only rotate on size
+			std::chrono::seconds tRotationPeriod{ 0 };
+			// Period of the background msync + fdatasync. Zero to leave it to the system
+			std::chrono::milliseconds tSyncInterval{ 1000 };
+		};
+
+		// Throws std::system_error if the first file can't be created
+		explicit MappedFileLogSink(Settings settings);
+		MappedFileLogSink(const MappedFileLogSink&) = delete;
+		void operator=(const MappedFileLogSink&) = delete;
+		~MappedFileLogSink();
+
+		void Write(LogLevel eLevel, const LogCategory& category, const char* psMsg) noexcept override;
+
+		// Has the background thread schedule the written pages for write-back, without waiting for the disk
+		void Flush() noexcept override;
+
+		// Path of the file currently written to
+		std::string GetCurrentPath() const;
+
+	private:
+		struct LogFile
+		{
+			MappedFile file;
+			std::string sPath;
+			// Set by the writer when it rotates to the next file
+			std::uint64_t nWritten{ 0 };
+		};
+
+		struct RetiredSegment
+		{
+			LogFile* pFile;
+			Blk segment;
+		};
+
+		std::unique_ptr<LogFile> OpenLogFile();
+		Blk MapSegment(LogFile& file, std::uint64_t nOffset) const;
+		void Append(const char* p, size_t n);
+		void NextSegment();
+		void Rotate();
+		void WaitPrepared(std::unique_lock<std::mutex>& lock, const Blk& prepared);
+
+		void BackgroundThread();
+		bool NeedsNextSegment() const noexcept;
+		void PrepareNextSegment(std::unique_lock<std::mutex>& lock);
+		void PrepareNextFile(std::unique_lock<std::mutex>& lock);
+		void WriteBack(std::unique_lock<std::mutex>& lock, bool bSync);
+		void Retire(std::vector<RetiredSegment> cSegments, std::vector<std::unique_ptr<LogFile>> cFiles) const noexcept;
+
+		Settings const m_settings;
+		size_t const m_nSegmentSize;
+		std::int64_t const m_nStartTime;
+		// Only used by the background thread once constructed
+		std::uint64_t m_nFileIndex{ 0 };
+
+		// Guards the state shared with the background thread. Neither thread holds it during a file
+		// system call: the writer only takes it to swap in what the background thread prepared
+		mutable std::mutex m_mutMapping;
+		std::unique_ptr<LogFile> m_pFile;
+		Blk m_segment{ nullptr, 0 };
+		std::uint64_t m_nSegmentOffset{ 0 };
+
+		// Prepared by the background thread, null until then
+		Blk m_nextSegment{ nullptr, 0 };
+		std::unique_ptr<LogFile> m_pNextFile;
+		Blk m_nextFileSegment{ nullptr, 0 };
+		// Stops the preparation until the writer reports it
+		std::exception_ptr m_pPrepareError;
+
+		// Done with by the writer, for the background thread to unmap and close. Only the background
+		// thread unmaps and closes, so a segment stays mapped until any sync that covers it is done
+		std::vector<RetiredSegment> m_cRetiredSegments;
+		std::vector<std::unique_ptr<LogFile>> m_cRetiredFiles;
+
+		bool m_bFlushRequested{ false };
+		bool m_bStopBackground{ false };
+		std::condition_variable m_cvBackground;
+		std::condition_variable m_cvPrepared;
+		std::thread m_backgroundThread;
+
+		// Only used by the writer
+		size_t m_nSegmentUsed{ 0 };
+		std::chrono::steady_clock::time_point m_tRotationDeadline;
+	};
+}
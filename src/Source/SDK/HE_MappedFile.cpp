@@ -0,0 +1,260 @@
+#include "HE_MappedFile.h"
+
+#include <system_error>
+#include <utility>
+
+#include "HE_Assert.h"
+#include "HE_String.h"
+
+#if defined(PLATFORM_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace HE
+{
+	namespace
+	{
+		[[noreturn]] void ThrowLastError(const std::string& sWhat)
+		{
+#if defined(PLATFORM_WINDOWS)
+			auto const nError = static_cast<int>(GetLastError());
+#else
+			auto const nError = errno;
+#endif
+			throw std::system_error{ nError, std::system_category(), sWhat };
+		}
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Close();
+#if defined(PLATFORM_WINDOWS)
+			m_hFile = std::exchange(other.m_hFile, nullptr);
+			m_hMapping = std::exchange(other.m_hMapping, nullptr);
+#else
+			m_nFile = std::exchange(other.m_nFile, -1);
+#endif
+			m_eAccess = other.m_eAccess;
+			m_nSize = std::exchange(other.m_nSize, 0);
+		}
+		return *this;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+#if defined(PLATFORM_WINDOWS)
+	namespace
+	{
+		// On Windows, the mapping object has a fixed size, and must be recreated when the file is resized
+		HANDLE CreateMapping(HANDLE hFile, MappedFile::Access eAccess, std::uint64_t nSize)
+		{
+			if (nSize == 0) return nullptr; // Windows can't map empty files
+
+			auto const nProtect = eAccess == MappedFile::Access::ReadWrite ? PAGE_READWRITE : PAGE_READONLY;
+			auto const hMapping = CreateFileMappingA(hFile, nullptr, nProtect, static_cast<DWORD>(nSize >> 32), static_cast<DWORD>(nSize), nullptr);
+			if (!hMapping) ThrowLastError("CreateFileMapping failed");
+			return hMapping;
+		}
+	}
+
+	MappedFile MappedFile::Open(const std::string& sPath, Access eAccess)
+	{
+		auto const bWrite = eAccess == Access::ReadWrite;
+		auto const hFile = CreateFileA(sPath.c_str(),
+			bWrite ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE,
+			nullptr,
+			bWrite ? OPEN_ALWAYS : OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL,
+			nullptr);
+		if (hFile == INVALID_HANDLE_VALUE) ThrowLastError(Format("Could not open \"{_}\"", sPath));
+
+		MappedFile file;
+		file.m_hFile = hFile;
+		file.m_eAccess = eAccess;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(hFile, &size)) ThrowLastError(Format("Could not get the size of \"{_}\"", sPath));
+		file.m_nSize = static_cast<std::uint64_t>(size.QuadPart);
+		file.m_hMapping = CreateMapping(hFile, eAccess, file.m_nSize);
+
+		return file;
+	}
+
+	bool MappedFile::IsOpen() const noexcept
+	{
+		return m_hFile != nullptr;
+	}
+
+	void MappedFile::Resize(std::uint64_t nSize)
+	{
+		EXPECTS(IsOpen() && m_eAccess == Access::ReadWrite);
+
+		if (m_hMapping)
+		{
+			CloseHandle(m_hMapping);
+			m_hMapping = nullptr;
+		}
+
+		LARGE_INTEGER position;
+		position.QuadPart = static_cast<LONGLONG>(nSize);
+		if (!SetFilePointerEx(m_hFile, position, nullptr, FILE_BEGIN) || !SetEndOfFile(m_hFile))
+		{
+			ThrowLastError("Could not resize the file");
+		}
+
+		m_nSize = nSize;
+		m_hMapping = CreateMapping(m_hFile, m_eAccess, m_nSize);
+	}
+
+	Blk MappedFile::Map(std::uint64_t nOffset, size_t nLength)
+	{
+		EXPECTS(IsOpen() && nOffset % GetMappingGranularity() == 0 && nOffset + nLength <= m_nSize);
+
+		auto const nDesiredAccess = m_eAccess == Access::ReadWrite ? FILE_MAP_WRITE : FILE_MAP_READ;
+		auto const p = MapViewOfFile(m_hMapping, nDesiredAccess, static_cast<DWORD>(nOffset >> 32), static_cast<DWORD>(nOffset), nLength);
+		if (!p) ThrowLastError("MapViewOfFile failed");
+
+		return{ p, nLength };
+	}
+
+	void MappedFile::Unmap(Blk view) noexcept
+	{
+		if (view.ptr) UnmapViewOfFile(view.ptr);
+	}
+
+	void MappedFile::FlushView(Blk view, bool bWait)
+	{
+		if (!view.ptr) return;
+
+		// FlushViewOfFile does not wait for the disk, only for the pages to be handed to the system.
+		// Without waiting, the system's lazy writer already takes care of dirty pages
+		if (bWait && !FlushViewOfFile(view.ptr, view.length)) ThrowLastError("FlushViewOfFile failed");
+	}
+
+	void MappedFile::Sync()
+	{
+		EXPECTS(IsOpen());
+		if (!FlushFileBuffers(m_hFile)) ThrowLastError("FlushFileBuffers failed");
+	}
+
+	void MappedFile::Close() noexcept
+	{
+		if (m_hMapping) CloseHandle(m_hMapping);
+		if (m_hFile) CloseHandle(m_hFile);
+		m_hMapping = nullptr;
+		m_hFile = nullptr;
+		m_nSize = 0;
+	}
+
+	size_t MappedFile::GetMappingGranularity() noexcept
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwAllocationGranularity;
+	}
+#else
+	MappedFile MappedFile::Open(const std::string& sPath, Access eAccess)
+	{
+		auto const bWrite = eAccess == Access::ReadWrite;
+		auto const nFile = ::open(sPath.c_str(), bWrite ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+		if (nFile < 0) ThrowLastError(Format("Could not open \"{_}\"", sPath));
+
+		MappedFile file;
+		file.m_nFile = nFile;
+		file.m_eAccess = eAccess;
+
+		struct stat fileStat;
+		if (::fstat(nFile, &fileStat) != 0) ThrowLastError(Format("Could not get the size of \"{_}\"", sPath));
+		file.m_nSize = static_cast<std::uint64_t>(fileStat.st_size);
+
+		return file;
+	}
+
+	bool MappedFile::IsOpen() const noexcept
+	{
+		return m_nFile >= 0;
+	}
+
+	void MappedFile::Resize(std::uint64_t nSize)
+	{
+		EXPECTS(IsOpen() && m_eAccess == Access::ReadWrite);
+
+		if (::ftruncate(m_nFile, static_cast<off_t>(nSize)) != 0) ThrowLastError("Could not resize the file");
+
+#if defined(PLATFORM_LINUX)
+		// ftruncate leaves a sparse file: writing to a view could then fail with SIGBUS if the disk is full
+		if (nSize > m_nSize)
+		{
+			auto const nResult = ::posix_fallocate(m_nFile, static_cast<off_t>(m_nSize), static_cast<off_t>(nSize - m_nSize));
+			if (nResult != 0) throw std::system_error{ nResult, std::system_category(), "Could not reserve storage for the file" };
+		}
+#endif
+
+		m_nSize = nSize;
+	}
+
+	Blk MappedFile::Map(std::uint64_t nOffset, size_t nLength)
+	{
+		EXPECTS(IsOpen() && nOffset % GetMappingGranularity() == 0 && nOffset + nLength <= m_nSize);
+
+		auto const nProtect = m_eAccess == Access::ReadWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+		auto const p = ::mmap(nullptr, nLength, nProtect, MAP_SHARED, m_nFile, static_cast<off_t>(nOffset));
+		if (p == MAP_FAILED) ThrowLastError("mmap failed");
+
+		return{ p, nLength };
+	}
+
+	void MappedFile::Unmap(Blk view) noexcept
+	{
+		if (view.ptr) ::munmap(view.ptr, view.length);
+	}
+
+	void MappedFile::FlushView(Blk view, bool bWait)
+	{
+		if (!view.ptr) return;
+		if (::msync(view.ptr, view.length, bWait ? MS_SYNC : MS_ASYNC) != 0) ThrowLastError("msync failed");
+	}
+
+	void MappedFile::Sync()
+	{
+		EXPECTS(IsOpen());
+#if defined(PLATFORM_APPLE)
+		auto const nResult = ::fsync(m_nFile);
+#else
+		auto const nResult = ::fdatasync(m_nFile);
+#endif
+		if (nResult != 0) ThrowLastError("fdatasync failed");
+	}
+
+	void MappedFile::Close() noexcept
+	{
+		if (m_nFile >= 0) ::close(m_nFile);
+		m_nFile = -1;
+		m_nSize = 0;
+	}
+
+	size_t MappedFile::GetMappingGranularity() noexcept
+	{
+		return static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+	}
+#endif
+}
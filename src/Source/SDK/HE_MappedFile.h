@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "HE_Allocator.h"
+#include "HE_Platform.h"
+
+namespace HE
+{
+	// A file that can be mapped in memory, as a whole or by windows (views)
+	// Errors from the operating system are reported by throwing std::system_error
+	class MappedFile
+	{
+	public:
+		enum class Access { Read, ReadWrite };
+
+		MappedFile() noexcept = default;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+		~MappedFile();
+
+		// Opens the file at sPath. With ReadWrite access, the file is created if it does not exist
+		static MappedFile Open(const std::string& sPath, Access eAccess);
+
+		bool IsOpen() const noexcept;
+		Access GetAccess() const noexcept { return m_eAccess; }
+		std::uint64_t GetSize() const noexcept { return m_nSize; }
+
+		// Changes the size of the file. When growing, the storage is reserved up front if the platform
+		// supports it, so that writing through a view can't fail later for lack of disk space
+		// Pre-condition: ReadWrite access, and no view is mapped past the new size
+		void Resize(std::uint64_t nSize);
+
+		// Maps nLength bytes of the file starting at nOffset
+		// Pre-condition: nOffset is a multiple of GetMappingGranularity(), and the range is within the file
+		Blk Map(std::uint64_t nOffset, size_t nLength);
+		void Unmap(Blk view) noexcept;
+
+		// Schedules the modified pages of the view to be written to the file. If bWait, blocks until they are
+		// This is enough for the data to survive a crash of the process, but not of the system: use Sync for that
+		void FlushView(Blk view, bool bWait);
+
+		// Blocks until all the data written to the file is on the storage device (fdatasync, FlushFileBuffers)
+		void Sync();
+
+		// Closes the file. Views that are still mapped stay valid until unmapped
+		void Close() noexcept;
+
+		// Alignment required for the offset of a view
+		static size_t GetMappingGranularity() noexcept;
+
+	private:
+#if defined(PLATFORM_WINDOWS)
+		void* m_hFile{ nullptr };
+		void* m_hMapping{ nullptr };
+#else
+		int m_nFile{ -1 };
+#endif
+		Access m_eAccess{ Access::Read };
+		std::uint64_t m_nSize{ 0 };
+	};
+}
@@ -1,72 +1,597 @@
 #pragma once
 
+#include <cmath>
 #include <type_traits>
 
+#include "HE_Platform.h"
 #include "TMP_Helper.h"
 
+// Instruction sets of the vector math, picked from the flags of the compiler, ex: /arch:AVX2, -mavx2 -mfma, -msse4.1
+// Define HE_MATH_SIMD before including to force one, ex: HE_MATH_SCALAR to check the results of the other paths
+#define HE_MATH_SCALAR 0
+#define HE_MATH_SSE2 1
+#define HE_MATH_SSE4 2
+#define HE_MATH_AVX2 3
+
+#ifndef HE_MATH_SIMD
+	#if defined(__AVX2__) && (defined(__FMA__) || defined(COMPILER_MSVC))
+		#define HE_MATH_SIMD HE_MATH_AVX2
+	#elif defined(__SSE4_1__) || defined(__AVX__)
+		#define HE_MATH_SIMD HE_MATH_SSE4
+	#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define HE_MATH_SIMD HE_MATH_SSE2
+	#else
+		#define HE_MATH_SIMD HE_MATH_SCALAR
+	#endif
+#endif
+
+#if HE_MATH_SIMD >= HE_MATH_AVX2
+	#define HE_MATH_SIMD_NAMESPACE Avx2
+#elif HE_MATH_SIMD >= HE_MATH_SSE4
+	#define HE_MATH_SIMD_NAMESPACE Sse4
+#elif HE_MATH_SIMD >= HE_MATH_SSE2
+	#define HE_MATH_SIMD_NAMESPACE Sse2
+#else
+	#define HE_MATH_SIMD_NAMESPACE NoSimd
+#endif
+
+#if HE_MATH_SIMD >= HE_MATH_AVX2
+#include <immintrin.h>
+#elif HE_MATH_SIMD >= HE_MATH_SSE4
+#include <smmintrin.h>
+#elif HE_MATH_SIMD >= HE_MATH_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace HE
 {
 	namespace Math
 	{
-		template<class T, class Enable = std::enable_if_t<std::is_integral<T>::value>>
-		constexpr bool IsPow2(T a) noexcept
+		// Named after the instruction set, so that translation units built for another one, ex: HE_Math_AVX2_Test.cpp,
+		// do not share the definitions of this one
+		inline namespace HE_MATH_SIMD_NAMESPACE
 		{
-			return a && !(a & (a - 1));
-		}
+			template<class T, class Enable = std::enable_if_t<std::is_integral<T>::value>>
+			constexpr bool IsPow2(T a) noexcept
+			{
+				return a && !(a & (a - 1));
+			}
 
-		template<class T1, class T2>
-		constexpr auto& Min(T1& a, T2& b) noexcept
-		{
-			return a < b ? a : b;
-		}
+			template<class T1, class T2>
+			constexpr auto& Min(T1& a, T2& b) noexcept
+			{
+				return a < b ? a : b;
+			}
 
-		template<class T1, class T2, class... Tr>
-		constexpr auto& Min(T1& a, T2& b, Tr&... rest) noexcept
-		{
-			return Min(a, Min(b, rest...));
-		}
+			template<class T1, class T2, class... Tr>
+			constexpr auto& Min(T1& a, T2& b, Tr&... rest) noexcept
+			{
+				return Min(a, Min(b, rest...));
+			}
 
-		template<class T1, class T2>
-		constexpr const auto& Min(const T1& a, const T2& b) noexcept
-		{
-			return a < b ? a : b;
-		}
+			template<class T1, class T2>
+			constexpr const auto& Min(const T1& a, const T2& b) noexcept
+			{
+				return a < b ? a : b;
+			}
 
-		template<class T1, class T2, class... Tr>
-		constexpr auto Min(const T1& a, const T2& b, const Tr&... rest) noexcept
-		{
-			return Min(a, Min(b, rest...));
-		}
+			template<class T1, class T2, class... Tr>
+			constexpr auto Min(const T1& a, const T2& b, const Tr&... rest) noexcept
+			{
+				return Min(a, Min(b, rest...));
+			}
 
-		template<class T1, class T2>
-		constexpr auto& Max(T1& a, T2& b) noexcept
-		{
-			return a > b ? a : b;
-		}
+			template<class T1, class T2>
+			constexpr auto& Max(T1& a, T2& b) noexcept
+			{
+				return a > b ? a : b;
+			}
 
-		template<class T1, class T2, class... Tr>
-		constexpr auto& Max(T1& a, T2& b, Tr&... rest) noexcept
-		{
-			return Min(a, Max(b, rest...));
-		}
+			template<class T1, class T2, class... Tr>
+			constexpr auto& Max(T1& a, T2& b, Tr&... rest) noexcept
+			{
+				return Min(a, Max(b, rest...));
+			}
 
-		template<class T1, class T2>
-		constexpr auto Max(const T1& a, const T2& b) noexcept
-		{
-			return a > b ? a : b;
-		}
+			template<class T1, class T2>
+			constexpr auto Max(const T1& a, const T2& b) noexcept
+			{
+				return a > b ? a : b;
+			}
 
-		template<class T1, class T2, class... Tr>
-		constexpr auto Max(const T1& a, const T2& b, const Tr&... rest) noexcept
-		{
-			return Max(a, Max(b, rest...));
-		}
+			template<class T1, class T2, class... Tr>
+			constexpr auto Max(const T1& a, const T2& b, const Tr&... rest) noexcept
+			{
+				return Max(a, Max(b, rest...));
+			}
 
-		// Base should be non-zero and unsigned
-		template<class T1, class T2, class Enable = std::enable_if_t<and_<std::is_integral<T1>, std::is_integral<T2>>::value>>
-		constexpr auto RoundUpToMultipleOf(T1 s, T2 base) noexcept
-		{
-			return (s % base) ? s + base - (s % base) : s;
+			// Base should be non-zero and unsigned
+			template<class T1, class T2, class Enable = std::enable_if_t<and_<std::is_integral<T1>, std::is_integral<T2>>::value>>
+			constexpr auto RoundUpToMultipleOf(T1 s, T2 base) noexcept
+			{
+				return (s % base) ? s + base - (s % base) : s;
+			}
+
+			// Vector math
+			//
+			// Plain aggregates of floats, ex: Vec3{ 1.0f, 2.0f, 3.0f }, uninitialized by default. The types that fit
+			// a SIMD register are aligned on 16 bytes, but the operations also accept unaligned ones, ex: in the
+			// vectors of 32-bit platforms. Matrices are column-major and multiply column vectors: (a * b) * v is
+			// a * (b * v)
+			//
+			// The operations with a SIMD path (Vec4, Mat4, Quat and AABB) are not constexpr. Their reference
+			// implementation, in HE::Math::Scalar, is, and gives the same results within rounding
+			struct Vec2
+			{
+				float x, y;
+			};
+
+			struct Vec3
+			{
+				float x, y, z;
+			};
+
+			struct alignas(16) Vec4
+			{
+				float x, y, z, w;
+			};
+
+			// Rotation, as a unit quaternion: (x, y, z) is the axis scaled by the sine of half the angle
+			struct alignas(16) Quat
+			{
+				float x, y, z, w;
+
+				static constexpr Quat Identity() noexcept { return{ 0.0f, 0.0f, 0.0f, 1.0f }; }
+				// The axis must be normalized. Counterclockwise, in radians
+				static Quat FromAxisAngle(const Vec3& axis, float fAngle) noexcept
+				{
+					auto const fSin = std::sin(fAngle * 0.5f);
+					return{ axis.x * fSin, axis.y * fSin, axis.z * fSin, std::cos(fAngle * 0.5f) };
+				}
+			};
+
+			struct Mat3
+			{
+				Vec3 aColumns[3];
+
+				static constexpr Mat3 Identity() noexcept
+				{
+					return{ { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } } };
+				}
+			};
+
+			struct alignas(16) Mat4
+			{
+				Vec4 aColumns[4];
+
+				static constexpr Mat4 Identity() noexcept
+				{
+					return{ { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } } };
+				}
+
+				static constexpr Mat4 Translation(const Vec3& t) noexcept
+				{
+					return{ { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f }, { t.x, t.y, t.z, 1.0f } } };
+				}
+
+				static constexpr Mat4 Scale(const Vec3& s) noexcept
+				{
+					return{ { { s.x, 0.0f, 0.0f, 0.0f }, { 0.0f, s.y, 0.0f, 0.0f }, { 0.0f, 0.0f, s.z, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } } };
+				}
+
+				static constexpr Mat4 Rotation(const Quat& q) noexcept
+				{
+					return{ {
+						{ 1.0f - 2.0f * (q.y * q.y + q.z * q.z), 2.0f * (q.x * q.y + q.z * q.w), 2.0f * (q.x * q.z - q.y * q.w), 0.0f },
+						{ 2.0f * (q.x * q.y - q.z * q.w), 1.0f - 2.0f * (q.x * q.x + q.z * q.z), 2.0f * (q.y * q.z + q.x * q.w), 0.0f },
+						{ 2.0f * (q.x * q.z + q.y * q.w), 2.0f * (q.y * q.z - q.x * q.w), 1.0f - 2.0f * (q.x * q.x + q.y * q.y), 0.0f },
+						{ 0.0f, 0.0f, 0.0f, 1.0f } } };
+				}
+			};
+
+			// Axis-aligned bounding box
+			struct AABB
+			{
+				Vec3 min;
+				Vec3 max;
+			};
+
+			// Vec2
+
+			constexpr Vec2 operator+(const Vec2& a, const Vec2& b) noexcept { return{ a.x + b.x, a.y + b.y }; }
+			constexpr Vec2 operator-(const Vec2& a, const Vec2& b) noexcept { return{ a.x - b.x, a.y - b.y }; }
+			constexpr Vec2 operator-(const Vec2& v) noexcept { return{ -v.x, -v.y }; }
+			constexpr Vec2 operator*(const Vec2& a, const Vec2& b) noexcept { return{ a.x * b.x, a.y * b.y }; }
+			constexpr Vec2 operator*(const Vec2& v, float f) noexcept { return{ v.x * f, v.y * f }; }
+			constexpr Vec2 operator*(float f, const Vec2& v) noexcept { return v * f; }
+			constexpr Vec2 operator/(const Vec2& v, float f) noexcept { return{ v.x / f, v.y / f }; }
+			constexpr bool operator==(const Vec2& a, const Vec2& b) noexcept { return a.x == b.x && a.y == b.y; }
+			constexpr bool operator!=(const Vec2& a, const Vec2& b) noexcept { return !(a == b); }
+			constexpr float Dot(const Vec2& a, const Vec2& b) noexcept { return a.x * b.x + a.y * b.y; }
+			inline float Length(const Vec2& v) noexcept { return std::sqrt(Dot(v, v)); }
+			inline Vec2 Normalize(const Vec2& v) noexcept { return v / Length(v); }
+
+			// Vec3
+
+			constexpr Vec3 operator+(const Vec3& a, const Vec3& b) noexcept { return{ a.x + b.x, a.y + b.y, a.z + b.z }; }
+			constexpr Vec3 operator-(const Vec3& a, const Vec3& b) noexcept { return{ a.x - b.x, a.y - b.y, a.z - b.z }; }
+			constexpr Vec3 operator-(const Vec3& v) noexcept { return{ -v.x, -v.y, -v.z }; }
+			constexpr Vec3 operator*(const Vec3& a, const Vec3& b) noexcept { return{ a.x * b.x, a.y * b.y, a.z * b.z }; }
+			constexpr Vec3 operator*(const Vec3& v, float f) noexcept { return{ v.x * f, v.y * f, v.z * f }; }
+			constexpr Vec3 operator*(float f, const Vec3& v) noexcept { return v * f; }
+			constexpr Vec3 operator/(const Vec3& v, float f) noexcept { return{ v.x / f, v.y / f, v.z / f }; }
+			constexpr bool operator==(const Vec3& a, const Vec3& b) noexcept { return a.x == b.x && a.y == b.y && a.z == b.z; }
+			constexpr bool operator!=(const Vec3& a, const Vec3& b) noexcept { return !(a == b); }
+			constexpr float Dot(const Vec3& a, const Vec3& b) noexcept { return a.x * b.x + a.y * b.y + a.z * b.z; }
+			constexpr Vec3 Cross(const Vec3& a, const Vec3& b) noexcept
+			{
+				return{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+			}
+			constexpr Vec3 ComponentMin(const Vec3& a, const Vec3& b) noexcept
+			{
+				return{ a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z };
+			}
+			constexpr Vec3 ComponentMax(const Vec3& a, const Vec3& b) noexcept
+			{
+				return{ a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z };
+			}
+			inline float Length(const Vec3& v) noexcept { return std::sqrt(Dot(v, v)); }
+			inline Vec3 Normalize(const Vec3& v) noexcept { return v / Length(v); }
+
+			// Mat3
+
+			constexpr Vec3 operator*(const Mat3& m, const Vec3& v) noexcept
+			{
+				return m.aColumns[0] * v.x + m.aColumns[1] * v.y + m.aColumns[2] * v.z;
+			}
+			constexpr Mat3 operator*(const Mat3& a, const Mat3& b) noexcept
+			{
+				return{ { a * b.aColumns[0], a * b.aColumns[1], a * b.aColumns[2] } };
+			}
+			constexpr Mat3 Transpose(const Mat3& m) noexcept
+			{
+				return{ {
+					{ m.aColumns[0].x, m.aColumns[1].x, m.aColumns[2].x },
+					{ m.aColumns[0].y, m.aColumns[1].y, m.aColumns[2].y },
+					{ m.aColumns[0].z, m.aColumns[1].z, m.aColumns[2].z } } };
+			}
+
+			// Comparisons, exact
+
+			constexpr bool operator==(const Vec4& a, const Vec4& b) noexcept { return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w; }
+			constexpr bool operator!=(const Vec4& a, const Vec4& b) noexcept { return !(a == b); }
+			constexpr bool operator==(const Quat& a, const Quat& b) noexcept { return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w; }
+			constexpr bool operator!=(const Quat& a, const Quat& b) noexcept { return !(a == b); }
+			constexpr bool operator==(const Mat4& a, const Mat4& b) noexcept
+			{
+				return a.aColumns[0] == b.aColumns[0] && a.aColumns[1] == b.aColumns[1] && a.aColumns[2] == b.aColumns[2] && a.aColumns[3] == b.aColumns[3];
+			}
+			constexpr bool operator!=(const Mat4& a, const Mat4& b) noexcept { return !(a == b); }
+
+			// AABB
+
+			constexpr Vec3 GetCenter(const AABB& box) noexcept { return (box.min + box.max) * 0.5f; }
+			// Half the size
+			constexpr Vec3 GetExtents(const AABB& box) noexcept { return (box.max - box.min) * 0.5f; }
+			constexpr AABB Union(const AABB& a, const AABB& b) noexcept { return{ ComponentMin(a.min, b.min), ComponentMax(a.max, b.max) }; }
+			constexpr bool Contains(const AABB& box, const Vec3& p) noexcept
+			{
+				return p.x >= box.min.x && p.x <= box.max.x && p.y >= box.min.y && p.y <= box.max.y && p.z >= box.min.z && p.z <= box.max.z;
+			}
+			constexpr bool Intersects(const AABB& a, const AABB& b) noexcept
+			{
+				return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y && b.min.y <= a.max.y && a.min.z <= b.max.z && b.min.z <= a.max.z;
+			}
+
+			// Reference implementation of the operations with a SIMD path
+			namespace Scalar
+			{
+				constexpr Vec4 Add(const Vec4& a, const Vec4& b) noexcept { return{ a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w }; }
+				constexpr Vec4 Subtract(const Vec4& a, const Vec4& b) noexcept { return{ a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w }; }
+				constexpr Vec4 Multiply(const Vec4& a, const Vec4& b) noexcept { return{ a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w }; }
+				constexpr Vec4 Multiply(const Vec4& v, float f) noexcept { return{ v.x * f, v.y * f, v.z * f, v.w * f }; }
+				constexpr float Dot(const Vec4& a, const Vec4& b) noexcept { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+
+				constexpr Vec4 Multiply(const Mat4& m, const Vec4& v) noexcept
+				{
+					return Add(Add(Multiply(m.aColumns[0], v.x), Multiply(m.aColumns[1], v.y)), Add(Multiply(m.aColumns[2], v.z), Multiply(m.aColumns[3], v.w)));
+				}
+
+				constexpr Mat4 Multiply(const Mat4& a, const Mat4& b) noexcept
+				{
+					return{ { Multiply(a, b.aColumns[0]), Multiply(a, b.aColumns[1]), Multiply(a, b.aColumns[2]), Multiply(a, b.aColumns[3]) } };
+				}
+
+				constexpr Mat4 Transpose(const Mat4& m) noexcept
+				{
+					return{ {
+						{ m.aColumns[0].x, m.aColumns[1].x, m.aColumns[2].x, m.aColumns[3].x },
+						{ m.aColumns[0].y, m.aColumns[1].y, m.aColumns[2].y, m.aColumns[3].y },
+						{ m.aColumns[0].z, m.aColumns[1].z, m.aColumns[2].z, m.aColumns[3].z },
+						{ m.aColumns[0].w, m.aColumns[1].w, m.aColumns[2].w, m.aColumns[3].w } } };
+				}
+
+				// a then b is b * a
+				constexpr Quat Multiply(const Quat& a, const Quat& b) noexcept
+				{
+					return{
+						a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+						a.w * b.y + a.y * b.w + a.z * b.x - a.x * b.z,
+						a.w * b.z + a.z * b.w + a.x * b.y - a.y * b.x,
+						a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z };
+				}
+
+				constexpr float Abs(float f) noexcept { return f < 0.0f ? -f : f; }
+
+				// Box around the transformed box: the center is transformed as a point, and the extents by the absolute
+				// values of the rotation and scale
+				constexpr AABB Transform(const AABB& box, const Mat4& m) noexcept
+				{
+					auto const center = GetCenter(box);
+					auto const extents = GetExtents(box);
+					Vec3 const newCenter{
+						m.aColumns[0].x * center.x + m.aColumns[1].x * center.y + m.aColumns[2].x * center.z + m.aColumns[3].x,
+						m.aColumns[0].y * center.x + m.aColumns[1].y * center.y + m.aColumns[2].y * center.z + m.aColumns[3].y,
+						m.aColumns[0].z * center.x + m.aColumns[1].z * center.y + m.aColumns[2].z * center.z + m.aColumns[3].z };
+					Vec3 const newExtents{
+						Abs(m.aColumns[0].x) * extents.x + Abs(m.aColumns[1].x) * extents.y + Abs(m.aColumns[2].x) * extents.z,
+						Abs(m.aColumns[0].y) * extents.x + Abs(m.aColumns[1].y) * extents.y + Abs(m.aColumns[2].y) * extents.z,
+						Abs(m.aColumns[0].z) * extents.x + Abs(m.aColumns[1].z) * extents.y + Abs(m.aColumns[2].z) * extents.z };
+					return{ newCenter - newExtents, newCenter + newExtents };
+				}
+			}
+
+#if HE_MATH_SIMD >= HE_MATH_SSE2
+			namespace Private
+			{
+				inline __m128 Load(const Vec4& v) noexcept { return _mm_loadu_ps(&v.x); }
+				inline __m128 Load(const Quat& q) noexcept { return _mm_loadu_ps(&q.x); }
+
+				inline Vec4 StoreVec4(__m128 v) noexcept
+				{
+					Vec4 result;
+					_mm_storeu_ps(&result.x, v);
+					return result;
+				}
+
+				inline Quat StoreQuat(__m128 v) noexcept
+				{
+					Quat result;
+					_mm_storeu_ps(&result.x, v);
+					return result;
+				}
+
+				template<int I>
+				__m128 Splat(__m128 v) noexcept
+				{
+					return _mm_shuffle_ps(v, v, _MM_SHUFFLE(I, I, I, I));
+				}
+
+				// Form: MultiplyAdd(a, b, c) -> a * b + c
+				inline __m128 MultiplyAdd(__m128 a, __m128 b, __m128 c) noexcept
+				{
+#if HE_MATH_SIMD >= HE_MATH_AVX2
+					return _mm_fmadd_ps(a, b, c);
+#else
+					return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+				}
+
+				// The columns of m weighted by the elements of v
+				inline __m128 Multiply(const Mat4& m, __m128 v) noexcept
+				{
+					auto const xy = MultiplyAdd(Load(m.aColumns[1]), Splat<1>(v), _mm_mul_ps(Load(m.aColumns[0]), Splat<0>(v)));
+					auto const zw = MultiplyAdd(Load(m.aColumns[3]), Splat<3>(v), _mm_mul_ps(Load(m.aColumns[2]), Splat<2>(v)));
+					return _mm_add_ps(xy, zw);
+				}
+			}
+#endif
+
+			// Vec4
+
+			inline Vec4 operator+(const Vec4& a, const Vec4& b) noexcept
+			{
+#if HE_MATH_SIMD >= HE_MATH_SSE2
+				return Private::StoreVec4(_mm_add_ps(Private::Load(a), Private::Load(b)));
+#else
+				return Scalar::Add(a, b);
+#endif
+			}
+
+			inline Vec4 operator-(const Vec4& a, const Vec4& b) noexcept
+			{
+#if HE_MATH_SIMD >= HE_MATH_SSE2
+				return Private::StoreVec4(_mm_sub_ps(Private::Load(a), Private::Load(b)));
+#else
+				return Scalar::Subtract(a, b);
+#endif
+			}
+
+			constexpr Vec4 operator-(const Vec4& v) noexcept { return{ -v.x, -v.y, -v.z, -v.w }; }
+
+			inline Vec4 operator*(const Vec4& a, const Vec4& b) noexcept
+			{
+#if HE_MATH_SIMD >= HE_MATH_SSE2
+				return Private::StoreVec4(_mm_mul_ps(Private::Load(a), Private::Load(b)));
+#else
+				return Scalar::Multiply(a, b);
+#endif
+			}
+
+			inline Vec4 operator*(const Vec4& v, float f) noexcept
+			{
+#if HE_MATH_SIMD >= HE_MATH_SSE2
+				return Private::StoreVec4(_mm_mul_ps(Private::Load(v), _mm_set1_ps(f)));
+#else
+				return Scalar::Multiply(v, f);
+#endif
+			}
+
+			inline Vec4 operator*(float f, const Vec4& v) noexcept { return v * f; }
+
+			inline float Dot(const Vec4& a, const Vec4& b) noexcept
+			{
+#if HE_MATH_SIMD >= HE_MATH_SSE4
+				return _mm_cvtss_f32(_mm_dp_ps(Private::Load(a), Private::Load(b), 0xF1));
+#elif HE_MATH_SIMD >= HE_MATH_SSE2
+				auto const product = _mm_mul_ps(Private::Load(a), Private::Load(b));
+				auto const pairs = _mm_add_ps(product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1)));
+				return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_movehl_ps(pairs, pairs)));
+#else
+				return Scalar::Dot(a, b);
+#endif
+			}
+
+			inline float Length(const Vec4& v) noexcept { return std::sqrt(Dot(v, v)); }
+			inline Vec4 Normalize(const Vec4& v) noexcept { return v * (1.0f / Length(v)); }
+
+			// Mat4
+
+			inline Vec4 operator*(const Mat4& m, const Vec4& v) noexcept
+			{
+#if HE_MATH_SIMD >= HE_MATH_SSE2
+				return Private::StoreVec4(Private::Multiply(m, Private::Load(v)));
+#else
+				return Scalar::Multiply(m, v);
+#endif
+			}
+
+			inline Mat4 operator*(const Mat4& a, const Mat4& b) noexcept
+			{
+#if HE_MATH_SIMD >= HE_MATH_AVX2
+				// Two columns of the result at a time, each in a half of the registers
+				auto const a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.aColumns[0]));
+				auto const a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.aColumns[1]));
+				auto const a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.aColumns[2]));
+				auto const a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.aColumns[3]));
+				Mat4 result;
+				for (int nColumn = 0; nColumn < 4; nColumn += 2)
+				{
+					auto const columns = _mm256_loadu_ps(&b.aColumns[nColumn].x);
+					auto const xy = _mm256_fmadd_ps(a1, _mm256_shuffle_ps(columns, columns, 0x55), _mm256_mul_ps(a0, _mm256_shuffle_ps(columns, columns, 0x00)));
+					auto const zw = _mm256_fmadd_ps(a3, _mm256_shuffle_ps(columns, columns, 0xFF), _mm256_mul_ps(a2, _mm256_shuffle_ps(columns, columns, 0xAA)));
+					_mm256_storeu_ps(&result.aColumns[nColumn].x, _mm256_add_ps(xy, zw));
+				}
+				return result;
+#elif HE_MATH_SIMD >= HE_MATH_SSE2
+				Mat4 result;
+				for (int nColumn = 0; nColumn < 4; ++nColumn)
+				{
+					_mm_storeu_ps(&result.aColumns[nColumn].x, Private::Multiply(a, Private::Load(b.aColumns[nColumn])));
+				}
+				return result;
+#else
+				return Scalar::Multiply(a, b);
+#endif
+			}
+
+			inline Mat4 Transpose(const Mat4& m) noexcept
+			{
+#if HE_MATH_SIMD >= HE_MATH_SSE2
+				auto c0 = Private::Load(m.aColumns[0]);
+				auto c1 = Private::Load(m.aColumns[1]);
+				auto c2 = Private::Load(m.aColumns[2]);
+				auto c3 = Private::Load(m.aColumns[3]);
+				_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+				return{ { Private::StoreVec4(c0), Private::StoreVec4(c1), Private::StoreVec4(c2), Private::StoreVec4(c3) } };
+#else
+				return Scalar::Transpose(m);
+#endif
+			}
+
+			inline Vec3 TransformPoint(const Mat4& m, const Vec3& p) noexcept
+			{
+				auto const v = m * Vec4{ p.x, p.y, p.z, 1.0f };
+				return{ v.x, v.y, v.z };
+			}
+
+			inline Vec3 TransformDirection(const Mat4& m, const Vec3& d) noexcept
+			{
+				auto const v = m * Vec4{ d.x, d.y, d.z, 0.0f };
+				return{ v.x, v.y, v.z };
+			}
+
+			// Quat
+
+			inline Quat operator*(const Quat& a, const Quat& b) noexcept
+			{
+#if HE_MATH_SIMD >= HE_MATH_SSE2
+				auto const va = Private::Load(a);
+				auto const vb = Private::Load(b);
+				// The sign of the w of the second and third terms
+				auto const sign = _mm_set_ps(-0.0f, 0.0f, 0.0f, 0.0f);
+				auto const first = _mm_mul_ps(Private::Splat<3>(va), vb);
+				auto const second = _mm_mul_ps(_mm_shuffle_ps(va, va, _MM_SHUFFLE(0, 2, 1, 0)), _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(0, 3, 3, 3)));
+				auto const third = _mm_mul_ps(_mm_shuffle_ps(va, va, _MM_SHUFFLE(1, 0, 2, 1)), _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(1, 1, 0, 2)));
+				auto const fourth = _mm_mul_ps(_mm_shuffle_ps(va, va, _MM_SHUFFLE(2, 1, 0, 2)), _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 0, 2, 1)));
+				auto const result = _mm_sub_ps(_mm_add_ps(first, _mm_xor_ps(_mm_add_ps(second, third), sign)), fourth);
+				return Private::StoreQuat(result);
+#else
+				return Scalar::Multiply(a, b);
+#endif
+			}
+
+			constexpr Quat Conjugate(const Quat& q) noexcept { return{ -q.x, -q.y, -q.z, q.w }; }
+
+			inline Quat Normalize(const Quat& q) noexcept
+			{
+				auto const fInverse = 1.0f / std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+				return{ q.x * fInverse, q.y * fInverse, q.z * fInverse, q.w * fInverse };
+			}
+
+			constexpr Vec3 Rotate(const Quat& q, const Vec3& v) noexcept
+			{
+				// v + w * t + u x t, with t = 2 * u x v
+				Vec3 const u{ q.x, q.y, q.z };
+				auto const t = Cross(u, v) * 2.0f;
+				return v + t * q.w + Cross(u, t);
+			}
+
+			// Spherical interpolation, along the shortest arc
+			inline Quat Slerp(const Quat& a, const Quat& b, float t) noexcept
+			{
+				auto fCos = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+				auto const fSign = fCos < 0.0f ? -1.0f : 1.0f;
+				fCos *= fSign;
+
+				float fWeightA = 1.0f - t;
+				float fWeightB = t;
+				// Close enough to interpolate linearly, and to avoid dividing by a sine of almost zero
+				if (fCos < 0.9995f)
+				{
+					auto const fAngle = std::acos(fCos);
+					auto const fInverseSin = 1.0f / std::sin(fAngle);
+					fWeightA = std::sin(fWeightA * fAngle) * fInverseSin;
+					fWeightB = std::sin(fWeightB * fAngle) * fInverseSin;
+				}
+				fWeightB *= fSign;
+				return Normalize(Quat{ a.x * fWeightA + b.x * fWeightB, a.y * fWeightA + b.y * fWeightB, a.z * fWeightA + b.z * fWeightB, a.w * fWeightA + b.w * fWeightB });
+			}
+
+			// AABB
+
+			inline AABB Transform(const AABB& box, const Mat4& m) noexcept
+			{
+#if HE_MATH_SIMD >= HE_MATH_SSE2
+				auto const center = GetCenter(box);
+				auto const extents = GetExtents(box);
+				auto const absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+				auto const c0 = Private::Load(m.aColumns[0]);
+				auto const c1 = Private::Load(m.aColumns[1]);
+				auto const c2 = Private::Load(m.aColumns[2]);
+
+				auto const newCenter = Private::MultiplyAdd(c2, _mm_set1_ps(center.z),
+					Private::MultiplyAdd(c1, _mm_set1_ps(center.y), Private::MultiplyAdd(c0, _mm_set1_ps(center.x), Private::Load(m.aColumns[3]))));
+				auto const newExtents = Private::MultiplyAdd(_mm_and_ps(c2, absMask), _mm_set1_ps(extents.z),
+					Private::MultiplyAdd(_mm_and_ps(c1, absMask), _mm_set1_ps(extents.y), _mm_mul_ps(_mm_and_ps(c0, absMask), _mm_set1_ps(extents.x))));
+
+				auto const min = Private::StoreVec4(_mm_sub_ps(newCenter, newExtents));
+				auto const max = Private::StoreVec4(_mm_add_ps(newCenter, newExtents));
+				return{ { min.x, min.y, min.z }, { max.x, max.y, max.z } };
+#else
+				return Scalar::Transform(box, m);
+#endif
+			}
 		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,384 @@
+#include "HE_Metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <new>
+
+#include "HE_Allocator.h"
+#include "HE_ConcurrentQueue.h"
+#include "HE_Math.h"
+#include "HE_String.h"
+
+namespace HE
+{
+	namespace
+	{
+		constexpr size_t SubBucketCount = size_t{ 1 } << HistogramSnapshot::SubBucketBits;
+		constexpr size_t NoSlot = static_cast<size_t>(-1);
+
+		unsigned FloorLog2(std::uint64_t n) noexcept
+		{
+			unsigned nLog = 0;
+			for (unsigned nShift = 32; nShift != 0; nShift /= 2)
+			{
+				if (n >> nShift)
+				{
+					n >>= nShift;
+					nLog += nShift;
+				}
+			}
+			return nLog;
+		}
+
+		struct SlotRegistry
+		{
+			SlotRegistry()
+			{
+				// Giving a slot back never allocates
+				cFree.reserve(Private::MetricThreadSlots);
+			}
+
+			std::mutex mutSlots;
+			std::vector<size_t> cFree;
+			size_t nNext{ 0 };
+		};
+
+		SlotRegistry& GetSlotRegistry()
+		{
+			static SlotRegistry s_registry;
+			return s_registry;
+		}
+
+		thread_local size_t t_nSlot = NoSlot;
+
+		// Gives the slot of the thread back when the thread ends
+		struct SlotRelease
+		{
+			~SlotRelease()
+			{
+				if (t_nSlot >= Private::MetricThreadSlots) return;
+
+				auto& registry = GetSlotRegistry();
+				std::lock_guard<std::mutex> lock{ registry.mutSlots };
+				registry.cFree.push_back(t_nSlot);
+				// Updates from the destructors of later thread locals go to the shared slot
+				t_nSlot = Private::MetricThreadSlots;
+			}
+		};
+		thread_local SlotRelease t_release;
+
+		size_t AcquireSlot() noexcept
+		{
+			auto& registry = GetSlotRegistry();
+			{
+				std::lock_guard<std::mutex> lock{ registry.mutSlots };
+				if (!registry.cFree.empty())
+				{
+					t_nSlot = registry.cFree.back();
+					registry.cFree.pop_back();
+				}
+				else if (registry.nNext < Private::MetricThreadSlots)
+				{
+					t_nSlot = registry.nNext++;
+				}
+				else
+				{
+					t_nSlot = Private::MetricThreadSlots;
+				}
+			}
+
+			// Constructs it, so that it is destroyed with the thread
+			static_cast<void>(&t_release);
+			return t_nSlot;
+		}
+
+		std::string FormatMetricValue(double fValue, MetricUnit eUnit)
+		{
+			switch (eUnit)
+			{
+			case MetricUnit::Nanoseconds: return Format("{_:.3}ms", fValue / 1e6);
+			case MetricUnit::Bytes: return Format("{_:.1}KiB", fValue / 1024.0);
+			default: return Format("{_:.0}", fValue);
+			}
+		}
+
+		std::string FormatMetricValue(std::uint64_t nValue, MetricUnit eUnit)
+		{
+			return eUnit == MetricUnit::Count ? Format("{_}", nValue) : FormatMetricValue(static_cast<double>(nValue), eUnit);
+		}
+	}
+
+	constexpr unsigned HistogramSnapshot::SubBucketBits;
+	constexpr unsigned HistogramSnapshot::MaxValueBits;
+	constexpr size_t HistogramSnapshot::BucketCount;
+
+	size_t HistogramSnapshot::GetBucket(std::uint64_t n) noexcept
+	{
+		if (n < 2 * SubBucketCount) return static_cast<size_t>(n);
+
+		// Sub-buckets of width 2^nShift
+		auto const nShift = FloorLog2(n) - SubBucketBits;
+		auto const nBucket = (size_t{ nShift } << SubBucketBits) + static_cast<size_t>(n >> nShift);
+		return std::min(nBucket, BucketCount - 1);
+	}
+
+	std::uint64_t HistogramSnapshot::GetBucketLow(size_t nBucket) noexcept
+	{
+		if (nBucket < 2 * SubBucketCount) return nBucket;
+
+		auto const nShift = (nBucket >> SubBucketBits) - 1;
+		return std::uint64_t{ nBucket - (nShift << SubBucketBits) } << nShift;
+	}
+
+	std::uint64_t HistogramSnapshot::GetBucketHigh(size_t nBucket) noexcept
+	{
+		if (nBucket < 2 * SubBucketCount) return nBucket;
+
+		auto const nShift = (nBucket >> SubBucketBits) - 1;
+		return GetBucketLow(nBucket) + (std::uint64_t{ 1 } << nShift) - 1;
+	}
+
+	std::uint64_t HistogramSnapshot::GetPercentile(double fFraction) const noexcept
+	{
+		if (nCount == 0) return 0;
+
+		auto const fRank = std::ceil(fFraction * static_cast<double>(nCount));
+		auto const nRank = fRank < 1.0 ? std::uint64_t{ 1 } : std::min(static_cast<std::uint64_t>(fRank), nCount);
+		std::uint64_t nSeen = 0;
+		for (size_t i = 0; i < cBuckets.size(); ++i)
+		{
+			nSeen += cBuckets[i];
+			if (nSeen >= nRank)
+			{
+				// The highest value of the bucket, as HdrHistogram: percentiles are never underestimated
+				return std::max(nMin, std::min(GetBucketHigh(i), nMax));
+			}
+		}
+		return nMax;
+	}
+
+	HistogramSnapshot HistogramSnapshot::Since(const HistogramSnapshot& earlier) const
+	{
+		if (earlier.cBuckets.empty()) return *this;
+
+		HistogramSnapshot result;
+		result.eUnit = eUnit;
+		result.nCount = nCount - earlier.nCount;
+		result.nSum = nSum - earlier.nSum;
+		result.cBuckets.resize(cBuckets.size());
+		bool bFirst = true;
+		for (size_t i = 0; i < cBuckets.size(); ++i)
+		{
+			result.cBuckets[i] = cBuckets[i] - earlier.cBuckets[i];
+			if (result.cBuckets[i] == 0) continue;
+
+			if (bFirst) result.nMin = std::max(nMin, GetBucketLow(i));
+			result.nMax = std::min(nMax, GetBucketHigh(i));
+			bFirst = false;
+		}
+		return result;
+	}
+
+	MetricsSnapshot MetricsSnapshot::Since(const MetricsSnapshot& earlier) const
+	{
+		auto result = *this;
+		for (auto& counter : result.cCounters)
+		{
+			auto const it = earlier.cCounters.find(counter.first);
+			if (it != earlier.cCounters.end()) counter.second -= it->second;
+		}
+		for (auto& histogram : result.cHistograms)
+		{
+			auto const it = earlier.cHistograms.find(histogram.first);
+			if (it != earlier.cHistograms.end()) histogram.second = histogram.second.Since(it->second);
+		}
+		return result;
+	}
+
+	std::string to_string(const MetricsSnapshot& snapshot)
+	{
+		std::vector<std::string> cLines;
+		for (auto const& counter : snapshot.cCounters)
+		{
+			cLines.push_back(Format("{_}: {_}", counter.first, counter.second));
+		}
+		for (auto const& gauge : snapshot.cGauges)
+		{
+			cLines.push_back(Format("{_}: {_}", gauge.first, FormatMetricValue(static_cast<double>(gauge.second.nValue), gauge.second.eUnit)));
+		}
+		for (auto const& entry : snapshot.cHistograms)
+		{
+			auto const& histogram = entry.second;
+			auto const eUnit = histogram.eUnit;
+			cLines.push_back(Format("{_}: {_} values, mean {_}, p50 {_}, p99 {_}, p999 {_}, max {_}",
+				entry.first, histogram.nCount, FormatMetricValue(histogram.GetMean(), eUnit),
+				FormatMetricValue(histogram.GetPercentile(0.5), eUnit),
+				FormatMetricValue(histogram.GetPercentile(0.99), eUnit),
+				FormatMetricValue(histogram.GetPercentile(0.999), eUnit),
+				FormatMetricValue(histogram.nMax, eUnit)));
+		}
+
+		std::string s;
+		for (auto const& sLine : cLines)
+		{
+			if (!s.empty()) s += '\n';
+			s += sLine;
+		}
+		return s;
+	}
+
+	namespace Private
+	{
+		// Whole cache lines, so that the shards of different threads don't share lines
+		template<class Shard>
+		constexpr size_t GetShardSize() noexcept
+		{
+			return Math::RoundUpToMultipleOf(sizeof(Shard), CacheLineSize);
+		}
+
+		size_t GetMetricThreadSlot() noexcept
+		{
+			return t_nSlot != NoSlot ? t_nSlot : AcquireSlot();
+		}
+
+		template<class Shard>
+		MetricShards<Shard>::~MetricShards()
+		{
+			for (auto& pShard : m_apShards)
+			{
+				if (auto const p = pShard.load(std::memory_order_relaxed))
+				{
+					p->~Shard();
+					AlignedMallocAllocator::it.deallocate({ p, GetShardSize<Shard>() });
+				}
+			}
+		}
+
+		template<class Shard>
+		Shard* MetricShards<Shard>::Create(std::atomic<Shard*>& pShard) noexcept
+		{
+			auto const b = AlignedMallocAllocator::it.allocate(GetShardSize<Shard>(), CacheLineSize);
+			if (!b.ptr) return nullptr;
+			auto const pNew = new (b.ptr) Shard;
+
+			// The threads past the slots race to create the shared one
+			Shard* pExpected = nullptr;
+			if (!pShard.compare_exchange_strong(pExpected, pNew, std::memory_order_acq_rel, std::memory_order_acquire))
+			{
+				pNew->~Shard();
+				AlignedMallocAllocator::it.deallocate(b);
+				return pExpected;
+			}
+			return pNew;
+		}
+
+		template class MetricShards<CounterShard>;
+		template class MetricShards<HistogramShard>;
+	}
+
+	void Histogram::Record(std::uint64_t n) noexcept
+	{
+		auto const pShard = m_shards.GetLocal();
+		if (pShard == nullptr) return;
+
+		pShard->anBuckets[HistogramSnapshot::GetBucket(n)].fetch_add(1, std::memory_order_relaxed);
+		pShard->nSum.fetch_add(n, std::memory_order_relaxed);
+		auto nMin = pShard->nMin.load(std::memory_order_relaxed);
+		while (n < nMin && !pShard->nMin.compare_exchange_weak(nMin, n, std::memory_order_relaxed)) { }
+		auto nMax = pShard->nMax.load(std::memory_order_relaxed);
+		while (n > nMax && !pShard->nMax.compare_exchange_weak(nMax, n, std::memory_order_relaxed)) { }
+		pShard->bDirty.store(true, std::memory_order_release);
+	}
+
+	bool Histogram::Merge(HistogramSnapshot& snapshot) const
+	{
+		bool bDirty = false;
+		m_shards.ForEach([&bDirty](Private::HistogramShard& shard) {
+			bDirty |= shard.bDirty.exchange(false, std::memory_order_acquire);
+		});
+		if (!bDirty && !snapshot.cBuckets.empty()) return false;
+
+		// From scratch rather than by deltas: an update racing with the merge is counted once, by a later merge
+		snapshot.cBuckets.assign(HistogramSnapshot::BucketCount, 0);
+		snapshot.nSum = 0;
+		snapshot.nMin = ~std::uint64_t{ 0 };
+		snapshot.nMax = 0;
+		m_shards.ForEach([&snapshot](const Private::HistogramShard& shard) {
+			for (size_t i = 0; i < HistogramSnapshot::BucketCount; ++i)
+			{
+				snapshot.cBuckets[i] += shard.anBuckets[i].load(std::memory_order_relaxed);
+			}
+			snapshot.nSum += shard.nSum.load(std::memory_order_relaxed);
+			snapshot.nMin = std::min(snapshot.nMin, shard.nMin.load(std::memory_order_relaxed));
+			snapshot.nMax = std::max(snapshot.nMax, shard.nMax.load(std::memory_order_relaxed));
+		});
+
+		snapshot.nCount = 0;
+		for (auto const nBucket : snapshot.cBuckets) snapshot.nCount += nBucket;
+		if (snapshot.nCount == 0) snapshot.nMin = 0;
+		return true;
+	}
+
+	Counter& MetricsRegistry::GetCounter(const std::string& sName)
+	{
+		std::lock_guard<std::mutex> lock{ m_mutMetrics };
+		auto& pCounter = m_cCounters[sName];
+		if (!pCounter)
+		{
+			pCounter = std::make_unique<Counter>(m_eSharding);
+			m_snapshot.cCounters[sName] = 0;
+		}
+		return *pCounter;
+	}
+
+	Gauge& MetricsRegistry::GetGauge(const std::string& sName, MetricUnit eUnit)
+	{
+		std::lock_guard<std::mutex> lock{ m_mutMetrics };
+		auto& pGauge = m_cGauges[sName];
+		if (!pGauge)
+		{
+			pGauge = std::make_unique<Gauge>(eUnit);
+			m_snapshot.cGauges[sName].eUnit = eUnit;
+		}
+		return *pGauge;
+	}
+
+	Histogram& MetricsRegistry::GetHistogram(const std::string& sName, MetricUnit eUnit)
+	{
+		std::lock_guard<std::mutex> lock{ m_mutMetrics };
+		auto& pHistogram = m_cHistograms[sName];
+		if (!pHistogram)
+		{
+			pHistogram = std::make_unique<Histogram>(eUnit, m_eSharding);
+			m_snapshot.cHistograms[sName].eUnit = eUnit;
+		}
+		return *pHistogram;
+	}
+
+	void MetricsRegistry::Merge()
+	{
+		std::lock_guard<std::mutex> lock{ m_mutMetrics };
+		for (auto const& counter : m_cCounters)
+		{
+			std::uint64_t nValue = 0;
+			counter.second->m_shards.ForEach([&nValue](const Private::CounterShard& shard) {
+				nValue += shard.nValue.load(std::memory_order_relaxed);
+			});
+			m_snapshot.cCounters[counter.first] = nValue;
+		}
+		for (auto const& gauge : m_cGauges)
+		{
+			m_snapshot.cGauges[gauge.first].nValue = gauge.second->Get();
+		}
+		for (auto const& histogram : m_cHistograms)
+		{
+			histogram.second->Merge(m_snapshot.cHistograms[histogram.first]);
+		}
+	}
+
+	MetricsSnapshot MetricsRegistry::GetSnapshot() const
+	{
+		std::lock_guard<std::mutex> lock{ m_mutMetrics };
+		return m_snapshot;
+	}
+}
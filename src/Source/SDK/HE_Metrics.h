@@ -0,0 +1,239 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace HE
+{
+	// How the values of a metric are printed
+	enum class MetricUnit { Count, Nanoseconds, Bytes };
+
+	// Where the counters and histograms of a registry are updated
+	enum class MetricSharding
+	{
+		// In a shard per thread, so that the threads never contend: a histogram takes about 9KB per thread updating it
+		PerThread,
+		// In a single shard, for registries mostly updated by one thread at a time, ex: one per session of a server
+		Single,
+	};
+
+	// The values recorded by a Histogram, merged over the threads
+	// Buckets are log-linear, as in HdrHistogram: each power of two is split in 32 linear sub-buckets, so that
+	// a value is known within 1/32 of itself, from 1 to 2^40 (18 minutes in nanoseconds)
+	struct HistogramSnapshot
+	{
+		static constexpr unsigned SubBucketBits = 5;
+		static constexpr unsigned MaxValueBits = 40;
+		static constexpr size_t BucketCount = size_t{ MaxValueBits - SubBucketBits + 1 } << SubBucketBits;
+
+		// Values past the range go to the last bucket
+		static size_t GetBucket(std::uint64_t n) noexcept;
+		static std::uint64_t GetBucketLow(size_t nBucket) noexcept;
+		static std::uint64_t GetBucketHigh(size_t nBucket) noexcept;
+
+		// Form: GetPercentile(0.99) -> value that 99% of the values are at or below, within its bucket
+		std::uint64_t GetPercentile(double fFraction) const noexcept;
+		double GetMean() const noexcept { return nCount != 0 ? static_cast<double>(nSum) / nCount : 0.0; }
+
+		// The values recorded after earlier, a snapshot of the same histogram. The min and max are bucket bounds
+		HistogramSnapshot Since(const HistogramSnapshot& earlier) const;
+
+		MetricUnit eUnit{ MetricUnit::Count };
+		std::uint64_t nCount{ 0 };
+		std::uint64_t nSum{ 0 };
+		std::uint64_t nMin{ 0 };
+		std::uint64_t nMax{ 0 };
+		// BucketCount of them, or none if nothing was merged yet
+		std::vector<std::uint64_t> cBuckets;
+	};
+
+	struct GaugeSnapshot
+	{
+		MetricUnit eUnit{ MetricUnit::Count };
+		std::int64_t nValue{ 0 };
+	};
+
+	// The metrics of a MetricsRegistry as of its last Merge, by name
+	struct MetricsSnapshot
+	{
+		// Counters and histograms count from the earlier snapshot, gauges keep their current value
+		MetricsSnapshot Since(const MetricsSnapshot& earlier) const;
+
+		std::map<std::string, std::uint64_t> cCounters;
+		std::map<std::string, GaugeSnapshot> cGauges;
+		std::map<std::string, HistogramSnapshot> cHistograms;
+	};
+
+	// One line per metric, with the p50, p99 and p999 of the histograms
+	std::string to_string(const MetricsSnapshot& snapshot);
+
+	namespace Private
+	{
+		// Threads get a slot of their own in each metric they update, given back when they end. The threads past
+		// the slots share the last one
+		constexpr size_t MetricThreadSlots = 64;
+
+		size_t GetMetricThreadSlot() noexcept;
+
+		// Shards are created by the first update of each slot, and live as long as the metric
+		template<class Shard>
+		class MetricShards
+		{
+		public:
+			explicit MetricShards(MetricSharding eSharding) noexcept
+				: m_bPerThread(eSharding == MetricSharding::PerThread)
+			{
+				for (auto& pShard : m_apShards) pShard.store(nullptr, std::memory_order_relaxed);
+			}
+			MetricShards(const MetricShards&) = delete;
+			void operator=(const MetricShards&) = delete;
+			~MetricShards();
+
+			// nullptr if the shard could not be allocated
+			Shard* GetLocal() noexcept
+			{
+				auto& pShard = m_apShards[m_bPerThread ? GetMetricThreadSlot() : 0];
+				auto const p = pShard.load(std::memory_order_acquire);
+				return p != nullptr ? p : Create(pShard);
+			}
+
+			template<class F>
+			void ForEach(F&& f) const
+			{
+				for (auto const& pShard : m_apShards)
+				{
+					if (auto const p = pShard.load(std::memory_order_acquire)) f(*p);
+				}
+			}
+
+		private:
+			static Shard* Create(std::atomic<Shard*>& pShard) noexcept;
+
+			bool const m_bPerThread;
+			std::array<std::atomic<Shard*>, MetricThreadSlots + 1> m_apShards;
+		};
+
+		struct CounterShard
+		{
+			std::atomic<std::uint64_t> nValue{ 0 };
+		};
+
+		struct HistogramShard
+		{
+			std::array<std::atomic<std::uint64_t>, HistogramSnapshot::BucketCount> anBuckets;
+			std::atomic<std::uint64_t> nSum{ 0 };
+			std::atomic<std::uint64_t> nMin{ ~std::uint64_t{ 0 } };
+			std::atomic<std::uint64_t> nMax{ 0 };
+			// Set by the updates, cleared by the merges, so that only the histograms updated since get merged
+			std::atomic<bool> bDirty{ false };
+
+			HistogramShard() noexcept
+			{
+				for (auto& nBucket : anBuckets) nBucket.store(0, std::memory_order_relaxed);
+			}
+		};
+	}
+
+	// Thread-safe. A total that only goes up, ex: frames, bytes sent
+	class Counter
+	{
+	public:
+		explicit Counter(MetricSharding eSharding = MetricSharding::PerThread) noexcept : m_shards(eSharding) { }
+
+		void Add(std::uint64_t n = 1) noexcept
+		{
+			if (auto const pShard = m_shards.GetLocal()) pShard->nValue.fetch_add(n, std::memory_order_relaxed);
+		}
+
+	private:
+		friend class MetricsRegistry;
+
+		Private::MetricShards<Private::CounterShard> m_shards;
+	};
+
+	// Thread-safe. A value sampled as it is, ex: queue depth, memory in use
+	class Gauge
+	{
+	public:
+		explicit Gauge(MetricUnit eUnit) noexcept : m_eUnit(eUnit) { }
+
+		void Set(std::int64_t n) noexcept { m_nValue.store(n, std::memory_order_relaxed); }
+		void Add(std::int64_t n) noexcept { m_nValue.fetch_add(n, std::memory_order_relaxed); }
+		std::int64_t Get() const noexcept { return m_nValue.load(std::memory_order_relaxed); }
+
+	private:
+		friend class MetricsRegistry;
+
+		MetricUnit const m_eUnit;
+		std::atomic<std::int64_t> m_nValue{ 0 };
+	};
+
+	// Thread-safe. The distribution of a value, ex: frame times, for its percentiles
+	// Recording costs a few uncontended atomic additions on the shard of the thread
+	class Histogram
+	{
+	public:
+		explicit Histogram(MetricUnit eUnit, MetricSharding eSharding = MetricSharding::PerThread) noexcept
+			: m_eUnit(eUnit),
+			m_shards(eSharding)
+		{
+
+		}
+
+		void Record(std::uint64_t n) noexcept;
+
+		template<class Rep, class Period>
+		void Record(std::chrono::duration<Rep, Period> t) noexcept
+		{
+			auto const nNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+			Record(static_cast<std::uint64_t>(nNanoseconds > 0 ? nNanoseconds : 0));
+		}
+
+	private:
+		friend class MetricsRegistry;
+
+		// Form: Merge(snapshot) -> whether the shards changed since the last merge
+		bool Merge(HistogramSnapshot& snapshot) const;
+
+		MetricUnit const m_eUnit;
+		Private::MetricShards<Private::HistogramShard> m_shards;
+	};
+
+	// Metrics registered by name, updated by any thread through per-thread shards, and merged into a snapshot
+	// by Merge, ex: once per frame. Readers only see the merged snapshot, never the shards
+	// Thread-safe. The metrics live as long as the registry: keep the references to update them cheaply
+	class MetricsRegistry
+	{
+	public:
+		explicit MetricsRegistry(MetricSharding eSharding = MetricSharding::PerThread) noexcept : m_eSharding(eSharding) { }
+		MetricsRegistry(const MetricsRegistry&) = delete;
+		void operator=(const MetricsRegistry&) = delete;
+
+		// Registers the metric on the first call with its name. The unit of later calls is ignored
+		Counter& GetCounter(const std::string& sName);
+		Gauge& GetGauge(const std::string& sName, MetricUnit eUnit = MetricUnit::Count);
+		Histogram& GetHistogram(const std::string& sName, MetricUnit eUnit = MetricUnit::Nanoseconds);
+
+		// Sums the shards of every metric into the snapshot
+		void Merge();
+
+		// Of the last Merge
+		MetricsSnapshot GetSnapshot() const;
+
+	private:
+		MetricSharding const m_eSharding;
+		// Registration and merging
+		mutable std::mutex m_mutMetrics;
+		std::map<std::string, std::unique_ptr<Counter>> m_cCounters;
+		std::map<std::string, std::unique_ptr<Gauge>> m_cGauges;
+		std::map<std::string, std::unique_ptr<Histogram>> m_cHistograms;
+		MetricsSnapshot m_snapshot;
+	};
+}
@@ -6,13 +6,15 @@
 
 	#endif
 #elif __APPLE__
-
+#define PLATFORM_APPLE
+#define PLATFORM_POSIX
 #elif __linux__
-
+#define PLATFORM_LINUX
+#define PLATFORM_POSIX
 #elif __unix__
-
+#define PLATFORM_POSIX
 #elif defined(_POSIX_VERSION)
-
+#define PLATFORM_POSIX
 #else
 #error "Unknown platform"
 #endif
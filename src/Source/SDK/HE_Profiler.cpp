@@ -0,0 +1,434 @@
+#include "HE_Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "HE_Assert.h"
+#include "HE_Binary.h"
+#include "HE_ConcurrentQueue.h"
+#include "HE_Platform.h"
+#include "HE_String.h"
+
+// The time stamp counter is constant-rate on the CPUs of the last decade, and much cheaper to read than the clocks
+#if defined(COMPILER_MSVC) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define HE_PROFILE_RDTSC 1
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define HE_PROFILE_RDTSC 1
+#else
+#define HE_PROFILE_RDTSC 0
+#endif
+
+namespace HE
+{
+	namespace
+	{
+		// Events a thread can hold until the next ProfileHistory::EndFrame
+		constexpr size_t ThreadRingCapacity = 1 << 14;
+	}
+
+	namespace Private
+	{
+		// Ring of events of a thread, held by its open scopes
+		struct ProfileThread
+		{
+			ProfileThread()
+				: events(ThreadRingCapacity)
+			{
+
+			}
+
+			// Pushed by the thread, popped under the lock of the registry
+			SpscQueue<ProfileEvent> events;
+			// Set under the lock of the registry, then owned by the thread
+			std::uint32_t nIndex{ 0 };
+			std::uint32_t nDepth{ 0 };
+			bool bInUse{ true };
+		};
+	}
+
+	namespace
+	{
+		using Private::ProfileThread;
+
+		struct ProfileRegistry
+		{
+			std::mutex mutThreads;
+			// The ring of a thread that ended goes to the next new thread
+			std::vector<std::unique_ptr<ProfileThread>> cThreads;
+			// By thread index: each thread has its own, even when it reuses a ring
+			std::vector<std::string> cThreadNames;
+			std::atomic<std::uint64_t> nDroppedEvents{ 0 };
+
+			std::mutex mutNames;
+			std::unordered_set<std::string> cNames;
+		};
+
+		ProfileRegistry& GetRegistry()
+		{
+			static ProfileRegistry s_registry;
+			return s_registry;
+		}
+
+		thread_local ProfileThread* t_pThread = nullptr;
+
+		// Gives the ring of the thread back when the thread ends
+		struct ThreadRelease
+		{
+			~ThreadRelease()
+			{
+				if (t_pThread == nullptr) return;
+
+				auto& registry = GetRegistry();
+				std::lock_guard<std::mutex> lock{ registry.mutThreads };
+				t_pThread->bInUse = false;
+				t_pThread = nullptr;
+			}
+		};
+		thread_local ThreadRelease t_release;
+
+		ProfileThread& RegisterThread()
+		{
+			auto& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock{ registry.mutThreads };
+			for (auto& pThread : registry.cThreads)
+			{
+				if (!pThread->bInUse)
+				{
+					pThread->bInUse = true;
+					t_pThread = pThread.get();
+					break;
+				}
+			}
+			if (t_pThread == nullptr)
+			{
+				registry.cThreads.push_back(std::make_unique<ProfileThread>());
+				t_pThread = registry.cThreads.back().get();
+			}
+			t_pThread->nIndex = static_cast<std::uint32_t>(registry.cThreadNames.size());
+			registry.cThreadNames.push_back(Format("Thread {_}", t_pThread->nIndex));
+
+			// Constructs it, so that it is destroyed with the thread
+			static_cast<void>(&t_release);
+			return *t_pThread;
+		}
+
+		ProfileThread& GetThread()
+		{
+			return t_pThread != nullptr ? *t_pThread : RegisterThread();
+		}
+
+		// Moves the events of all the threads to cEvents
+		void DrainThreads(std::vector<ProfileEvent>& cEvents)
+		{
+			auto& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock{ registry.mutThreads };
+			ProfileEvent aBatch[256];
+			for (auto& pThread : registry.cThreads)
+			{
+				while (auto const nCount = pThread->events.TryPopBatch(aBatch, 256))
+				{
+					cEvents.insert(cEvents.end(), aBatch, aBatch + nCount);
+				}
+			}
+		}
+
+		struct Calibration
+		{
+			std::uint64_t nTicks;
+			std::chrono::steady_clock::time_point t;
+		};
+		// At the start of the program, so that the interval is long by the time the rate is needed
+		Calibration const s_calibration{ ReadProfileTicks(), std::chrono::steady_clock::now() };
+
+		void WriteJsonString(std::ostream& stream, const std::string& s)
+		{
+			stream << '"';
+			for (auto const c : s)
+			{
+				switch (c)
+				{
+				case '"': stream << "\\\""; break;
+				case '\\': stream << "\\\\"; break;
+				case '\n': stream << "\\n"; break;
+				case '\t': stream << "\\t"; break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20) stream << CStringFormat("\\u%04x", static_cast<unsigned>(c));
+					else stream << c;
+				}
+			}
+			stream << '"';
+		}
+
+		// Binary form: LEB128 integers, and strings as their size then their characters
+		constexpr char BinaryMagic[4] = { 'H', 'E', 'P', 'F' };
+		constexpr std::uint64_t BinaryVersion = 1;
+
+		std::uint32_t ReadIndex(BinaryStreamReader& reader, size_t nEnd)
+		{
+			auto const n = reader.ReadVarint();
+			if (n >= nEnd) reader.ThrowInvalid("index out of range");
+			return static_cast<std::uint32_t>(n);
+		}
+	}
+
+	std::uint64_t ReadProfileTicks() noexcept
+	{
+#if HE_PROFILE_RDTSC
+		return __rdtsc();
+#else
+		return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+	}
+
+	double GetProfileTicksPerSecond() noexcept
+	{
+		static double const s_fTicksPerSecond = []() {
+#if HE_PROFILE_RDTSC
+			constexpr auto MinInterval = std::chrono::milliseconds{ 10 };
+			while (std::chrono::steady_clock::now() - s_calibration.t < MinInterval)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+			}
+			auto const nTicks = ReadProfileTicks();
+			auto const t = std::chrono::steady_clock::now();
+			return static_cast<double>(nTicks - s_calibration.nTicks) / std::chrono::duration<double>(t - s_calibration.t).count();
+#else
+			using Period = std::chrono::steady_clock::period;
+			return static_cast<double>(Period::den) / Period::num;
+#endif
+		}();
+		return s_fTicksPerSecond;
+	}
+
+	void SetProfileThreadName(std::string sName)
+	{
+		auto const nIndex = GetThread().nIndex;
+		auto& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock{ registry.mutThreads };
+		registry.cThreadNames[nIndex] = std::move(sName);
+	}
+
+	const char* InternProfileName(const std::string& sName)
+	{
+		auto& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock{ registry.mutNames };
+		// The nodes of the set never move
+		return registry.cNames.insert(sName).first->c_str();
+	}
+
+	Private::ProfileThread* ProfileScope::Enter() noexcept
+	{
+		auto& thread = GetThread();
+		++thread.nDepth;
+		return &thread;
+	}
+
+	void ProfileScope::End() noexcept
+	{
+		auto const nEnd = ReadProfileTicks();
+		auto& thread = *m_pThread;
+		--thread.nDepth;
+		if (!thread.events.TryPush(ProfileEvent{ m_psName, m_nBegin, nEnd, thread.nIndex, thread.nDepth }))
+		{
+			GetRegistry().nDroppedEvents.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	ProfileHistory::ProfileHistory(size_t nMaxFrames)
+		: m_nMaxFrames(nMaxFrames),
+		m_nFrameBegin(ReadProfileTicks())
+	{
+
+	}
+
+	void ProfileHistory::EndFrame()
+	{
+		auto const nNow = ReadProfileTicks();
+		Frame frame{ m_nNextFrame++, m_nFrameBegin, nNow, {} };
+		m_nFrameBegin = nNow;
+
+		// Reuses the events of the oldest frame
+		if (m_cFrames.size() == m_nMaxFrames && !m_cFrames.empty())
+		{
+			frame.cEvents = std::move(m_cFrames.front().cEvents);
+			frame.cEvents.clear();
+			m_cFrames.pop_front();
+		}
+		DrainThreads(frame.cEvents);
+		if (m_nMaxFrames > 0) m_cFrames.push_back(std::move(frame));
+	}
+
+	ProfileCapture ProfileHistory::Capture(size_t nFrames) const
+	{
+		ProfileCapture capture;
+		capture.fTicksPerSecond = GetProfileTicksPerSecond();
+		{
+			auto& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock{ registry.mutThreads };
+			capture.cThreadNames = registry.cThreadNames;
+			capture.nDroppedEvents = registry.nDroppedEvents.load(std::memory_order_relaxed);
+		}
+
+		// The same literal can have several addresses, one per module for instance
+		std::unordered_map<const char*, std::uint32_t> cIndexByAddress;
+		std::unordered_map<std::string, std::uint32_t> cIndexByName;
+		auto const getName = [&](const char* psName) {
+			auto const it = cIndexByAddress.find(psName);
+			if (it != cIndexByAddress.end()) return it->second;
+
+			auto const nIndex = cIndexByName.emplace(psName, static_cast<std::uint32_t>(capture.cNames.size())).first->second;
+			if (nIndex == capture.cNames.size()) capture.cNames.push_back(psName);
+			cIndexByAddress.emplace(psName, nIndex);
+			return nIndex;
+		};
+
+		auto const nFirst = m_cFrames.size() - std::min(nFrames, m_cFrames.size());
+		for (auto i = nFirst; i < m_cFrames.size(); ++i)
+		{
+			auto const& frame = m_cFrames[i];
+			ProfileCapture::Frame captured{ frame.nNumber, frame.nBegin, frame.nEnd, {} };
+			captured.cEvents.reserve(frame.cEvents.size());
+			for (auto const& event : frame.cEvents)
+			{
+				captured.cEvents.push_back({ getName(event.psName), event.nThread, event.nDepth, event.nBegin, event.nEnd });
+			}
+			std::sort(captured.cEvents.begin(), captured.cEvents.end(), [](const ProfileCapture::Event& a, const ProfileCapture::Event& b) {
+				return a.nThread != b.nThread ? a.nThread < b.nThread : a.nBegin < b.nBegin;
+			});
+			capture.cFrames.push_back(std::move(captured));
+		}
+		return capture;
+	}
+
+	void WriteChromeTrace(std::ostream& stream, const ProfileCapture& capture)
+	{
+		auto const nBase = capture.cFrames.empty() ? 0 : capture.cFrames.front().nBegin;
+		auto const fMicrosecondsPerTick = capture.fTicksPerSecond > 0.0 ? 1e6 / capture.fTicksPerSecond : 0.0;
+		auto const toMicroseconds = [nBase, fMicrosecondsPerTick](std::uint64_t nTicks) {
+			// Scopes can begin before the first frame
+			return static_cast<double>(static_cast<std::int64_t>(nTicks - nBase)) * fMicrosecondsPerTick;
+		};
+
+		auto const flags = stream.flags();
+		auto const nPrecision = stream.precision();
+		stream.setf(std::ios::fixed, std::ios::floatfield);
+		stream.precision(3);
+
+		stream << "{\"traceEvents\":[\n";
+		auto bFirst = true;
+		auto const separate = [&stream, &bFirst]() {
+			if (!bFirst) stream << ",\n";
+			bFirst = false;
+		};
+
+		for (size_t i = 0; i < capture.cThreadNames.size(); ++i)
+		{
+			separate();
+			stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i << ",\"args\":{\"name\":";
+			WriteJsonString(stream, capture.cThreadNames[i]);
+			stream << "}}";
+		}
+
+		for (auto const& frame : capture.cFrames)
+		{
+			separate();
+			stream << "{\"name\":\"Frame " << frame.nNumber << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":"
+				<< toMicroseconds(frame.nBegin) << '}';
+
+			for (auto const& event : frame.cEvents)
+			{
+				separate();
+				stream << "{\"name\":";
+				WriteJsonString(stream, capture.cNames[event.nName]);
+				stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.nThread
+					<< ",\"ts\":" << toMicroseconds(event.nBegin)
+					<< ",\"dur\":" << static_cast<double>(event.nEnd - event.nBegin) * fMicrosecondsPerTick << '}';
+			}
+		}
+		stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+		stream.flags(flags);
+		stream.precision(nPrecision);
+	}
+
+	void WriteProfileBinary(std::ostream& stream, const ProfileCapture& capture)
+	{
+		stream.write(BinaryMagic, sizeof(BinaryMagic));
+		WriteVarint(stream, BinaryVersion);
+
+		std::uint64_t nTicksPerSecond;
+		static_assert(sizeof(nTicksPerSecond) == sizeof(capture.fTicksPerSecond), "Unexpected size of double");
+		std::memcpy(&nTicksPerSecond, &capture.fTicksPerSecond, sizeof(nTicksPerSecond));
+		WriteVarint(stream, nTicksPerSecond);
+		WriteVarint(stream, capture.nDroppedEvents);
+
+		WriteVarint(stream, capture.cNames.size());
+		for (auto const& sName : capture.cNames) WriteString(stream, sName);
+		WriteVarint(stream, capture.cThreadNames.size());
+		for (auto const& sName : capture.cThreadNames) WriteString(stream, sName);
+
+		WriteVarint(stream, capture.cFrames.size());
+		for (auto const& frame : capture.cFrames)
+		{
+			WriteVarint(stream, frame.nNumber);
+			WriteVarint(stream, frame.nBegin);
+			WriteVarint(stream, frame.nEnd - frame.nBegin);
+			WriteVarint(stream, frame.cEvents.size());
+			for (auto const& event : frame.cEvents)
+			{
+				WriteVarint(stream, event.nName);
+				WriteVarint(stream, event.nThread);
+				WriteVarint(stream, event.nDepth);
+				WriteVarint(stream, ZigZag(static_cast<std::int64_t>(event.nBegin - frame.nBegin)));
+				WriteVarint(stream, event.nEnd - event.nBegin);
+			}
+		}
+	}
+
+	ProfileCapture ReadProfileBinary(std::istream& stream)
+	{
+		BinaryStreamReader reader{ stream, "Invalid profile capture" };
+		char aMagic[sizeof(BinaryMagic)];
+		if (!stream.read(aMagic, sizeof(aMagic)) || std::memcmp(aMagic, BinaryMagic, sizeof(aMagic)) != 0) reader.ThrowInvalid("not a profile capture");
+		if (reader.ReadVarint() != BinaryVersion) reader.ThrowInvalid("unknown version");
+
+		ProfileCapture capture;
+		auto const nTicksPerSecond = reader.ReadVarint();
+		std::memcpy(&capture.fTicksPerSecond, &nTicksPerSecond, sizeof(nTicksPerSecond));
+		capture.nDroppedEvents = reader.ReadVarint();
+
+		for (auto nNames = reader.ReadVarint(); nNames > 0; --nNames) capture.cNames.push_back(reader.ReadString());
+		for (auto nThreads = reader.ReadVarint(); nThreads > 0; --nThreads) capture.cThreadNames.push_back(reader.ReadString());
+
+		for (auto nFrames = reader.ReadVarint(); nFrames > 0; --nFrames)
+		{
+			ProfileCapture::Frame frame;
+			frame.nNumber = reader.ReadVarint();
+			frame.nBegin = reader.ReadVarint();
+			frame.nEnd = frame.nBegin + reader.ReadVarint();
+			for (auto nEvents = reader.ReadVarint(); nEvents > 0; --nEvents)
+			{
+				ProfileCapture::Event event;
+				event.nName = ReadIndex(reader, capture.cNames.size());
+				event.nThread = ReadIndex(reader, capture.cThreadNames.size());
+				event.nDepth = static_cast<std::uint32_t>(reader.ReadVarint());
+				event.nBegin = frame.nBegin + static_cast<std::uint64_t>(UnZigZag(reader.ReadVarint()));
+				event.nEnd = event.nBegin + reader.ReadVarint();
+				frame.cEvents.push_back(event);
+			}
+			capture.cFrames.push_back(std::move(frame));
+		}
+		return capture;
+	}
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Compile-time switch of the profiler. With 0, HE_PROFILE_SCOPE compiles to nothing
+#ifndef HE_PROFILE_ENABLED
+#define HE_PROFILE_ENABLED 1
+#endif
+
+namespace HE
+{
+	// Timestamp of the profiler: the time stamp counter of the CPU where there is one, the steady clock otherwise
+	std::uint64_t ReadProfileTicks() noexcept;
+
+	// Calibrated against the steady clock from the start of the program. The first call waits for the
+	// calibration interval to be long enough to be precise, a few milliseconds at most
+	double GetProfileTicksPerSecond() noexcept;
+
+	// Names the calling thread in the captures, ex: "Worker 1". Threads are named "Thread N" by default
+	void SetProfileThreadName(std::string sName);
+
+	// Thread-safe. A copy of the name that lives until the end of the program, for scopes named at runtime,
+	// ex: after a system. Equal names give the same pointer
+	const char* InternProfileName(const std::string& sName);
+
+	// A scope that ended on some thread
+	struct ProfileEvent
+	{
+		// The name given to the scope. Must outlive the ProfileHistory, ex: a string literal or from InternProfileName
+		const char* psName;
+		std::uint64_t nBegin;
+		std::uint64_t nEnd;
+		// Index of the thread in the profiler, in order of their first scope or SetProfileThreadName
+		std::uint32_t nThread;
+		// Scopes open around it on its thread
+		std::uint32_t nDepth;
+	};
+
+	namespace Private
+	{
+		struct ProfileThread;
+	}
+
+	// Records the time spent between its construction and destruction, with HE_PROFILE_SCOPE
+	// Each thread has a lock-free ring of events: ending a scope pushes a single event, and costs a couple of
+	// time stamp reads. When the ring is full, because no ProfileHistory collects it, the events are dropped
+	class ProfileScope
+	{
+	public:
+		explicit ProfileScope(const char* psName) noexcept
+			: m_psName(psName),
+			m_pThread(Enter()),
+			m_nBegin(ReadProfileTicks())
+		{
+
+		}
+		ProfileScope(const ProfileScope&) = delete;
+		void operator=(const ProfileScope&) = delete;
+		~ProfileScope() { End(); }
+
+	private:
+		// The ring of the calling thread, registered on its first scope
+		static Private::ProfileThread* Enter() noexcept;
+		void End() noexcept;
+
+		const char* m_psName;
+		Private::ProfileThread* m_pThread;
+		std::uint64_t m_nBegin;
+	};
+
+	// Events of the frames of a ProfileHistory, self-contained to be written to a file or read back from one
+	struct ProfileCapture
+	{
+		struct Event
+		{
+			// Index in cNames
+			std::uint32_t nName;
+			std::uint32_t nThread;
+			std::uint32_t nDepth;
+			std::uint64_t nBegin;
+			std::uint64_t nEnd;
+		};
+
+		struct Frame
+		{
+			std::uint64_t nNumber;
+			std::uint64_t nBegin;
+			std::uint64_t nEnd;
+			// Of the scopes that ended during the frame, by thread then by beginning
+			std::vector<Event> cEvents;
+		};
+
+		double fTicksPerSecond{ 0.0 };
+		std::vector<std::string> cNames;
+		// By thread index
+		std::vector<std::string> cThreadNames;
+		// Oldest first
+		std::vector<Frame> cFrames;
+		// Events lost to full rings since the start
+		std::uint64_t nDroppedEvents{ 0 };
+	};
+
+	// Sorts the events of all the threads into frames, keeping the last nMaxFrames ones
+	// EndFrame drains the rings of the threads, and there is a single consumer for them, so use one history per
+	// process: events go to whichever history ends a frame first
+	// Not thread-safe
+	class ProfileHistory
+	{
+	public:
+		explicit ProfileHistory(size_t nMaxFrames);
+		ProfileHistory(const ProfileHistory&) = delete;
+		void operator=(const ProfileHistory&) = delete;
+
+		// Ends the current frame with the scopes that ended since the last call, and starts the next one
+		void EndFrame();
+
+		size_t GetFrameCount() const noexcept { return m_cFrames.size(); }
+
+		// Form: Capture(nFrames) -> capture of the last nFrames frames at most
+		ProfileCapture Capture(size_t nFrames = static_cast<size_t>(-1)) const;
+
+	private:
+		struct Frame
+		{
+			std::uint64_t nNumber;
+			std::uint64_t nBegin;
+			std::uint64_t nEnd;
+			std::vector<ProfileEvent> cEvents;
+		};
+
+		size_t m_nMaxFrames;
+		std::deque<Frame> m_cFrames;
+		std::uint64_t m_nNextFrame{ 0 };
+		std::uint64_t m_nFrameBegin;
+	};
+
+	// Writes the capture in the trace event format of Chrome (chrome://tracing, Perfetto): a complete event per
+	// scope, in microseconds since the first frame, and an instant event at the start of each frame
+	void WriteChromeTrace(std::ostream& stream, const ProfileCapture& capture);
+
+	// Compact binary form of a capture, about 10 bytes per event, to be read back with ReadProfileBinary
+	void WriteProfileBinary(std::ostream& stream, const ProfileCapture& capture);
+	// Throws std::runtime_error if the stream does not hold a capture written by WriteProfileBinary
+	ProfileCapture ReadProfileBinary(std::istream& stream);
+}
+
+#define HE_PROFILE_CONCAT_IMPL(a, b) a##b
+#define HE_PROFILE_CONCAT(a, b) HE_PROFILE_CONCAT_IMPL(a, b)
+
+// Form: HE_PROFILE_SCOPE(psName)
+// Profiles the rest of the enclosing scope under that name. The name must outlive the ProfileHistory, ex: a
+// string literal or from HE::InternProfileName
+#if HE_PROFILE_ENABLED
+#define HE_PROFILE_SCOPE(psName) HE::ProfileScope HE_PROFILE_CONCAT(heProfileScope, __LINE__){ psName }
+#else
+#define HE_PROFILE_SCOPE(psName) ((void)0)
+#endif
@@ -0,0 +1,440 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "TMP_Helper.h"
+
+// Describes the fields of a type, at namespace scope next to it, for the operations of HE::Reflection
+// Example:
+// struct Position { float x, y; };
+// HE_REFLECT(Position, x, y)
+//
+// Fields are data members, up to 16. The description is found by argument-dependent lookup, so it must be in the
+// namespace of the type. Fields that are not described are left out of every operation
+#define HE_REFLECT(Type, ...) \
+	inline ::HE::Reflection::FieldList<HE_REFLECT_FOR_EACH(HE_REFLECT_FIELD, Type, __VA_ARGS__)> HE_GetFields(const Type*) noexcept \
+	{ \
+		return{ { HE_REFLECT_FOR_EACH(HE_REFLECT_NAME, Type, __VA_ARGS__) } }; \
+	}
+
+// Implementation of HE_REFLECT. The extra expansions are for the preprocessor of MSVC, which passes __VA_ARGS__
+// as one argument
+#define HE_REFLECT_EXPAND(...) __VA_ARGS__
+#define HE_REFLECT_CAT(a, b) HE_REFLECT_CAT_IMPL(a, b)
+#define HE_REFLECT_CAT_IMPL(a, b) a##b
+#define HE_REFLECT_COUNT(...) HE_REFLECT_EXPAND(HE_REFLECT_COUNT_IMPL(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1))
+#define HE_REFLECT_COUNT_IMPL(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, N, ...) N
+#define HE_REFLECT_FOR_EACH(M, T, ...) HE_REFLECT_EXPAND(HE_REFLECT_CAT(HE_REFLECT_FOR_EACH_, HE_REFLECT_COUNT(__VA_ARGS__))(M, T, __VA_ARGS__))
+#define HE_REFLECT_FOR_EACH_1(M, T, a) M(T, a)
+#define HE_REFLECT_FOR_EACH_2(M, T, a, ...) M(T, a), HE_REFLECT_EXPAND(HE_REFLECT_FOR_EACH_1(M, T, __VA_ARGS__))
+#define HE_REFLECT_FOR_EACH_3(M, T, a, ...) M(T, a), HE_REFLECT_EXPAND(HE_REFLECT_FOR_EACH_2(M, T, __VA_ARGS__))
+#define HE_REFLECT_FOR_EACH_4(M, T, a, ...) M(T, a), HE_REFLECT_EXPAND(HE_REFLECT_FOR_EACH_3(M, T, __VA_ARGS__))
+#define HE_REFLECT_FOR_EACH_5(M, T, a, ...) M(T, a), HE_REFLECT_EXPAND(HE_REFLECT_FOR_EACH_4(M, T, __VA_ARGS__))
+#define HE_REFLECT_FOR_EACH_6(M, T, a, ...) M(T, a), HE_REFLECT_EXPAND(HE_REFLECT_FOR_EACH_5(M, T, __VA_ARGS__))
+#define HE_REFLECT_FOR_EACH_7(M, T, a, ...) M(T, a), HE_REFLECT_EXPAND(HE_REFLECT_FOR_EACH_6(M, T, __VA_ARGS__))
+#define HE_REFLECT_FOR_EACH_8(M, T, a, ...) M(T, a), HE_REFLECT_EXPAND(HE_REFLECT_FOR_EACH_7(M, T, __VA_ARGS__))
+#define HE_REFLECT_FOR_EACH_9(M, T, a, ...) M(T, a), HE_REFLECT_EXPAND(HE_REFLECT_FOR_EACH_8(M, T, __VA_ARGS__))
+#define HE_REFLECT_FOR_EACH_10(M, T, a, ...) M(T, a), HE_REFLECT_EXPAND(HE_REFLECT_FOR_EACH_9(M, T, __VA_ARGS__))
+#define HE_REFLECT_FOR_EACH_11(M, T, a, ...) M(T, a), HE_REFLECT_EXPAND(HE_REFLECT_FOR_EACH_10(M, T, __VA_ARGS__))
+#define HE_REFLECT_FOR_EACH_12(M, T, a, ...) M(T, a), HE_REFLECT_EXPAND(HE_REFLECT_FOR_EACH_11(M, T, __VA_ARGS__))
+#define HE_REFLECT_FOR_EACH_13(M, T, a, ...) M(T, a), HE_REFLECT_EXPAND(HE_REFLECT_FOR_EACH_12(M, T, __VA_ARGS__))
+#define HE_REFLECT_FOR_EACH_14(M, T, a, ...) M(T, a), HE_REFLECT_EXPAND(HE_REFLECT_FOR_EACH_13(M, T, __VA_ARGS__))
+#define HE_REFLECT_FOR_EACH_15(M, T, a, ...) M(T, a), HE_REFLECT_EXPAND(HE_REFLECT_FOR_EACH_14(M, T, __VA_ARGS__))
+#define HE_REFLECT_FOR_EACH_16(M, T, a, ...) M(T, a), HE_REFLECT_EXPAND(HE_REFLECT_FOR_EACH_15(M, T, __VA_ARGS__))
+#define HE_REFLECT_FIELD(Type, f) ::HE::Reflection::Field<decltype(&Type::f), &Type::f>
+#define HE_REFLECT_NAME(Type, f) #f
+
+namespace HE
+{
+	// Compile-time descriptions of types, from HE_REFLECT
+	//
+	// Every operation expands to the fields of the type in order, with no lookup at runtime: a serializer is a
+	// sequence of memcpy, a hasher a sequence of hashes of the fields. Fields are visited down to their leaves:
+	// - the fields of described types
+	// - the elements of arrays
+	// - anything else, which must be trivially copyable, as its bytes, ex: numbers, enums, or an EntityHandle
+	// The padding between fields is never read, so the results only depend on the values of the fields
+	namespace Reflection
+	{
+		template<class TMember, TMember pMember>
+		struct Field;
+
+		template<class TClass, class T, T TClass::*pMember>
+		struct Field<T TClass::*, pMember>
+		{
+			using Class = TClass;
+			using Type = T;
+
+			static T& Get(TClass& object) noexcept { return object.*pMember; }
+			static const T& Get(const TClass& object) noexcept { return object.*pMember; }
+		};
+
+		template<class... Fields>
+		struct FieldList
+		{
+			static constexpr size_t Count = sizeof...(Fields);
+			const char* aNames[sizeof...(Fields)];
+		};
+
+		template<class T>
+		using try_get_fields = decltype(HE_GetFields(std::declval<const T*>()));
+
+		template<class T>
+		struct IsReflected : has_op<T, try_get_fields> {};
+
+		// The FieldList of T
+		template<class T>
+		using FieldsOf = try_get_fields<T>;
+
+		template<class T>
+		const char* GetFieldName(size_t nField) noexcept
+		{
+			return HE_GetFields(static_cast<const T*>(nullptr)).aNames[nField];
+		}
+
+		namespace Private
+		{
+			template<size_t I, class List>
+			struct FieldAt;
+
+			template<size_t I, class First, class... Fields>
+			struct FieldAt<I, FieldList<First, Fields...>> : FieldAt<I - 1, FieldList<Fields...>> {};
+
+			template<class First, class... Fields>
+			struct FieldAt<0, FieldList<First, Fields...>>
+			{
+				using Type = First;
+			};
+
+			using ReflectedTag = std::integral_constant<int, 0>;
+			using ArrayTag = std::integral_constant<int, 1>;
+			using LeafTag = std::integral_constant<int, 2>;
+
+			template<class T>
+			using KindOf = std::integral_constant<int, IsReflected<T>::value ? 0 : std::is_array<T>::value ? 1 : 2>;
+
+			template<class F, class T, class... Ts>
+			void VisitLeaves(F& f, T& value, Ts&... values);
+
+			template<class Field, class F, class T, class... Ts>
+			void VisitField(F& f, T& value, Ts&... values)
+			{
+				VisitLeaves(f, Field::Get(value), Field::Get(values)...);
+			}
+
+			template<class F, size_t... Is, class T, class... Ts>
+			void VisitFields(std::index_sequence<Is...>, F& f, T& value, Ts&... values)
+			{
+				using Fields = FieldsOf<std::remove_const_t<T>>;
+				int aVisit[] = { 0, (VisitField<typename FieldAt<Is, Fields>::Type>(f, value, values...), 0)... };
+				(void)aVisit;
+			}
+
+			template<class F, class T, class... Ts>
+			void VisitLeaves(ReflectedTag, F& f, T& value, Ts&... values)
+			{
+				VisitFields(std::make_index_sequence<FieldsOf<std::remove_const_t<T>>::Count>{}, f, value, values...);
+			}
+
+			template<class F, class T, class... Ts>
+			void VisitLeaves(ArrayTag, F& f, T& value, Ts&... values)
+			{
+				for (size_t i = 0; i < std::extent<T>::value; ++i)
+				{
+					VisitLeaves(f, value[i], values[i]...);
+				}
+			}
+
+			template<class F, class T, class... Ts>
+			void VisitLeaves(LeafTag, F& f, T& value, Ts&... values)
+			{
+				static_assert(std::is_trivially_copyable<T>::value, "Fields that are not described must be trivially copyable");
+				f(value, values...);
+			}
+
+			// Form: VisitLeaves(f, values...), calls f(leaves...) for each leaf of values, which all have the same type
+			template<class F, class T, class... Ts>
+			void VisitLeaves(F& f, T& value, Ts&... values)
+			{
+				VisitLeaves(KindOf<std::remove_const_t<T>>{}, f, value, values...);
+			}
+
+			template<class T, int Kind = KindOf<T>::value>
+			struct PackedSizeImpl : std::integral_constant<size_t, sizeof(T)> {};
+
+			template<class T>
+			struct PackedSizeImpl<T, 1> : std::integral_constant<size_t, std::extent<T>::value * PackedSizeImpl<std::remove_extent_t<T>>::value> {};
+
+			template<class List>
+			struct SumPackedSizes;
+
+			template<>
+			struct SumPackedSizes<FieldList<>> : std::integral_constant<size_t, 0> {};
+
+			template<class First, class... Fields>
+			struct SumPackedSizes<FieldList<First, Fields...>>
+				: std::integral_constant<size_t, PackedSizeImpl<typename First::Type>::value + SumPackedSizes<FieldList<Fields...>>::value> {};
+
+			template<class T>
+			struct PackedSizeImpl<T, 0> : SumPackedSizes<FieldsOf<T>> {};
+
+			template<class T>
+			void Print(std::ostream& stream, const T& value, ReflectedTag);
+
+			template<class T>
+			void Print(std::ostream& stream, const T& value, ArrayTag)
+			{
+				stream << '[';
+				for (size_t i = 0; i < std::extent<T>::value; ++i)
+				{
+					if (i != 0) stream << ", ";
+					Print(stream, value[i], KindOf<std::remove_extent_t<T>>{});
+				}
+				stream << ']';
+			}
+
+			template<class T>
+			void PrintLeaf(std::ostream& stream, const T& value, std::true_type /*arithmetic*/)
+			{
+				// Bytes as numbers, not characters
+				stream << +value;
+			}
+
+			template<class T>
+			void PrintLeaf(std::ostream& stream, const T&, std::false_type)
+			{
+				stream << '<' << sizeof(T) << " bytes>";
+			}
+
+			template<class T>
+			void Print(std::ostream& stream, const T& value, LeafTag)
+			{
+				PrintLeaf(stream, value, std::is_arithmetic<T>{});
+			}
+
+			template<class T, size_t... Is>
+			void PrintFields(std::ostream& stream, const T& value, std::index_sequence<Is...>)
+			{
+				using Fields = FieldsOf<T>;
+				stream << '{';
+				int aPrint[] = { 0, (stream << (Is == 0 ? " " : ", ") << GetFieldName<T>(Is) << ": ",
+					Print(stream, FieldAt<Is, Fields>::Type::Get(value), KindOf<typename FieldAt<Is, Fields>::Type::Type>{}), 0)... };
+				(void)aPrint;
+				stream << " }";
+			}
+
+			template<class T>
+			void Print(std::ostream& stream, const T& value, ReflectedTag)
+			{
+				PrintFields(stream, value, std::make_index_sequence<FieldsOf<T>::Count>{});
+			}
+		}
+
+		// Size of the leaves of T, without padding
+		template<class T>
+		constexpr size_t GetPackedSize() noexcept
+		{
+			return Private::PackedSizeImpl<T>::value;
+		}
+
+		namespace Private
+		{
+			template<class T, class F, size_t... Is>
+			void ForEachField(T& object, F& f, std::index_sequence<Is...>)
+			{
+				using Class = std::remove_const_t<T>;
+				int aVisit[] = { 0, (f(GetFieldName<Class>(Is), FieldAt<Is, FieldsOf<Class>>::Type::Get(object)), 0)... };
+				(void)aVisit;
+			}
+
+			template<class T>
+			bool LeavesDiffer(const T& a, const T& b) noexcept
+			{
+				bool bDiffer = false;
+				auto compare = [&bDiffer](const auto& leafA, const auto& leafB) {
+					bDiffer = bDiffer || std::memcmp(&leafA, &leafB, sizeof(leafA)) != 0;
+				};
+				VisitLeaves(compare, a, b);
+				return bDiffer;
+			}
+
+			template<class T, size_t... Is>
+			std::uint64_t Diff(const T& a, const T& b, std::index_sequence<Is...>) noexcept
+			{
+				using Fields = FieldsOf<T>;
+				std::uint64_t nMask = 0;
+				int aDiff[] = { 0, (nMask |= LeavesDiffer(FieldAt<Is, Fields>::Type::Get(a), FieldAt<Is, Fields>::Type::Get(b)) ? std::uint64_t{ 1 } << Is : 0, 0)... };
+				(void)aDiff;
+				return nMask;
+			}
+
+			template<class List>
+			struct Columns;
+
+			template<class... Fields>
+			struct Columns<FieldList<Fields...>>
+			{
+				// End of the first nFields columns
+				static constexpr size_t GetEnd(size_t nFields, size_t nCapacity) noexcept
+				{
+					size_t const aSizes[] = { sizeof(typename Fields::Type)... };
+					size_t const aAlignments[] = { alignof(typename Fields::Type)... };
+					size_t nEnd = 0;
+					for (size_t i = 0; i < nFields; ++i)
+					{
+						nEnd = (nEnd + aAlignments[i] - 1) / aAlignments[i] * aAlignments[i] + aSizes[i] * nCapacity;
+					}
+					return nEnd;
+				}
+
+				static constexpr size_t GetOffset(size_t nField, size_t nCapacity) noexcept
+				{
+					size_t const aAlignments[] = { alignof(typename Fields::Type)... };
+					return (GetEnd(nField, nCapacity) + aAlignments[nField] - 1) / aAlignments[nField] * aAlignments[nField];
+				}
+			};
+		}
+
+		// Form: ForEachField(object, f(psName, field)), over the fields of the object, not down to their leaves
+		template<class T, class F>
+		void ForEachField(T& object, F&& f)
+		{
+			Private::ForEachField(object, f, std::make_index_sequence<FieldsOf<std::remove_const_t<T>>::Count>{});
+		}
+
+		// FNV-1a of the leaves, continued from nHash
+		template<class T>
+		std::uint64_t Hash(const T& value, std::uint64_t nHash = 14695981039346656037ull) noexcept
+		{
+			auto hash = [&nHash](const auto& leaf) {
+				auto const pBytes = reinterpret_cast<const unsigned char*>(&leaf);
+				for (size_t i = 0; i < sizeof(leaf); ++i)
+				{
+					nHash = (nHash ^ pBytes[i]) * 1099511628211ull;
+				}
+			};
+			Private::VisitLeaves(hash, value);
+			return nHash;
+		}
+
+		// Writes the leaves one after the other, GetPackedSize<T>() bytes, and returns the end of what was written
+		template<class T>
+		unsigned char* Write(const T& value, unsigned char* pOut) noexcept
+		{
+			auto write = [&pOut](const auto& leaf) {
+				std::memcpy(pOut, &leaf, sizeof(leaf));
+				pOut += sizeof(leaf);
+			};
+			Private::VisitLeaves(write, value);
+			return pOut;
+		}
+
+		// Reads what Write wrote, and returns the end of what was read
+		template<class T>
+		const unsigned char* Read(T& value, const unsigned char* pIn) noexcept
+		{
+			auto read = [&pIn](auto& leaf) {
+				std::memcpy(&leaf, pIn, sizeof(leaf));
+				pIn += sizeof(leaf);
+			};
+			Private::VisitLeaves(read, value);
+			return pIn;
+		}
+
+		// Bit i is set if field i differs between a and b, comparing their leaves as bytes
+		template<class T>
+		std::uint64_t Diff(const T& a, const T& b) noexcept
+		{
+			static_assert(FieldsOf<T>::Count <= 64, "Diff gives one bit per field");
+			return Private::Diff(a, b, std::make_index_sequence<FieldsOf<T>::Count>{});
+		}
+
+		// Writes the fields in the mask from Diff, as Write does, and returns the end of what was written
+		template<class T>
+		unsigned char* WriteFields(const T& value, std::uint64_t nMask, unsigned char* pOut) noexcept
+		{
+			size_t nField = 0;
+			ForEachField(value, [&](const char*, const auto& field) {
+				if (nMask & (std::uint64_t{ 1 } << nField++)) pOut = Write(field, pOut);
+			});
+			return pOut;
+		}
+
+		// Reads what WriteFields wrote with the same mask, and returns the end of what was read
+		template<class T>
+		const unsigned char* ReadFields(T& value, std::uint64_t nMask, const unsigned char* pIn) noexcept
+		{
+			size_t nField = 0;
+			ForEachField(value, [&](const char*, auto& field) {
+				if (nMask & (std::uint64_t{ 1 } << nField++)) pIn = Read(field, pIn);
+			});
+			return pIn;
+		}
+
+		// "{ x: 1, y: 2 }", for debugging. Leaves that are not numbers are shown by size
+		template<class T>
+		std::string ToString(const T& value)
+		{
+			std::ostringstream stream;
+			Private::Print(stream, value, Private::KindOf<T>{});
+			return stream.str();
+		}
+
+		// Layout of nCapacity Ts as one array per field, each aligned on its type: the columns of a chunk, ex: to
+		// store a component as a structure of arrays, and still load and store it as a whole
+		template<class T>
+		class SoALayout
+		{
+			using Columns = Private::Columns<FieldsOf<T>>;
+
+		public:
+			static constexpr size_t FieldCount = FieldsOf<T>::Count;
+
+			template<size_t I>
+			using FieldType = typename Private::FieldAt<I, FieldsOf<T>>::Type::Type;
+
+			static constexpr size_t GetColumnOffset(size_t nField, size_t nCapacity) noexcept { return Columns::GetOffset(nField, nCapacity); }
+			static constexpr size_t GetSize(size_t nCapacity) noexcept { return Columns::GetEnd(FieldCount, nCapacity); }
+
+			template<size_t I>
+			static FieldType<I>* GetColumn(unsigned char* pBlock, size_t nCapacity) noexcept
+			{
+				return reinterpret_cast<FieldType<I>*>(pBlock + GetColumnOffset(I, nCapacity));
+			}
+
+			// Copies the fields of the value into row i of the columns
+			static void Store(unsigned char* pBlock, size_t nCapacity, size_t i, const T& value) noexcept
+			{
+				Store(pBlock, nCapacity, i, value, std::make_index_sequence<FieldCount>{});
+			}
+
+			static void Load(const unsigned char* pBlock, size_t nCapacity, size_t i, T& value) noexcept
+			{
+				Load(pBlock, nCapacity, i, value, std::make_index_sequence<FieldCount>{});
+			}
+
+		private:
+			template<size_t I>
+			using FieldAt = typename Private::FieldAt<I, FieldsOf<T>>::Type;
+
+			template<size_t... Is>
+			static void Store(unsigned char* pBlock, size_t nCapacity, size_t i, const T& value, std::index_sequence<Is...>) noexcept
+			{
+				int aStore[] = { 0, (std::memcpy(pBlock + GetColumnOffset(Is, nCapacity) + i * sizeof(FieldType<Is>), &FieldAt<Is>::Get(value), sizeof(FieldType<Is>)), 0)... };
+				(void)aStore;
+			}
+
+			template<size_t... Is>
+			static void Load(const unsigned char* pBlock, size_t nCapacity, size_t i, T& value, std::index_sequence<Is...>) noexcept
+			{
+				int aLoad[] = { 0, (std::memcpy(&FieldAt<Is>::Get(value), pBlock + GetColumnOffset(Is, nCapacity) + i * sizeof(FieldType<Is>), sizeof(FieldType<Is>)), 0)... };
+				(void)aLoad;
+			}
+		};
+	}
+}
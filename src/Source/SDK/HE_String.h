@@ -4,7 +4,9 @@
 #include <string>
 #include <cstdarg>
 #include <typeinfo>
+#include <cstdio>
 #include <exception>
+#include <stdexcept>
 
 #include "HE_Assert.h"
 #include "TMP_Helper.h"
@@ -50,6 +52,9 @@ namespace HE
 {
 	namespace Private
 	{
+		// Keeps the global to_string overloads visible even if HE declares to_string for its own types
+		using ::to_string;
+
 		template<class T>
 		using try_format = decltype(to_string(std::declval<T>()));
 
@@ -62,65 +67,208 @@ namespace HE
 		template<class T>
 		using has_format_specifier = has_op<T, try_format_specifier >;
 
-		template< typename Arg >
-		std::string FormatIthArgN(size_t i, size_t n, Arg&& arg)
+		template<class T>
+		using try_string_data = std::enable_if_t<std::is_same<const char*, decltype(static_cast<const char*>(std::declval<const T&>().data()))>::value
+			&& std::is_convertible<decltype(std::declval<const T&>().size()), size_t>::value>;
+
+		// Types with char data() and size(), like std::string, are appended without going through to_string
+		template<class T>
+		using is_char_range = has_op<std::decay_t<T>, try_string_data>;
+
+		// Output must have append(const char*, size_t), like std::string
+		// Arguments are appended without a temporary string where possible, so that formatting into
+		// an output with enough capacity (ex: a HE::BasicString with a big enough inline buffer) does not allocate
+		template<class Output, class Arg>
+		void AppendArg(Output& out, Arg&& arg, std::true_type /*bCString*/, std::false_type, std::false_type)
+		{
+			const char* const ps = arg;
+			out.append(ps, std::char_traits<char>::length(ps));
+		}
+
+		template<class Output, class Arg>
+		void AppendArg(Output& out, Arg&& arg, std::false_type, std::true_type /*bCharRange*/, std::false_type)
+		{
+			out.append(arg.data(), static_cast<size_t>(arg.size()));
+		}
+
+		// Same output as std::to_string
+		template<class Output, class Arg>
+		void AppendArg(Output& out, Arg&& arg, std::false_type, std::false_type, std::true_type /*bArithmetic*/)
+		{
+			using T = std::decay_t<Arg>;
+			char buffer[64];
+			int nSize;
+			if (std::is_floating_point<T>::value)
+				nSize = std::snprintf(buffer, sizeof(buffer), "%Lf", static_cast<long double>(arg));
+			else if (std::is_signed<T>::value)
+				nSize = std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(arg));
+			else
+				nSize = std::snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(arg));
+
+			if (nSize >= 0 && static_cast<size_t>(nSize) < sizeof(buffer))
+			{
+				out.append(buffer, static_cast<size_t>(nSize));
+			}
+			else
+			{
+				auto const s = to_string(std::forward<Arg>(arg));
+				out.append(s.data(), s.size());
+			}
+		}
+
+		template<class Output, class Arg>
+		void AppendArg(Output& out, Arg&& arg, std::false_type, std::false_type, std::false_type)
+		{
+			auto const s = to_string(std::forward<Arg>(arg));
+			out.append(s.data(), s.size());
+		}
+
+		template<class Output, class Arg>
+		void AppendArg(Output& out, Arg&& arg)
+		{
+			using bCString = std::is_convertible<Arg, const char*>;
+			using bCharRange = and_<not_<bCString>, is_char_range<Arg>>;
+			using bArithmetic = std::is_arithmetic<std::decay_t<Arg>>;
+			AppendArg(out, std::forward<Arg>(arg),
+				std::integral_constant<bool, bCString::value>{},
+				std::integral_constant<bool, bCharRange::value>{},
+				std::integral_constant<bool, bArithmetic::value>{});
+		}
+
+		// Formatting without arguments, where any token is an error
+		template< class Output >
+		void AppendIthArgN(Output&, size_t, size_t)
+		{
+			ASSERT_MSG(false, "String format token number was higher than the number of arguments");
+		}
+
+		template< class Output >
+		void AppendIthArgFN(Output&, size_t, size_t, const std::string&)
+		{
+			ASSERT_MSG(false, "String format token number was higher than the number of arguments");
+		}
+
+		template< class Output, typename Arg >
+		void AppendIthArgN(Output& out, size_t i, size_t n, Arg&& arg)
 		{
 			ASSERT_MSG(i == n, "String format token number was higher than the number of arguments");
-			return to_string(std::forward<Arg>(arg));
+			AppendArg(out, std::forward<Arg>(arg));
 		}
 
-		template< typename Arg1, typename... Args >
-		std::string FormatIthArgN(size_t i, size_t n, Arg1&& arg, Args&&... args)
+		template< class Output, typename Arg1, typename... Args >
+		void AppendIthArgN(Output& out, size_t i, size_t n, Arg1&& arg, Args&&... args)
 		{
 			if (i == n)
 			{
-				return to_string(std::forward<Arg1>(arg));
+				AppendArg(out, std::forward<Arg1>(arg));
 			}
 			else
 			{
-				return FormatIthArgN(i, n + 1, std::forward<Args>(args)...);
+				AppendIthArgN(out, i, n + 1, std::forward<Args>(args)...);
 			}
 		}
 
-		template< typename Arg>
-		auto FormatIthArgFN(size_t i, size_t n, const std::string& format, Arg&& arg)
-			-> std::enable_if_t<has_format_specifier<Arg>::value, std::string>
+		template< class Output, typename Arg>
+		auto AppendIthArgFN(Output& out, size_t i, size_t n, const std::string& format, Arg&& arg)
+			-> std::enable_if_t<has_format_specifier<Arg>::value>
 		{
 			ASSERT_MSG(i == n, "String format token number was higher than the number of arguments");
-			return to_string(std::forward<Arg>(arg), format);
+			auto const s = to_string(std::forward<Arg>(arg), format);
+			out.append(s.data(), s.size());
 		}
 
-		template< typename Arg >
-		auto FormatIthArgFN(size_t i, size_t n, const std::string& format, Arg&& arg)
-			-> std::enable_if_t<!has_format_specifier<Arg>::value, std::string>
+		template< class Output, typename Arg >
+		auto AppendIthArgFN(Output&, size_t, size_t, const std::string&, Arg&&)
+			-> std::enable_if_t<!has_format_specifier<Arg>::value>
 		{
 			ASSERT_MSG(false , "A format specifier was supplied with type "s + typeid(Arg).name() + " which that does not support it");
-			return "";
 		}
 
-		template< typename Arg1, typename... Args >
-		std::string FormatIthArgFN(size_t i, size_t n, const std::string& format, Arg1&& arg, Args&&... args)
+		template< class Output, typename Arg1, typename... Args >
+		void AppendIthArgFN(Output& out, size_t i, size_t n, const std::string& format, Arg1&& arg, Args&&... args)
 		{
 			if (i == n)
 			{
-				return FormatIthArgFN(i, n, format, std::forward<Arg1>(arg));
+				AppendIthArgFN(out, i, n, format, std::forward<Arg1>(arg));
 			}
 			else
 			{
-				return FormatIthArgFN(i, n + 1, format, std::forward<Args>(args)...);
+				AppendIthArgFN(out, i, n + 1, format, std::forward<Args>(args)...);
 			}
 		}
 
-		template< typename... Args >
-		std::string FormatIthArg(size_t i, Args&&... args)
+		inline size_t Find(const char* ps, size_t nSize, char c, size_t nPos) noexcept
 		{
-			return FormatIthArgN(i, 0, std::forward<Args>(args)...);
+			for (; nPos < nSize; ++nPos)
+			{
+				if (ps[nPos] == c) return nPos;
+			}
+			return std::string::npos;
 		}
 
-		template< typename... Args >
-		std::string FormatIthArgF(size_t i, const std::string& format, Args&&... args)
+		template< class Output, typename... Args>
+		void FormatTo(Output& out, const char* const psFormat, size_t const nFormatSize, Args&&... args)
 		{
-			return FormatIthArgFN(i, 0, format, std::forward<Args>(args)...);
+			size_t nNextArg = 0;
+			for (size_t i = 0; i < nFormatSize; ++i)
+			{
+				// Find the next format token
+				auto const posToken = Find(psFormat, nFormatSize, '{', i);
+
+				// Add to the output all the characters up until the next format token (or the end)
+				// and process the format token if necessary
+				if (posToken == std::string::npos)
+				{
+					out.append(psFormat + i, nFormatSize - i);
+					break;
+				}
+				// The sequence "\{" is not a token start, so we continue as if it was a normal character
+				else if (posToken != 0 && psFormat[posToken - 1] == '\\')
+				{
+					out.append(psFormat + i, posToken - i);
+					i = posToken;
+					continue;
+				}
+				// Otherwise, we have a format token
+				else
+				{
+					out.append(psFormat + i, posToken - i); // Add everything before the token
+
+					auto const endToken = Find(psFormat, nFormatSize, '}', posToken);
+					ASSERT_MSG(endToken != std::string::npos, "Token error in string format \"" + std::string(psFormat, nFormatSize) + "\"");
+					i = endToken;
+
+					// Find the index token inside the whole token
+					auto const psFormatToken = psFormat + posToken + 1;
+					auto const nFormatTokenSize = (endToken - 1) - posToken;
+					auto const nSpecifierSentinel = Find(psFormatToken, nFormatTokenSize, ':', 0);
+					auto const nIndexTokenSize = nSpecifierSentinel == std::string::npos ? nFormatTokenSize : nSpecifierSentinel;
+
+					// Find the index of the current arg for this token
+					auto const argPos = [psFormatToken, nIndexTokenSize, nNextArg]() -> size_t {
+						if (nIndexTokenSize == 1 && psFormatToken[0] == '_')
+						{
+							return nNextArg;
+						}
+						else
+						{
+							return std::stoi(std::string(psFormatToken, nIndexTokenSize));
+						}
+					}();
+					nNextArg = argPos + 1;
+
+					// Add the formatted argument to the output
+					if (nSpecifierSentinel == std::string::npos)
+					{
+						AppendIthArgN(out, argPos, 0, std::forward<Args>(args)...);
+					}
+					else
+					{
+						auto const sSpecifierToken = std::string(psFormatToken + nSpecifierSentinel + 1, nFormatTokenSize - nSpecifierSentinel - 1);
+						AppendIthArgFN(out, argPos, 0, sSpecifierToken, std::forward<Args>(args)...);
+					}
+				}
+			}
 		}
 	}
 
@@ -160,83 +308,63 @@ namespace HE
 		return sFormat;
 	}
 
+	// Without it, the variadic overload below would be the better match for a string literal
+	inline std::string Format(const char* psFormat)
+	{
+		return psFormat;
+	}
+
 	template< typename... Args>
 	std::string Format(const std::string& sFormat, Args&&... args)
 	{
 		static_assert(HasFormat<Args...>(), "An argument cannot be formatted (HasFormat returns false)");
 
-		using namespace HE::Private;
+		std::string sOutput;
+		Private::FormatTo(sOutput, sFormat.data(), sFormat.size(), std::forward<Args>(args)...);
+		return sOutput;
+	}
+
+	template< typename... Args>
+	std::string Format(const char* psFormat, Args&&... args)
+	{
+		static_assert(HasFormat<Args...>(), "An argument cannot be formatted (HasFormat returns false)");
 
 		std::string sOutput;
-		size_t nNextArg = 0;
-		for (size_t i = 0; i < sFormat.size(); ++i)
-		{
-			// Find the next format token
-			auto const posToken = sFormat.find_first_of('{', i);
+		Private::FormatTo(sOutput, psFormat, std::char_traits<char>::length(psFormat), std::forward<Args>(args)...);
+		return sOutput;
+	}
 
-			// Add to the output all the characters up until the next format token (or the end)
-			// and process the format token if necessary
-			if (posToken == std::string::npos)
-			{
-				sOutput += sFormat.substr(i);
-				break;
-			}
-			// The sequence "\{" is not a token start, so we continue as if it was a normal character
-			else if (posToken != 0 && sFormat[posToken - 1] == '\\')
-			{
-				sOutput += sFormat.substr(i, posToken - i);
-				i = posToken;
-				continue;
-			}
-			// Otherwise, we have a format token
-			else
-			{
-				sOutput += sFormat.substr(i, posToken - i); // Add everything before the token
+	// Form: FormatTo(out, sFormat, args...)
+	// Same as Format, but appends to any Output with append(const char*, size_t)
+	template< class Output, typename... Args>
+	void FormatTo(Output& out, const char* psFormat, Args&&... args)
+	{
+		static_assert(HasFormat<Args...>(), "An argument cannot be formatted (HasFormat returns false)");
+		Private::FormatTo(out, psFormat, std::char_traits<char>::length(psFormat), std::forward<Args>(args)...);
+	}
 
-				auto const endToken = sFormat.find_first_of('}', posToken);
-				i = endToken;
-				ASSERT_MSG(endToken != std::string::npos, "Token error in string format \"" + sFormat + "\"");
+	template< class Output, typename... Args>
+	void FormatTo(Output& out, const std::string& sFormat, Args&&... args)
+	{
+		static_assert(HasFormat<Args...>(), "An argument cannot be formatted (HasFormat returns false)");
+		Private::FormatTo(out, sFormat.data(), sFormat.size(), std::forward<Args>(args)...);
+	}
 
-				// Find the index token inside the whole token
-				auto const sFormatToken = sFormat.substr(posToken + 1, (endToken - 1) - posToken);
-				auto const nSpecifierSentinel = sFormatToken.find_first_of(':');
-				auto const sIndexToken = [sFormatToken, nSpecifierSentinel]() {
-					if (nSpecifierSentinel == std::string::npos)
-					{
-						return sFormatToken;
-					}
-					else
-					{
-						return sFormatToken.substr(0, nSpecifierSentinel);
-					}
-				}();
-				
-				// Find the index of the current arg for this token
-				auto const argPos = [sIndexToken, nNextArg]() -> size_t {
-					if (sIndexToken == "_")
-					{
-						return nNextArg;
-					}
-					else
-					{
-						return std::stoi(sIndexToken);
-					}
-				}();
-				nNextArg = argPos + 1;
-				
-				// Add the formatted argument to the output
-				if (nSpecifierSentinel == std::string::npos)
-				{	
-					sOutput += FormatIthArg(argPos, std::forward<Args>(args)...);
-				}
-				else
-				{
-					auto const sSpecifierToken = sFormatToken.substr(nSpecifierSentinel + 1);
-					sOutput += FormatIthArgF(argPos, sSpecifierToken, std::forward<Args>(args)...);
-				}
-			}
-		}
+	// Form: FormatAs<String>(sFormat, args...) -> sFormatted
+	// Same as Format, but returns the given string type. Ex: FormatAs<HE::String>("Entity {_}", id)
+	template< class String, typename... Args>
+	String FormatAs(const char* psFormat, Args&&... args)
+	{
+		String sOutput;
+		FormatTo(sOutput, psFormat, std::forward<Args>(args)...);
+		return sOutput;
+	}
 
+	template< class String, typename... Args>
+	String FormatAs(const std::string& sFormat, Args&&... args)
+	{
+		String sOutput;
+		FormatTo(sOutput, sFormat, std::forward<Args>(args)...);
 		return sOutput;
 	}
 	
@@ -275,6 +403,9 @@ namespace HE
 
 		constexpr size_t size() const noexcept { return m_nSize; }
 
+		// Null-terminated, since the string comes from a literal
+		constexpr const Char* data() const noexcept { return m_pStr; }
+
 	private:
 		const Char* const m_pStr;
 		const size_t m_nSize;
@@ -284,4 +415,23 @@ namespace HE
 	using constexpr_wstring = basic_constexpr_string<wchar_t>;
 	using constexpr_u16string = basic_constexpr_string<char16_t>;
 	using constexpr_u32string = basic_constexpr_string<char32_t>;
+}
+
+// Form: to_string<String>(val) -> sVal
+// Converts to the given string type instead of std::string, ex: to_string<HE::String>(42)
+// Uses the same conversions as Format's arguments
+template<class String, class T>
+String to_string(T&& val)
+{
+	String sOutput;
+	HE::Private::AppendArg(sOutput, std::forward<T>(val));
+	return sOutput;
+}
+
+template<class String, class T>
+String to_string(T&& val, const std::string& sFormat)
+{
+	String sOutput;
+	HE::Private::AppendIthArgFN(sOutput, 0, 0, sFormat, std::forward<T>(val));
+	return sOutput;
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "HE_StringId.h"
+
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#include "HE_Allocator.h"
+#include "HE_Assert.h"
+#include "HE_Log.h"
+
+HE_DEFINE_LOG_CATEGORY(StringId, Info);
+
+namespace HE
+{
+	namespace
+	{
+#if HE_STRING_ID_DEBUG
+		// Open addressing table of interned strings, inserted to with CAS and never shrunk
+		// A slot is claimed by setting its hash, then published by setting its string
+		// Only GetDebugString reads it, so it only exists with HE_STRING_ID_DEBUG
+		constexpr size_t InternTableSize = 1 << 16;
+		static_assert(Math::IsPow2(InternTableSize), "The intern table size must be a power of 2");
+
+		struct InternSlot
+		{
+			std::atomic<std::uint64_t> nHash;
+			std::atomic<const char*> psString;
+		};
+
+		InternSlot s_aInternTable[InternTableSize];
+
+		const char* CopyString(const char* ps, size_t nSize)
+		{
+			// Interned strings live as long as the process
+			auto const b = MallocAllocator::it.allocate(nSize + 1);
+			if (!b.ptr) throw std::bad_alloc{};
+
+			auto const psCopy = static_cast<char*>(b.ptr);
+			std::memcpy(psCopy, ps, nSize);
+			psCopy[nSize] = '\0';
+			return psCopy;
+		}
+
+		void FreeString(const char* ps, size_t nSize) noexcept
+		{
+			if (ps) MallocAllocator::it.deallocate({ const_cast<char*>(ps), nSize + 1 });
+		}
+
+		const char* WaitForString(const InternSlot& slot) noexcept
+		{
+			// The string is published right after the hash, with nothing in between that can fail,
+			// so this only spins if the inserting thread got preempted
+			const char* psString;
+			while (!(psString = slot.psString.load(std::memory_order_acquire)))
+			{
+				std::this_thread::yield();
+			}
+			return psString;
+		}
+
+		// Returns the interned copy of the string, or nullptr if the table is full
+		const char* InternString(std::uint64_t nHash, const char* ps, size_t nSize)
+		{
+			// Copied before claiming a slot, so that a claimed slot always gets its string
+			// Only the first thread to claim the slot keeps its copy
+			const char* psCopy = nullptr;
+			auto i = static_cast<size_t>(nHash) & (InternTableSize - 1);
+			for (size_t nProbes = 0; nProbes < InternTableSize; ++nProbes, i = (i + 1) & (InternTableSize - 1))
+			{
+				auto& slot = s_aInternTable[i];
+				auto nSlotHash = slot.nHash.load(std::memory_order_acquire);
+				if (nSlotHash == 0)
+				{
+					if (!psCopy) psCopy = CopyString(ps, nSize);
+					if (slot.nHash.compare_exchange_strong(nSlotHash, nHash, std::memory_order_acq_rel))
+					{
+						slot.psString.store(psCopy, std::memory_order_release);
+						return psCopy;
+					}
+					// Lost the slot to another thread, nSlotHash now holds its hash
+				}
+
+				if (nSlotHash == nHash)
+				{
+					FreeString(psCopy, nSize);
+					auto const psString = WaitForString(slot);
+					ASSERT_MSG(std::strlen(psString) == nSize && std::memcmp(psString, ps, nSize) == 0,
+						"StringId hash collision between \"" + std::string(psString) + "\" and \"" + std::string(ps, nSize) + "\"");
+					return psString;
+				}
+			}
+
+			FreeString(psCopy, nSize);
+			return nullptr;
+		}
+
+		const char* FindString(std::uint64_t nHash) noexcept
+		{
+			auto i = static_cast<size_t>(nHash) & (InternTableSize - 1);
+			for (size_t nProbes = 0; nProbes < InternTableSize; ++nProbes, i = (i + 1) & (InternTableSize - 1))
+			{
+				auto const& slot = s_aInternTable[i];
+				auto const nSlotHash = slot.nHash.load(std::memory_order_acquire);
+				if (nSlotHash == 0) return nullptr;
+				if (nSlotHash == nHash) return WaitForString(slot);
+			}
+			return nullptr;
+		}
+#endif
+	}
+
+	std::uint64_t HashString(const char* ps, size_t nSize) noexcept
+	{
+		auto nHash = Private::Fnv1aOffsetBasis;
+		for (size_t i = 0; i < nSize; ++i)
+		{
+			nHash = (nHash ^ static_cast<unsigned char>(ps[i])) * Private::Fnv1aPrime;
+		}
+		return nHash;
+	}
+
+	StringId StringId::Intern(const char* ps, size_t nSize)
+	{
+		if (nSize == 0) return StringId{};
+
+		auto const nHash = HashString(ps, nSize);
+		ASSERT_MSG(nHash != 0, "The hash of \"" + std::string(ps, nSize) + "\" is the reserved empty hash");
+#if HE_STRING_ID_DEBUG
+		if (!InternString(nHash, ps, nSize))
+		{
+			HE_LOG_ONCE(Error, StringId, "The StringId intern table is full: \"{_}\" and the strings after it have no debug string",
+				std::string(ps, nSize));
+			ASSERT_MSG(false, "The StringId intern table is full");
+		}
+#endif
+		return StringId{ nHash };
+	}
+
+#if HE_STRING_ID_DEBUG
+	const char* StringId::GetDebugString() const noexcept
+	{
+		return m_nHash == 0 ? "" : FindString(m_nHash);
+	}
+#endif
+
+	std::string to_string(StringId id)
+	{
+#if HE_STRING_ID_DEBUG
+		if (auto const psString = id.GetDebugString()) return psString;
+#endif
+		return ::to_string(static_cast<unsigned long long>(id.GetHash()), "#016llx");
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "HE_String.h"
+
+// Debug string ids keep a pointer to their string, and check the intern table for hash collisions
+#ifndef HE_STRING_ID_DEBUG
+	#if defined(_DEBUG) || !defined(NDEBUG)
+	#define HE_STRING_ID_DEBUG 1
+	#else
+	#define HE_STRING_ID_DEBUG 0
+	#endif
+#endif
+
+namespace HE
+{
+	namespace Private
+	{
+		constexpr std::uint64_t Fnv1aOffsetBasis = 14695981039346656037ull;
+		constexpr std::uint64_t Fnv1aPrime = 1099511628211ull;
+
+		// Recursive, so that it stays a valid constexpr function for C++11 compilers
+		constexpr std::uint64_t Fnv1a(const constexpr_string& s, size_t i, std::uint64_t nHash) noexcept
+		{
+			return i == s.size() ? nHash : Fnv1a(s, i + 1, (nHash ^ static_cast<unsigned char>(s[i])) * Fnv1aPrime);
+		}
+	}
+
+	// 64-bit FNV-1a hash of a string
+	constexpr std::uint64_t HashString(const constexpr_string& s) noexcept
+	{
+		return Private::Fnv1a(s, 0, Private::Fnv1aOffsetBasis);
+	}
+	std::uint64_t HashString(const char* ps, size_t nSize) noexcept;
+	inline std::uint64_t HashString(const std::string& s) noexcept { return HashString(s.data(), s.size()); }
+
+	// Identifies a string by its 64-bit hash, so that it can be compared and hashed as an integer
+	// String literals are hashed at compile time: StringId{ "Player" }, or HE_SID("Player") to force it
+	// Strings only known at runtime go through StringId::Intern
+	// With HE_STRING_ID_DEBUG, Intern also keeps a copy of the string in a global lock-free table, in which
+	// GetDebugString() looks it up, and interning two different strings with the same hash is reported as an
+	// assertion failure. The id itself is only the hash in every configuration, so that code built with and
+	// without it can be mixed
+	// The empty string is the empty id
+	class StringId
+	{
+	public:
+		constexpr StringId() noexcept
+			: m_nHash{ 0 }
+		{}
+
+		constexpr explicit StringId(const constexpr_string& s) noexcept
+			: m_nHash{ s.size() == 0 ? 0 : HashString(s) }
+		{}
+
+		// Used by HE_SID, with nHash == HashString(s)
+		static constexpr StringId FromLiteral(std::uint64_t nHash, const constexpr_string& s) noexcept
+		{
+			return s.size() == 0 ? StringId{} : StringId{ nHash };
+		}
+
+		// Thread-safe and lock-free
+		static StringId Intern(const char* ps, size_t nSize);
+		static StringId Intern(const char* ps) { return Intern(ps, std::char_traits<char>::length(ps)); }
+		static StringId Intern(const std::string& s) { return Intern(s.data(), s.size()); }
+
+		// Id of a hash computed elsewhere, ex: loaded from a file
+		static constexpr StringId FromHash(std::uint64_t nHash) noexcept { return StringId{ nHash }; }
+
+		constexpr std::uint64_t GetHash() const noexcept { return m_nHash; }
+		constexpr bool IsEmpty() const noexcept { return m_nHash == 0; }
+
+#if HE_STRING_ID_DEBUG
+		// Returns the string, or nullptr if it was never interned by this process
+		// Literals are only found once the same string was interned
+		const char* GetDebugString() const noexcept;
+#endif
+
+		friend constexpr bool operator==(StringId a, StringId b) noexcept { return a.m_nHash == b.m_nHash; }
+		friend constexpr bool operator!=(StringId a, StringId b) noexcept { return a.m_nHash != b.m_nHash; }
+		friend constexpr bool operator<(StringId a, StringId b) noexcept { return a.m_nHash < b.m_nHash; }
+
+	private:
+		constexpr explicit StringId(std::uint64_t nHash) noexcept
+			: m_nHash{ nHash }
+		{}
+
+		std::uint64_t m_nHash;
+	};
+	static_assert(sizeof(StringId) == sizeof(std::uint64_t), "A StringId should only hold its hash");
+
+	// The string if known (debug), otherwise the hash in hexadecimal
+	std::string to_string(StringId id);
+}
+
+namespace std
+{
+	template<>
+	struct hash<HE::StringId>
+	{
+		size_t operator()(HE::StringId id) const noexcept
+		{
+			// Already a good hash
+			return static_cast<size_t>(id.GetHash());
+		}
+	};
+}
+
+// Form: HE_SID("Literal") -> StringId
+// Hashes the literal at compile time, even where the compiler would otherwise defer to runtime
+#define HE_SID(sLiteral) \
+	(HE::StringId::FromLiteral(std::integral_constant<std::uint64_t, HE::HashString(HE::constexpr_string{ sLiteral })>::value, HE::constexpr_string{ sLiteral }))
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace HE
+{
+	// Three copies of a T, passed from one writer thread to one reader thread without locks
+	// The writer fills the back buffer, then publishes it. The reader acquires the latest published buffer,
+	// and reads it for as long as it wants. Neither thread ever waits on the other: the writer always has a
+	// buffer that the reader is not using, and the reader keeps its buffer until it acquires a newer one
+	//
+	// Each thread owns one buffer, and the third is shared. Publish and Acquire swap the buffer of the calling
+	// thread with the shared one in a single atomic exchange, which also carries whether the shared buffer was
+	// published since the reader last acquired it
+	// Double buffering would make the writer wait for the reader to be done with the other buffer
+	template<class T>
+	class TripleBuffer
+	{
+	public:
+		TripleBuffer() = default;
+
+		// Form: TripleBuffer(args...), each buffer constructed with T(args...)
+		template<class... Args>
+		explicit TripleBuffer(const Args&... args)
+			: m_aBuffers{ { T(args...), T(args...), T(args...) } }
+		{
+
+		}
+
+		TripleBuffer(const TripleBuffer&) = delete;
+		void operator=(const TripleBuffer&) = delete;
+
+		// Writer only. The buffer to fill. It holds the content the writer published two Publish ago, at best
+		T& GetBack() noexcept { return m_aBuffers[m_nBack]; }
+
+		// Writer only. Makes the back buffer the latest for the reader, and takes the shared buffer as the new back buffer
+		void Publish() noexcept
+		{
+			// Release of the back buffer content, acquire of the reader being done with the shared one
+			m_nBack = static_cast<std::uint8_t>(m_nShared.exchange(static_cast<std::uint8_t>(m_nBack | Fresh), std::memory_order_acq_rel) & IndexMask);
+		}
+
+		// Reader only. Takes the latest published buffer as the front buffer
+		// Returns false, and keeps the front buffer, if nothing was published since the last Acquire
+		bool Acquire() noexcept
+		{
+			if ((m_nShared.load(std::memory_order_relaxed) & Fresh) == 0) return false;
+
+			m_nFront = static_cast<std::uint8_t>(m_nShared.exchange(m_nFront, std::memory_order_acq_rel) & IndexMask);
+			return true;
+		}
+
+		// Reader only. Default-constructed until the first Publish is acquired
+		const T& GetFront() const noexcept { return m_aBuffers[m_nFront]; }
+
+	private:
+		static constexpr std::uint8_t IndexMask = 0x3;
+		static constexpr std::uint8_t Fresh = 0x4;
+
+		std::array<T, 3> m_aBuffers;
+		// Each index is owned by one thread
+		std::uint8_t m_nBack{ 0 };
+		std::uint8_t m_nFront{ 1 };
+		std::atomic<std::uint8_t> m_nShared{ 2 };
+	};
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "HE_Assert.h"
+#include "HE_Math.h"
+
+namespace HE
+{
+	// Bounded Chase-Lev work-stealing deque of pointers
+	// The owner thread pushes and pops at the bottom, in LIFO order. Any other thread can steal from
+	// the top, in FIFO order. All operations are lock-free, and the owner only contends with thieves
+	// when a single item is left
+	// Based on "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê, Pop, Cohen, Zappa Nardelli),
+	// without the growing buffer: Push fails when the deque is full, and the caller decides where the item goes
+	template<class T>
+	class WorkStealingDeque
+	{
+	public:
+		explicit WorkStealingDeque(size_t nCapacity)
+			: m_nMask(static_cast<std::int64_t>(nCapacity) - 1),
+			m_aItems(new std::atomic<T*>[nCapacity])
+		{
+			EXPECTS(Math::IsPow2(nCapacity));
+		}
+		WorkStealingDeque(const WorkStealingDeque&) = delete;
+		void operator=(const WorkStealingDeque&) = delete;
+
+		// Owner only. Returns false if the deque is full
+		bool Push(T* pItem) noexcept
+		{
+			auto const nBottom = m_nBottom.load(std::memory_order_relaxed);
+			auto const nTop = m_nTop.load(std::memory_order_acquire);
+			if (nBottom - nTop > m_nMask) return false;
+
+			m_aItems[nBottom & m_nMask].store(pItem, std::memory_order_relaxed);
+			// Publishes the item, and whatever it points to, to the thieves
+			m_nBottom.store(nBottom + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Owner only. Returns nullptr if the deque is empty
+		T* Pop() noexcept
+		{
+			auto const nBottom = m_nBottom.load(std::memory_order_relaxed) - 1;
+			m_nBottom.store(nBottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			auto nTop = m_nTop.load(std::memory_order_relaxed);
+
+			if (nTop > nBottom)
+			{
+				// Empty
+				m_nBottom.store(nBottom + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			auto pItem = m_aItems[nBottom & m_nMask].load(std::memory_order_relaxed);
+			if (nTop == nBottom)
+			{
+				// Last item: race the thieves for it
+				if (!m_nTop.compare_exchange_strong(nTop, nTop + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					pItem = nullptr;
+				}
+				m_nBottom.store(nBottom + 1, std::memory_order_relaxed);
+			}
+			return pItem;
+		}
+
+		// Thread-safe. Returns nullptr if the deque is empty or another thread won the race for the item
+		T* Steal() noexcept
+		{
+			auto nTop = m_nTop.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			auto const nBottom = m_nBottom.load(std::memory_order_acquire);
+			if (nTop >= nBottom) return nullptr;
+
+			auto const pItem = m_aItems[nTop & m_nMask].load(std::memory_order_relaxed);
+			if (!m_nTop.compare_exchange_strong(nTop, nTop + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				return nullptr;
+			}
+			return pItem;
+		}
+
+		// Approximate when other threads are using the deque
+		bool IsEmpty() const noexcept
+		{
+			return m_nBottom.load(std::memory_order_relaxed) <= m_nTop.load(std::memory_order_relaxed);
+		}
+
+		// Approximate when other threads are using the deque
+		size_t GetSize() const noexcept
+		{
+			auto const nSize = m_nBottom.load(std::memory_order_relaxed) - m_nTop.load(std::memory_order_relaxed);
+			return nSize > 0 ? static_cast<size_t>(nSize) : 0;
+		}
+
+		size_t GetCapacity() const noexcept { return static_cast<size_t>(m_nMask + 1); }
+
+	private:
+		std::int64_t const m_nMask;
+		std::unique_ptr<std::atomic<T*>[]> m_aItems;
+
+		// On separate cache lines, since the owner writes the bottom and thieves write the top
+		alignas(64) std::atomic<std::int64_t> m_nTop{ 0 };
+		alignas(64) std::atomic<std::int64_t> m_nBottom{ 0 };
+	};
+}
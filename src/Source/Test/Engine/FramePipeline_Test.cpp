@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+
+#include "FramePipeline.h"
+#include "HE_JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace HE;
+using namespace std::chrono_literals;
+
+namespace
+{
+	// What ran, in order
+	class Trace
+	{
+	public:
+		void Add(size_t nStage, std::uint64_t nFrame)
+		{
+			std::lock_guard<std::mutex> lock{ m_mutEvents };
+			m_cEvents.emplace_back(nStage, nFrame);
+		}
+
+		std::vector<std::pair<size_t, std::uint64_t>> Get()
+		{
+			std::lock_guard<std::mutex> lock{ m_mutEvents };
+			return m_cEvents;
+		}
+
+		// Position of the stage of the frame in the trace
+		size_t Find(size_t nStage, std::uint64_t nFrame)
+		{
+			std::lock_guard<std::mutex> lock{ m_mutEvents };
+			for (size_t i = 0; i < m_cEvents.size(); ++i)
+			{
+				if (m_cEvents[i] == std::make_pair(nStage, nFrame)) return i;
+			}
+			return m_cEvents.size();
+		}
+
+	private:
+		std::mutex m_mutEvents;
+		std::vector<std::pair<size_t, std::uint64_t>> m_cEvents;
+	};
+}
+
+TEST(FramePipeline, StagesRunInOrder)
+{
+	JobSystem jobSystem{ 3 };
+	FramePipeline pipeline{ jobSystem, 3 };
+	Trace trace;
+	for (size_t i = 0; i < 4; ++i)
+	{
+		pipeline.AddStage("Stage", [&trace, i](const PipelineFrame& frame) {
+			trace.Add(i, frame.nNumber);
+			std::this_thread::sleep_for(100us);
+		});
+	}
+	EXPECT_EQ(4u, pipeline.GetStageCount());
+
+	for (std::uint64_t nFrame = 0; nFrame < 20; ++nFrame)
+	{
+		auto const frame = pipeline.StartFrame();
+		EXPECT_EQ(nFrame, frame.nNumber);
+		EXPECT_EQ(nFrame % 3, frame.nSlot);
+		EXPECT_LE(pipeline.GetFramesInFlight(), 3u);
+	}
+	pipeline.Flush();
+	EXPECT_EQ(0u, pipeline.GetFramesInFlight());
+	ASSERT_EQ(80u, trace.Get().size());
+
+	for (std::uint64_t nFrame = 0; nFrame < 20; ++nFrame)
+	{
+		for (size_t nStage = 0; nStage < 4; ++nStage)
+		{
+			auto const nPosition = trace.Find(nStage, nFrame);
+			if (nStage > 0)
+			{
+				EXPECT_LT(trace.Find(nStage - 1, nFrame), nPosition);
+			}
+			if (nFrame > 0)
+			{
+				EXPECT_LT(trace.Find(nStage, nFrame - 1), nPosition);
+			}
+		}
+	}
+}
+
+TEST(FramePipeline, StagesOverlap)
+{
+	// The stages sleep, so they overlap even on a single core
+	JobSystem jobSystem{ 3 };
+	FramePipeline pipeline{ jobSystem, 3 };
+	std::atomic<int> nRunning{ 0 };
+	std::atomic<int> nMaxRunning{ 0 };
+	for (int i = 0; i < 3; ++i)
+	{
+		pipeline.AddStage("Stage", [&nRunning, &nMaxRunning](const PipelineFrame&) {
+			auto const nNow = ++nRunning;
+			auto nMax = nMaxRunning.load();
+			while (nMax < nNow && !nMaxRunning.compare_exchange_weak(nMax, nNow)) { }
+			std::this_thread::sleep_for(2ms);
+			--nRunning;
+		});
+	}
+
+	for (int i = 0; i < 20; ++i)
+	{
+		pipeline.StartFrame();
+	}
+	pipeline.Flush();
+	EXPECT_GT(nMaxRunning.load(), 1);
+	EXPECT_LE(nMaxRunning.load(), 3);
+}
+
+TEST(FramePipeline, Backpressure)
+{
+	JobSystem jobSystem{ 3 };
+	FramePipeline pipeline{ jobSystem, 2 };
+	std::atomic<int> nStarted{ 0 };
+	std::atomic<int> nDone{ 0 };
+	bool bBounded = true;
+	pipeline.AddStage("First", [&nStarted](const PipelineFrame&) { ++nStarted; });
+	pipeline.AddStage("Slow", [&nDone](const PipelineFrame&) {
+		std::this_thread::sleep_for(1ms);
+		++nDone;
+	});
+
+	for (int i = 0; i < 20; ++i)
+	{
+		pipeline.StartFrame();
+		bBounded = bBounded && nStarted.load() - nDone.load() <= 2;
+	}
+	pipeline.Flush();
+	EXPECT_TRUE(bBounded);
+	EXPECT_EQ(20, nDone.load());
+}
+
+TEST(FramePipeline, PreviousFrameDependency)
+{
+	JobSystem jobSystem{ 3 };
+	FramePipeline pipeline{ jobSystem, 3 };
+	Trace trace;
+	auto const nSimulate = pipeline.AddStage("Simulate", [&trace](const PipelineFrame& frame) { trace.Add(0, frame.nNumber); });
+	auto const nExtract = pipeline.AddStage("Extract", [&trace](const PipelineFrame& frame) {
+		std::this_thread::sleep_for(200us);
+		trace.Add(1, frame.nNumber);
+	});
+	pipeline.AddStage("Render", [&trace](const PipelineFrame& frame) {
+		std::this_thread::sleep_for(500us);
+		trace.Add(2, frame.nNumber);
+	});
+	pipeline.AddPreviousFrameDependency(nSimulate, nExtract);
+
+	for (int i = 0; i < 10; ++i)
+	{
+		pipeline.StartFrame();
+	}
+	pipeline.Flush();
+
+	for (std::uint64_t nFrame = 1; nFrame < 10; ++nFrame)
+	{
+		EXPECT_LT(trace.Find(1, nFrame - 1), trace.Find(0, nFrame));
+	}
+}
+
+TEST(FramePipeline, Exception)
+{
+	JobSystem jobSystem{ 3 };
+	FramePipeline pipeline{ jobSystem, 2 };
+	std::atomic<int> nRendered{ 0 };
+	pipeline.AddStage("Simulate", [](const PipelineFrame& frame) {
+		if (frame.nNumber == 3) throw std::runtime_error{ "Simulate" };
+	});
+	pipeline.AddStage("Render", [&nRendered](const PipelineFrame&) { ++nRendered; });
+
+	auto const run = [&pipeline]() {
+		for (int i = 0; i < 10; ++i)
+		{
+			pipeline.StartFrame();
+		}
+		pipeline.Flush();
+	};
+	EXPECT_THROW(run(), std::runtime_error);
+	EXPECT_EQ(0u, pipeline.GetFramesInFlight());
+	// The stages left after the exception are skipped
+	auto const nRenderedBefore = nRendered.load();
+	EXPECT_LE(nRenderedBefore, 3);
+
+	// Then the pipeline starts over
+	pipeline.StartFrame();
+	pipeline.Flush();
+	EXPECT_EQ(nRenderedBefore + 1, nRendered.load());
+}
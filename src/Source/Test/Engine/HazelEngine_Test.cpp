@@ -0,0 +1,325 @@
+#include <gtest/gtest.h>
+
+#include "HazelEngine.h"
+#include "HE_Log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace HE;
+using namespace std::chrono_literals;
+
+HE_DEFINE_LOG_CATEGORY(EngineTest, Off);
+
+namespace
+{
+	// Messages of a single category
+	class CaptureLogSink : public LogSink
+	{
+	public:
+		explicit CaptureLogSink(const LogCategory& category) noexcept : m_category(category) { }
+
+		void Write(LogLevel, const LogCategory& category, const char* psMsg) noexcept override
+		{
+			if (&category == &m_category) m_cMessages.push_back(psMsg);
+		}
+
+		const LogCategory& m_category;
+		std::vector<std::string> m_cMessages;
+	};
+}
+
+TEST(FrameTimingHistory, Summary)
+{
+	FrameTimingHistory history{ 10ms };
+
+	FrameTiming timing;
+	timing.tInterval = 8ms;
+	timing.tWork = 2ms;
+	timing.nTicks = 1;
+	history.Add(timing);
+
+	timing.tInterval = 12ms;
+	timing.tWork = 11ms;
+	timing.nTicks = 2;
+	timing.bOverrun = true;
+	history.Add(timing);
+
+	auto const summary = history.GetSummary();
+	EXPECT_EQ(2u, summary.nFrames);
+	EXPECT_EQ(3u, summary.nTotalTicks);
+	EXPECT_EQ(1u, summary.nOverruns);
+	EXPECT_EQ(std::chrono::nanoseconds{ 10ms }, summary.tMeanInterval);
+	EXPECT_EQ(std::chrono::nanoseconds{ 12ms }, summary.tMaxInterval);
+	EXPECT_EQ(std::chrono::nanoseconds{ 2ms }, summary.tMeanJitter);
+	EXPECT_DOUBLE_EQ(100.0, summary.fFrameRate);
+	EXPECT_DOUBLE_EQ(150.0, summary.fTickRate);
+}
+
+TEST(FrameTimingHistory, KeepsRecentFrames)
+{
+	FrameTimingHistory history{ 0ms };
+
+	FrameTiming timing;
+	timing.tInterval = 1ms;
+	for (size_t i = 0; i < FrameTimingHistory::HistorySize * 2; ++i)
+	{
+		history.Add(timing);
+	}
+
+	auto const summary = history.GetSummary();
+	EXPECT_EQ(FrameTimingHistory::HistorySize, summary.nFrames);
+	EXPECT_EQ(FrameTimingHistory::HistorySize * 2, summary.nTotalFrames);
+	EXPECT_EQ(std::chrono::nanoseconds{ 0 }, summary.tMaxJitter);
+}
+
+TEST(Engine, FixedTickRate)
+{
+	EngineSettings settings;
+	settings.tTickPeriod = 5ms;
+	settings.tFramePeriod = 10ms;
+
+	Engine engine{ settings };
+	auto futEnd = engine.Run();
+	std::this_thread::sleep_for(200ms);
+	engine.Stop();
+	futEnd.get();
+
+	// Loose bounds, the test machine may be busy
+	auto const summary = engine.GetFrameTimingSummary();
+	EXPECT_GT(summary.nTotalFrames, 5u);
+	EXPECT_GT(summary.nTotalTicks, summary.nTotalFrames);
+	EXPECT_LE(summary.nTotalTicks, summary.nTotalFrames * settings.nMaxTicksPerFrame);
+}
+
+TEST(Engine, StopWakesLoop)
+{
+	EngineSettings settings;
+	settings.tFramePeriod = 10s;
+
+	Engine engine{ settings };
+	auto futEnd = engine.Run();
+	std::this_thread::sleep_for(20ms);
+
+	auto const tStop = std::chrono::steady_clock::now();
+	engine.Stop();
+	futEnd.get();
+	EXPECT_LT(std::chrono::steady_clock::now() - tStop, 5s);
+}
+
+TEST(Engine, RenderStages)
+{
+	EngineSettings settings;
+	settings.tTickPeriod = 5ms;
+	settings.tFramePeriod = 5ms;
+	settings.nPipelineDepth = 3;
+
+	std::atomic<std::uint64_t> nCulled{ 0 };
+	std::atomic<std::uint64_t> nSubmitted{ 0 };
+	std::atomic<bool> bInOrder{ true };
+	Engine engine{ settings };
+	engine.AddRenderStage("Cull", [&nCulled](const ModelSnapshot&, const PipelineFrame& frame) {
+		nCulled = frame.nNumber + 1;
+	});
+	engine.AddRenderStage("Submit", [&nCulled, &nSubmitted, &bInOrder](const ModelSnapshot&, const PipelineFrame& frame) {
+		if (nCulled.load() <= frame.nNumber || nSubmitted.load() != frame.nNumber) bInOrder = false;
+		nSubmitted = frame.nNumber + 1;
+	});
+
+	auto futEnd = engine.Run();
+	std::this_thread::sleep_for(100ms);
+	engine.Stop();
+	futEnd.get();
+
+	// Every frame started went through all the stages
+	EXPECT_TRUE(bInOrder.load());
+	EXPECT_EQ(engine.GetFrameTimingSummary().nTotalFrames, nSubmitted.load());
+}
+
+TEST(Engine, WorkIncludesStages)
+{
+	EngineSettings settings;
+	settings.tTickPeriod = 5ms;
+	settings.tFramePeriod = 5ms;
+	settings.nPipelineDepth = 2;
+
+	// Longer than the two frame periods the pipeline can absorb
+	Engine engine{ settings };
+	engine.AddRenderStage("Slow", [](const ModelSnapshot&, const PipelineFrame&) {
+		std::this_thread::sleep_for(15ms);
+	});
+
+	auto futEnd = engine.Run();
+	std::this_thread::sleep_for(100ms);
+	engine.Stop();
+	futEnd.get();
+
+	auto const summary = engine.GetFrameTimingSummary();
+	EXPECT_GE(summary.tMaxWork, 15ms);
+	EXPECT_GE(summary.tMeanWork, 15ms);
+	EXPECT_EQ(summary.nTotalFrames, summary.nTotalOverruns);
+}
+
+TEST(Engine, Profile)
+{
+	EngineSettings settings;
+	settings.tTickPeriod = 5ms;
+	settings.tFramePeriod = 5ms;
+	Engine engine{ settings };
+	engine.AddRenderStage("Render", [](const ModelSnapshot&, const PipelineFrame&) {});
+
+	auto futEnd = engine.Run();
+	std::this_thread::sleep_for(100ms);
+	engine.Stop();
+	futEnd.get();
+
+	auto const capture = engine.CaptureProfile();
+	EXPECT_FALSE(capture.cFrames.empty());
+	EXPECT_LE(capture.cFrames.size(), settings.nProfileFrames);
+
+	// The loop, the stages of the pipeline, and what they run
+	std::vector<std::string> cSeen;
+	for (auto const& frame : capture.cFrames)
+	{
+		for (auto const& event : frame.cEvents)
+		{
+			cSeen.push_back(capture.cNames[event.nName]);
+		}
+	}
+	for (auto const psName : { "Engine::StartFrame", "Simulate", "Model::Update", "Extract", "Render" })
+	{
+		EXPECT_NE(cSeen.end(), std::find(cSeen.begin(), cSeen.end(), psName)) << psName;
+	}
+	EXPECT_NE(capture.cThreadNames.end(), std::find(capture.cThreadNames.begin(), capture.cThreadNames.end(), "Engine"));
+}
+
+TEST(Engine, Metrics)
+{
+	EngineSettings settings;
+	settings.tTickPeriod = 5ms;
+	settings.tFramePeriod = 5ms;
+	settings.tMetricsLogPeriod = 50ms;
+	Engine engine{ settings };
+	auto& custom = engine.GetMetricsRegistry().GetCounter("Game.Custom");
+	custom.Add(7);
+
+	auto futEnd = engine.Run();
+	std::this_thread::sleep_for(100ms);
+	engine.Stop();
+	futEnd.get();
+
+	auto const metrics = engine.GetMetrics();
+	auto const nFrames = metrics.cCounters.at("Engine.Frames");
+	EXPECT_LT(0u, nFrames);
+	EXPECT_EQ(7u, metrics.cCounters.at("Game.Custom"));
+	EXPECT_EQ(nFrames, metrics.cHistograms.at("Engine.FrameInterval").nCount);
+	EXPECT_EQ(nFrames, metrics.cHistograms.at("Engine.FrameWork").nCount);
+	EXPECT_LE(metrics.cHistograms.at("Engine.FrameInterval").GetPercentile(0.5), metrics.cHistograms.at("Engine.FrameInterval").GetPercentile(0.99));
+	for (auto const psGauge : { "Jobs.Queued", "Jobs.Memory", "Model.Entities", "Model.ChunkMemory" })
+	{
+		EXPECT_NE(metrics.cGauges.end(), metrics.cGauges.find(psGauge)) << psGauge;
+	}
+}
+
+TEST(Engine, ParseSettings)
+{
+	auto const settings = ParseEngineSettings({ "game.exe", "--headless", "--tick-rate=30", "--frame-rate=0", "--time-scale=4.5",
+		"--max-ticks=1000", "--max-ticks-per-frame=16", "--workers=2", "--metrics-log-period=0.5", "--record-replay=match.replay", "--game-option=1" });
+	EXPECT_TRUE(settings.bHeadless);
+	EXPECT_EQ(std::chrono::nanoseconds{ 33333333 }, settings.tTickPeriod);
+	EXPECT_EQ(0, settings.tFramePeriod.count());
+	EXPECT_EQ(4.5, settings.fTimeScale);
+	EXPECT_EQ(1000u, settings.nMaxTicks);
+	EXPECT_EQ(16u, settings.nMaxTicksPerFrame);
+	EXPECT_EQ(2u, settings.nWorkerThreads);
+	EXPECT_EQ(std::chrono::nanoseconds{ 500ms }, settings.tMetricsLogPeriod);
+	EXPECT_EQ("match.replay", settings.sRecordReplayPath);
+
+	// Defaults are kept for what is not given
+	EngineSettings defaults;
+	defaults.nPipelineDepth = 1;
+	auto const kept = ParseEngineSettings({}, defaults);
+	EXPECT_FALSE(kept.bHeadless);
+	EXPECT_EQ(1u, kept.nPipelineDepth);
+	EXPECT_EQ(1.0, kept.fTimeScale);
+
+	for (auto const psInvalid : { "--tick-rate=0", "--tick-rate", "--frame-rate=fast", "--time-scale=-1", "--max-ticks=1.5",
+		"--max-ticks-per-frame=0", "--workers=2x", "--record-replay=", "--headless=no" })
+	{
+		EXPECT_THROW(ParseEngineSettings({ psInvalid }), std::invalid_argument) << psInvalid;
+	}
+}
+
+TEST(Engine, ParseSettingsWarnsOfUnknownArguments)
+{
+	auto const pCategory = LogCategory::Find("Engine");
+	ASSERT_NE(nullptr, pCategory);
+	CaptureLogSink sink{ *pCategory };
+	AddLogSink(sink);
+	auto const settings = ParseEngineSettings({ "game.exe", "--tick-rate=30", "--tickrate=20", "level1" });
+	RemoveLogSink(sink);
+
+	EXPECT_EQ(std::chrono::nanoseconds{ 33333333 }, settings.tTickPeriod);
+	ASSERT_EQ(1u, sink.m_cMessages.size());
+	EXPECT_NE(std::string::npos, sink.m_cMessages[0].find("--tickrate=20"));
+}
+
+TEST(Engine, Headless)
+{
+	// As fast as possible, for a fixed number of ticks: stops by itself
+	Engine engine{ std::vector<std::string>{ "--headless", "--time-scale=0", "--frame-rate=0", "--max-ticks=100", "--max-ticks-per-frame=8" } };
+	EXPECT_TRUE(engine.GetSettings().bHeadless);
+
+	auto futEnd = engine.Run();
+	ASSERT_EQ(std::future_status::ready, futEnd.wait_for(10s));
+	futEnd.get();
+
+	auto const summary = engine.GetFrameTimingSummary();
+	EXPECT_EQ(100u, summary.nTotalTicks);
+	// 8 ticks per frame, and the 4 left on the last one
+	EXPECT_EQ(13u, summary.nTotalFrames);
+	EXPECT_EQ(100u, engine.GetMetrics().cCounters.at("Engine.Ticks"));
+}
+
+TEST(Engine, FlushesLogSinks)
+{
+	CaptureLogSink target{ g_LogCategoryEngineTest };
+	DedupLogSink dedup{ target };
+	AddLogSink(dedup);
+	g_LogCategoryEngineTest.SetLevel(LogLevel::Info);
+	HE_LOG(Info, EngineTest, "Repeated");
+	HE_LOG(Info, EngineTest, "Repeated");
+
+	// The summary is emitted when the Engine stops
+	Engine engine{ std::vector<std::string>{ "--headless", "--time-scale=0", "--frame-rate=0", "--max-ticks=10" } };
+	engine.Run().get();
+	g_LogCategoryEngineTest.SetLevel(LogLevel::Off);
+	RemoveLogSink(dedup);
+
+	ASSERT_EQ(2u, target.m_cMessages.size());
+	EXPECT_EQ("Repeated (repeated 1 times)", target.m_cMessages[1]);
+}
+
+TEST(Engine, FasterThanRealTime)
+{
+	EngineSettings settings;
+	settings.tTickPeriod = 5ms;
+	settings.tFramePeriod = 10ms;
+	settings.fTimeScale = 4.0;
+	settings.bHeadless = true;
+
+	Engine engine{ settings };
+	auto futEnd = engine.Run();
+	std::this_thread::sleep_for(200ms);
+	engine.Stop();
+	futEnd.get();
+
+	// 8 ticks per 10ms frame instead of 2. Loose bound, the test machine may be busy
+	auto const summary = engine.GetFrameTimingSummary();
+	EXPECT_GT(summary.nTotalTicks, summary.nTotalFrames * 3);
+}
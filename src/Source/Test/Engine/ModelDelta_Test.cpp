@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+
+#include "Model.h"
+#include "ModelDelta.h"
+#include "ModelState.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace HE;
+
+// Components are found by type name: a named namespace keeps these apart from the types of other tests
+namespace ModelDeltaTest
+{
+	struct Position
+	{
+		float x, y;
+	};
+
+	struct Velocity
+	{
+		float x, y;
+	};
+
+	struct Health
+	{
+		int nValue;
+	};
+
+	struct Name
+	{
+		std::string sValue;
+	};
+}
+
+using namespace ModelDeltaTest;
+
+namespace
+{
+	// Returns the size of the delta
+	size_t Send(DeltaEncoder& encoder, Model& model, DeltaDecoder& decoder, Model& replica)
+	{
+		std::stringstream stream;
+		encoder.Encode(model, stream);
+		decoder.Apply(stream, replica);
+		return stream.str().size();
+	}
+}
+
+TEST(ModelDelta, Replicates)
+{
+	Model model;
+	std::vector<EntityHandle> cEntities;
+	for (int i = 0; i < 3000; ++i)
+	{
+		cEntities.push_back(i % 4 == 0 ? model.CreateEntity(Position{ static_cast<float>(i), 0.0f })
+			: model.CreateEntity(Position{ static_cast<float>(i), 1.0f }, Velocity{ 1.0f, 2.0f }));
+	}
+
+	DeltaEncoder encoder;
+	DeltaDecoder decoder;
+	Model replica;
+	Send(encoder, model, decoder, replica);
+	EXPECT_EQ(model.ComputeStateHash(), replica.ComputeStateHash());
+	EXPECT_EQ(3000u, replica.GetEntityCount());
+
+	// Every kind of change: writes, structural changes, new archetypes and component types
+	model.GetComponent<Position>(cEntities[10])->x = 100.0f;
+	model.DestroyEntity(cEntities[0]);
+	model.DestroyEntity(cEntities[2999]);
+	model.RemoveComponent<Velocity>(cEntities[2001]);
+	model.AddComponent(cEntities[1500], Health{ 10 });
+	auto const created = model.CreateEntityWithID(9000, Health{ 20 });
+	Send(encoder, model, decoder, replica);
+	EXPECT_EQ(model.ComputeStateHash(), replica.ComputeStateHash());
+	EXPECT_EQ(100.0f, replica.GetComponent<Position>(cEntities[10])->x);
+	EXPECT_FALSE(replica.IsAlive(cEntities[0]));
+	EXPECT_FALSE(replica.HasComponent<Velocity>(cEntities[2001]));
+	EXPECT_EQ(10, replica.GetComponent<Health>(cEntities[1500])->nValue);
+	EXPECT_EQ(created, replica.FindEntity(9000));
+	EXPECT_EQ(model.GetGlobalUniqueID(cEntities[5]), replica.GetGlobalUniqueID(cEntities[5]));
+
+	// Going back in time is a change like any other
+	ModelState state;
+	state.Save(model);
+	for (int i = 1; i < 1000; i += 2)
+	{
+		model.DestroyEntity(cEntities[i]);
+	}
+	Send(encoder, model, decoder, replica);
+	EXPECT_EQ(model.ComputeStateHash(), replica.ComputeStateHash());
+	state.Restore(model);
+	Send(encoder, model, decoder, replica);
+	EXPECT_EQ(model.ComputeStateHash(), replica.ComputeStateHash());
+	EXPECT_EQ(4u, decoder.GetSequence());
+
+	// New entities get the same handles and IDs in both
+	auto const next = model.CreateEntity(Position{});
+	auto const nextInReplica = replica.CreateEntity(Position{});
+	EXPECT_EQ(next, nextInReplica);
+	EXPECT_EQ(model.GetGlobalUniqueID(next), replica.GetGlobalUniqueID(nextInReplica));
+}
+
+TEST(ModelDelta, SendsChanges)
+{
+	Model model;
+	std::vector<EntityHandle> cEntities;
+	for (int i = 0; i < 10000; ++i)
+	{
+		cEntities.push_back(model.CreateEntity(Position{ static_cast<float>(i), 0.0f }, Velocity{ 1.0f, 0.0f }));
+	}
+
+	DeltaEncoder encoder;
+	DeltaDecoder decoder;
+	Model replica;
+	auto const nFullSize = Send(encoder, model, decoder, replica);
+	EXPECT_GT(nFullSize, 10000 * (sizeof(Position) + sizeof(Velocity)));
+
+	// Nothing changed
+	EXPECT_GT(64u, Send(encoder, model, decoder, replica));
+
+	// One component of one entity: only its column of its chunk
+	model.GetComponent<Velocity>(cEntities[5000])->x = 2.0f;
+	EXPECT_GT(64u, Send(encoder, model, decoder, replica));
+	EXPECT_EQ(2.0f, replica.GetComponent<Velocity>(cEntities[5000])->x);
+
+	// Written with the same values
+	for (auto const entity : cEntities)
+	{
+		model.GetComponent<Position>(entity)->y = 0.0f;
+	}
+	EXPECT_GT(nFullSize / 20, Send(encoder, model, decoder, replica));
+
+	model.DestroyEntity(cEntities[42]);
+	EXPECT_GT(nFullSize / 20, Send(encoder, model, decoder, replica));
+	EXPECT_EQ(model.ComputeStateHash(), replica.ComputeStateHash());
+}
+
+TEST(ModelDelta, Invalid)
+{
+	Model model;
+	model.CreateEntity(Position{ 1.0f, 2.0f });
+
+	DeltaEncoder encoder;
+	std::stringstream first;
+	encoder.Encode(model, first);
+	auto const sFirst = first.str();
+
+	{
+		DeltaDecoder decoder;
+		Model replica;
+		std::istringstream garbage{ "HEDL garbage" };
+		EXPECT_THROW(decoder.Apply(garbage, replica), std::runtime_error);
+	}
+	{
+		DeltaDecoder decoder;
+		Model replica;
+		std::istringstream truncated{ sFirst.substr(0, sFirst.size() / 2) };
+		EXPECT_THROW(decoder.Apply(truncated, replica), std::runtime_error);
+	}
+	{
+		// Applied twice: out of order
+		DeltaDecoder decoder;
+		Model replica;
+		std::istringstream stream{ sFirst };
+		decoder.Apply(stream, replica);
+		std::istringstream again{ sFirst };
+		EXPECT_THROW(decoder.Apply(again, replica), std::runtime_error);
+	}
+
+	model.CreateEntity(Name{ "Hazel" });
+	std::stringstream stream;
+	EXPECT_THROW(encoder.Encode(model, stream), std::invalid_argument);
+	EXPECT_TRUE(stream.str().empty());
+}
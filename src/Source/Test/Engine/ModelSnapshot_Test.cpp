@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include "HE_TripleBuffer.h"
+#include "Model.h"
+#include "ModelSnapshot.h"
+#include "Query.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace HE;
+
+namespace
+{
+	struct Position
+	{
+		float x, y;
+	};
+
+	struct Velocity
+	{
+		float x, y;
+	};
+
+	struct Name
+	{
+		std::string sValue;
+	};
+
+	float SumX(const ModelSnapshot& snapshot)
+	{
+		float fSum = 0.0f;
+		snapshot.ForEach<Position>([&fSum](EntityHandle, const Position& position) { fSum += position.x; });
+		return fSum;
+	}
+}
+
+TEST(ModelSnapshot, CopiesMaskedComponents)
+{
+	Model model;
+	auto const moving = model.CreateEntity(Position{ 1.0f, 2.0f }, Velocity{ 3.0f, 4.0f });
+	auto const named = model.CreateEntity(Position{ 5.0f, 6.0f }, Name{ "Hazel" });
+	model.CreateEntity(Velocity{ 7.0f, 8.0f });
+
+	ModelSnapshot snapshot{ MakeComponentMask<Position>() };
+	EXPECT_EQ(0u, snapshot.GetVersion());
+	snapshot.Capture(model);
+	EXPECT_EQ(2u, snapshot.GetEntityCount());
+	EXPECT_NE(0u, snapshot.GetVersion());
+	EXPECT_LT(snapshot.GetVersion(), model.GetChangeVersion());
+
+	std::vector<EntityHandle> cEntities;
+	snapshot.ForEach<Position>([&cEntities](EntityHandle entity, const Position& position) {
+		cEntities.push_back(entity);
+		EXPECT_EQ(position.x + 1.0f, position.y);
+	});
+	ASSERT_EQ(2u, cEntities.size());
+	EXPECT_EQ(moving, cEntities[0]);
+	EXPECT_EQ(named, cEntities[1]);
+
+	EXPECT_THROW(ModelSnapshot{ MakeComponentMask<Name>() }, std::invalid_argument);
+}
+
+TEST(ModelSnapshot, CopiesChangedChunks)
+{
+	Model model;
+	std::vector<EntityHandle> cEntities;
+	for (int i = 0; i < 3000; ++i)
+	{
+		cEntities.push_back(model.CreateEntity(Position{ 1.0f, 0.0f }, Velocity{ 1.0f, 0.0f }));
+	}
+
+	ModelSnapshot snapshot{ MakeComponentMask<Position>() };
+	snapshot.Capture(model);
+	EXPECT_EQ(3000.0f, SumX(snapshot));
+
+	// Writes that do not mark the chunk are not copied
+	const_cast<Position*>(static_cast<const Model&>(model).GetComponent<Position>(cEntities[0]))->x = 2.0f;
+	snapshot.Capture(model);
+	EXPECT_EQ(3000.0f, SumX(snapshot));
+
+	model.MarkChanged(cEntities[0]);
+	snapshot.Capture(model);
+	EXPECT_EQ(3001.0f, SumX(snapshot));
+
+	model.GetComponent<Position>(cEntities[2999])->x = 3.0f;
+	snapshot.Capture(model);
+	EXPECT_EQ(3003.0f, SumX(snapshot));
+
+	Query<Position, const Velocity> query{ model };
+	query.ForEach([](Position& position, const Velocity& velocity) { position.x += velocity.x; });
+	snapshot.Capture(model);
+	EXPECT_EQ(6003.0f, SumX(snapshot));
+
+	// Structural changes
+	model.DestroyEntity(cEntities[1]);
+	model.RemoveComponent<Velocity>(cEntities[2]);
+	model.CreateEntity(Position{ 10.0f, 0.0f });
+	snapshot.Capture(model);
+	EXPECT_EQ(3000u, snapshot.GetEntityCount());
+	EXPECT_EQ(6011.0f, SumX(snapshot));
+}
+
+TEST(ModelSnapshot, TripleBuffered)
+{
+	// Each buffer only copies what changed since its own last Capture, two Captures ago
+	Model model;
+	std::vector<EntityHandle> cEntities;
+	for (int i = 0; i < 2000; ++i)
+	{
+		cEntities.push_back(model.CreateEntity(Position{ 0.0f, 0.0f }));
+	}
+
+	TripleBuffer<ModelSnapshot> snapshots{ MakeComponentMask<Position>() };
+	for (int nFrame = 1; nFrame <= 10; ++nFrame)
+	{
+		model.GetComponent<Position>(cEntities[nFrame * 97 % cEntities.size()])->x += 1.0f;
+
+		snapshots.GetBack().Capture(model);
+		snapshots.Publish();
+		ASSERT_TRUE(snapshots.Acquire());
+		EXPECT_EQ(static_cast<float>(nFrame), SumX(snapshots.GetFront())) << "Frame " << nFrame;
+	}
+}
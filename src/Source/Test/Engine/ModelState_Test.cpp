@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include "Model.h"
+#include "ModelSnapshot.h"
+#include "ModelState.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace HE;
+
+namespace
+{
+	struct Position
+	{
+		float x, y;
+	};
+
+	struct Velocity
+	{
+		float x, y;
+	};
+
+	struct Name
+	{
+		std::string sValue;
+	};
+}
+
+TEST(ModelState, SaveAndRestore)
+{
+	Model model;
+	std::vector<EntityHandle> cEntities;
+	for (int i = 0; i < 3000; ++i)
+	{
+		cEntities.push_back(model.CreateEntity(Position{ static_cast<float>(i), 0.0f }, Velocity{ 1.0f, 0.0f }));
+	}
+	auto const still = model.CreateEntity(Position{ -1.0f, 0.0f });
+
+	ModelState state;
+	EXPECT_FALSE(state.IsSaved());
+	state.Save(model);
+	EXPECT_TRUE(state.IsSaved());
+	EXPECT_EQ(3001u, state.GetEntityCount());
+	auto const nHash = model.ComputeStateHash();
+
+	// Every kind of change: writes, structural changes, new archetypes
+	model.GetComponent<Position>(cEntities[10])->x = 100.0f;
+	model.DestroyEntity(cEntities[0]);
+	model.DestroyEntity(still);
+	model.RemoveComponent<Velocity>(cEntities[2000]);
+	model.AddComponent(cEntities[2999], Name{ "Hazel" });
+	auto const created = model.CreateEntity(Velocity{ 2.0f, 0.0f });
+	auto const nGlobalUniqueID = model.GetGlobalUniqueID(created);
+	EXPECT_NE(nHash, model.ComputeStateHash());
+
+	state.Restore(model);
+	EXPECT_EQ(nHash, model.ComputeStateHash());
+	EXPECT_EQ(3001u, model.GetEntityCount());
+	EXPECT_TRUE(model.IsAlive(cEntities[0]));
+	EXPECT_TRUE(model.IsAlive(still));
+	EXPECT_FALSE(model.IsAlive(created));
+	EXPECT_EQ(10.0f, model.GetComponent<Position>(cEntities[10])->x);
+	EXPECT_TRUE(model.HasComponent<Velocity>(cEntities[2000]));
+	EXPECT_FALSE(model.HasComponent<Name>(cEntities[2999]));
+	EXPECT_EQ(cEntities[0], model.FindEntity(model.GetGlobalUniqueID(cEntities[0])));
+	EXPECT_FALSE(model.FindEntity(nGlobalUniqueID).IsValid());
+
+	// The same ID is given again
+	auto const recreated = model.CreateEntity(Velocity{ 2.0f, 0.0f });
+	EXPECT_EQ(nGlobalUniqueID, model.GetGlobalUniqueID(recreated));
+}
+
+TEST(ModelState, RestoresChangedChunks)
+{
+	Model model;
+	std::vector<EntityHandle> cEntities;
+	for (int i = 0; i < 3000; ++i)
+	{
+		cEntities.push_back(model.CreateEntity(Position{ 1.0f, 0.0f }));
+	}
+
+	ModelState first;
+	first.Save(model);
+	model.GetComponent<Position>(cEntities[0])->x = 2.0f;
+	ModelState second;
+	second.Save(model);
+	model.GetComponent<Position>(cEntities[2999])->x = 3.0f;
+
+	// Back and forth between states, with no change in between
+	first.Restore(model);
+	EXPECT_EQ(1.0f, model.GetComponent<Position>(cEntities[0])->x);
+	EXPECT_EQ(1.0f, model.GetComponent<Position>(cEntities[2999])->x);
+	second.Restore(model);
+	EXPECT_EQ(2.0f, model.GetComponent<Position>(cEntities[0])->x);
+	EXPECT_EQ(1.0f, model.GetComponent<Position>(cEntities[2999])->x);
+
+	// Saving again into a state only copies what changed, and the snapshots see the restored chunks as changed
+	ModelSnapshot snapshot{ MakeComponentMask<Position>() };
+	snapshot.Capture(model);
+	model.GetComponent<Position>(cEntities[1])->x = 4.0f;
+	first.Save(model);
+	second.Restore(model);
+	snapshot.Capture(model);
+	float fSum = 0.0f;
+	snapshot.ForEach<Position>([&fSum](EntityHandle, const Position& position) { fSum += position.x; });
+	EXPECT_EQ(3001.0f, fSum);
+
+	first.Restore(model);
+	EXPECT_EQ(4.0f, model.GetComponent<Position>(cEntities[1])->x);
+}
+
+TEST(ModelState, NotTriviallyCopyable)
+{
+	Model model;
+	model.CreateEntity(Position{ 1.0f, 0.0f });
+
+	ModelState state;
+	state.Save(model);
+
+	// Dropped by a Restore, since they were created after the Save
+	model.CreateEntity(Name{ "Hazel" });
+	state.Restore(model);
+	EXPECT_EQ(1u, model.GetEntityCount());
+
+	model.CreateEntity(Name{ "Hazel" });
+	EXPECT_THROW(state.Save(model), std::invalid_argument);
+	EXPECT_FALSE(state.IsSaved());
+}
@@ -0,0 +1,401 @@
+#include <gtest/gtest.h>
+
+#include "CommandBuffer.h"
+#include "Model.h"
+#include "Query.h"
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+
+using namespace HE;
+
+namespace
+{
+	struct Position
+	{
+		float x, y;
+	};
+
+	struct Velocity
+	{
+		float x, y;
+	};
+
+	struct Name
+	{
+		std::string sValue;
+	};
+
+	// Counts its live instances, to check that the Model constructs and destroys components exactly once
+	struct Tracked
+	{
+		static int s_nAlive;
+
+		Tracked() noexcept { ++s_nAlive; }
+		explicit Tracked(int nValue) noexcept : pValue(std::make_unique<int>(nValue)) { ++s_nAlive; }
+		Tracked(Tracked&& other) noexcept : pValue(std::move(other.pValue)) { ++s_nAlive; }
+		Tracked& operator=(Tracked&& other) noexcept { pValue = std::move(other.pValue); return *this; }
+		~Tracked() { --s_nAlive; }
+
+		std::unique_ptr<int> pValue;
+	};
+	int Tracked::s_nAlive = 0;
+
+	// Padding after nTeam
+	struct Unit
+	{
+		std::uint8_t nTeam;
+		float fHealth;
+	};
+	HE_REFLECT(Unit, nTeam, fHealth)
+}
+
+TEST(Model, CreateEntity)
+{
+	Model model;
+	auto const entity = model.CreateEntity(Position{ 1.0f, 2.0f }, Name{ "Hazel" });
+
+	EXPECT_TRUE(model.IsAlive(entity));
+	EXPECT_EQ(1u, model.GetEntityCount());
+	ASSERT_NE(nullptr, model.GetComponent<Position>(entity));
+	EXPECT_EQ(2.0f, model.GetComponent<Position>(entity)->y);
+	EXPECT_EQ("Hazel", model.GetComponent<Name>(entity)->sValue);
+	EXPECT_FALSE(model.HasComponent<Velocity>(entity));
+
+	auto const other = model.CreateEntity();
+	EXPECT_NE(entity, other);
+	EXPECT_EQ(2u, model.GetEntityCount());
+}
+
+TEST(Model, DestroyKeepsOtherEntities)
+{
+	Model model;
+	std::vector<EntityHandle> cEntities;
+	for (int i = 0; i < 5000; ++i)
+	{
+		cEntities.push_back(model.CreateEntity(Position{ static_cast<float>(i), 0.0f }, Name{ std::to_string(i) }));
+	}
+
+	// Spans several chunks, so that removals move entities across chunks
+	for (int i = 0; i < 5000; i += 3)
+	{
+		model.DestroyEntity(cEntities[i]);
+	}
+
+	for (int i = 0; i < 5000; ++i)
+	{
+		if (i % 3 == 0)
+		{
+			EXPECT_FALSE(model.IsAlive(cEntities[i]));
+			continue;
+		}
+		ASSERT_TRUE(model.IsAlive(cEntities[i]));
+		EXPECT_EQ(static_cast<float>(i), model.GetComponent<Position>(cEntities[i])->x);
+		EXPECT_EQ(std::to_string(i), model.GetComponent<Name>(cEntities[i])->sValue);
+	}
+}
+
+TEST(Model, AddAndRemoveComponent)
+{
+	Model model;
+	auto const entity = model.CreateEntity(Position{ 1.0f, 2.0f });
+	auto const other = model.CreateEntity(Position{ 3.0f, 4.0f });
+
+	model.AddComponent(entity, Velocity{ 5.0f, 6.0f });
+	model.AddComponent(entity, Name{ "Moved" });
+	EXPECT_EQ(1.0f, model.GetComponent<Position>(entity)->x);
+	EXPECT_EQ(6.0f, model.GetComponent<Velocity>(entity)->y);
+	EXPECT_EQ(3.0f, model.GetComponent<Position>(other)->x);
+
+	// Replaces
+	model.AddComponent(entity, Velocity{ 7.0f, 8.0f });
+	EXPECT_EQ(7.0f, model.GetComponent<Velocity>(entity)->x);
+
+	model.RemoveComponent<Velocity>(entity);
+	EXPECT_FALSE(model.HasComponent<Velocity>(entity));
+	EXPECT_EQ(2.0f, model.GetComponent<Position>(entity)->y);
+	EXPECT_EQ("Moved", model.GetComponent<Name>(entity)->sValue);
+
+	// Does nothing
+	model.RemoveComponent<Velocity>(entity);
+	EXPECT_TRUE(model.IsAlive(entity));
+}
+
+TEST(Model, StaleHandles)
+{
+	Model model;
+	auto const entity = model.CreateEntity(Position{ 1.0f, 0.0f });
+	model.DestroyEntity(entity);
+	EXPECT_FALSE(model.IsAlive(entity));
+	EXPECT_EQ(nullptr, model.GetComponent<Position>(entity));
+
+	// Reuses the slot, with a new generation
+	auto const reused = model.CreateEntity(Position{ 2.0f, 0.0f });
+	EXPECT_EQ(entity.GetIndex(), reused.GetIndex());
+	EXPECT_NE(entity.GetGeneration(), reused.GetGeneration());
+	EXPECT_FALSE(model.IsAlive(entity));
+	EXPECT_TRUE(model.IsAlive(reused));
+	EXPECT_EQ(nullptr, model.GetComponent<Position>(entity));
+	EXPECT_EQ(2.0f, model.GetComponent<Position>(reused)->x);
+
+	EXPECT_FALSE(model.IsAlive(EntityHandle{}));
+	EXPECT_FALSE(model.IsAlive(EntityHandle{ 1000, 1 }));
+}
+
+TEST(Model, GlobalUniqueIDs)
+{
+	Model model;
+	auto const first = model.CreateEntity();
+	auto const loaded = model.CreateEntityWithID(1000, Position{ 3.0f, 0.0f });
+	auto const next = model.CreateEntity();
+
+	EXPECT_EQ(1000u, model.GetGlobalUniqueID(loaded));
+	EXPECT_NE(model.GetGlobalUniqueID(first), model.GetGlobalUniqueID(next));
+	// Automatic IDs never collide with the ones given
+	EXPECT_GT(model.GetGlobalUniqueID(next), 1000u);
+
+	EXPECT_EQ(loaded, model.FindEntity(1000));
+	EXPECT_EQ(first, model.FindEntity(model.GetGlobalUniqueID(first)));
+	EXPECT_FALSE(model.FindEntity(999).IsValid());
+
+	model.DestroyEntity(loaded);
+	EXPECT_FALSE(model.FindEntity(1000).IsValid());
+
+	// The slot is reused, the ID is not taken anymore
+	auto const reloaded = model.CreateEntityWithID(1000);
+	EXPECT_EQ(reloaded, model.FindEntity(1000));
+	EXPECT_NE(loaded, reloaded);
+}
+
+TEST(Model, ManyGlobalUniqueIDs)
+{
+	Model model;
+	std::map<std::uint64_t, EntityHandle> cExpected;
+	std::uint64_t nRandom = 1;
+	for (int i = 0; i < 20000; ++i)
+	{
+		// Spread IDs, and destroys at random, so that entries collide and move back on erase
+		nRandom = nRandom * 6364136223846793005ull + 1442695040888963407ull;
+		if (!cExpected.empty() && (nRandom >> 60) < 6)
+		{
+			auto const it = cExpected.lower_bound(nRandom >> 40);
+			auto const itErased = it != cExpected.end() ? it : cExpected.begin();
+			model.DestroyEntity(itErased->second);
+			cExpected.erase(itErased);
+		}
+		else
+		{
+			auto const nID = (nRandom >> 40) * 64 + 1;
+			if (!cExpected.count(nID)) cExpected[nID] = model.CreateEntityWithID(nID);
+		}
+	}
+
+	EXPECT_EQ(cExpected.size(), model.GetEntityCount());
+	for (auto const& expected : cExpected)
+	{
+		EXPECT_EQ(expected.second, model.FindEntity(expected.first));
+		EXPECT_FALSE(model.FindEntity(expected.first + 1).IsValid());
+	}
+}
+
+TEST(Model, ComponentLifetimes)
+{
+	{
+		Model model;
+		std::vector<EntityHandle> cEntities;
+		for (int i = 0; i < 1000; ++i)
+		{
+			cEntities.push_back(model.CreateEntity(Tracked{ i }, Position{}));
+		}
+		EXPECT_EQ(1000, Tracked::s_nAlive);
+
+		for (int i = 0; i < 1000; i += 2)
+		{
+			model.DestroyEntity(cEntities[i]);
+		}
+		EXPECT_EQ(500, Tracked::s_nAlive);
+
+		for (int i = 1; i < 1000; i += 4)
+		{
+			model.RemoveComponent<Position>(cEntities[i]);
+		}
+		EXPECT_EQ(500, Tracked::s_nAlive);
+		EXPECT_EQ(5, *model.GetComponent<Tracked>(cEntities[5])->pValue);
+		EXPECT_EQ(7, *model.GetComponent<Tracked>(cEntities[7])->pValue);
+	}
+	EXPECT_EQ(0, Tracked::s_nAlive);
+}
+
+TEST(Model, ChunksAreDense)
+{
+	Model model;
+	for (int i = 0; i < 3000; ++i)
+	{
+		model.CreateEntity(Position{}, Velocity{});
+	}
+
+	Query<Position, Velocity> query{ model };
+	ASSERT_EQ(1u, query.GetArchetypes().size());
+	auto const& archetype = *query.GetArchetypes().front();
+	EXPECT_LE(archetype.GetChunkCapacity() * (sizeof(EntityHandle) + sizeof(Position) + sizeof(Velocity)), Chunk::Size);
+
+	size_t nChunks = 0;
+	query.ForEachChunk([&](const ChunkView<Position, Velocity>& view) {
+		++nChunks;
+		auto const nAddress = reinterpret_cast<std::uintptr_t>(view.Get<Velocity>());
+		EXPECT_EQ(0u, nAddress % Chunk::ColumnAlignment);
+		if (nChunks < archetype.GetChunkCount())
+		{
+			EXPECT_EQ(archetype.GetChunkCapacity(), view.GetCount());
+		}
+	});
+	EXPECT_EQ((3000 + archetype.GetChunkCapacity() - 1) / archetype.GetChunkCapacity(), nChunks);
+}
+
+TEST(Query, MatchesAllComponents)
+{
+	Model model;
+	model.CreateEntity(Position{ 1.0f, 0.0f });
+	model.CreateEntity(Position{ 2.0f, 0.0f }, Velocity{ 1.0f, 1.0f });
+	model.CreateEntity(Velocity{ 1.0f, 1.0f });
+
+	Query<Position, const Velocity> query{ model };
+	auto nCount = 0;
+	query.ForEach([&](Position& position, const Velocity& velocity) {
+		position.x += velocity.x;
+		++nCount;
+	});
+	EXPECT_EQ(1, nCount);
+	EXPECT_EQ(1u, query.GetEntityCount());
+
+	// Picks up the archetypes created after the first use
+	auto const entity = model.CreateEntity(Velocity{ 2.0f, 0.0f }, Position{ 0.0f, 0.0f }, Name{});
+	query.ForEach([&](Position& position, const Velocity& velocity) {
+		position.x += velocity.x;
+	});
+	EXPECT_EQ(2u, query.GetEntityCount());
+	EXPECT_EQ(2.0f, model.GetComponent<Position>(entity)->x);
+
+	float fSum = 0.0f;
+	Query<Position>{ model }.ForEachEntity([&](EntityHandle e, const Position& position) {
+		EXPECT_TRUE(model.IsAlive(e));
+		fSum += position.x;
+	});
+	EXPECT_EQ(1.0f + 4.0f + 2.0f, fSum);
+}
+
+TEST(CommandBuffer, DefersStructuralChanges)
+{
+	Model model;
+	auto const entity = model.CreateEntity(Position{ 1.0f, 1.0f });
+	auto const doomed = model.CreateEntity(Position{ 2.0f, 2.0f });
+
+	CommandBuffer commands{ model };
+	Query<Position>{ model }.ForEachEntity([&](EntityHandle e, Position& position) {
+		if (position.x > 1.5f)
+		{
+			commands.DestroyEntity(e);
+		}
+		else
+		{
+			commands.AddComponent(e, Name{ "Added" });
+			commands.CreateEntity(Position{ position.x * 10.0f, 0.0f }, Tracked{ 3 });
+		}
+	});
+	auto const removed = model.CreateEntity(Position{}, Velocity{});
+	commands.RemoveComponent<Velocity>(removed);
+
+	// Nothing happened yet
+	EXPECT_EQ(3u, model.GetEntityCount());
+	EXPECT_TRUE(model.IsAlive(doomed));
+	EXPECT_EQ(6u, commands.GetCommandCount());
+
+	model.Apply(commands);
+	EXPECT_TRUE(commands.IsEmpty());
+	EXPECT_FALSE(model.IsAlive(doomed));
+	EXPECT_EQ("Added", model.GetComponent<Name>(entity)->sValue);
+	EXPECT_FALSE(model.HasComponent<Velocity>(removed));
+	EXPECT_EQ(1, Tracked::s_nAlive);
+
+	Query<Position, Tracked> created{ model };
+	created.ForEach([](Position& position, Tracked& tracked) {
+		EXPECT_EQ(10.0f, position.x);
+		EXPECT_EQ(3, *tracked.pValue);
+	});
+	EXPECT_EQ(1u, created.GetEntityCount());
+}
+
+TEST(CommandBuffer, DropsCommandsOnDeadEntities)
+{
+	Model model;
+	auto const entity = model.CreateEntity(Position{});
+
+	{
+		CommandBuffer commands{ model };
+		commands.DestroyEntity(entity);
+		commands.DestroyEntity(entity);
+		commands.AddComponent(entity, Tracked{ 1 });
+		model.Apply(commands);
+		EXPECT_EQ(0u, model.GetEntityCount());
+		EXPECT_EQ(0, Tracked::s_nAlive);
+
+		// Never applied: the components are destroyed with the buffer
+		commands.CreateEntity(Tracked{ 2 });
+		commands.AddComponent(entity, Tracked{ 3 });
+		EXPECT_EQ(2, Tracked::s_nAlive);
+	}
+	EXPECT_EQ(0, Tracked::s_nAlive);
+}
+
+TEST(CommandBuffer, PendingHandles)
+{
+	Model model;
+	auto const existing = model.CreateEntity();
+
+	CommandBuffer commands{ model };
+	auto const parent = commands.CreateEntity(Position{ 1.0f, 0.0f });
+	auto const child = commands.CreateEntity(Position{ 2.0f, 0.0f });
+	EXPECT_TRUE(parent.IsPending());
+	EXPECT_FALSE(model.IsAlive(parent));
+
+	commands.AddComponent(child, Velocity{ 5.0f, 0.0f });
+	commands.DestroyEntity(parent);
+	commands.DestroyEntity(existing);
+	model.Apply(commands);
+
+	auto const& cCreated = commands.GetCreatedEntities();
+	ASSERT_EQ(2u, cCreated.size());
+	EXPECT_FALSE(model.IsAlive(cCreated[parent.GetIndex()]));
+	EXPECT_TRUE(model.IsAlive(cCreated[child.GetIndex()]));
+	EXPECT_EQ(5.0f, model.GetComponent<Velocity>(cCreated[child.GetIndex()])->x);
+	EXPECT_EQ(1u, model.GetEntityCount());
+}
+
+TEST(Model, ReflectedComponents)
+{
+	// The padding is left out of the hash
+	Unit first;
+	std::memset(&first, 0x00, sizeof(first));
+	first.nTeam = 1;
+	first.fHealth = 10.0f;
+	Unit second;
+	std::memset(&second, 0xFF, sizeof(second));
+	second.nTeam = 1;
+	second.fHealth = 10.0f;
+
+	Model a;
+	Model b;
+	auto const entity = a.CreateEntity(first, Position{ 1.0f, 2.0f });
+	b.CreateEntity(second, Position{ 1.0f, 2.0f });
+	EXPECT_EQ(a.ComputeStateHash(), b.ComputeStateHash());
+
+	a.GetComponent<Unit>(entity)->fHealth = 5.0f;
+	EXPECT_NE(a.ComputeStateHash(), b.ComputeStateHash());
+
+	auto const sDescription = a.DescribeEntity(entity);
+	EXPECT_NE(std::string::npos, sDescription.find("{ nTeam: 1, fHealth: 5 }\n"));
+	EXPECT_NE(std::string::npos, sDescription.find(typeid(Position).name()));
+}
@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+
+#include "HazelEngine.h"
+#include "HE_JobSystem.h"
+#include "Model.h"
+#include "Replay.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace HE;
+
+namespace
+{
+	struct Position
+	{
+		float x, y;
+	};
+
+	struct Velocity
+	{
+		float x, y;
+	};
+
+	// Each byte of input pushes the entity of that index
+	void AddScenario(Model& model)
+	{
+		for (int i = 0; i < 1000; ++i)
+		{
+			model.CreateEntity(Position{ static_cast<float>(i), 0.0f }, Velocity{ 0.0f, 0.0f });
+		}
+
+		auto& systems = model.GetSystems();
+		systems.AddTask("Push", MakeComponentMask<Velocity>(), MakeComponentMask<Velocity>(), [](SystemContext& context) {
+			auto const& model = context.GetModel();
+			for (auto const nIndex : model.GetInput())
+			{
+				auto const entity = model.FindEntity(nIndex + 1u);
+				auto const velocity = *model.GetComponent<Velocity>(entity);
+				context.GetCommands().AddComponent(entity, Velocity{ velocity.x + 1.0f, velocity.y });
+			}
+		});
+		systems.AddSyncPoint();
+		systems.AddSystem<Position, const Velocity>("Move", [](SystemContext& context, const ChunkView<Position, const Velocity>& view) {
+			auto const pPositions = view.Get<Position>();
+			auto const pVelocities = view.Get<const Velocity>();
+			auto const fDt = static_cast<float>(context.GetDt());
+			for (size_t i = 0; i < view.GetCount(); ++i)
+			{
+				pPositions[i].x += pVelocities[i].x * fDt;
+				pPositions[i].y += pVelocities[i].y * fDt;
+			}
+		});
+	}
+
+	// 100 ticks, with input on some of them
+	std::string Record(JobSystem& jobSystem, std::uint64_t& nFinalHash)
+	{
+		Model model;
+		AddScenario(model);
+
+		std::ostringstream stream;
+		ReplayRecorder recorder{ stream, model, 10 };
+		for (std::uint32_t nTick = 0; nTick < 100; ++nTick)
+		{
+			if (nTick % 3 == 0)
+			{
+				unsigned char const aInput[] = { static_cast<unsigned char>(nTick), static_cast<unsigned char>(nTick * 7) };
+				model.SetInput(aInput, sizeof(aInput));
+			}
+			recorder.Update(model, 1.0 / 60.0, jobSystem);
+		}
+		EXPECT_EQ(100u, recorder.GetTickCount());
+		nFinalHash = model.ComputeStateHash();
+		return stream.str();
+	}
+}
+
+TEST(Replay, SameStates)
+{
+	JobSystem jobSystem{ 3 };
+	std::uint64_t nFinalHash;
+	auto const sRecording = Record(jobSystem, nFinalHash);
+
+	Model model;
+	AddScenario(model);
+	std::istringstream stream{ sRecording };
+	auto const result = RunReplay(stream, model, jobSystem);
+
+	EXPECT_FALSE(result.HasDiverged());
+	EXPECT_EQ(100u, result.nTicks);
+	// The state before the first tick, then every 10 ticks
+	EXPECT_EQ(11u, result.nChecksums);
+	EXPECT_EQ(100u, result.tickTime.nCount);
+	EXPECT_LE(result.tickTime.GetPercentile(0.5), result.tickTime.GetPercentile(0.99));
+	EXPECT_EQ(nFinalHash, model.ComputeStateHash());
+	EXPECT_NE(std::string::npos, to_string(result).find("Replayed 100 ticks"));
+}
+
+TEST(Replay, Divergence)
+{
+	JobSystem jobSystem{ 3 };
+	std::uint64_t nFinalHash;
+	auto sRecording = Record(jobSystem, nFinalHash);
+
+	{
+		// Set up differently
+		Model model;
+		AddScenario(model);
+		model.CreateEntity(Position{ 0.0f, 0.0f });
+		std::istringstream stream{ sRecording };
+		auto const result = RunReplay(stream, model, jobSystem);
+		EXPECT_EQ(0u, result.nDivergentTick);
+		EXPECT_EQ(0u, result.nTicks);
+	}
+
+	{
+		// A system that behaves differently from tick 25
+		Model model;
+		AddScenario(model);
+		std::uint32_t nTick = 0;
+		model.GetSystems().AddTask("Drift", MakeComponentMask<Position>(), MakeComponentMask<Position>(), [&nTick](SystemContext& context) {
+			if (++nTick <= 25) return;
+			auto const entity = context.GetModel().FindEntity(1);
+			context.GetCommands().AddComponent(entity, Position{ 0.0f, static_cast<float>(nTick) });
+		});
+
+		std::istringstream stream{ sRecording };
+		auto const result = RunReplay(stream, model, jobSystem);
+		EXPECT_TRUE(result.HasDiverged());
+		// Caught by the next state hash
+		EXPECT_EQ(30u, result.nDivergentTick);
+		EXPECT_EQ(30u, result.nTicks);
+	}
+
+	// Truncated in the middle of a tick
+	{
+		Model model;
+		AddScenario(model);
+		std::istringstream stream{ sRecording.substr(0, sRecording.size() / 2) };
+		EXPECT_THROW(RunReplay(stream, model, jobSystem), std::runtime_error);
+	}
+
+	{
+		Model model;
+		std::istringstream stream{ "HEPF" };
+		EXPECT_THROW(RunReplay(stream, model, jobSystem), std::runtime_error);
+	}
+}
+
+TEST(Replay, Engine)
+{
+	auto const sPath = std::string{ "Replay_Test.bin" };
+	EngineSettings settings;
+	settings.bHeadless = true;
+	settings.fTimeScale = 0.0;
+	settings.tFramePeriod = std::chrono::nanoseconds{ 0 };
+	settings.nMaxTicks = 50;
+	settings.sRecordReplayPath = sPath;
+
+	std::uint64_t nFinalHash;
+	{
+		Engine engine{ settings };
+		AddScenario(engine.GetModel());
+		unsigned char const aInput[] = { 1, 2, 3 };
+		engine.QueueInput(aInput, sizeof(aInput));
+		engine.Run().get();
+		nFinalHash = engine.GetModel().ComputeStateHash();
+	}
+
+	JobSystem jobSystem{ 1 };
+	Model model;
+	AddScenario(model);
+	{
+		std::ifstream file{ sPath, std::ios::binary };
+		auto const result = RunReplay(file, model, jobSystem);
+		EXPECT_FALSE(result.HasDiverged());
+		EXPECT_EQ(50u, result.nTicks);
+	}
+	EXPECT_EQ(nFinalHash, model.ComputeStateHash());
+	std::remove(sPath.c_str());
+}
@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+
+#include "Model.h"
+#include "Query.h"
+#include "SceneFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace HE;
+using namespace std::string_literals;
+
+// Components are found by type name: a named namespace keeps these apart from the types of other tests
+namespace SceneFileTest
+{
+	struct Position
+	{
+		float x, y;
+	};
+
+	struct Velocity
+	{
+		float x, y;
+	};
+
+	struct Name
+	{
+		std::string sValue;
+	};
+}
+
+using namespace SceneFileTest;
+
+namespace
+{
+	// Entities in a few archetypes, with destroyed entities for free slots
+	std::vector<EntityHandle> MakeScene(Model& model)
+	{
+		std::vector<EntityHandle> cEntities;
+		for (int i = 0; i < 2000; ++i)
+		{
+			cEntities.push_back(i % 3 == 0 ? model.CreateEntity(Position{ static_cast<float>(i), 0.0f })
+				: model.CreateEntity(Position{ static_cast<float>(i), 1.0f }, Velocity{ 1.0f, 2.0f }));
+		}
+		for (int i = 0; i < 2000; i += 7)
+		{
+			model.DestroyEntity(cEntities[i]);
+		}
+		cEntities.push_back(model.CreateEntityWithID(5000, Velocity{ 3.0f, 4.0f }));
+		return cEntities;
+	}
+
+	void Corrupt(const std::string& sPath, std::streamoff nOffset)
+	{
+		std::fstream file{ sPath, std::ios::binary | std::ios::in | std::ios::out };
+		file.seekg(nOffset);
+		auto const c = static_cast<char>(file.get() ^ 0x5A);
+		file.seekp(nOffset);
+		file.put(c);
+	}
+}
+
+TEST(SceneFile, SaveAndLoad)
+{
+	auto const sPath = "HE_SceneFile_Test.bin"s;
+	Model model;
+	auto const cEntities = MakeScene(model);
+	SceneFile::Save(model, sPath);
+
+	{
+		auto const scene = SceneFile::Open(sPath);
+		EXPECT_EQ(model.GetEntityCount(), scene.GetEntityCount());
+
+		Model loaded;
+		scene.Load(loaded);
+		EXPECT_EQ(model.ComputeStateHash(), loaded.ComputeStateHash());
+		EXPECT_EQ(model.GetEntityCount(), loaded.GetEntityCount());
+		EXPECT_FALSE(loaded.IsAlive(cEntities[0]));
+		EXPECT_EQ(1.0f, loaded.GetComponent<Position>(cEntities[1])->y);
+		EXPECT_EQ(cEntities.back(), loaded.FindEntity(5000));
+
+		// Loaded entities are like any other, and new ones get the same handles and IDs as in the saved Model
+		auto const created = model.CreateEntity(Position{});
+		auto const createdInLoaded = loaded.CreateEntity(Position{});
+		EXPECT_EQ(created, createdInLoaded);
+		EXPECT_EQ(model.GetGlobalUniqueID(created), loaded.GetGlobalUniqueID(createdInLoaded));
+		loaded.DestroyEntity(cEntities[1]);
+		EXPECT_FALSE(loaded.IsAlive(cEntities[1]));
+	}
+	std::remove(sPath.c_str());
+}
+
+TEST(SceneFile, ReadInPlace)
+{
+	auto const sPath = "HE_SceneFile_Test.bin"s;
+	Model model;
+	MakeScene(model);
+	SceneFile::Save(model, sPath, false);
+
+	{
+		auto const scene = SceneFile::Open(sPath);
+		size_t nCount = 0;
+		float fSum = 0.0f;
+		scene.ForEachChunk<Position, Velocity>([&](const ChunkView<const Position, const Velocity>& view) {
+			for (std::uint32_t i = 0; i < view.GetCount(); ++i)
+			{
+				fSum += view.Get<const Position>()[i].y + view.Get<const Velocity>()[i].x;
+			}
+			nCount += view.GetCount();
+		});
+
+		Query<const Position, const Velocity> query{ model };
+		EXPECT_EQ(query.GetEntityCount(), nCount);
+		EXPECT_EQ(2.0f * nCount, fSum);
+	}
+	std::remove(sPath.c_str());
+}
+
+TEST(SceneFile, Invalid)
+{
+	auto const sPath = "HE_SceneFile_Test.bin"s;
+	Model model;
+	MakeScene(model);
+	SceneFile::Save(model, sPath);
+
+	// In the components, past the tables
+	Corrupt(sPath, 3 * 4096 + 100);
+	EXPECT_THROW(SceneFile::Open(sPath), std::runtime_error);
+	EXPECT_NO_THROW(SceneFile::Open(sPath, false));
+
+	// In the magic
+	Corrupt(sPath, 0);
+	EXPECT_THROW(SceneFile::Open(sPath, false), std::runtime_error);
+
+	{
+		std::ofstream file{ sPath, std::ios::binary | std::ios::trunc };
+		file << "HESC";
+	}
+	EXPECT_THROW(SceneFile::Open(sPath), std::runtime_error);
+	std::remove(sPath.c_str());
+
+	model.CreateEntity(Name{ "Hazel" });
+	EXPECT_THROW(SceneFile::Save(model, sPath), std::invalid_argument);
+	std::remove(sPath.c_str());
+}
+
+TEST(SceneFile, EmptyArchetype)
+{
+	auto const sPath = "HE_SceneFile_Test.bin"s;
+	Model model;
+	model.CreateEntity(Position{ 1.0f, 2.0f });
+	SceneFile::Save(model, sPath, false);
+
+	std::vector<char> cFile;
+	{
+		std::ifstream file{ sPath, std::ios::binary };
+		cFile.assign(std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{});
+	}
+	auto const read = [&cFile](size_t nOffset) {
+		std::uint64_t n;
+		std::memcpy(&n, &cFile[nOffset], sizeof(n));
+		return n;
+	};
+	auto const write = [&cFile](size_t nOffset, std::uint64_t n) { std::memcpy(&cFile[nOffset], &n, sizeof(n)); };
+
+	// A second archetype record of 48 bytes, without types, entities nor chunks, with a chunk capacity of 1
+	// Header fields: the archetype count at 20, the offsets of the archetypes at 80, then of the columns, names,
+	// slots and free slots at 88, 96, 112 and 120. The record is taken from the padding before the chunks
+	std::uint32_t nArchetypeCount;
+	std::memcpy(&nArchetypeCount, &cFile[20], sizeof(nArchetypeCount));
+	ASSERT_EQ(1u, nArchetypeCount);
+	++nArchetypeCount;
+	std::memcpy(&cFile[20], &nArchetypeCount, sizeof(nArchetypeCount));
+	for (size_t nField : { 88, 96, 112, 120 }) write(nField, read(nField) + 48);
+
+	std::vector<char> cRecord(48, '\0');
+	cRecord[32] = 1;
+	ASSERT_EQ(std::vector<char>(48, '\0'), std::vector<char>(cFile.begin() + 4096 - 48, cFile.begin() + 4096));
+	cFile.erase(cFile.begin() + 4096 - 48, cFile.begin() + 4096);
+	cFile.insert(cFile.begin() + static_cast<std::ptrdiff_t>(read(80) + 48), cRecord.begin(), cRecord.end());
+	{
+		std::ofstream file{ sPath, std::ios::binary | std::ios::trunc };
+		file.write(cFile.data(), static_cast<std::streamsize>(cFile.size()));
+	}
+
+	EXPECT_THROW(SceneFile::Open(sPath, false), std::runtime_error);
+	std::remove(sPath.c_str());
+}
@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+
+#include "ChunkArena.h"
+#include "Model.h"
+#include "SessionHost.h"
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace HE;
+using namespace std::chrono_literals;
+
+namespace
+{
+	struct Position
+	{
+		float x, y;
+	};
+
+	// Counts the ticks of the session in its Model, and moves a few entities
+	void AddCountingSession(Model& model)
+	{
+		for (int i = 0; i < 100; ++i)
+		{
+			model.CreateEntity(Position{ static_cast<float>(i), 0.0f });
+		}
+		model.GetSystems().AddSystem<Position>("Move", [](SystemContext& context, const ChunkView<Position>& view) {
+			auto const pPositions = view.Get<Position>();
+			for (size_t i = 0; i < view.GetCount(); ++i)
+			{
+				pPositions[i].y += static_cast<float>(context.GetDt());
+			}
+		});
+	}
+}
+
+TEST(ChunkArena, Budget)
+{
+	ChunkArena arena{ 3 * Chunk::Size, 2 };
+
+	std::vector<unsigned char*> cChunks;
+	for (int i = 0; i < 3; ++i)
+	{
+		cChunks.push_back(arena.Allocate());
+		EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(cChunks.back()) % Chunk::ColumnAlignment);
+	}
+	EXPECT_EQ(3 * Chunk::Size, arena.GetUsedBytes());
+	// The last slab is cut to the budget
+	EXPECT_EQ(3 * Chunk::Size, arena.GetReservedBytes());
+	EXPECT_THROW(arena.Allocate(), std::bad_alloc);
+
+	// Freed chunks are reused, without reserving more
+	auto const pFreed = cChunks[1];
+	arena.Free(pFreed);
+	EXPECT_EQ(2 * Chunk::Size, arena.GetUsedBytes());
+	cChunks[1] = arena.Allocate();
+	EXPECT_EQ(pFreed, cChunks[1]);
+	EXPECT_EQ(3 * Chunk::Size, arena.GetReservedBytes());
+
+	for (auto const pChunk : cChunks) arena.Free(pChunk);
+	EXPECT_EQ(0u, arena.GetUsedBytes());
+}
+
+TEST(ChunkArena, Model)
+{
+	ChunkArena arena{ 2 * Chunk::Size };
+	{
+		Model model{ arena };
+		std::vector<EntityHandle> cEntities;
+		try
+		{
+			for (;;)
+			{
+				cEntities.push_back(model.CreateEntity(Position{ 1.0f, 2.0f }));
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+
+		}
+
+		// Up to the budget, and the Model is left as it was before the failed creation
+		EXPECT_LT(0u, cEntities.size());
+		EXPECT_EQ(cEntities.size(), model.GetEntityCount());
+		EXPECT_EQ(model.GetChunkMemory(), arena.GetUsedBytes());
+		EXPECT_EQ(2 * Chunk::Size, arena.GetUsedBytes());
+
+		for (auto const entity : cEntities) model.DestroyEntity(entity);
+		EXPECT_EQ(model.GetChunkMemory(), arena.GetUsedBytes());
+	}
+	EXPECT_EQ(0u, arena.GetUsedBytes());
+}
+
+TEST(SessionHost, Ticks)
+{
+	SessionHostSettings hostSettings;
+	hostSettings.nWorkerThreads = 2;
+	SessionHost host{ hostSettings };
+
+	SessionSettings settings;
+	settings.tTickPeriod = 5ms;
+	std::vector<Session*> cSessions;
+	for (int i = 0; i < 4; ++i)
+	{
+		cSessions.push_back(&host.AddSession("Session" + std::to_string(i), settings, AddCountingSession));
+	}
+	EXPECT_EQ(4u, host.GetSessionCount());
+
+	auto futEnd = host.Run();
+	std::this_thread::sleep_for(200ms);
+	host.Stop();
+	futEnd.get();
+
+	// Loose bounds, the test machine may be busy
+	for (auto const pSession : cSessions)
+	{
+		auto const metrics = pSession->GetMetrics();
+		auto const nTicks = metrics.cCounters.at("Session.Ticks");
+		EXPECT_GT(nTicks, 10u) << pSession->GetName();
+		EXPECT_LE(nTicks, 200u / 5 + settings.nMaxTicksPerUpdate) << pSession->GetName();
+		EXPECT_EQ(nTicks, metrics.cHistograms.at("Session.TickTime").nCount);
+		EXPECT_EQ(nTicks, metrics.cHistograms.at("System.Move").nCount);
+		EXPECT_EQ(100, metrics.cGauges.at("Model.Entities").nValue);
+		EXPECT_EQ(static_cast<std::int64_t>(pSession->GetArena().GetUsedBytes()), metrics.cGauges.at("Session.ArenaUsed").nValue);
+		EXPECT_LT(0, metrics.cGauges.at("Session.ArenaUsed").nValue);
+		EXPECT_FALSE(pSession->HasFailed());
+	}
+}
+
+TEST(SessionHost, AddAndRemoveWhileRunning)
+{
+	SessionHostSettings hostSettings;
+	hostSettings.nWorkerThreads = 2;
+	SessionHost host{ hostSettings };
+
+	SessionSettings settings;
+	settings.tTickPeriod = 2ms;
+	auto futEnd = host.Run();
+	auto& first = host.AddSession("First", settings, AddCountingSession);
+	std::this_thread::sleep_for(50ms);
+	auto& second = host.AddSession("Second", settings, AddCountingSession);
+	std::this_thread::sleep_for(50ms);
+
+	host.RemoveSession(first);
+	EXPECT_EQ(1u, host.GetSessionCount());
+	host.ForEachSession([&second](const Session& session) {
+		EXPECT_EQ(&second, &session);
+	});
+
+	auto const nTicks = second.GetMetrics().cCounters["Session.Ticks"];
+	std::this_thread::sleep_for(50ms);
+	host.Stop();
+	futEnd.get();
+	EXPECT_LT(nTicks, second.GetMetrics().cCounters.at("Session.Ticks"));
+}
+
+TEST(SessionHost, RemoveWithoutWorkers)
+{
+	// The host thread runs the updates itself
+	SessionHostSettings hostSettings;
+	hostSettings.nWorkerThreads = 0;
+	SessionHost host{ hostSettings };
+
+	SessionSettings settings;
+	settings.tTickPeriod = 1ms;
+	auto futEnd = host.Run();
+	for (int i = 0; i < 20; ++i)
+	{
+		auto& session = host.AddSession("Session" + std::to_string(i), settings, AddCountingSession);
+		std::this_thread::sleep_for(2ms);
+		host.RemoveSession(session);
+	}
+	auto& kept = host.AddSession("Kept", settings, AddCountingSession);
+	std::this_thread::sleep_for(50ms);
+	host.Stop();
+	futEnd.get();
+
+	EXPECT_EQ(1u, host.GetSessionCount());
+	EXPECT_LT(0u, kept.GetMetrics().cCounters.at("Session.Ticks"));
+}
+
+TEST(SessionHost, FailedSession)
+{
+	SessionHostSettings hostSettings;
+	hostSettings.nWorkerThreads = 2;
+	SessionHost host{ hostSettings };
+
+	SessionSettings settings;
+	settings.tTickPeriod = 5ms;
+	std::atomic<int> nFailingTicks{ 0 };
+	auto& failing = host.AddSession("Failing", settings, [&nFailingTicks](Model& model) {
+		model.GetSystems().AddTask("Throw", 0, 0, [&nFailingTicks](SystemContext&) {
+			if (++nFailingTicks == 3) throw std::runtime_error{ "Expected failure" };
+		});
+	});
+	auto& healthy = host.AddSession("Healthy", settings, AddCountingSession);
+
+	auto futEnd = host.Run();
+	std::this_thread::sleep_for(150ms);
+	host.Stop();
+	futEnd.get();
+
+	// The failing session stopped on its third tick, the other one went on
+	EXPECT_TRUE(failing.HasFailed());
+	EXPECT_EQ(3, nFailingTicks.load());
+	EXPECT_EQ(2u, failing.GetMetrics().cCounters.at("Session.Ticks"));
+	EXPECT_FALSE(healthy.HasFailed());
+	EXPECT_GT(healthy.GetMetrics().cCounters.at("Session.Ticks"), 5u);
+}
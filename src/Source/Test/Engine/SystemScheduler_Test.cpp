@@ -0,0 +1,316 @@
+#include <gtest/gtest.h>
+
+#include "HE_JobSystem.h"
+#include "HE_Metrics.h"
+#include "Model.h"
+#include "Query.h"
+#include "SystemScheduler.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+using namespace HE;
+
+namespace
+{
+	struct Position
+	{
+		float x, y;
+	};
+
+	struct Velocity
+	{
+		float x, y;
+	};
+
+	struct Health
+	{
+		std::int32_t nValue;
+	};
+
+	struct Spawner
+	{
+		std::uint32_t nTicks;
+	};
+
+	struct Hit
+	{
+		EntityHandle entity;
+	};
+
+	// Moves, damages, spawns and destroys entities, and reacts to events, so that every kind of
+	// change is merged at the sync points
+	void AddScenario(Model& model)
+	{
+		for (int i = 0; i < 4000; ++i)
+		{
+			auto const f = static_cast<float>(i);
+			model.CreateEntity(Position{ f * 0.01f, 0.0f }, Velocity{ 1.0f + (i % 7) * 0.25f, -0.5f }, Health{ 3 + i % 5 });
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			model.CreateEntity(Position{ static_cast<float>(i), 0.0f }, Spawner{ 0 });
+		}
+
+		auto& systems = model.GetSystems();
+		systems.AddSystem<Position, const Velocity>("Move", [](SystemContext& context, const ChunkView<Position, const Velocity>& view) {
+			auto const pPositions = view.Get<Position>();
+			auto const pVelocities = view.Get<const Velocity>();
+			auto const fDt = static_cast<float>(context.GetDt());
+			for (std::uint32_t i = 0; i < view.GetCount(); ++i)
+			{
+				pPositions[i].x += pVelocities[i].x * fDt;
+				pPositions[i].y += pVelocities[i].y * fDt;
+			}
+		});
+		systems.AddSystem<Health, const Position>("Damage", [](SystemContext& context, const ChunkView<Health, const Position>& view) {
+			auto const pHealths = view.Get<Health>();
+			auto const pPositions = view.Get<const Position>();
+			for (std::uint32_t i = 0; i < view.GetCount(); ++i)
+			{
+				if (pPositions[i].x < 35.0f) continue;
+
+				context.Emit(Hit{ view.GetEntities()[i] });
+				if (--pHealths[i].nValue <= 0)
+				{
+					context.GetCommands().DestroyEntity(view.GetEntities()[i]);
+				}
+			}
+		});
+		systems.AddSystem<Spawner, const Position>("Spawn", [](SystemContext& context, const ChunkView<Spawner, const Position>& view) {
+			auto const pSpawners = view.Get<Spawner>();
+			auto const pPositions = view.Get<const Position>();
+			for (std::uint32_t i = 0; i < view.GetCount(); ++i)
+			{
+				if (++pSpawners[i].nTicks % 3 != 0) continue;
+
+				auto const fSpeed = 0.5f + static_cast<float>(pSpawners[i].nTicks % 11);
+				context.GetCommands().CreateEntity(pPositions[i], Velocity{ fSpeed, fSpeed }, Health{ 2 });
+			}
+		});
+
+		systems.AddSyncPoint();
+		systems.AddTask("Knockback", MakeComponentMask<>(), MakeComponentMask<Velocity>(), [](SystemContext& context) {
+			for (auto const& hit : context.GetEvents<Hit>())
+			{
+				if (context.GetModel().IsAlive(hit.entity))
+				{
+					context.GetCommands().AddComponent(hit.entity, Velocity{ -1.0f, 0.0f });
+				}
+			}
+		});
+	}
+}
+
+TEST(SystemScheduler, WritersRunInOrder)
+{
+	Model model;
+	model.CreateEntity(Position{ 0.0f, 0.0f }, Velocity{ 0.0f, 0.0f });
+
+	auto& systems = model.GetSystems();
+	systems.AddSystem<Position>("Teleport", [](SystemContext&, const ChunkView<Position>& view) {
+		view.Get<Position>()[0].x = 5.0f;
+	});
+	// Reads what Teleport wrote
+	systems.AddSystem<Velocity, const Position>("Follow", [](SystemContext&, const ChunkView<Velocity, const Position>& view) {
+		view.Get<Velocity>()[0].x = view.Get<const Position>()[0].x;
+	});
+	// Writes what Follow read
+	systems.AddSystem<Position>("Reset", [](SystemContext&, const ChunkView<Position>& view) {
+		view.Get<Position>()[0].x = 0.0f;
+	});
+	EXPECT_EQ(3u, systems.GetSystemCount());
+
+	JobSystem jobSystem{ 3 };
+	model.Update(1.0, jobSystem);
+
+	Query<const Position, const Velocity> query{ model };
+	query.ForEach([](const Position& position, const Velocity& velocity) {
+		EXPECT_EQ(0.0f, position.x);
+		EXPECT_EQ(5.0f, velocity.x);
+	});
+}
+
+TEST(SystemScheduler, DisjointWritersMarkChanged)
+{
+	Model model;
+	for (int i = 0; i < 4000; ++i)
+	{
+		model.CreateEntity(Position{ 0.0f, 0.0f }, Velocity{ 1.0f, 0.0f }, Health{ 1 });
+	}
+
+	// Same wave, same chunks, different columns
+	auto& systems = model.GetSystems();
+	systems.AddSystem<Position>("Teleport", [](SystemContext&, const ChunkView<Position>& view) {
+		for (std::uint32_t i = 0; i < view.GetCount(); ++i) view.Get<Position>()[i].x = 5.0f;
+	});
+	systems.AddSystem<Velocity>("Stop", [](SystemContext&, const ChunkView<Velocity>& view) {
+		for (std::uint32_t i = 0; i < view.GetCount(); ++i) view.Get<Velocity>()[i].x = 0.0f;
+	});
+
+	JobSystem jobSystem{ 3 };
+	model.AdvanceChangeVersion();
+	model.Update(1.0, jobSystem);
+
+	ASSERT_EQ(1u, model.GetArchetypes().size());
+	auto const& archetype = *model.GetArchetypes()[0];
+	auto const nVersion = model.GetChangeVersion();
+	ASSERT_GT(archetype.GetChunkCount(), 1u);
+	for (size_t nChunk = 0; nChunk < archetype.GetChunkCount(); ++nChunk)
+	{
+		EXPECT_EQ(nVersion, archetype.GetChunk(nChunk).nChangeVersion);
+		for (size_t i = 0; i < archetype.GetComponentTypes().size(); ++i)
+		{
+			auto const nType = archetype.GetComponentTypes()[i];
+			auto const bWritten = nType == GetComponentTypeId<Position>() || nType == GetComponentTypeId<Velocity>();
+			EXPECT_EQ(bWritten, archetype.GetColumnVersion(nChunk, i + 1) == nVersion);
+		}
+	}
+}
+
+TEST(SystemScheduler, ChangesAppliedAtSyncPoints)
+{
+	Model model;
+	model.CreateEntity(Health{ 1 });
+
+	std::vector<size_t> cCounts;
+	auto& systems = model.GetSystems();
+	systems.AddSystem<const Health>("Split", [](SystemContext& context, const ChunkView<const Health>& view) {
+		for (std::uint32_t i = 0; i < view.GetCount(); ++i)
+		{
+			context.GetCommands().CreateEntity(Health{ view.Get<const Health>()[i].nValue + 1 });
+			context.GetCommands().DestroyEntity(view.GetEntities()[i]);
+		}
+	});
+	systems.AddTask("Count", MakeComponentMask<Health>(), 0, [&cCounts](SystemContext& context) {
+		cCounts.push_back(context.GetModel().GetEntityCount());
+	});
+	systems.AddSyncPoint();
+	systems.AddTask("CountAfterSync", MakeComponentMask<Health>(), 0, [&cCounts](SystemContext& context) {
+		cCounts.push_back(context.GetModel().GetEntityCount());
+	});
+
+	JobSystem jobSystem{ 3 };
+	model.Update(1.0, jobSystem);
+	ASSERT_EQ(2u, cCounts.size());
+	EXPECT_EQ(1u, cCounts[0]);
+	EXPECT_EQ(1u, cCounts[1]);
+
+	Query<const Health> query{ model };
+	query.ForEach([](const Health& health) { EXPECT_EQ(2, health.nValue); });
+}
+
+TEST(SystemScheduler, EventsPublishedAtSyncPoints)
+{
+	Model model;
+	auto const entity = model.CreateEntity(Health{ 1 });
+
+	size_t nSeenBeforeSync = 0;
+	size_t nSeenAfterSync = 0;
+	auto& systems = model.GetSystems();
+	systems.AddSystem<const Health>("Emit", [](SystemContext& context, const ChunkView<const Health>& view) {
+		context.Emit(Hit{ view.GetEntities()[0] });
+	});
+	systems.AddTask("BeforeSync", 0, 0, [&nSeenBeforeSync](SystemContext& context) {
+		nSeenBeforeSync += context.GetEvents<Hit>().size();
+	});
+	systems.AddSyncPoint();
+	systems.AddTask("AfterSync", 0, 0, [&nSeenAfterSync](SystemContext& context) {
+		nSeenAfterSync += context.GetEvents<Hit>().size();
+	});
+
+	JobSystem jobSystem{ 3 };
+	model.Update(1.0, jobSystem);
+	EXPECT_EQ(0u, nSeenBeforeSync);
+	EXPECT_EQ(1u, nSeenAfterSync);
+	ASSERT_EQ(1u, systems.GetEvents<Hit>().size());
+	EXPECT_EQ(entity, systems.GetEvents<Hit>()[0].entity);
+
+	// Events last one update
+	model.Update(1.0, jobSystem);
+	EXPECT_EQ(2u, nSeenAfterSync);
+	EXPECT_EQ(1u, systems.GetEvents<Hit>().size());
+}
+
+TEST(SystemScheduler, ExceptionDropsStageChanges)
+{
+	Model model;
+	for (int i = 0; i < 2000; ++i)
+	{
+		model.CreateEntity(Health{ i });
+	}
+
+	bool bThrow = true;
+	auto& systems = model.GetSystems();
+	systems.AddSystem<const Health>("Spawn", [](SystemContext& context, const ChunkView<const Health>& view) {
+		context.GetCommands().CreateEntity(Health{ -1 });
+		context.Emit(Hit{ view.GetEntities()[0] });
+	});
+	systems.AddTask("Fail", 0, 0, [&bThrow](SystemContext&) {
+		if (bThrow) throw std::runtime_error{ "Fail" };
+	});
+
+	JobSystem jobSystem{ 3 };
+	EXPECT_THROW(model.Update(1.0, jobSystem), std::runtime_error);
+	EXPECT_EQ(2000u, model.GetEntityCount());
+	EXPECT_TRUE(systems.GetEvents<Hit>().empty());
+
+	bThrow = false;
+	model.Update(1.0, jobSystem);
+	EXPECT_LT(2000u, model.GetEntityCount());
+	EXPECT_FALSE(systems.GetEvents<Hit>().empty());
+}
+
+TEST(SystemScheduler, ParallelMatchesSequential)
+{
+	Model sequential;
+	AddScenario(sequential);
+	sequential.GetSystems().SetExecutionMode(ExecutionMode::Sequential);
+
+	Model parallel;
+	AddScenario(parallel);
+	EXPECT_EQ(ExecutionMode::Parallel, parallel.GetSystems().GetExecutionMode());
+
+	JobSystem jobSystem{ 3 };
+	ASSERT_EQ(sequential.ComputeStateHash(), parallel.ComputeStateHash());
+	for (int nTick = 0; nTick < 60; ++nTick)
+	{
+		sequential.Update(1.0 / 60.0, jobSystem);
+		parallel.Update(1.0 / 60.0, jobSystem);
+		ASSERT_EQ(sequential.GetEntityCount(), parallel.GetEntityCount()) << "Tick " << nTick;
+		ASSERT_EQ(sequential.ComputeStateHash(), parallel.ComputeStateHash()) << "Tick " << nTick;
+	}
+}
+
+TEST(SystemScheduler, Metrics)
+{
+	MetricsRegistry metrics;
+	Model model;
+	AddScenario(model);
+	// Before and after the systems are added
+	model.GetSystems().SetMetrics(&metrics);
+	model.GetSystems().AddTask("Idle", 0, 0, [](SystemContext&) {});
+
+	JobSystem jobSystem{ 3 };
+	for (int nTick = 0; nTick < 5; ++nTick)
+	{
+		model.Update(1.0 / 60.0, jobSystem);
+	}
+	metrics.Merge();
+
+	// One time per update, summed over the tasks of the system
+	auto const snapshot = metrics.GetSnapshot();
+	for (auto const psName : { "System.Move", "System.Damage", "System.Idle" })
+	{
+		auto const it = snapshot.cHistograms.find(psName);
+		ASSERT_NE(snapshot.cHistograms.end(), it) << psName;
+		EXPECT_EQ(5u, it->second.nCount) << psName;
+		EXPECT_EQ(MetricUnit::Nanoseconds, it->second.eUnit);
+	}
+
+	model.GetSystems().SetMetrics(nullptr);
+	model.Update(1.0 / 60.0, jobSystem);
+	metrics.Merge();
+	EXPECT_EQ(5u, metrics.GetSnapshot().cHistograms["System.Move"].nCount);
+}
@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+
+#include "HE_JobSystem.h"
+#include "TransformHierarchy.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace HE;
+
+namespace
+{
+	// Translation part of the world transform
+	void ExpectPosition(const TransformHierarchy& hierarchy, EntityHandle entity, float x, float y, float z)
+	{
+		auto const& world = hierarchy.GetWorld(entity);
+		EXPECT_FLOAT_EQ(x, world.aColumns[3].x);
+		EXPECT_FLOAT_EQ(y, world.aColumns[3].y);
+		EXPECT_FLOAT_EQ(z, world.aColumns[3].z);
+	}
+}
+
+TEST(TransformHierarchy, Update)
+{
+	TransformHierarchy hierarchy;
+	EntityHandle const root{ 0, 1 };
+	EntityHandle const child{ 1, 1 };
+	EntityHandle const grandChild{ 2, 1 };
+	EntityHandle const other{ 3, 1 };
+	hierarchy.Add(root, Math::Mat4::Translation({ 1.0f, 0.0f, 0.0f }));
+	hierarchy.Add(child, Math::Mat4::Translation({ 0.0f, 1.0f, 0.0f }), root);
+	hierarchy.Add(grandChild, Math::Mat4::Translation({ 0.0f, 0.0f, 1.0f }), child);
+	hierarchy.Add(other, Math::Mat4::Translation({ 5.0f, 0.0f, 0.0f }));
+	EXPECT_EQ(4u, hierarchy.GetNodeCount());
+	EXPECT_EQ(child, hierarchy.GetParent(grandChild));
+	EXPECT_FALSE(hierarchy.GetParent(root).IsValid());
+
+	hierarchy.Update();
+	ExpectPosition(hierarchy, grandChild, 1.0f, 1.0f, 1.0f);
+	ExpectPosition(hierarchy, other, 5.0f, 0.0f, 0.0f);
+
+	// Changes go down to the descendants
+	hierarchy.SetLocal(root, Math::Mat4::Translation({ 2.0f, 0.0f, 0.0f }));
+	hierarchy.Update();
+	ExpectPosition(hierarchy, child, 2.0f, 1.0f, 0.0f);
+	ExpectPosition(hierarchy, grandChild, 2.0f, 1.0f, 1.0f);
+
+	// With its subtree
+	hierarchy.SetParent(child, other);
+	hierarchy.Update();
+	ExpectPosition(hierarchy, grandChild, 5.0f, 1.0f, 1.0f);
+	hierarchy.SetParent(child, {});
+	hierarchy.Update();
+	ExpectPosition(hierarchy, grandChild, 0.0f, 1.0f, 1.0f);
+
+	hierarchy.SetParent(child, root);
+	hierarchy.Remove(child);
+	EXPECT_FALSE(hierarchy.Contains(child));
+	EXPECT_FALSE(hierarchy.Contains(grandChild));
+	EXPECT_TRUE(hierarchy.Contains(root));
+	EXPECT_EQ(2u, hierarchy.GetNodeCount());
+
+	// The slots are reused
+	EntityHandle const reused{ 1, 2 };
+	hierarchy.Add(reused, Math::Mat4::Translation({ 0.0f, 3.0f, 0.0f }), other);
+	hierarchy.Update();
+	ExpectPosition(hierarchy, reused, 5.0f, 3.0f, 0.0f);
+	ExpectPosition(hierarchy, root, 2.0f, 0.0f, 0.0f);
+}
+
+TEST(TransformHierarchy, Parallel)
+{
+	// Depths wide enough to be split on the JobSystem: short chains under many roots
+	TransformHierarchy hierarchy;
+	std::vector<EntityHandle> cEntities;
+	std::uint32_t nIndex = 0;
+	for (int nRoot = 0; nRoot < 5000; ++nRoot)
+	{
+		EntityHandle parent{};
+		for (int nDepth = 0; nDepth < 4; ++nDepth)
+		{
+			EntityHandle const entity{ nIndex++, 1 };
+			hierarchy.Add(entity, Math::Mat4::Translation({ 1.0f, static_cast<float>(nRoot), 0.0f }), parent);
+			cEntities.push_back(entity);
+			parent = entity;
+		}
+	}
+
+	// The end of each chain under the root of the next one, a depth higher
+	for (int nRoot = 0; nRoot < 4999; ++nRoot)
+	{
+		hierarchy.SetParent(cEntities[nRoot * 4 + 2], cEntities[(nRoot + 1) * 4]);
+	}
+
+	JobSystem jobSystem{ 3 };
+	hierarchy.Update(jobSystem);
+	ExpectPosition(hierarchy, cEntities[10 * 4 + 3], 3.0f, 11.0f + 2.0f * 10.0f, 0.0f);
+	ExpectPosition(hierarchy, cEntities[4999 * 4 + 3], 4.0f, 4.0f * 4999.0f, 0.0f);
+
+	auto sequential = hierarchy;
+	hierarchy.SetLocal(cEntities[11 * 4], Math::Mat4::Translation({ 2.0f, 11.0f, 0.0f }));
+	sequential.SetLocal(cEntities[11 * 4], Math::Mat4::Translation({ 2.0f, 11.0f, 0.0f }));
+	hierarchy.Update(jobSystem);
+	sequential.Update();
+	ExpectPosition(hierarchy, cEntities[10 * 4 + 3], 4.0f, 11.0f + 2.0f * 10.0f, 0.0f);
+	ExpectPosition(hierarchy, cEntities[11 * 4 + 1], 3.0f, 22.0f, 0.0f);
+	for (auto const entity : cEntities)
+	{
+		ASSERT_EQ(sequential.GetWorld(entity), hierarchy.GetWorld(entity));
+	}
+}
+
+TEST(TransformHierarchy, Changes)
+{
+	// Random changes, checked against the parents and the translations kept aside
+	TransformHierarchy hierarchy;
+	std::vector<EntityHandle> cEntities;
+	std::vector<std::uint32_t> cParents;
+	std::vector<float> cTranslations;
+	std::uint64_t nState = 7;
+	auto const random = [&nState](std::uint32_t nCount) {
+		nState = nState * 6364136223846793005ull + 1442695040888963407ull;
+		return static_cast<std::uint32_t>((nState >> 33) % nCount);
+	};
+	auto const isAlive = [&](std::uint32_t nIndex) { return hierarchy.Contains(cEntities[nIndex]); };
+	auto const isDescendant = [&](std::uint32_t nIndex, std::uint32_t nAncestor) {
+		for (; nIndex != ~0u; nIndex = cParents[nIndex])
+		{
+			if (nIndex == nAncestor) return true;
+		}
+		return false;
+	};
+	// A random node in the hierarchy, ~0u for none
+	auto const pickAlive = [&]() {
+		for (int nTry = 0; nTry < 8 && !cEntities.empty(); ++nTry)
+		{
+			auto const nIndex = random(static_cast<std::uint32_t>(cEntities.size()));
+			if (isAlive(nIndex)) return nIndex;
+		}
+		return ~0u;
+	};
+
+	JobSystem jobSystem{ 3 };
+	for (int nStep = 0; nStep < 3000; ++nStep)
+	{
+		auto const nOperation = nStep < 500 ? 0 : random(8);
+		auto const nNode = pickAlive();
+		auto const nOther = pickAlive();
+		if (nOperation <= 3 || nNode == ~0u)
+		{
+			// Into a removed entity's slot, or a new one
+			auto nIndex = static_cast<std::uint32_t>(cEntities.size());
+			auto const nReused = random(static_cast<std::uint32_t>(cEntities.size() + 1));
+			if (nReused < cEntities.size() && !isAlive(nReused))
+			{
+				nIndex = nReused;
+			}
+			else
+			{
+				cEntities.push_back({});
+				cParents.push_back(~0u);
+				cTranslations.push_back(0.0f);
+			}
+			cEntities[nIndex] = EntityHandle{ nIndex, cEntities[nIndex].GetGeneration() + 1 };
+			cParents[nIndex] = nNode;
+			cTranslations[nIndex] = static_cast<float>(random(16));
+			hierarchy.Add(cEntities[nIndex], Math::Mat4::Translation({ cTranslations[nIndex], 0.0f, 0.0f }), nNode != ~0u ? cEntities[nNode] : EntityHandle{});
+		}
+		else if (nOperation == 4)
+		{
+			hierarchy.Remove(cEntities[nNode]);
+		}
+		else if (nOperation == 5 && (nOther == ~0u || !isDescendant(nOther, nNode)))
+		{
+			cParents[nNode] = nOther;
+			hierarchy.SetParent(cEntities[nNode], nOther != ~0u ? cEntities[nOther] : EntityHandle{});
+		}
+		else
+		{
+			cTranslations[nNode] = static_cast<float>(random(16));
+			hierarchy.SetLocal(cEntities[nNode], Math::Mat4::Translation({ cTranslations[nNode], 0.0f, 0.0f }));
+		}
+
+		if (nStep % 10 != 9) continue;
+		if (nStep % 20 == 9)
+		{
+			hierarchy.Update();
+		}
+		else
+		{
+			hierarchy.Update(jobSystem);
+		}
+
+		size_t nAlive = 0;
+		for (std::uint32_t i = 0; i < cEntities.size(); ++i)
+		{
+			if (!isAlive(i)) continue;
+
+			++nAlive;
+			ASSERT_EQ(cParents[i] != ~0u ? cEntities[cParents[i]] : EntityHandle{}, hierarchy.GetParent(cEntities[i]));
+			float fExpected = 0.0f;
+			for (auto j = i; j != ~0u; j = cParents[j])
+			{
+				fExpected += cTranslations[j];
+			}
+			ASSERT_EQ(fExpected, hierarchy.GetWorld(cEntities[i]).aColumns[3].x);
+		}
+		ASSERT_EQ(nAlive, hierarchy.GetNodeCount());
+	}
+}
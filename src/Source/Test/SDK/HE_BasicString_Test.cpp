@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include "HE_BasicString.h"
+
+#include <unordered_set>
+#include <utility>
+
+using namespace HE;
+using namespace std::string_literals;
+
+TEST(BasicString, Empty)
+{
+	String s;
+	EXPECT_TRUE(s.empty());
+	EXPECT_TRUE(s.is_inline());
+	EXPECT_EQ(0u, s.size());
+	EXPECT_STREQ("", s.c_str());
+}
+
+TEST(BasicString, InlineUntilCapacity)
+{
+	BasicString<char, MallocAllocator, 8> s{ "12345678" };
+	EXPECT_TRUE(s.is_inline());
+	EXPECT_EQ("12345678", s);
+
+	s.push_back('9');
+	EXPECT_FALSE(s.is_inline());
+	EXPECT_EQ("123456789", s);
+	EXPECT_STREQ("123456789", s.c_str());
+}
+
+TEST(BasicString, Append)
+{
+	BasicString<char, MallocAllocator, 4> s;
+	for (int i = 0; i < 100; ++i)
+	{
+		s += "ab";
+	}
+	EXPECT_EQ(200u, s.size());
+	EXPECT_EQ(std::string(100, 'a').size() * 2, s.size());
+	EXPECT_EQ('a', s.front());
+	EXPECT_EQ('b', s.back());
+
+	// Appending a part of itself while growing
+	BasicString<char, MallocAllocator, 4> s2{ "abcd" };
+	s2.append(s2.data() + 1, 3);
+	EXPECT_EQ("abcdbcd", s2);
+}
+
+TEST(BasicString, Move)
+{
+	String sInline{ "short" };
+	String sMovedInline{ std::move(sInline) };
+	EXPECT_EQ("short", sMovedInline);
+	EXPECT_TRUE(sInline.empty());
+
+	String sHeap(100, 'x');
+	auto const pData = sHeap.data();
+	String sMovedHeap{ std::move(sHeap) };
+	EXPECT_EQ(pData, sMovedHeap.data());
+	EXPECT_EQ(String(100, 'x'), sMovedHeap);
+	EXPECT_TRUE(sHeap.empty());
+	EXPECT_TRUE(sHeap.is_inline());
+
+	sHeap = std::move(sMovedHeap);
+	EXPECT_EQ(pData, sHeap.data());
+}
+
+TEST(BasicString, Copy)
+{
+	String const s(100, 'x');
+	BasicString<char, MallocAllocator, 128> sOther{ s };
+	EXPECT_TRUE(sOther.is_inline());
+	EXPECT_EQ(s, sOther);
+
+	String sCopy;
+	sCopy = s;
+	EXPECT_EQ(s, sCopy);
+	EXPECT_NE(s.data(), sCopy.data());
+}
+
+TEST(BasicString, Compare)
+{
+	String const s{ "abc" };
+	EXPECT_EQ(s, "abc");
+	EXPECT_EQ("abc"s, s);
+	EXPECT_NE(s, "ab");
+	EXPECT_LT(String{ "ab" }, s);
+	EXPECT_LT(s, String{ "abd" });
+	EXPECT_EQ(s.str(), "abc"s);
+	EXPECT_EQ(1u, s.find('b'));
+	EXPECT_EQ(String::npos, s.find('z'));
+	EXPECT_EQ("bc", s.substr(1));
+}
+
+TEST(BasicString, Hash)
+{
+	std::unordered_set<String> set{ String{ "a" }, String{ "b" }, String(64, 'c') };
+	EXPECT_EQ(1u, set.count(String{ "a" }));
+	EXPECT_EQ(1u, set.count(String(64, 'c')));
+	EXPECT_EQ(0u, set.count(String{ "c" }));
+}
+
+TEST(BasicString, Format)
+{
+	auto const s = FormatAs<String>("{_} + {_} = {_}", 1, 2.5, "3.5");
+	EXPECT_EQ("1 + 2.500000 = 3.5", s);
+	EXPECT_TRUE(s.is_inline());
+
+	EXPECT_EQ(Format("{0:.2}", 2.0), FormatAs<String>("{0:.2}", 2.0));
+	EXPECT_EQ("Name: abc", Format("Name: {_}", String{ "abc" }));
+}
+
+TEST(BasicString, to_string)
+{
+	EXPECT_EQ("42", to_string<String>(42));
+	EXPECT_EQ("-42", to_string<String>(-42ll));
+	EXPECT_EQ(std::to_string(1.5f), to_string<String>(1.5f));
+	EXPECT_EQ("abc", to_string<String>("abc"s));
+	EXPECT_EQ("002a", to_string<String>(42, "04x"));
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include "HE_Binary.h"
+
+#include <sstream>
+#include <stdexcept>
+
+using namespace HE;
+using namespace std::string_literals;
+
+static_assert(ZigZag(0) == 0 && ZigZag(-1) == 1 && ZigZag(1) == 2 && ZigZag(-2) == 3, "HE::ZigZag failed to pass test");
+static_assert(UnZigZag(ZigZag(INT64_MIN)) == INT64_MIN && UnZigZag(ZigZag(INT64_MAX)) == INT64_MAX, "HE::UnZigZag failed to pass test");
+
+TEST(Binary, Varint)
+{
+	std::vector<unsigned char> cBytes;
+	WriteVarint(cBytes, 0);
+	WriteVarint(cBytes, 0x7F);
+	WriteVarint(cBytes, 300);
+	EXPECT_EQ((std::vector<unsigned char>{ 0x00, 0x7F, 0xAC, 0x02 }), cBytes);
+
+	std::stringstream stream;
+	for (std::uint64_t n : { std::uint64_t{ 0 }, std::uint64_t{ 300 }, ~std::uint64_t{ 0 } }) WriteVarint(stream, n);
+	BinaryStreamReader reader{ stream, "Invalid test" };
+	EXPECT_EQ(0u, reader.ReadVarint());
+	EXPECT_EQ(300u, reader.ReadVarint());
+	EXPECT_EQ(~std::uint64_t{ 0 }, reader.ReadVarint());
+	EXPECT_THROW(reader.ReadVarint(), std::runtime_error);
+
+	// Longer than 64 bits
+	std::stringstream invalid{ std::string(10, '\x80') + '\x01' };
+	BinaryStreamReader invalidReader{ invalid, "Invalid test" };
+	EXPECT_THROW(invalidReader.ReadVarint(), std::runtime_error);
+}
+
+TEST(Binary, StringsAndBytes)
+{
+	std::stringstream stream;
+	WriteString(stream, "");
+	WriteString(stream, "Hello\0World"s);
+	unsigned char const aBytes[] = { 1, 2, 3 };
+	WriteBytes(stream, aBytes, sizeof(aBytes));
+
+	BinaryStreamReader reader{ stream, "Invalid test" };
+	EXPECT_EQ("", reader.ReadString());
+	EXPECT_EQ("Hello\0World"s, reader.ReadString());
+	std::vector<unsigned char> cBytes{ 9 };
+	reader.ReadBytes(cBytes);
+	EXPECT_EQ((std::vector<unsigned char>{ 1, 2, 3 }), cBytes);
+
+	// A corrupted size fails on the end of the stream
+	std::stringstream truncated;
+	WriteVarint(truncated, ~std::uint64_t{ 0 } >> 1);
+	truncated << "abc";
+	BinaryStreamReader truncatedReader{ truncated, "Invalid test" };
+	try
+	{
+		truncatedReader.ReadString();
+		ADD_FAILURE();
+	}
+	catch (const std::runtime_error& e)
+	{
+		EXPECT_STREQ("Invalid test: truncated", e.what());
+	}
+}
+
+TEST(Binary, MemoryReader)
+{
+	std::vector<unsigned char> cBytes;
+	WriteVarint(cBytes, 5);
+	WriteVarint(cBytes, 1000);
+	cBytes.insert(cBytes.end(), { 'a', 'b' });
+	WriteVarint(cBytes, 300);
+
+	BinaryMemoryReader reader{ cBytes.data(), cBytes.size(), "Invalid test" };
+	EXPECT_EQ(5u, reader.ReadVarint());
+	EXPECT_THROW(reader.ReadSize(999), std::runtime_error);
+	EXPECT_EQ(cBytes.data() + 3, reader.ReadBytes(2));
+	EXPECT_THROW(reader.ReadBytes(3), std::runtime_error);
+	EXPECT_EQ(300u, reader.ReadSize(300));
+	EXPECT_TRUE(reader.IsAtEnd());
+	EXPECT_THROW(reader.ReadVarint(), std::runtime_error);
+
+	// Truncated in the middle of an integer
+	BinaryMemoryReader truncatedReader{ cBytes.data() + 1, 1, "Invalid test" };
+	EXPECT_THROW(truncatedReader.ReadVarint(), std::runtime_error);
+}
@@ -0,0 +1,308 @@
+#include <gtest/gtest.h>
+
+#include "HE_ConcurrentQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace HE;
+
+namespace
+{
+	// Counts the allocations, to check the queues use their allocator
+	class CountingAllocator
+	{
+	public:
+		static CountingAllocator it;
+
+		Blk allocate(size_t n) { return allocate(n, PlatformMaxAlignment); }
+		Blk allocate(size_t n, size_t alignment)
+		{
+			++m_nAllocated;
+			EXPECT_EQ(0u, n % alignment);
+			return AlignedMallocAllocator::it.allocate(n, alignment);
+		}
+		void deallocate(Blk blk) noexcept
+		{
+			++m_nDeallocated;
+			AlignedMallocAllocator::it.deallocate(blk);
+		}
+
+		int m_nAllocated{ 0 };
+		int m_nDeallocated{ 0 };
+	};
+	CountingAllocator CountingAllocator::it;
+
+	struct Item : MpscQueueNode
+	{
+		int nProducer;
+		int nValue;
+	};
+
+	// Each producer pushes 0 to nCount - 1. The consumers must see every value of each producer once,
+	// in order when there is a single consumer
+	template<class Queue>
+	void TestConcurrent(Queue& queue, int nProducers, int nConsumers, int nCount, bool bBatches)
+	{
+		std::vector<std::atomic<int>> cSeen(static_cast<size_t>(nProducers) * nCount);
+		for (auto& n : cSeen) n = 0;
+		std::atomic<int> nPopped{ 0 };
+		std::atomic<bool> bOrdered{ true };
+
+		std::vector<std::thread> cThreads;
+		for (int p = 0; p < nProducers; ++p)
+		{
+			cThreads.emplace_back([&queue, p, nCount, bBatches]() {
+				int i = 0;
+				while (i < nCount)
+				{
+					if (bBatches)
+					{
+						std::int64_t aBatch[8];
+						auto const nBatch = std::min(8, nCount - i);
+						for (int j = 0; j < nBatch; ++j) aBatch[j] = (std::int64_t{ p } << 32) | (i + j);
+						i += static_cast<int>(queue.TryPushBatch(aBatch, nBatch));
+					}
+					else if (queue.TryPush((std::int64_t{ p } << 32) | i))
+					{
+						++i;
+					}
+					std::this_thread::yield();
+				}
+			});
+		}
+		for (int c = 0; c < nConsumers; ++c)
+		{
+			cThreads.emplace_back([&, nConsumers]() {
+				std::vector<int> cLast(nProducers, -1);
+				auto const nTotal = nProducers * nCount;
+				while (nPopped.load() < nTotal)
+				{
+					std::int64_t aBatch[8];
+					size_t nBatch = 0;
+					if (bBatches) nBatch = queue.TryPopBatch(aBatch, 8);
+					else if (queue.TryPop(aBatch[0])) nBatch = 1;
+
+					for (size_t j = 0; j < nBatch; ++j)
+					{
+						auto const p = static_cast<int>(aBatch[j] >> 32);
+						auto const i = static_cast<int>(aBatch[j] & 0xFFFFFFFF);
+						++cSeen[p * nCount + i];
+						if (nConsumers == 1 && i != cLast[p] + 1) bOrdered = false;
+						cLast[p] = i;
+					}
+					nPopped += static_cast<int>(nBatch);
+					if (nBatch == 0) std::this_thread::yield();
+				}
+			});
+		}
+		for (auto& thread : cThreads) thread.join();
+
+		EXPECT_TRUE(bOrdered.load());
+		for (auto& n : cSeen) ASSERT_EQ(1, n.load());
+	}
+}
+
+TEST(SpscQueue, Fifo)
+{
+	SpscQueue<int> queue{ 4 };
+	EXPECT_EQ(4u, queue.GetCapacity());
+	int n;
+	EXPECT_FALSE(queue.TryPop(n));
+	for (int i = 0; i < 4; ++i) EXPECT_TRUE(queue.TryPush(i));
+	EXPECT_FALSE(queue.TryPush(4));
+	EXPECT_EQ(4u, queue.GetSize());
+
+	for (int i = 0; i < 4; ++i)
+	{
+		ASSERT_TRUE(queue.TryPop(n));
+		EXPECT_EQ(i, n);
+	}
+	EXPECT_FALSE(queue.TryPop(n));
+}
+
+TEST(SpscQueue, Batches)
+{
+	SpscQueue<int> queue{ 8 };
+	int aIn[6] = { 0, 1, 2, 3, 4, 5 };
+	EXPECT_EQ(6u, queue.TryPushBatch(aIn, 6));
+	EXPECT_EQ(2u, queue.TryPushBatch(aIn, 6));
+
+	int aOut[16];
+	EXPECT_EQ(5u, queue.TryPopBatch(aOut, 5));
+	EXPECT_EQ(4, aOut[4]);
+	// Wraps around
+	EXPECT_EQ(5u, queue.TryPushBatch(aIn, 6));
+	EXPECT_EQ(8u, queue.TryPopBatch(aOut, 16));
+	EXPECT_EQ(5, aOut[0]);
+	EXPECT_EQ(0, aOut[1]);
+	EXPECT_EQ(1, aOut[2]);
+	EXPECT_EQ(0, aOut[3]);
+	EXPECT_EQ(4, aOut[7]);
+	EXPECT_EQ(0u, queue.TryPopBatch(aOut, 16));
+}
+
+TEST(SpscQueue, DestroysItems)
+{
+	auto const pShared = std::make_shared<int>(0);
+	{
+		auto const nAllocated = CountingAllocator::it.m_nAllocated;
+		SpscQueue<std::shared_ptr<int>, CountingAllocator> queue{ 4 };
+		EXPECT_EQ(nAllocated + 1, CountingAllocator::it.m_nAllocated);
+		queue.TryPush(pShared);
+		queue.TryPush(pShared);
+		std::shared_ptr<int> p;
+		queue.TryPop(p);
+		EXPECT_EQ(3, pShared.use_count());
+	}
+	EXPECT_EQ(1, pShared.use_count());
+	EXPECT_EQ(CountingAllocator::it.m_nAllocated, CountingAllocator::it.m_nDeallocated);
+}
+
+TEST(SpscQueue, Concurrent)
+{
+	SpscQueue<std::int64_t> queue{ 64 };
+	TestConcurrent(queue, 1, 1, 100000, false);
+	TestConcurrent(queue, 1, 1, 100000, true);
+}
+
+TEST(MpmcQueue, Fifo)
+{
+	MpmcQueue<int> queue{ 4 };
+	int n;
+	EXPECT_FALSE(queue.TryPop(n));
+	for (int i = 0; i < 4; ++i) EXPECT_TRUE(queue.TryPush(i));
+	EXPECT_FALSE(queue.TryPush(4));
+	EXPECT_EQ(4u, queue.GetSize());
+
+	for (int i = 0; i < 4; ++i)
+	{
+		ASSERT_TRUE(queue.TryPop(n));
+		EXPECT_EQ(i, n);
+	}
+	EXPECT_FALSE(queue.TryPop(n));
+	EXPECT_EQ(0u, queue.GetSize());
+}
+
+TEST(MpmcQueue, Batches)
+{
+	MpmcQueue<int> queue{ 8 };
+	int aIn[6] = { 0, 1, 2, 3, 4, 5 };
+	EXPECT_EQ(6u, queue.TryPushBatch(aIn, 6));
+	EXPECT_EQ(2u, queue.TryPushBatch(aIn, 6));
+	EXPECT_EQ(0u, queue.TryPushBatch(aIn, 6));
+
+	int aOut[16];
+	EXPECT_EQ(5u, queue.TryPopBatch(aOut, 5));
+	EXPECT_EQ(4, aOut[4]);
+	EXPECT_EQ(5u, queue.TryPushBatch(aIn, 6));
+	EXPECT_EQ(8u, queue.TryPopBatch(aOut, 16));
+	EXPECT_EQ(5, aOut[0]);
+	EXPECT_EQ(1, aOut[2]);
+	EXPECT_EQ(4, aOut[7]);
+	EXPECT_EQ(0u, queue.TryPopBatch(aOut, 16));
+}
+
+TEST(MpmcQueue, DestroysItems)
+{
+	auto const pShared = std::make_shared<int>(0);
+	{
+		MpmcQueue<std::shared_ptr<int>, CountingAllocator> queue{ 4 };
+		queue.TryPush(pShared);
+		queue.TryPush(pShared);
+		std::shared_ptr<int> p;
+		queue.TryPop(p);
+		EXPECT_EQ(3, pShared.use_count());
+	}
+	EXPECT_EQ(1, pShared.use_count());
+	EXPECT_EQ(CountingAllocator::it.m_nAllocated, CountingAllocator::it.m_nDeallocated);
+}
+
+TEST(MpmcQueue, Concurrent)
+{
+	MpmcQueue<std::int64_t> queue{ 64 };
+	TestConcurrent(queue, 1, 1, 50000, false);
+	TestConcurrent(queue, 4, 1, 20000, true);
+	TestConcurrent(queue, 4, 4, 20000, false);
+	TestConcurrent(queue, 3, 3, 20000, true);
+}
+
+TEST(MpscQueue, Fifo)
+{
+	MpscQueue<Item> queue;
+	EXPECT_TRUE(queue.IsEmpty());
+	EXPECT_EQ(nullptr, queue.Pop());
+
+	Item aItems[4];
+	queue.Push(&aItems[0]);
+	EXPECT_FALSE(queue.IsEmpty());
+	Item* apBatch[] = { &aItems[1], &aItems[2], &aItems[3] };
+	queue.PushBatch(std::begin(apBatch), std::end(apBatch));
+
+	EXPECT_EQ(&aItems[0], queue.Pop());
+	Item* apOut[8];
+	ASSERT_EQ(3u, queue.PopBatch(apOut, 8));
+	EXPECT_EQ(&aItems[1], apOut[0]);
+	EXPECT_EQ(&aItems[3], apOut[2]);
+	EXPECT_TRUE(queue.IsEmpty());
+
+	// Items can be pushed again once popped
+	queue.Push(&aItems[2]);
+	EXPECT_EQ(&aItems[2], queue.Pop());
+	EXPECT_EQ(nullptr, queue.Pop());
+}
+
+TEST(MpscQueue, Concurrent)
+{
+	constexpr int ProducerCount = 4;
+	constexpr int ItemCount = 20000;
+	std::vector<Item> cItems(ProducerCount * ItemCount);
+	MpscQueue<Item> queue;
+
+	std::vector<std::thread> cProducers;
+	for (int p = 0; p < ProducerCount; ++p)
+	{
+		cProducers.emplace_back([&cItems, &queue, p]() {
+			for (int i = 0; i < ItemCount; i += 4)
+			{
+				Item* apBatch[4];
+				for (int j = 0; j < 4; ++j)
+				{
+					apBatch[j] = &cItems[p * ItemCount + i + j];
+					apBatch[j]->nProducer = p;
+					apBatch[j]->nValue = i + j;
+				}
+				if (i % 8 == 0)
+				{
+					queue.PushBatch(std::begin(apBatch), std::end(apBatch));
+				}
+				else
+				{
+					for (auto pItem : apBatch) queue.Push(pItem);
+				}
+			}
+		});
+	}
+
+	// Each producer's items come out in order
+	std::vector<int> cLast(ProducerCount, -1);
+	int nPopped = 0;
+	while (nPopped < ProducerCount * ItemCount)
+	{
+		auto const pItem = queue.Pop();
+		if (pItem == nullptr)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		ASSERT_EQ(cLast[pItem->nProducer] + 1, pItem->nValue);
+		cLast[pItem->nProducer] = pItem->nValue;
+		++nPopped;
+	}
+	for (auto& thread : cProducers) thread.join();
+	EXPECT_TRUE(queue.IsEmpty());
+}
@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+
+#include "HE_FramePacer.h"
+
+#include <thread>
+
+using namespace HE;
+using namespace std::chrono_literals;
+
+TEST(FramePacer, WaitsUntilDeadline)
+{
+	FramePacer pacer;
+	auto const tDeadline = FramePacer::Clock::now() + 20ms;
+	EXPECT_TRUE(pacer.WaitUntil(tDeadline));
+	EXPECT_GE(FramePacer::Clock::now(), tDeadline);
+}
+
+TEST(FramePacer, PastDeadline)
+{
+	FramePacer pacer;
+	EXPECT_TRUE(pacer.WaitUntil(FramePacer::Clock::now() - 1ms));
+}
+
+TEST(FramePacer, WakeInterruptsWait)
+{
+	FramePacer pacer;
+	std::thread waker{ [&pacer]() {
+		std::this_thread::sleep_for(10ms);
+		pacer.Wake();
+	} };
+
+	auto const tStart = FramePacer::Clock::now();
+	EXPECT_FALSE(pacer.WaitUntil(tStart + 10s));
+	EXPECT_LT(FramePacer::Clock::now() - tStart, 5s);
+	waker.join();
+}
+
+TEST(FramePacer, WakeBeforeWait)
+{
+	FramePacer pacer;
+	pacer.Wake();
+	EXPECT_FALSE(pacer.WaitUntil(FramePacer::Clock::now() + 10s));
+	// The wake was consumed
+	EXPECT_TRUE(pacer.WaitUntil(FramePacer::Clock::now() + 1ms));
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include "HE_JobSystem.h"
+
+#include <atomic>
+#include <numeric>
+#include <vector>
+
+using namespace HE;
+
+namespace
+{
+	std::uint64_t Fibonacci(JobSystem& jobSystem, unsigned n)
+	{
+		if (n < 12)
+		{
+			return n < 2 ? n : Fibonacci(jobSystem, n - 1) + Fibonacci(jobSystem, n - 2);
+		}
+
+		// Nested jobs waiting on each other
+		std::uint64_t a, b;
+		JobCounter counter;
+		jobSystem.Run(counter, [&jobSystem, &a, n]() { a = Fibonacci(jobSystem, n - 1); });
+		b = Fibonacci(jobSystem, n - 2);
+		jobSystem.Wait(counter);
+		return a + b;
+	}
+}
+
+TEST(JobSystem, RunAndWait)
+{
+	JobSystem jobSystem{ 3 };
+	std::atomic<int> nRan{ 0 };
+	JobCounter counter;
+	for (int i = 0; i < 1000; ++i)
+	{
+		jobSystem.Run(counter, [&nRan]() { ++nRan; });
+	}
+	jobSystem.Wait(counter);
+	EXPECT_TRUE(counter.IsDone());
+	EXPECT_EQ(1000, nRan.load());
+}
+
+TEST(JobSystem, NoWorkers)
+{
+	// The waiting thread runs everything
+	JobSystem jobSystem{ 0 };
+	EXPECT_EQ(1u, jobSystem.GetThreadCount());
+
+	int nRan = 0;
+	JobCounter counter;
+	jobSystem.Run(counter, [&nRan]() { ++nRan; });
+	jobSystem.Wait(counter);
+	EXPECT_EQ(1, nRan);
+}
+
+TEST(JobSystem, Nested)
+{
+	JobSystem jobSystem{ 3 };
+	EXPECT_EQ(832040u, Fibonacci(jobSystem, 30));
+}
+
+TEST(JobSystem, Dependencies)
+{
+	JobSystem jobSystem{ 3 };
+	for (int nRepeat = 0; nRepeat < 100; ++nRepeat)
+	{
+		std::atomic<int> nFirst{ 0 };
+		std::atomic<bool> bFirstDoneBeforeSecond{ true };
+
+		JobCounter first, second;
+		for (int i = 0; i < 16; ++i)
+		{
+			jobSystem.Run(first, [&nFirst]() { ++nFirst; });
+		}
+		for (int i = 0; i < 4; ++i)
+		{
+			jobSystem.RunAfter(first, second, [&nFirst, &bFirstDoneBeforeSecond]() {
+				if (nFirst.load() != 16) bFirstDoneBeforeSecond = false;
+			});
+		}
+		jobSystem.Wait(second);
+		EXPECT_TRUE(first.IsDone());
+		EXPECT_TRUE(bFirstDoneBeforeSecond.load());
+	}
+}
+
+TEST(JobSystem, DependencyAlreadyDone)
+{
+	JobSystem jobSystem{ 1 };
+	JobCounter done, counter;
+	bool bRan = false;
+	jobSystem.RunAfter(done, counter, [&bRan]() { bRan = true; });
+	jobSystem.Wait(counter);
+	EXPECT_TRUE(bRan);
+}
+
+TEST(JobSystem, ParallelFor)
+{
+	JobSystem jobSystem{ 3 };
+	std::vector<int> cValues(100000, 0);
+	jobSystem.ParallelFor(0, cValues.size(), [&cValues](size_t i) { cValues[i] += static_cast<int>(i % 7); });
+
+	std::vector<int> cExpected(cValues.size());
+	for (size_t i = 0; i < cExpected.size(); ++i) cExpected[i] = static_cast<int>(i % 7);
+	EXPECT_EQ(cExpected, cValues);
+}
+
+TEST(JobSystem, ParallelForRangeGrain)
+{
+	JobSystem jobSystem{ 2 };
+	std::atomic<size_t> nTotal{ 0 };
+	std::atomic<bool> bGrainRespected{ true };
+	jobSystem.ParallelForRange(10, 1010, [&](size_t nBegin, size_t nEnd) {
+		if (nEnd - nBegin > 50) bGrainRespected = false;
+		nTotal += nEnd - nBegin;
+	}, 50);
+	EXPECT_EQ(1000u, nTotal.load());
+	EXPECT_TRUE(bGrainRespected.load());
+
+	// Empty range
+	jobSystem.ParallelFor(5, 5, [](size_t) { FAIL(); });
+}
+
+TEST(JobSystem, ThreadIndex)
+{
+	JobSystem jobSystem{ 2 };
+	EXPECT_EQ(0u, jobSystem.GetCurrentThreadIndex());
+
+	std::atomic<bool> bValid{ true };
+	jobSystem.ParallelFor(0, 1000, [&](size_t) {
+		if (jobSystem.GetCurrentThreadIndex() > jobSystem.GetWorkerCount()) bValid = false;
+	});
+	EXPECT_TRUE(bValid.load());
+}
+
+TEST(JobSystem, DestructorRunsRemainingJobs)
+{
+	std::atomic<int> nRan{ 0 };
+	{
+		JobSystem jobSystem{ 0 };
+		for (int i = 0; i < 10; ++i)
+		{
+			jobSystem.Run([&nRan]() { ++nRan; });
+		}
+	}
+	EXPECT_EQ(10, nRan.load());
+}
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include "HE_LogFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace HE;
+using namespace std::string_literals;
+
+HE_DEFINE_LOG_CATEGORY(LogFileTest, Info);
+
+namespace
+{
+	std::string ReadFile(const std::string& sPath)
+	{
+		std::ifstream file{ sPath, std::ios::binary };
+		return{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+	}
+
+	size_t CountLines(const std::string& s)
+	{
+		return static_cast<size_t>(std::count(s.begin(), s.end(), '\n'));
+	}
+}
+
+TEST(MappedFile, ReadWrite)
+{
+	auto const sPath = "HE_MappedFile_Test.bin"s;
+	{
+		auto file = MappedFile::Open(sPath, MappedFile::Access::ReadWrite);
+		file.Resize(MappedFile::GetMappingGranularity());
+		EXPECT_EQ(MappedFile::GetMappingGranularity(), file.GetSize());
+
+		auto const view = file.Map(0, 5);
+		std::memcpy(view.ptr, "Hazel", 5);
+		file.FlushView(view, true);
+		file.Unmap(view);
+		file.Resize(5);
+	}
+
+	{
+		auto file = MappedFile::Open(sPath, MappedFile::Access::Read);
+		ASSERT_EQ(5u, file.GetSize());
+		auto const view = file.Map(0, 5);
+		EXPECT_EQ(0, std::memcmp(view.ptr, "Hazel", 5));
+		file.Unmap(view);
+	}
+
+	std::remove(sPath.c_str());
+}
+
+TEST(MappedFileLogSink, WriteAndClose)
+{
+	MappedFileLogSink::Settings settings;
+	settings.sPathPrefix = "HE_LogFile_Test";
+	settings.nSegmentSize = 1; // Rounded up to a single page, so that records cross segments
+	settings.tSyncInterval = std::chrono::milliseconds{ 10 };
+
+	std::string sPath;
+	{
+		MappedFileLogSink sink{ settings };
+		sPath = sink.GetCurrentPath();
+		for (int i = 0; i < 1000; ++i)
+		{
+			sink.Write(LogLevel::Info, g_LogCategoryLogFileTest, Format("Message number {_}", i).c_str());
+		}
+	}
+
+	// The file is truncated to its content on close
+	auto const sContent = ReadFile(sPath);
+	EXPECT_EQ(1000u, CountLines(sContent));
+	EXPECT_EQ(std::string::npos, sContent.find('\0'));
+	EXPECT_NE(std::string::npos, sContent.find("[LogFileTest][Info] Message number 999\n"));
+
+	// The next file, created ahead of the rotation, is removed with the sink
+	auto const sNextPath = sPath.substr(0, sPath.size() - "0.log"s.size()) + "1.log";
+	EXPECT_FALSE(std::ifstream{ sNextPath }.good());
+
+	std::remove(sPath.c_str());
+}
+
+TEST(MappedFileLogSink, RotateOnSize)
+{
+	MappedFileLogSink::Settings settings;
+	settings.sPathPrefix = "HE_LogFile_Test";
+	settings.nFileSize = 4096;
+	settings.tSyncInterval = std::chrono::milliseconds{ 0 };
+
+	std::vector<std::string> cPaths;
+	{
+		MappedFileLogSink sink{ settings };
+		for (int i = 0; i < 500; ++i)
+		{
+			sink.Write(LogLevel::Warning, g_LogCategoryLogFileTest, Format("Message number {_}", i).c_str());
+			if (cPaths.empty() || cPaths.back() != sink.GetCurrentPath())
+			{
+				cPaths.push_back(sink.GetCurrentPath());
+			}
+		}
+	}
+
+	ASSERT_GT(cPaths.size(), 1u);
+	size_t nLines = 0;
+	for (auto const& sPath : cPaths)
+	{
+		auto const sContent = ReadFile(sPath);
+		EXPECT_LE(sContent.size(), 4096u);
+		// Records never span files
+		EXPECT_EQ('\n', sContent.back());
+		nLines += CountLines(sContent);
+		std::remove(sPath.c_str());
+	}
+	EXPECT_EQ(500u, nLines);
+}
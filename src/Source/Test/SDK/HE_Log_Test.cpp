@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+
+#include "HE_Log.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace HE;
+
+HE_DEFINE_LOG_CATEGORY(LogTest, Off);
+
+namespace
+{
+	int SideEffect(int& n)
+	{
+		return ++n;
+	}
+}
+
+TEST(LogLevel, Parse)
+{
+	LogLevel eLevel = LogLevel::Info;
+	EXPECT_TRUE(ParseLogLevel("verbose", eLevel));
+	EXPECT_EQ(LogLevel::Verbose, eLevel);
+	EXPECT_TRUE(ParseLogLevel("Warning", eLevel));
+	EXPECT_EQ(LogLevel::Warning, eLevel);
+	EXPECT_FALSE(ParseLogLevel("Loud", eLevel));
+	EXPECT_EQ(LogLevel::Warning, eLevel);
+}
+
+TEST(LogLevel, ToString)
+{
+	EXPECT_EQ("Debug", to_string(LogLevel::Debug));
+	EXPECT_EQ("Level: Error", Format("Level: {0}", LogLevel::Error));
+}
+
+TEST(LogCategory, Find)
+{
+	EXPECT_EQ(&g_LogCategoryLogTest, LogCategory::Find("LogTest"));
+	EXPECT_EQ(nullptr, LogCategory::Find("NotACategory"));
+}
+
+TEST(LogCategory, Threshold)
+{
+	g_LogCategoryLogTest.SetLevel(LogLevel::Warning);
+	EXPECT_FALSE(g_LogCategoryLogTest.IsEnabled(LogLevel::Info));
+	EXPECT_TRUE(g_LogCategoryLogTest.IsEnabled(LogLevel::Warning));
+	EXPECT_TRUE(g_LogCategoryLogTest.IsEnabled(LogLevel::Error));
+	g_LogCategoryLogTest.SetLevel(LogLevel::Off);
+}
+
+TEST(HE_LOG, FilteredArgumentsNotEvaluated)
+{
+	int n = 0;
+	g_LogCategoryLogTest.SetLevel(LogLevel::Off);
+	HE_LOG(Error, LogTest, "Side effect {_}", SideEffect(n));
+	EXPECT_EQ(0, n);
+
+	g_LogCategoryLogTest.SetLevel(LogLevel::Info);
+	HE_LOG(Verbose, LogTest, "Side effect {_}", SideEffect(n));
+	EXPECT_EQ(0, n);
+	HE_LOG(Info, LogTest, "Side effect {_}", SideEffect(n));
+	EXPECT_EQ(1, n);
+	g_LogCategoryLogTest.SetLevel(LogLevel::Off);
+}
+
+TEST(SetLogLevels, Spec)
+{
+	EXPECT_TRUE(SetLogLevels("LogTest=Debug"));
+	EXPECT_EQ(LogLevel::Debug, g_LogCategoryLogTest.GetLevel());
+
+	EXPECT_FALSE(SetLogLevels(" LogTest = Error , NotACategory=Info, LogTest"));
+	EXPECT_EQ(LogLevel::Error, g_LogCategoryLogTest.GetLevel());
+	g_LogCategoryLogTest.SetLevel(LogLevel::Off);
+}
+
+namespace
+{
+	class CaptureLogSink : public LogSink
+	{
+	public:
+		void Write(LogLevel, const LogCategory&, const char* psMsg) noexcept override
+		{
+			m_cMessages.push_back(psMsg);
+		}
+
+		void Flush() noexcept override
+		{
+			++m_nFlushes;
+		}
+
+		std::vector<std::string> m_cMessages;
+		int m_nFlushes{ 0 };
+	};
+}
+
+TEST(HE_LOG, Sink)
+{
+	CaptureLogSink sink;
+	AddLogSink(sink);
+	g_LogCategoryLogTest.SetLevel(LogLevel::Info);
+	HE_LOG(Info, LogTest, "Message {_}", 1);
+	HE_LOG(Verbose, LogTest, "Message {_}", 2);
+	g_LogCategoryLogTest.SetLevel(LogLevel::Off);
+	RemoveLogSink(sink);
+	HE_LOG(Error, LogTest, "Message {_}", 3);
+
+	ASSERT_EQ(1u, sink.m_cMessages.size());
+	EXPECT_EQ("Message 1", sink.m_cMessages[0]);
+}
+
+TEST(HE_LOG, Once)
+{
+	CaptureLogSink sink;
+	AddLogSink(sink);
+	g_LogCategoryLogTest.SetLevel(LogLevel::Info);
+	for (int i = 0; i < 10; ++i)
+	{
+		HE_LOG_ONCE(Info, LogTest, "Once {_}", i);
+	}
+	g_LogCategoryLogTest.SetLevel(LogLevel::Off);
+	RemoveLogSink(sink);
+
+	ASSERT_EQ(1u, sink.m_cMessages.size());
+	EXPECT_EQ("Once 0", sink.m_cMessages[0]);
+}
+
+TEST(HE_LOG, Every)
+{
+	CaptureLogSink sink;
+	AddLogSink(sink);
+	g_LogCategoryLogTest.SetLevel(LogLevel::Info);
+	for (int i = 0; i < 10; ++i)
+	{
+		HE_LOG_EVERY(4, Info, LogTest, "Every {_}", i);
+	}
+	g_LogCategoryLogTest.SetLevel(LogLevel::Off);
+	RemoveLogSink(sink);
+
+	ASSERT_EQ(3u, sink.m_cMessages.size());
+	EXPECT_EQ("Every 0", sink.m_cMessages[0]);
+	EXPECT_EQ("Every 4", sink.m_cMessages[1]);
+	EXPECT_EQ("Every 8", sink.m_cMessages[2]);
+
+	LogEveryNGate gate;
+	EXPECT_FALSE(gate.ShouldLog(0));
+	EXPECT_FALSE(gate.ShouldLog(0));
+}
+
+TEST(HE_LOG, AtMostPerSecond)
+{
+	CaptureLogSink sink;
+	AddLogSink(sink);
+	g_LogCategoryLogTest.SetLevel(LogLevel::Info);
+	for (int i = 0; i < 1000; ++i)
+	{
+		HE_LOG_AT_MOST_PER_SECOND(5, Info, LogTest, "Rate {_}", i);
+	}
+	g_LogCategoryLogTest.SetLevel(LogLevel::Off);
+	RemoveLogSink(sink);
+
+	// The loop might straddle a second boundary
+	EXPECT_GE(sink.m_cMessages.size(), 5u);
+	EXPECT_LE(sink.m_cMessages.size(), 10u);
+}
+
+TEST(DedupLogSink, Summary)
+{
+	CaptureLogSink target;
+	DedupLogSink dedup{ target };
+	for (int i = 0; i < 100; ++i)
+	{
+		dedup.Write(LogLevel::Error, g_LogCategoryLogTest, "Entity exploded");
+		dedup.Write(LogLevel::Error, g_LogCategoryLogTest, i % 2 ? "Odd" : "Even");
+	}
+	dedup.Write(LogLevel::Error, g_LogCategoryLogTest, "Unique");
+
+	ASSERT_EQ(4u, target.m_cMessages.size());
+
+	dedup.Flush();
+	EXPECT_EQ(1, target.m_nFlushes);
+	ASSERT_EQ(7u, target.m_cMessages.size());
+	auto const bFound = std::find(target.m_cMessages.begin(), target.m_cMessages.end(), "Entity exploded (repeated 99 times)") != target.m_cMessages.end();
+	EXPECT_TRUE(bFound);
+
+	// Messages are forgotten after a flush
+	dedup.Write(LogLevel::Error, g_LogCategoryLogTest, "Entity exploded");
+	EXPECT_EQ(8u, target.m_cMessages.size());
+}
+
+TEST(DedupLogSink, FlushLogSinks)
+{
+	CaptureLogSink target;
+	DedupLogSink dedup{ target };
+	AddLogSink(dedup);
+	g_LogCategoryLogTest.SetLevel(LogLevel::Info);
+	for (int i = 0; i < 3; ++i)
+	{
+		HE_LOG(Info, LogTest, "Repeated");
+	}
+	FlushLogSinks();
+	g_LogCategoryLogTest.SetLevel(LogLevel::Off);
+	RemoveLogSink(dedup);
+
+	ASSERT_EQ(2u, target.m_cMessages.size());
+	EXPECT_EQ("Repeated", target.m_cMessages[0]);
+	EXPECT_EQ("Repeated (repeated 2 times)", target.m_cMessages[1]);
+	EXPECT_EQ(1, target.m_nFlushes);
+}
@@ -0,0 +1,6 @@
+// The tests of HE_Math_Test.cpp on the AVX2 path, which also covers the SSE4 one: this file is built with /arch:AVX2
+// (see HazelEngine_Test.vcxproj), whatever the instruction set of the rest of the tests
+#define HE_MATH_TEST_SUITE Math_AVX2
+#include "HE_Math_Test.cpp"
+
+static_assert(HE_MATH_SIMD == HE_MATH_AVX2, "HE_Math_AVX2_Test.cpp should be built with /arch:AVX2");
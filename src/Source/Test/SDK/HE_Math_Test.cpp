@@ -2,6 +2,14 @@
 
 #include "HE_Math.h"
 
+#include <cmath>
+#include <cstdint>
+
+// Name of the test suite, so that HE_Math_AVX2_Test.cpp can run the tests again on its instruction set
+#ifndef HE_MATH_TEST_SUITE
+#define HE_MATH_TEST_SUITE Math
+#endif
+
 using namespace HE::Math;
 
 static_assert(!IsPow2(0), "HE::Math::IsPow2 failed to pass test");
@@ -19,4 +27,165 @@ static_assert(Max(2, 2.4f, 1.0) == 2.4f, "HE::Math::Max failed to pass test");
 
 static_assert(RoundUpToMultipleOf(1, 4) == 4, "HE::Math::RoundUpToMultipleOf failed to pass test");
 static_assert(RoundUpToMultipleOf(13, 9) == 18, "HE::Math::RoundUpToMultipleOf failed to pass test");
-//static_assert(RoundUpToMultipleOf(1, -2) == 4, "HE::Math::RoundUpToMultipleOf failed to pass test"); // Should not compile
\ No newline at end of file
+//static_assert(RoundUpToMultipleOf(1, -2) == 4, "HE::Math::RoundUpToMultipleOf failed to pass test"); // Should not compile
+
+// Vector math: the operations with a SIMD path are compared to their reference in HE::Math::Scalar, on the
+// instruction set of this build (see HE_MATH_SIMD)
+
+static_assert(Dot(Vec3{ 1.0f, 2.0f, 3.0f }, Vec3{ 4.0f, 5.0f, 6.0f }) == 32.0f, "HE::Math::Dot failed to pass test");
+static_assert(Cross(Vec3{ 1.0f, 0.0f, 0.0f }, Vec3{ 0.0f, 1.0f, 0.0f }) == Vec3{ 0.0f, 0.0f, 1.0f }, "HE::Math::Cross failed to pass test");
+static_assert(Mat3::Identity() * Vec3{ 1.0f, 2.0f, 3.0f } == Vec3{ 1.0f, 2.0f, 3.0f }, "HE::Math::Mat3 failed to pass test");
+static_assert(Scalar::Multiply(Mat4::Translation({ 1.0f, 2.0f, 3.0f }), Vec4{ 1.0f, 1.0f, 1.0f, 1.0f }) == Vec4{ 2.0f, 3.0f, 4.0f, 1.0f }, "HE::Math::Scalar::Multiply failed to pass test");
+static_assert(Rotate(Quat::Identity(), Vec3{ 1.0f, 2.0f, 3.0f }) == Vec3{ 1.0f, 2.0f, 3.0f }, "HE::Math::Rotate failed to pass test");
+static_assert(Intersects(AABB{ { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } }, AABB{ { 1.0f, 1.0f, 1.0f }, { 2.0f, 2.0f, 2.0f } }), "HE::Math::Intersects failed to pass test");
+static_assert(!Contains(AABB{ { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } }, Vec3{ 0.5f, 1.5f, 0.5f }), "HE::Math::Contains failed to pass test");
+static_assert(alignof(Vec4) == 16 && alignof(Mat4) == 16 && alignof(Quat) == 16, "HE::Math types should fit SIMD registers");
+
+namespace
+{
+	// Deterministic values in [-10, 10)
+	class Values
+	{
+	public:
+		float Next() noexcept
+		{
+			m_nState = m_nState * 6364136223846793005ull + 1442695040888963407ull;
+			return static_cast<float>(m_nState >> 40) / static_cast<float>(1 << 24) * 20.0f - 10.0f;
+		}
+
+		Vec3 NextVec3() noexcept { auto const x = Next(); auto const y = Next(); return{ x, y, Next() }; }
+		Vec4 NextVec4() noexcept { auto const x = Next(); auto const y = Next(); auto const z = Next(); return{ x, y, z, Next() }; }
+		Mat4 NextMat4() noexcept { auto const c0 = NextVec4(); auto const c1 = NextVec4(); auto const c2 = NextVec4(); return{ { c0, c1, c2, NextVec4() } }; }
+		Quat NextQuat() noexcept { auto const v = NextVec4(); return Normalize(Quat{ v.x, v.y, v.z, v.w }); }
+
+	private:
+		std::uint64_t m_nState{ 42 };
+	};
+
+	// The SIMD paths add in another order, or fuse the multiplies
+	void ExpectNear(float fExpected, float fActual)
+	{
+		EXPECT_NEAR(fExpected, fActual, 1e-4f * (1.0f + std::abs(fExpected)));
+	}
+
+	void ExpectNear(const Vec3& expected, const Vec3& actual)
+	{
+		ExpectNear(expected.x, actual.x);
+		ExpectNear(expected.y, actual.y);
+		ExpectNear(expected.z, actual.z);
+	}
+
+	void ExpectNear(const Vec4& expected, const Vec4& actual)
+	{
+		ExpectNear(expected.x, actual.x);
+		ExpectNear(expected.y, actual.y);
+		ExpectNear(expected.z, actual.z);
+		ExpectNear(expected.w, actual.w);
+	}
+
+	void ExpectNear(const Mat4& expected, const Mat4& actual)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			ExpectNear(expected.aColumns[i], actual.aColumns[i]);
+		}
+	}
+
+	void ExpectNear(const Quat& expected, const Quat& actual)
+	{
+		ExpectNear(Vec4{ expected.x, expected.y, expected.z, expected.w }, Vec4{ actual.x, actual.y, actual.z, actual.w });
+	}
+
+	int const Iterations = 100;
+}
+
+TEST(HE_MATH_TEST_SUITE, Vec4)
+{
+	Values values;
+	for (int i = 0; i < Iterations; ++i)
+	{
+		auto const a = values.NextVec4();
+		auto const b = values.NextVec4();
+		auto const f = values.Next();
+		EXPECT_EQ(Scalar::Add(a, b), a + b);
+		EXPECT_EQ(Scalar::Subtract(a, b), a - b);
+		EXPECT_EQ(Scalar::Multiply(a, b), a * b);
+		EXPECT_EQ(Scalar::Multiply(a, f), a * f);
+		ExpectNear(Scalar::Dot(a, b), Dot(a, b));
+	}
+}
+
+TEST(HE_MATH_TEST_SUITE, Mat4)
+{
+	Values values;
+	for (int i = 0; i < Iterations; ++i)
+	{
+		auto const a = values.NextMat4();
+		auto const b = values.NextMat4();
+		auto const v = values.NextVec4();
+		ExpectNear(Scalar::Multiply(a, b), a * b);
+		ExpectNear(Scalar::Multiply(a, v), a * v);
+		EXPECT_EQ(Scalar::Transpose(a), Transpose(a));
+	}
+
+	// Scale, then translate: the translation is not scaled
+	auto const scale = Mat4::Scale({ 2.0f, 2.0f, 2.0f });
+	auto const translation = Mat4::Translation({ 1.0f, 2.0f, 3.0f });
+	EXPECT_EQ((Vec3{ 3.0f, 4.0f, 5.0f }), TransformPoint(translation * scale, { 1.0f, 1.0f, 1.0f }));
+	EXPECT_EQ((Vec3{ 4.0f, 6.0f, 8.0f }), TransformPoint(scale * translation, { 1.0f, 1.0f, 1.0f }));
+	EXPECT_EQ((Vec3{ 2.0f, 2.0f, 2.0f }), TransformDirection(translation * scale, { 1.0f, 1.0f, 1.0f }));
+}
+
+TEST(HE_MATH_TEST_SUITE, Quat)
+{
+	Values values;
+	for (int i = 0; i < Iterations; ++i)
+	{
+		auto const a = values.NextQuat();
+		auto const b = values.NextQuat();
+		auto const v = values.NextVec3();
+		ExpectNear(Scalar::Multiply(a, b), a * b);
+		// Same rotation as the matrix, and composed in the same order
+		ExpectNear(TransformPoint(Mat4::Rotation(a), v), Rotate(a, v));
+		ExpectNear(Rotate(a, Rotate(b, v)), Rotate(a * b, v));
+		ExpectNear(v, Rotate(Conjugate(a), Rotate(a, v)));
+	}
+
+	// A quarter turn around z
+	auto const quarter = Quat::FromAxisAngle({ 0.0f, 0.0f, 1.0f }, 1.57079632679f);
+	ExpectNear(Vec3{ 0.0f, 1.0f, 0.0f }, Rotate(quarter, { 1.0f, 0.0f, 0.0f }));
+	ExpectNear(Vec3{ std::sqrt(0.5f), std::sqrt(0.5f), 0.0f }, Rotate(Slerp(Quat::Identity(), quarter, 0.5f), { 1.0f, 0.0f, 0.0f }));
+	ExpectNear(quarter, Slerp(Quat::Identity(), quarter, 1.0f));
+}
+
+TEST(HE_MATH_TEST_SUITE, AABB)
+{
+	Values values;
+	for (int i = 0; i < Iterations; ++i)
+	{
+		auto const a = values.NextVec3();
+		auto const b = values.NextVec3();
+		AABB const box{ ComponentMin(a, b), ComponentMax(a, b) };
+		auto const m = values.NextMat4();
+		auto const expected = Scalar::Transform(box, m);
+		auto const actual = Transform(box, m);
+		ExpectNear(expected.min, actual.min);
+		ExpectNear(expected.max, actual.max);
+
+		// The corners are inside the transformed box
+		for (int nCorner = 0; nCorner < 8; ++nCorner)
+		{
+			Vec3 const corner{ nCorner & 1 ? box.max.x : box.min.x, nCorner & 2 ? box.max.y : box.min.y, nCorner & 4 ? box.max.z : box.min.z };
+			auto const p = TransformPoint(m, corner);
+			AABB const margin{ actual.min - Vec3{ 1e-3f, 1e-3f, 1e-3f } * (1.0f + Length(p)), actual.max + Vec3{ 1e-3f, 1e-3f, 1e-3f } * (1.0f + Length(p)) };
+			EXPECT_TRUE(Contains(margin, p));
+		}
+	}
+
+	AABB const box{ { 0.0f, 0.0f, 0.0f }, { 2.0f, 2.0f, 2.0f } };
+	EXPECT_EQ((Vec3{ 1.0f, 1.0f, 1.0f }), GetCenter(box));
+	EXPECT_EQ((Vec3{ 1.0f, 1.0f, 1.0f }), GetExtents(box));
+	auto const merged = Union(box, AABB{ { -1.0f, 1.0f, 1.0f }, { 1.0f, 3.0f, 1.0f } });
+	EXPECT_EQ((Vec3{ -1.0f, 0.0f, 0.0f }), merged.min);
+	EXPECT_EQ((Vec3{ 2.0f, 3.0f, 2.0f }), merged.max);
+}
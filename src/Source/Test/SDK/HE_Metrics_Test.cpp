@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+
+#include "HE_Metrics.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace HE;
+
+TEST(Metrics, Buckets)
+{
+	// Exact below 64, then within 1/32 of the value
+	for (std::uint64_t n = 0; n < 64; ++n)
+	{
+		EXPECT_EQ(n, HistogramSnapshot::GetBucketLow(HistogramSnapshot::GetBucket(n)));
+		EXPECT_EQ(n, HistogramSnapshot::GetBucketHigh(HistogramSnapshot::GetBucket(n)));
+	}
+	for (std::uint64_t n = 64; n < (std::uint64_t{ 1 } << 40); n = n * 5 / 4 + 3)
+	{
+		auto const nBucket = HistogramSnapshot::GetBucket(n);
+		ASSERT_LT(nBucket, HistogramSnapshot::BucketCount);
+		auto const nLow = HistogramSnapshot::GetBucketLow(nBucket);
+		auto const nHigh = HistogramSnapshot::GetBucketHigh(nBucket);
+		ASSERT_LE(nLow, n);
+		ASSERT_GE(nHigh, n);
+		ASSERT_LE(nHigh - nLow, n / 32);
+	}
+
+	// Contiguous, up to the last bucket, which also takes the values past the range
+	for (size_t i = 1; i < HistogramSnapshot::BucketCount; ++i)
+	{
+		ASSERT_EQ(HistogramSnapshot::GetBucketHigh(i - 1) + 1, HistogramSnapshot::GetBucketLow(i));
+	}
+	EXPECT_EQ((std::uint64_t{ 1 } << 40) - 1, HistogramSnapshot::GetBucketHigh(HistogramSnapshot::BucketCount - 1));
+	EXPECT_EQ(HistogramSnapshot::BucketCount - 1, HistogramSnapshot::GetBucket(~std::uint64_t{ 0 }));
+}
+
+TEST(Metrics, Percentiles)
+{
+	MetricsRegistry metrics;
+	auto& histogram = metrics.GetHistogram("Latency");
+	// 1 to 1000 microseconds
+	for (std::uint64_t n = 1; n <= 1000; ++n)
+	{
+		histogram.Record(std::chrono::microseconds{ n });
+	}
+	metrics.Merge();
+
+	auto const snapshot = metrics.GetSnapshot().cHistograms["Latency"];
+	EXPECT_EQ(1000u, snapshot.nCount);
+	EXPECT_EQ(1000u, snapshot.nMin);
+	EXPECT_EQ(1000000u, snapshot.nMax);
+	EXPECT_DOUBLE_EQ(500500.0, snapshot.GetMean());
+	auto const ExpectNear = [](std::uint64_t nExpected, std::uint64_t nValue) {
+		EXPECT_LE(nExpected, nValue);
+		EXPECT_GE(nExpected + nExpected / 32, nValue);
+	};
+	ExpectNear(500000, snapshot.GetPercentile(0.5));
+	ExpectNear(990000, snapshot.GetPercentile(0.99));
+	ExpectNear(999000, snapshot.GetPercentile(0.999));
+	EXPECT_EQ(1000000u, snapshot.GetPercentile(1.0));
+	ExpectNear(1000, snapshot.GetPercentile(0.0));
+}
+
+TEST(Metrics, MergedOnlyByMerge)
+{
+	MetricsRegistry metrics;
+	auto& counter = metrics.GetCounter("Frames");
+	auto& gauge = metrics.GetGauge("Memory", MetricUnit::Bytes);
+	EXPECT_EQ(&counter, &metrics.GetCounter("Frames"));
+
+	counter.Add(3);
+	gauge.Set(2048);
+	EXPECT_EQ(0u, metrics.GetSnapshot().cCounters["Frames"]);
+	EXPECT_EQ(0, metrics.GetSnapshot().cGauges["Memory"].nValue);
+
+	metrics.Merge();
+	auto const snapshot = metrics.GetSnapshot();
+	EXPECT_EQ(3u, snapshot.cCounters.at("Frames"));
+	EXPECT_EQ(2048, snapshot.cGauges.at("Memory").nValue);
+	EXPECT_EQ(MetricUnit::Bytes, snapshot.cGauges.at("Memory").eUnit);
+}
+
+TEST(Metrics, Threads)
+{
+	MetricsRegistry metrics;
+	auto& counter = metrics.GetCounter("Items");
+	auto& histogram = metrics.GetHistogram("Values", MetricUnit::Count);
+
+	// Merging while the threads update: each merge sees a consistent total of what came before
+	std::vector<std::thread> cThreads;
+	for (std::uint64_t t = 0; t < 4; ++t)
+	{
+		cThreads.emplace_back([&counter, &histogram, t]() {
+			for (std::uint64_t i = 0; i < 10000; ++i)
+			{
+				counter.Add();
+				histogram.Record(t * 100 + i % 100);
+			}
+		});
+	}
+	for (int i = 0; i < 10; ++i)
+	{
+		metrics.Merge();
+		auto const snapshot = metrics.GetSnapshot();
+		EXPECT_GE(40000u, snapshot.cCounters.at("Items"));
+		EXPECT_GE(40000u, snapshot.cHistograms.at("Values").nCount);
+	}
+	for (auto& thread : cThreads) thread.join();
+
+	metrics.Merge();
+	auto const snapshot = metrics.GetSnapshot();
+	EXPECT_EQ(40000u, snapshot.cCounters.at("Items"));
+	auto const& values = snapshot.cHistograms.at("Values");
+	EXPECT_EQ(40000u, values.nCount);
+	EXPECT_EQ(0u, values.nMin);
+	EXPECT_EQ(399u, values.nMax);
+}
+
+TEST(Metrics, SingleShard)
+{
+	// Same totals, with the threads contending on one shard
+	MetricsRegistry metrics{ MetricSharding::Single };
+	auto& counter = metrics.GetCounter("Items");
+	auto& histogram = metrics.GetHistogram("Values", MetricUnit::Count);
+	std::vector<std::thread> cThreads;
+	for (std::uint64_t t = 0; t < 4; ++t)
+	{
+		cThreads.emplace_back([&counter, &histogram, t]() {
+			for (std::uint64_t i = 0; i < 10000; ++i)
+			{
+				counter.Add();
+				histogram.Record(t * 100 + i % 100);
+			}
+		});
+	}
+	for (auto& thread : cThreads) thread.join();
+
+	metrics.Merge();
+	auto const snapshot = metrics.GetSnapshot();
+	EXPECT_EQ(40000u, snapshot.cCounters.at("Items"));
+	auto const& values = snapshot.cHistograms.at("Values");
+	EXPECT_EQ(40000u, values.nCount);
+	EXPECT_EQ(0u, values.nMin);
+	EXPECT_EQ(399u, values.nMax);
+}
+
+TEST(Metrics, Since)
+{
+	MetricsRegistry metrics;
+	auto& counter = metrics.GetCounter("Frames");
+	auto& histogram = metrics.GetHistogram("FrameTime");
+	for (int i = 0; i < 100; ++i)
+	{
+		counter.Add();
+		histogram.Record(std::chrono::milliseconds{ 1 });
+	}
+	metrics.Merge();
+	auto const earlier = metrics.GetSnapshot();
+
+	for (int i = 0; i < 10; ++i)
+	{
+		counter.Add();
+		histogram.Record(std::chrono::milliseconds{ 20 });
+	}
+	metrics.Merge();
+
+	// Only the slow frames
+	auto const interval = metrics.GetSnapshot().Since(earlier);
+	EXPECT_EQ(10u, interval.cCounters.at("Frames"));
+	auto const& frameTime = interval.cHistograms.at("FrameTime");
+	EXPECT_EQ(10u, frameTime.nCount);
+	EXPECT_EQ(200000000u, frameTime.nSum);
+	EXPECT_LE(19000000u, frameTime.nMin);
+	EXPECT_EQ(20000000u, frameTime.GetPercentile(0.5));
+}
+
+TEST(Metrics, Text)
+{
+	MetricsRegistry metrics;
+	metrics.GetCounter("Engine.Frames").Add(60);
+	metrics.GetGauge("Jobs.Memory", MetricUnit::Bytes).Set(4096);
+	metrics.GetHistogram("Engine.FrameInterval").Record(std::chrono::microseconds{ 16667 });
+	metrics.Merge();
+
+	auto const sText = to_string(metrics.GetSnapshot());
+	EXPECT_NE(std::string::npos, sText.find("Engine.Frames: 60\n"));
+	EXPECT_NE(std::string::npos, sText.find("Jobs.Memory: 4.0KiB\n"));
+	EXPECT_NE(std::string::npos, sText.find("Engine.FrameInterval: 1 values, mean 16.667ms, p50 16.667ms, p99 16.667ms, p999 16.667ms, max 16.667ms"));
+}
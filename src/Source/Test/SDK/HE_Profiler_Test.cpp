@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+
+#include "HE_Profiler.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace HE;
+
+namespace
+{
+	// Events of the capture with that name, over all its frames
+	std::vector<ProfileCapture::Event> FindEvents(const ProfileCapture& capture, const std::string& sName)
+	{
+		std::vector<ProfileCapture::Event> cEvents;
+		for (auto const& frame : capture.cFrames)
+		{
+			for (auto const& event : frame.cEvents)
+			{
+				if (capture.cNames[event.nName] == sName) cEvents.push_back(event);
+			}
+		}
+		return cEvents;
+	}
+
+	ProfileCapture CaptureNested()
+	{
+		ProfileHistory history{ 4 };
+		// Drops what earlier tests left in the rings
+		history.EndFrame();
+		{
+			HE_PROFILE_SCOPE("Outer");
+			for (int i = 0; i < 3; ++i)
+			{
+				HE_PROFILE_SCOPE("Inner \"quoted\"");
+			}
+		}
+		history.EndFrame();
+		return history.Capture(1);
+	}
+}
+
+TEST(Profiler, NestedScopes)
+{
+	auto const capture = CaptureNested();
+	EXPECT_GT(capture.fTicksPerSecond, 0.0);
+	ASSERT_EQ(1u, capture.cFrames.size());
+	EXPECT_EQ(1u, capture.cFrames[0].nNumber);
+
+	auto const cOuter = FindEvents(capture, "Outer");
+	auto const cInner = FindEvents(capture, "Inner \"quoted\"");
+	ASSERT_EQ(1u, cOuter.size());
+	ASSERT_EQ(3u, cInner.size());
+	EXPECT_EQ(0u, cOuter[0].nDepth);
+	for (auto const& inner : cInner)
+	{
+		EXPECT_EQ(1u, inner.nDepth);
+		EXPECT_EQ(cOuter[0].nThread, inner.nThread);
+		EXPECT_LE(cOuter[0].nBegin, inner.nBegin);
+		EXPECT_LE(inner.nEnd, cOuter[0].nEnd);
+	}
+	EXPECT_LE(capture.cFrames[0].nBegin, cOuter[0].nBegin);
+	EXPECT_LE(cOuter[0].nEnd, capture.cFrames[0].nEnd);
+}
+
+TEST(Profiler, Threads)
+{
+	ProfileHistory history{ 4 };
+	history.EndFrame();
+
+	std::vector<std::thread> cThreads;
+	for (int i = 0; i < 3; ++i)
+	{
+		cThreads.emplace_back([i]() {
+			SetProfileThreadName("Profiled " + std::to_string(i));
+			HE_PROFILE_SCOPE("Thread work");
+		});
+	}
+	for (auto& thread : cThreads) thread.join();
+	history.EndFrame();
+
+	auto const capture = history.Capture();
+	auto const cEvents = FindEvents(capture, "Thread work");
+	ASSERT_EQ(3u, cEvents.size());
+	std::vector<std::string> cNames;
+	for (auto const& event : cEvents)
+	{
+		ASSERT_LT(event.nThread, capture.cThreadNames.size());
+		cNames.push_back(capture.cThreadNames[event.nThread]);
+	}
+	std::sort(cNames.begin(), cNames.end());
+	EXPECT_EQ((std::vector<std::string>{ "Profiled 0", "Profiled 1", "Profiled 2" }), cNames);
+}
+
+TEST(Profiler, KeepsLastFrames)
+{
+	ProfileHistory history{ 4 };
+	for (int i = 0; i < 10; ++i)
+	{
+		HE_PROFILE_SCOPE("Frame work");
+		history.EndFrame();
+	}
+	EXPECT_EQ(4u, history.GetFrameCount());
+
+	auto const capture = history.Capture(2);
+	ASSERT_EQ(2u, capture.cFrames.size());
+	EXPECT_EQ(8u, capture.cFrames[0].nNumber);
+	EXPECT_EQ(9u, capture.cFrames[1].nNumber);
+	EXPECT_EQ(capture.cFrames[0].nEnd, capture.cFrames[1].nBegin);
+}
+
+TEST(Profiler, InternedNames)
+{
+	auto const psName = InternProfileName(std::string{ "Sys" } + "tem");
+	EXPECT_EQ(psName, InternProfileName("System"));
+	EXPECT_STREQ("System", psName);
+}
+
+TEST(Profiler, ChromeTrace)
+{
+	std::ostringstream stream;
+	WriteChromeTrace(stream, CaptureNested());
+	auto const sTrace = stream.str();
+
+	EXPECT_EQ(0u, sTrace.find("{\"traceEvents\":["));
+	EXPECT_NE(std::string::npos, sTrace.find("{\"name\":\"Outer\",\"ph\":\"X\",\"pid\":1,"));
+	EXPECT_NE(std::string::npos, sTrace.find("{\"name\":\"Inner \\\"quoted\\\"\",\"ph\":\"X\""));
+	EXPECT_NE(std::string::npos, sTrace.find("\"name\":\"thread_name\""));
+	EXPECT_NE(std::string::npos, sTrace.find("{\"name\":\"Frame 1\",\"ph\":\"i\""));
+}
+
+TEST(Profiler, BinaryRoundTrip)
+{
+	auto const capture = CaptureNested();
+	std::stringstream stream;
+	WriteProfileBinary(stream, capture);
+
+	auto const read = ReadProfileBinary(stream);
+	EXPECT_EQ(capture.fTicksPerSecond, read.fTicksPerSecond);
+	EXPECT_EQ(capture.nDroppedEvents, read.nDroppedEvents);
+	EXPECT_EQ(capture.cNames, read.cNames);
+	EXPECT_EQ(capture.cThreadNames, read.cThreadNames);
+	ASSERT_EQ(capture.cFrames.size(), read.cFrames.size());
+	auto const& frame = capture.cFrames[0];
+	auto const& readFrame = read.cFrames[0];
+	EXPECT_EQ(frame.nNumber, readFrame.nNumber);
+	EXPECT_EQ(frame.nBegin, readFrame.nBegin);
+	EXPECT_EQ(frame.nEnd, readFrame.nEnd);
+	ASSERT_EQ(frame.cEvents.size(), readFrame.cEvents.size());
+	for (size_t i = 0; i < frame.cEvents.size(); ++i)
+	{
+		EXPECT_EQ(frame.cEvents[i].nName, readFrame.cEvents[i].nName);
+		EXPECT_EQ(frame.cEvents[i].nThread, readFrame.cEvents[i].nThread);
+		EXPECT_EQ(frame.cEvents[i].nDepth, readFrame.cEvents[i].nDepth);
+		EXPECT_EQ(frame.cEvents[i].nBegin, readFrame.cEvents[i].nBegin);
+		EXPECT_EQ(frame.cEvents[i].nEnd, readFrame.cEvents[i].nEnd);
+	}
+
+	// Compact: past the names, a few bytes per event
+	size_t nNamesSize = 0;
+	for (auto const& sName : capture.cNames) nNamesSize += sName.size() + 1;
+	for (auto const& sName : capture.cThreadNames) nNamesSize += sName.size() + 1;
+	EXPECT_LT(stream.str().size(), nNamesSize + 64 + 16 * frame.cEvents.size());
+
+	std::istringstream invalid{ "HEPF\x01" };
+	EXPECT_THROW(ReadProfileBinary(invalid), std::runtime_error);
+	std::istringstream notProfile{ "Not a profile" };
+	EXPECT_THROW(ReadProfileBinary(notProfile), std::runtime_error);
+}
@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+
+#include "HE_Reflection.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace HE;
+
+// The descriptions are found by argument-dependent lookup: they go in the namespace of the types
+namespace ReflectionTest
+{
+	struct Vec
+	{
+		float x, y;
+	};
+	HE_REFLECT(Vec, x, y)
+
+	enum class Team : std::uint8_t { Red, Blue };
+
+	// Padding after nFlags and after team
+	struct Unit
+	{
+		std::uint8_t nFlags;
+		double fHealth;
+		Team team;
+		Vec aPath[2];
+		int nNotDescribed;
+	};
+	HE_REFLECT(Unit, nFlags, fHealth, team, aPath)
+
+	struct Plain
+	{
+		int n;
+	};
+}
+
+using namespace ReflectionTest;
+
+static_assert(Reflection::IsReflected<Vec>::value, "");
+static_assert(Reflection::IsReflected<Unit>::value, "");
+static_assert(!Reflection::IsReflected<Plain>::value, "");
+static_assert(!Reflection::IsReflected<int>::value, "");
+static_assert(Reflection::FieldsOf<Unit>::Count == 4, "");
+static_assert(Reflection::GetPackedSize<Vec>() == 8, "");
+static_assert(Reflection::GetPackedSize<Unit>() == 1 + 8 + 1 + 16, "");
+
+namespace
+{
+	Unit MakeUnit(unsigned char nGarbage)
+	{
+		// The padding and the field that is not described are filled with garbage
+		Unit unit;
+		std::memset(&unit, nGarbage, sizeof(unit));
+		unit.nFlags = 3;
+		unit.fHealth = 50.0;
+		unit.team = Team::Blue;
+		unit.aPath[0] = { 1.0f, 2.0f };
+		unit.aPath[1] = { 3.0f, 4.0f };
+		return unit;
+	}
+}
+
+TEST(Reflection, FieldNames)
+{
+	std::vector<std::string> cNames;
+	auto const unit = MakeUnit(0);
+	Reflection::ForEachField(unit, [&cNames](const char* psName, const auto&) { cNames.push_back(psName); });
+	EXPECT_EQ((std::vector<std::string>{ "nFlags", "fHealth", "team", "aPath" }), cNames);
+	EXPECT_STREQ("y", Reflection::GetFieldName<Vec>(1));
+}
+
+TEST(Reflection, Hash)
+{
+	EXPECT_EQ(Reflection::Hash(MakeUnit(0x00)), Reflection::Hash(MakeUnit(0xFF)));
+
+	auto other = MakeUnit(0);
+	other.aPath[1].y = 5.0f;
+	EXPECT_NE(Reflection::Hash(MakeUnit(0)), Reflection::Hash(other));
+
+	// Same as hashing the packed bytes
+	unsigned char aBytes[Reflection::GetPackedSize<Unit>()];
+	Reflection::Write(MakeUnit(0), aBytes);
+	std::uint64_t nHash = 14695981039346656037ull;
+	for (auto const nByte : aBytes)
+	{
+		nHash = (nHash ^ nByte) * 1099511628211ull;
+	}
+	EXPECT_EQ(nHash, Reflection::Hash(MakeUnit(0)));
+}
+
+TEST(Reflection, WriteRead)
+{
+	auto const unit = MakeUnit(0xAB);
+	unsigned char aBytes[Reflection::GetPackedSize<Unit>()];
+	EXPECT_EQ(aBytes + sizeof(aBytes), Reflection::Write(unit, aBytes));
+
+	Unit read = MakeUnit(0);
+	read.nFlags = 0;
+	read.fHealth = 0.0;
+	read.aPath[1].x = 0.0f;
+	EXPECT_EQ(aBytes + sizeof(aBytes), Reflection::Read(read, aBytes));
+	EXPECT_EQ(3, read.nFlags);
+	EXPECT_EQ(50.0, read.fHealth);
+	EXPECT_EQ(Team::Blue, read.team);
+	EXPECT_EQ(3.0f, read.aPath[1].x);
+	EXPECT_EQ(0, read.nNotDescribed);
+}
+
+TEST(Reflection, Diff)
+{
+	auto const unit = MakeUnit(0);
+	EXPECT_EQ(0u, Reflection::Diff(unit, MakeUnit(0xFF)));
+
+	auto changed = MakeUnit(0);
+	changed.fHealth = 10.0;
+	changed.aPath[0].x = -1.0f;
+	auto const nMask = Reflection::Diff(unit, changed);
+	EXPECT_EQ(0b1010u, nMask);
+
+	// Only the changed fields are sent
+	unsigned char aBytes[Reflection::GetPackedSize<Unit>()];
+	auto const pEnd = Reflection::WriteFields(changed, nMask, aBytes);
+	EXPECT_EQ(sizeof(double) + sizeof(Vec) * 2, static_cast<size_t>(pEnd - aBytes));
+
+	auto replica = unit;
+	EXPECT_EQ(pEnd, Reflection::ReadFields(replica, nMask, aBytes));
+	EXPECT_EQ(0u, Reflection::Diff(replica, changed));
+}
+
+TEST(Reflection, ToString)
+{
+	EXPECT_EQ("{ x: 1, y: 2.5 }", Reflection::ToString(Vec{ 1.0f, 2.5f }));
+	EXPECT_EQ("{ nFlags: 3, fHealth: 50, team: <1 bytes>, aPath: [{ x: 1, y: 2 }, { x: 3, y: 4 }] }", Reflection::ToString(MakeUnit(0)));
+}
+
+TEST(Reflection, SoALayout)
+{
+	using Layout = Reflection::SoALayout<Unit>;
+	static_assert(Layout::FieldCount == 4, "");
+	static_assert(std::is_same<Layout::FieldType<3>, Vec[2]>::value, "");
+	static_assert(Layout::GetColumnOffset(0, 10) == 0, "");
+	static_assert(Layout::GetColumnOffset(1, 10) == 16, "");
+	static_assert(Layout::GetColumnOffset(2, 10) == 96, "");
+	static_assert(Layout::GetColumnOffset(3, 10) == 108, "");
+	static_assert(Layout::GetSize(10) == 108 + 160, "");
+
+	alignas(Unit) unsigned char aBlock[Layout::GetSize(10)];
+	for (size_t i = 0; i < 10; ++i)
+	{
+		auto unit = MakeUnit(0);
+		unit.fHealth = static_cast<double>(i);
+		Layout::Store(aBlock, 10, i, unit);
+	}
+
+	auto const pHealth = Layout::GetColumn<1>(aBlock, 10);
+	for (size_t i = 0; i < 10; ++i)
+	{
+		EXPECT_EQ(static_cast<double>(i), pHealth[i]);
+	}
+
+	Unit loaded = MakeUnit(0xFF);
+	Layout::Load(aBlock, 10, 7, loaded);
+	auto expected = MakeUnit(0);
+	expected.fHealth = 7.0;
+	EXPECT_EQ(0u, Reflection::Diff(expected, loaded));
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include "HE_StringId.h"
+
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace HE;
+using namespace std::string_literals;
+
+// Compile-time hashing
+static_assert(HashString(constexpr_string{ "" }) == 14695981039346656037ull, "HE::HashString failed to pass test");
+static_assert(HashString(constexpr_string{ "a" }) == 0xaf63dc4c8601ec8cull, "HE::HashString failed to pass test");
+static_assert(HashString(constexpr_string{ "foobar" }) == 0x85944171f73967e8ull, "HE::HashString failed to pass test");
+static_assert(StringId{ "Player" } == StringId{ "Player" }, "HE::StringId failed to pass test");
+static_assert(StringId{ "Player" } != StringId{ "Enemy" }, "HE::StringId failed to pass test");
+static_assert(StringId{}.IsEmpty(), "HE::StringId failed to pass test");
+static_assert(StringId{ "" }.IsEmpty() && HE_SID("").IsEmpty(), "HE::StringId failed to pass test");
+static_assert(HE_SID("Player").GetHash() == StringId{ "Player" }.GetHash(), "HE_SID failed to pass test");
+
+TEST(StringId, RuntimeMatchesCompileTime)
+{
+	EXPECT_EQ(HashString("foobar"s), HashString(constexpr_string{ "foobar" }));
+	EXPECT_EQ(HE_SID("Assets/Textures/Hazel.png"), StringId::Intern("Assets/Textures/Hazel.png"s));
+}
+
+TEST(StringId, Empty)
+{
+	EXPECT_TRUE(StringId::Intern("").IsEmpty());
+	EXPECT_TRUE(StringId::Intern(""s).IsEmpty());
+	EXPECT_EQ(StringId{}, StringId::Intern(nullptr, 0));
+}
+
+TEST(StringId, FromHash)
+{
+	auto const id = StringId::Intern("FromHashTest");
+	EXPECT_EQ(id, StringId::FromHash(id.GetHash()));
+}
+
+TEST(StringId, Hashable)
+{
+	std::unordered_set<StringId> cIds{ HE_SID("A"), HE_SID("B"), StringId::Intern("A") };
+	EXPECT_EQ(2u, cIds.size());
+}
+
+TEST(StringId, ConcurrentIntern)
+{
+	std::vector<std::thread> cThreads;
+	std::vector<std::vector<StringId>> cResults(4);
+	for (size_t t = 0; t < cResults.size(); ++t)
+	{
+		cThreads.emplace_back([&cResults, t]() {
+			for (int i = 0; i < 1000; ++i)
+			{
+				cResults[t].push_back(StringId::Intern(Format("Entity_{_}", i)));
+			}
+		});
+	}
+	for (auto& thread : cThreads) thread.join();
+
+	for (size_t t = 1; t < cResults.size(); ++t)
+	{
+		EXPECT_EQ(cResults[0], cResults[t]);
+	}
+}
+
+#if HE_STRING_ID_DEBUG
+TEST(StringId, DebugString)
+{
+	// Literals are only known once interned
+	EXPECT_EQ(nullptr, StringId{ "Literal" }.GetDebugString());
+	StringId::Intern("Literal");
+	StringId::Intern("Macro");
+	EXPECT_STREQ("Literal", StringId{ "Literal" }.GetDebugString());
+	EXPECT_STREQ("Macro", HE_SID("Macro").GetDebugString());
+	EXPECT_STREQ("", StringId{}.GetDebugString());
+
+	auto const sRuntime = "Runtime_"s + std::to_string(42);
+	auto const id = StringId::Intern(sRuntime);
+	EXPECT_STREQ("Runtime_42", id.GetDebugString());
+	EXPECT_STREQ("Runtime_42", StringId::FromHash(id.GetHash()).GetDebugString());
+	EXPECT_EQ(nullptr, StringId::FromHash(12345).GetDebugString());
+	EXPECT_EQ("Runtime_42", to_string(id));
+}
+#endif
@@ -65,6 +65,8 @@ TEST(to_string, nested_exception)
 TEST(HE_Format, NoFormat)
 {
 	ASSERT_EQ("Hello", Format("Hello"));
+	// Without arguments, literals are not parsed either
+	ASSERT_EQ("Hello {0}", Format("Hello {0}"));
 }
 
 TEST(HE_Format, SimpleString)
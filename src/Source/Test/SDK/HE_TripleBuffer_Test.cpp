@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include "HE_TripleBuffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+using namespace HE;
+
+TEST(TripleBuffer, PublishAndAcquire)
+{
+	TripleBuffer<int> buffer{ -1 };
+	EXPECT_FALSE(buffer.Acquire());
+	EXPECT_EQ(-1, buffer.GetFront());
+
+	buffer.GetBack() = 1;
+	buffer.Publish();
+	buffer.GetBack() = 2;
+	buffer.Publish();
+
+	// Only the latest
+	EXPECT_TRUE(buffer.Acquire());
+	EXPECT_EQ(2, buffer.GetFront());
+	EXPECT_FALSE(buffer.Acquire());
+	EXPECT_EQ(2, buffer.GetFront());
+
+	// The writer never gets the front buffer
+	for (int i = 3; i < 10; ++i)
+	{
+		EXPECT_NE(&buffer.GetFront(), &buffer.GetBack());
+		buffer.GetBack() = i;
+		buffer.Publish();
+	}
+	EXPECT_TRUE(buffer.Acquire());
+	EXPECT_EQ(9, buffer.GetFront());
+}
+
+TEST(TripleBuffer, Concurrent)
+{
+	// Each published buffer is consistent: its values all come from the same Publish
+	struct Values
+	{
+		std::uint64_t a, b;
+	};
+
+	TripleBuffer<Values> buffer;
+	std::atomic<bool> bDone{ false };
+	std::thread writer{ [&buffer, &bDone]() {
+		for (std::uint64_t i = 1; i <= 100000; ++i)
+		{
+			auto& values = buffer.GetBack();
+			values.a = i;
+			values.b = i * 3;
+			buffer.Publish();
+		}
+		bDone = true;
+	} };
+
+	std::uint64_t nLast = 0;
+	bool bConsistent = true;
+	bool bWriterDone = false;
+	while (!bWriterDone)
+	{
+		// Done before the last Acquire, so that the last Publish is acquired
+		bWriterDone = bDone;
+		if (!buffer.Acquire()) continue;
+
+		auto const& values = buffer.GetFront();
+		bConsistent = bConsistent && values.a * 3 == values.b && nLast < values.a;
+		nLast = values.a;
+	}
+	writer.join();
+	EXPECT_TRUE(bConsistent);
+	EXPECT_EQ(100000u, nLast);
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include "HE_WorkStealingDeque.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace HE;
+
+TEST(WorkStealingDeque, OwnerIsLifo)
+{
+	WorkStealingDeque<int> deque{ 4 };
+	int a[3];
+	EXPECT_TRUE(deque.Push(&a[0]));
+	EXPECT_TRUE(deque.Push(&a[1]));
+	EXPECT_TRUE(deque.Push(&a[2]));
+	EXPECT_EQ(&a[2], deque.Pop());
+	EXPECT_EQ(&a[1], deque.Pop());
+	EXPECT_EQ(&a[0], deque.Pop());
+	EXPECT_EQ(nullptr, deque.Pop());
+	EXPECT_TRUE(deque.IsEmpty());
+}
+
+TEST(WorkStealingDeque, ThiefIsFifo)
+{
+	WorkStealingDeque<int> deque{ 4 };
+	int a[2];
+	deque.Push(&a[0]);
+	deque.Push(&a[1]);
+	EXPECT_EQ(&a[0], deque.Steal());
+	EXPECT_EQ(&a[1], deque.Steal());
+	EXPECT_EQ(nullptr, deque.Steal());
+}
+
+TEST(WorkStealingDeque, Full)
+{
+	WorkStealingDeque<int> deque{ 2 };
+	int a[3];
+	EXPECT_TRUE(deque.Push(&a[0]));
+	EXPECT_TRUE(deque.Push(&a[1]));
+	EXPECT_FALSE(deque.Push(&a[2]));
+	EXPECT_EQ(&a[0], deque.Steal());
+	EXPECT_TRUE(deque.Push(&a[2]));
+}
+
+TEST(WorkStealingDeque, ConcurrentSteal)
+{
+	// Every item must be taken exactly once, by the owner or a thief
+	constexpr int ItemCount = 100000;
+	std::vector<int> cItems(ItemCount, 0);
+	std::vector<std::atomic<int>> cTaken(ItemCount);
+	for (auto& n : cTaken) n = 0;
+
+	WorkStealingDeque<int> deque{ 1024 };
+	std::atomic<bool> bDone{ false };
+
+	std::vector<std::thread> cThieves;
+	for (int t = 0; t < 3; ++t)
+	{
+		cThieves.emplace_back([&]() {
+			while (!bDone)
+			{
+				if (auto const p = deque.Steal()) ++cTaken[p - cItems.data()];
+			}
+		});
+	}
+
+	for (int i = 0; i < ItemCount; ++i)
+	{
+		while (!deque.Push(&cItems[i]))
+		{
+			if (auto const p = deque.Pop()) ++cTaken[p - cItems.data()];
+		}
+		if (i % 3 == 0)
+		{
+			if (auto const p = deque.Pop()) ++cTaken[p - cItems.data()];
+		}
+	}
+	while (auto const p = deque.Pop()) ++cTaken[p - cItems.data()];
+
+	bDone = true;
+	for (auto& thief : cThieves) thief.join();
+
+	for (int i = 0; i < ItemCount; ++i)
+	{
+		ASSERT_EQ(1, cTaken[i].load()) << "Item " << i;
+	}
+}
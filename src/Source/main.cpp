@@ -1,6 +1,9 @@
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
 #include <gsl.h>
 
 #include "HE_String.h"
@@ -89,9 +92,18 @@ namespace
 int main(int const argc, char const* const argv[])
 {
 	CmdArgs const args{ gsl::as_span( argv, argc ) };
+	std::vector<std::string> const engineArgs(argv + 1, argv + argc);
 
 	try
 	{
+		if (HE::ParseEngineSettings(engineArgs).bHeadless)
+		{
+			// No view, no Vulkan: the Engine simulates until it stops, ex: after --max-ticks
+			HE::Engine engine{ engineArgs };
+			engine.Run().get();
+			return 0;
+		}
+
 		vk::ApplicationInfo const applicationInfo{ "VulkanTest", 0x1, "HazelEngine", HE::MakeVersion(0, 0, 1), VK_MAKE_VERSION(1, 0, 4) };
 		auto const instanceCreateInfo = vk::InstanceCreateInfo{}
 			.pApplicationInfo(&applicationInfo);
@@ -152,6 +164,11 @@ int main(int const argc, char const* const argv[])
 		HE::LogError(to_string(e));
 		return -1;
 	}
+	catch (const std::invalid_argument& e)
+	{
+		HE::LogError(to_string(e));
+		return -1;
+	}
 	
 	return 0;
 }
\ No newline at end of file